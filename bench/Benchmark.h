@@ -0,0 +1,98 @@
+/**
+ * @file Benchmark.h
+ * @brief Small helpers shared by the benchmark programs.
+ */
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace i2pcpp {
+    namespace Bench {
+        typedef std::chrono::steady_clock Clock;
+
+        /**
+         * @return the current time on the monotonic clock, in nanoseconds
+         */
+        inline uint64_t now()
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+        }
+
+        /**
+         * Collects samples (e.g. latencies in nanoseconds) and computes
+         *  percentiles over them.
+         */
+        class Samples {
+            public:
+                void add(uint64_t v)
+                {
+                    m_samples.push_back(v);
+                    m_sorted = false;
+                }
+
+                size_t size() const
+                {
+                    return m_samples.size();
+                }
+
+                /**
+                 * @param p the percentile, between 0 and 100
+                 * @return the sample at percentile \a p (nearest rank), or 0
+                 *  if there are no samples
+                 */
+                uint64_t percentile(double p)
+                {
+                    if(m_samples.empty())
+                        return 0;
+
+                    sort();
+
+                    size_t rank = (size_t)((p / 100.0) * (m_samples.size() - 1) + 0.5);
+                    return m_samples[std::min(rank, m_samples.size() - 1)];
+                }
+
+                uint64_t max()
+                {
+                    if(m_samples.empty())
+                        return 0;
+
+                    sort();
+
+                    return m_samples.back();
+                }
+
+            private:
+                void sort()
+                {
+                    if(!m_sorted) {
+                        std::sort(m_samples.begin(), m_samples.end());
+                        m_sorted = true;
+                    }
+                }
+
+                std::vector<uint64_t> m_samples;
+                bool m_sorted = true;
+        };
+
+        /**
+         * Prints a "name: value unit" line with aligned columns.
+         */
+        template<typename T>
+        void report(std::string const &name, T const &value, std::string const &unit = "")
+        {
+            std::cout << std::left << std::setw(28) << name << std::right << std::setw(16) << value;
+            if(unit.size())
+                std::cout << ' ' << unit;
+            std::cout << std::endl;
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,155 @@
+/**
+ * @file BuildRecords.cpp
+ * @brief Measures the latency of forwarding a tunnel build message through
+ *  a participating hop, without the ElGamal decryption of our own record.
+ *
+ * A hop parses the message, finds its record, replaces it with its reply,
+ *  AES encrypts all records and serializes them for the next hop. This is
+ *  done once with a list of i2pcpp::BuildRecord objects, as the records were
+ *  handled before, and once in place with an i2pcpp::BuildRecordBlock.
+ */
+#include "Benchmark.h"
+
+#include <i2pcpp/datatypes/BuildRecordBlock.h>
+
+#include <botan/auto_rng.h>
+
+#include <boost/program_options.hpp>
+
+#include <algorithm>
+#include <list>
+
+using namespace i2pcpp;
+
+namespace {
+    void report(std::string const &name, uint32_t iterations, double elapsed, Bench::Samples &latency)
+    {
+        std::cout << name << std::endl;
+        Bench::report("  messages/s", iterations / elapsed);
+        Bench::report("  latency p50", latency.percentile(50) / 1000.0, "us");
+        Bench::report("  latency p99", latency.percentile(99) / 1000.0, "us");
+        Bench::report("  latency max", latency.max() / 1000.0, "us");
+    }
+
+    ByteArray forwardList(ByteArray const &msg, StaticByteArray<16> const &header, BuildRecord const &reply, StaticByteArray<16> const &iv, SessionKey const &key)
+    {
+        auto begin = msg.cbegin();
+        const unsigned char count = *begin++;
+
+        std::list<BuildRecordPtr> records;
+        for(unsigned char i = 0; i < count; i++)
+            records.push_back(std::make_shared<BuildRecord>(begin, msg.cend()));
+
+        auto itr = std::find_if(records.begin(), records.end(), [&header](BuildRecordPtr const &r) { return header == r->getHeader(); });
+        *itr = std::make_shared<BuildRecord>(reply);
+
+        for(auto& r: records)
+            r->encrypt(iv, key);
+
+        ByteArray b;
+        b.push_back(records.size());
+        for(auto& r: records) {
+            const ByteArray rb = r->serialize();
+            b.insert(b.end(), rb.cbegin(), rb.cend());
+        }
+
+        return b;
+    }
+
+    ByteArray forwardBlock(ByteArray const &msg, StaticByteArray<16> const &header, BuildRecord const &reply, StaticByteArray<16> const &iv, SessionKey const &key)
+    {
+        auto begin = msg.cbegin();
+        BuildRecordBlock records(begin, msg.cend());
+
+        records.set(records.find(header), reply);
+        records.encrypt(iv, key);
+
+        return records.serialize();
+    }
+}
+
+int main(int argc, char **argv)
+{
+    namespace po = boost::program_options;
+
+    uint32_t iterations, numRecords;
+
+    po::options_description desc("Options");
+    desc.add_options()
+        ("help,h", "Produce this help message")
+        ("iterations,n", po::value<uint32_t>(&iterations)->default_value(20000), "Number of messages to forward")
+        ("records,r", po::value<uint32_t>(&numRecords)->default_value(8), "Number of records per message");
+
+    po::variables_map vm;
+    try {
+        po::store(po::parse_command_line(argc, argv, desc), vm);
+        po::notify(vm);
+    } catch(po::error &e) {
+        std::cerr << "error parsing command line arguments: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if(vm.count("help")) {
+        std::cout << desc << std::endl;
+        return EXIT_SUCCESS;
+    }
+
+    if(!numRecords || numRecords > 255) {
+        std::cerr << "the number of records must be between 1 and 255" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    Botan::AutoSeeded_RNG rng;
+
+    ByteArray msg(1 + numRecords * BuildRecordBlock::RECORD_SIZE);
+    msg[0] = numRecords;
+    rng.randomize(msg.data() + 1, msg.size() - 1);
+
+    // Our record is the last one, so finding it walks all of them.
+    StaticByteArray<16> header;
+    std::copy(msg.cend() - BuildRecordBlock::RECORD_SIZE, msg.cend() - BuildRecordBlock::RECORD_SIZE + 16, header.begin());
+
+    ByteArray replyBytes(BuildRecordBlock::RECORD_SIZE);
+    rng.randomize(replyBytes.data(), replyBytes.size());
+    auto replyItr = replyBytes.cbegin();
+    const BuildRecord reply(replyItr, replyBytes.cend());
+
+    StaticByteArray<16> iv;
+    rng.randomize(iv.data(), iv.size());
+    SessionKey key;
+    rng.randomize(key.data(), key.size());
+
+    if(forwardList(msg, header, reply, iv, key) != forwardBlock(msg, header, reply, iv, key)) {
+        std::cerr << "the two forward paths disagree" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    Bench::report("messages", iterations);
+    Bench::report("records", numRecords);
+
+    typedef ByteArray (*ForwardFn)(ByteArray const &, StaticByteArray<16> const &, BuildRecord const &, StaticByteArray<16> const &, SessionKey const &);
+    const std::vector<std::pair<std::string, ForwardFn>> paths = {
+        { "record list", forwardList },
+        { "record block", forwardBlock }
+    };
+
+    for(auto& p: paths) {
+        Bench::Samples latency;
+        size_t sink = 0;
+        const uint64_t start = Bench::now();
+
+        for(uint32_t i = 0; i < iterations; i++) {
+            const uint64_t begin = Bench::now();
+            sink += p.second(msg, header, reply, iv, key).size();
+            latency.add(Bench::now() - begin);
+        }
+
+        const double elapsed = (Bench::now() - start) / 1e9;
+        if(sink != (size_t)iterations * msg.size())
+            return EXIT_FAILURE;
+
+        report(p.first, iterations, elapsed, latency);
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,465 @@
+/**
+ * @file Primitives.cpp
+ * @brief Microbenchmarks of the datatype serialization and cryptographic
+ *  primitives on the message path.
+ *
+ * Each benchmark runs its operation in batches, sized so that a batch takes
+ *  at least a millisecond, until the minimum time has passed. The cost of
+ *  an operation is reported per batch, as percentiles over the batches.
+ *  With --json the results are also written as a JSON document, so that
+ *  runs at different commits can be compared by a script.
+ */
+#include "Benchmark.h"
+
+#include "tunnel/Message.h"
+#include "dht/Kademlia.h"
+#include "Packet.h"
+
+#include <i2pcpp/datatypes/BuildRecord.h>
+#include <i2pcpp/datatypes/Mapping.h>
+#include <i2pcpp/datatypes/RouterIdentity.h>
+#include <i2pcpp/datatypes/RouterInfo.h>
+
+#include <i2pcpp/util/Base64.h>
+#include <i2pcpp/util/ElGamal.h>
+#include <i2pcpp/util/Random.h>
+#include <i2pcpp/util/gzip.h>
+
+#include <botan/auto_rng.h>
+#include <botan/dl_group.h>
+#include <botan/elgamal.h>
+#include <botan/pipe.h>
+#include <botan/pubkey.h>
+
+#include <boost/program_options.hpp>
+
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <list>
+#include <memory>
+#include <sstream>
+
+#include "SampleRI.inc"
+
+using namespace i2pcpp;
+
+namespace {
+    struct Result {
+        std::string name;
+        uint64_t operations;
+        double perSecond;
+
+        /// Nanoseconds per operation
+        uint64_t min, p50, p99;
+    };
+
+    /**
+     * Runs the benchmarks whose name contains the filter and keeps their
+     *  results.
+     */
+    class Suite {
+        public:
+            /**
+             * @param minTime the time to spend on each benchmark, in
+             *  milliseconds, not counting the calibration
+             */
+            Suite(uint32_t minTime, std::string const &filter, bool quiet) :
+                m_minTime(minTime * 1000000ULL),
+                m_filter(filter),
+                m_quiet(quiet) {}
+
+            /**
+             * @param items the number of operations done by one call of
+             *  \a op, costs are reported per operation
+             */
+            void run(std::string const &name, std::function<void()> const &op, uint32_t items = 1)
+            {
+                if(name.find(m_filter) == std::string::npos)
+                    return;
+
+                // This also warms the caches and the allocator up.
+                uint64_t batch = 1;
+                while(time(op, batch) < BATCH_TIME && batch < (1ULL << 30))
+                    batch *= 2;
+
+                Bench::Samples cost;
+                uint64_t elapsed = 0;
+                while(elapsed < m_minTime || cost.size() < MIN_BATCHES) {
+                    const uint64_t t = time(op, batch);
+                    cost.add(t / (batch * items));
+                    elapsed += t;
+                }
+
+                Result r;
+                r.name = name;
+                r.operations = cost.size() * batch * items;
+                r.perSecond = r.operations / (elapsed / 1e9);
+                r.min = cost.percentile(0);
+                r.p50 = cost.percentile(50);
+                r.p99 = cost.percentile(99);
+                m_results.push_back(r);
+
+                if(!m_quiet) {
+                    std::cout << name << std::endl;
+                    Bench::report("  operations/s", r.perSecond);
+                    Bench::report("  cost p50", r.p50, "ns");
+                    Bench::report("  cost p99", r.p99, "ns");
+                }
+            }
+
+            std::vector<Result> const &getResults() const
+            {
+                return m_results;
+            }
+
+        private:
+            static uint64_t time(std::function<void()> const &op, uint64_t batch)
+            {
+                const uint64_t begin = Bench::now();
+                for(uint64_t i = 0; i < batch; i++)
+                    op();
+
+                return Bench::now() - begin;
+            }
+
+            /// The least time a batch should take, in nanoseconds
+            static const uint64_t BATCH_TIME = 1000000;
+
+            static const size_t MIN_BATCHES = 10;
+
+            uint64_t m_minTime;
+            std::string m_filter;
+            bool m_quiet;
+            std::vector<Result> m_results;
+    };
+
+    std::string quote(std::string const &s)
+    {
+        std::ostringstream os;
+        os << '"';
+        for(char c: s) {
+            if(c == '"' || c == '\\')
+                os << '\\' << c;
+            else if((unsigned char)c < 0x20)
+                os << "\\u" << std::hex << std::setw(4) << std::setfill('0') << (int)c << std::dec << std::setfill(' ');
+            else
+                os << c;
+        }
+        os << '"';
+
+        return os.str();
+    }
+
+    /**
+     * Writes {"label": ..., "time": ..., "benchmarks": [{"name": ...,
+     *  "operations": ..., "per_second": ..., "ns": {"min": ..., "p50":
+     *  ..., "p99": ...}}, ...]}, "time" being seconds since the epoch.
+     */
+    void writeJSON(std::ostream &os, std::string const &label, std::vector<Result> const &results)
+    {
+        os << "{\n";
+        os << "  \"label\": " << quote(label) << ",\n";
+        os << "  \"time\": " << std::time(nullptr) << ",\n";
+        os << "  \"benchmarks\": [\n";
+
+        for(size_t i = 0; i < results.size(); i++) {
+            Result const &r = results[i];
+            os << "    {\"name\": " << quote(r.name)
+               << ", \"operations\": " << r.operations
+               << ", \"per_second\": " << std::fixed << std::setprecision(1) << r.perSecond
+               << ", \"ns\": {\"min\": " << r.min << ", \"p50\": " << r.p50 << ", \"p99\": " << r.p99 << "}}"
+               << (i + 1 < results.size() ? ",\n" : "\n");
+        }
+
+        os << "  ]\n";
+        os << "}\n";
+    }
+
+    ByteArray gzip(ByteArray const &data)
+    {
+        Botan::Pipe gzPipe(new Gzip_Compression);
+        gzPipe.start_msg();
+        gzPipe.write(data);
+        gzPipe.end_msg();
+
+        ByteArray b(gzPipe.remaining());
+        gzPipe.read(b.data(), b.size());
+
+        return b;
+    }
+
+    ByteArray gunzip(ByteArray const &data)
+    {
+        Botan::Pipe ungzPipe(new Gzip_Decompression);
+        ungzPipe.start_msg();
+        ungzPipe.write(data);
+        ungzPipe.end_msg();
+
+        ByteArray b(ungzPipe.remaining());
+        ungzPipe.read(b.data(), b.size());
+
+        return b;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    namespace po = boost::program_options;
+
+    uint32_t minTime, packetSize, messageSize, numPeers;
+    std::string filter, json, label;
+
+    po::options_description desc("Options");
+    desc.add_options()
+        ("help,h", "Produce this help message")
+        ("min-time,t", po::value<uint32_t>(&minTime)->default_value(500), "Milliseconds to spend on each benchmark")
+        ("filter,f", po::value<std::string>(&filter)->default_value(""), "Only run the benchmarks whose name contains this")
+        ("json,j", po::value<std::string>(&json), "Write the results as JSON to this file, - for standard output")
+        ("label,l", po::value<std::string>(&label)->default_value(""), "Label for the JSON results, such as a commit hash")
+        ("packet-size", po::value<uint32_t>(&packetSize)->default_value(1024), "Payload bytes in an SSU packet")
+        ("message-size", po::value<uint32_t>(&messageSize)->default_value(900), "Payload bytes in a tunnel message")
+        ("peers,p", po::value<uint32_t>(&numPeers)->default_value(5000), "Number of peers in the Kademlia table");
+
+    po::variables_map vm;
+    try {
+        po::store(po::parse_command_line(argc, argv, desc), vm);
+        po::notify(vm);
+    } catch(po::error &e) {
+        std::cerr << "error parsing command line arguments: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if(vm.count("help")) {
+        std::cout << desc << std::endl;
+        return EXIT_SUCCESS;
+    }
+
+    if(!packetSize || !numPeers) {
+        std::cerr << "the packet size and the number of peers must be positive" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if(!messageSize || messageSize > 1003 - 3) {
+        std::cerr << "the message must fit in a single unfragmented tunnel message" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    Suite suite(minTime, filter, json == "-");
+    Botan::AutoSeeded_RNG rng;
+
+    try {
+        /* Datatypes */
+        auto riItr = sample_routerInfo.cbegin();
+        const RouterInfo ri(riItr, sample_routerInfo.cend());
+        const ByteArray identityBytes = ri.getIdentity().serialize();
+        const ByteArray mappingBytes = ri.getOptions().serialize();
+
+        if(ri.serialize() != sample_routerInfo || !ri.verifySignature()) {
+            std::cerr << "the sample RouterInfo does not round trip" << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        suite.run("RouterInfo parse", [&]() {
+            auto begin = sample_routerInfo.cbegin();
+            RouterInfo r(begin, sample_routerInfo.cend());
+        });
+
+        suite.run("RouterInfo serialize", [&]() {
+            ri.serialize();
+        });
+
+        suite.run("RouterInfo::verifySignature", [&]() {
+            ri.verifySignature();
+        });
+
+        suite.run("RouterIdentity parse", [&]() {
+            auto begin = identityBytes.cbegin();
+            RouterIdentity r(begin, identityBytes.cend());
+        });
+
+        suite.run("RouterIdentity serialize", [&]() {
+            ri.getIdentity().serialize();
+        });
+
+        suite.run("Mapping parse", [&]() {
+            auto begin = mappingBytes.cbegin();
+            Mapping m(begin, mappingBytes.cend());
+        });
+
+        suite.run("Mapping serialize", [&]() {
+            ri.getOptions().serialize();
+        });
+
+        /* Base64, over a RouterInfo as it is kept in the database */
+        ByteArray riBytes = sample_routerInfo;
+        const std::string riBase64 = Base64::encode(riBytes.data(), riBytes.size());
+
+        suite.run("Base64::encode", [&]() {
+            Base64::encode(riBytes.data(), riBytes.size());
+        });
+
+        suite.run("Base64::decode", [&]() {
+            Base64::decode(riBase64);
+        });
+
+        /* gzip, as for a RouterInfo in a DatabaseStore */
+        const ByteArray riGzipped = gzip(sample_routerInfo);
+        if(gunzip(riGzipped) != sample_routerInfo) {
+            std::cerr << "gzip does not round trip" << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        suite.run("gzip compress", [&]() {
+            gzip(sample_routerInfo);
+        });
+
+        suite.run("gzip decompress", [&]() {
+            gunzip(riGzipped);
+        });
+
+        /* SSU packets */
+        const Endpoint ep("127.0.0.1", 0);
+        SessionKey sessionKey, macKey;
+        rng.randomize(sessionKey.data(), sessionKey.size());
+        rng.randomize(macKey.data(), macKey.size());
+
+        ByteArray payload(packetSize);
+        rng.randomize(payload.data(), payload.size());
+        const SSU::Packet plainPacket(ep, payload.data(), payload.size());
+
+        SSU::Packet encryptedPacket = plainPacket;
+        encryptedPacket.encrypt(sessionKey, macKey);
+
+        SSU::Packet decryptedPacket = encryptedPacket;
+        if(!decryptedPacket.verify(macKey)) {
+            std::cerr << "the SSU packet does not verify" << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        decryptedPacket.decrypt(sessionKey);
+        if(!std::equal(payload.cbegin(), payload.cend(), decryptedPacket.getData().cbegin())) {
+            std::cerr << "the SSU packet does not round trip" << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        suite.run("SSU::Packet::encrypt", [&]() {
+            SSU::Packet p = plainPacket;
+            p.encrypt(sessionKey, macKey);
+        });
+
+        suite.run("SSU::Packet::verify", [&]() {
+            encryptedPacket.verify(macKey);
+        });
+
+        suite.run("SSU::Packet::decrypt", [&]() {
+            SSU::Packet p = encryptedPacket;
+            p.decrypt(sessionKey);
+        });
+
+        /* Tunnel messages */
+        ByteArray messageData(messageSize);
+        rng.randomize(messageData.data(), messageData.size());
+
+        std::list<Tunnel::FragmentPtr> fragments;
+        for(auto& f: Tunnel::Fragment::fragmentMessage(messageData))
+            fragments.push_back(std::move(f));
+
+        Tunnel::Message outbound(fragments);
+        outbound.compile();
+
+        const Tunnel::Message inbound(outbound.getEncryptedData());
+        const std::vector<Tunnel::FragmentView> views = inbound.parse();
+        if(views.size() != 1 || views.front().size != messageData.size()) {
+            std::cerr << "the tunnel message does not round trip" << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        const Botan::SymmetricKey ivKey(rng, 32);
+        const Botan::SymmetricKey layerKey(rng, 32);
+
+        // Each call adds a layer, as every hop of an outbound tunnel does.
+        suite.run("Tunnel::Message::encrypt", [&]() {
+            outbound.encrypt(ivKey, layerKey);
+        });
+
+        suite.run("Tunnel::Message::parse", [&]() {
+            inbound.parse();
+        });
+
+        /* Build records */
+        {
+            const Botan::ElGamal_PrivateKey elgKey(rng, Botan::DL_Group("modp/ietf/2048"));
+            const ByteArray encryptionKey = Botan::BigInt::encode(elgKey.get_y());
+            const Botan::PK_Decryptor_EME decryptor(elgKey, "Raw");
+            const ElGamal::Ephemeral ephemeral = ElGamal::generate(rng);
+
+            ByteArray recordBytes(528);
+            rng.randomize(recordBytes.data(), recordBytes.size());
+            auto recordItr = recordBytes.cbegin();
+            const BuildRecord plainRecord(recordItr, recordBytes.cend());
+
+            BuildRecord encryptedRecord = plainRecord;
+            encryptedRecord.encrypt(encryptionKey);
+
+            BuildRecord decryptedRecord = encryptedRecord;
+            decryptedRecord.decrypt(decryptor);
+
+            suite.run("BuildRecord::encrypt", [&]() {
+                BuildRecord r = plainRecord;
+                r.encrypt(encryptionKey);
+            });
+
+            // With the ephemeral key precomputed, as by the BuildPreparer
+            suite.run("BuildRecord::encrypt pooled", [&]() {
+                BuildRecord r = plainRecord;
+                r.encrypt(encryptionKey, ephemeral);
+            });
+
+            suite.run("BuildRecord::decrypt", [&]() {
+                BuildRecord r = encryptedRecord;
+                r.decrypt(decryptor);
+            });
+        }
+
+        /* Kademlia */
+        DHT::Kademlia::key_type reference;
+        rng.randomize(reference.data(), reference.size());
+
+        std::vector<DHT::Kademlia::key_type> keys(numPeers);
+        for(auto& k: keys)
+            rng.randomize(k.data(), k.size());
+
+        suite.run("Kademlia::insert", [&]() {
+            DHT::Kademlia table(reference);
+            for(auto& k: keys)
+                table.insert(k, k);
+        }, numPeers);
+
+        DHT::Kademlia table(reference);
+        for(auto& k: keys)
+            table.insert(k, k);
+
+        size_t next = 0;
+        suite.run("Kademlia::find", [&]() {
+            table.find(keys[next++ % keys.size()], K_VALUE);
+        });
+    } catch(std::exception &e) {
+        std::cerr << "error: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if(json == "-") {
+        writeJSON(std::cout, label, suite.getResults());
+    } else if(json.size()) {
+        std::ofstream f(json);
+        writeJSON(f, label, suite.getResults());
+
+        if(!f) {
+            std::cerr << "error writing " << json << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,422 @@
+/**
+ * @file SSULoopback.cpp
+ * @brief Runs several i2pcpp::SSU::SSU transports on the loopback interface
+ *  and measures how well messages are delivered between them.
+ *
+ * Every pair of transports talks through a UDP relay which can drop,
+ *  delay, reorder and rate limit packets, so the transport can be measured
+ *  under loss without the live network.
+ */
+#include "Benchmark.h"
+
+#include <i2pcpp/Log.h>
+
+#include <i2pcpp/transports/SSU.h>
+
+#include <i2pcpp/datatypes/Endpoint.h>
+#include <i2pcpp/datatypes/RouterInfo.h>
+#include <i2pcpp/datatypes/RouterIdentity.h>
+
+#include <i2pcpp/util/I2PDH.h>
+
+#include <botan/auto_rng.h>
+#include <botan/dl_group.h>
+#include <botan/dsa.h>
+#include <botan/elgamal.h>
+
+#include <boost/asio.hpp>
+#include <boost/bind.hpp>
+#include <boost/log/core.hpp>
+#include <boost/log/expressions.hpp>
+#include <boost/program_options.hpp>
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <random>
+#include <thread>
+
+using namespace i2pcpp;
+using boost::asio::ip::udp;
+
+namespace {
+    /**
+     * Impairments applied by a Link, in each direction.
+     */
+    struct LinkOptions {
+        double loss = 0.0; ///< Probability of dropping a packet
+        double reorder = 0.0; ///< Probability of holding a packet back
+        uint32_t delay = 0; ///< One way delay, in microseconds
+        uint32_t jitter = 0; ///< Uniformly distributed extra delay, in microseconds
+        uint64_t bandwidth = 0; ///< Bytes per second, 0 for unlimited
+    };
+
+    /**
+     * A UDP relay standing in for the network between two transports A
+     *  and B. A sends to the near socket, which it knows as B's address,
+     *  and the relay forwards the packet to B out of the far socket. B
+     *  therefore sees A at the far socket, and its replies travel back the
+     *  same way.
+     */
+    class Link {
+        public:
+            Link(boost::asio::io_service &ios, LinkOptions const &opts, udp::endpoint const &a, udp::endpoint const &b, unsigned int seed) :
+                m_ios(ios),
+                m_opts(opts),
+                m_near(ios, udp::endpoint(boost::asio::ip::address_v4::loopback(), 0)),
+                m_far(ios, udp::endpoint(boost::asio::ip::address_v4::loopback(), 0)),
+                m_forward(m_near, m_far, b),
+                m_backward(m_far, m_near, a),
+                m_rng(seed)
+            {
+                receive(m_forward);
+                receive(m_backward);
+            }
+
+            Link(const Link &) = delete;
+            Link& operator=(Link &) = delete;
+
+            uint16_t getNearPort() const
+            {
+                return m_near.local_endpoint().port();
+            }
+
+            uint64_t getForwarded() const
+            {
+                return m_forwarded;
+            }
+
+            uint64_t getDropped() const
+            {
+                return m_dropped;
+            }
+
+        private:
+            struct Direction {
+                Direction(udp::socket &i, udp::socket &o, udp::endpoint const &t) :
+                    in(i),
+                    out(o),
+                    to(t) {}
+
+                udp::socket &in;
+                udp::socket &out;
+                udp::endpoint to;
+                udp::endpoint from;
+                std::array<unsigned char, 2048> buf;
+
+                /// When the simulated wire is free again, in nanoseconds
+                uint64_t nextFree = 0;
+            };
+
+            void receive(Direction &d)
+            {
+                d.in.async_receive_from(boost::asio::buffer(d.buf), d.from,
+                        boost::bind(&Link::received, this, boost::ref(d), boost::asio::placeholders::error, boost::asio::placeholders::bytes_transferred));
+            }
+
+            void received(Direction &d, const boost::system::error_code &e, size_t n)
+            {
+                if(e) return;
+
+                std::uniform_real_distribution<double> chance(0.0, 1.0);
+
+                if(chance(m_rng) < m_opts.loss) {
+                    ++m_dropped;
+                    receive(d);
+                    return;
+                }
+
+                uint64_t delay = m_opts.delay;
+
+                if(m_opts.jitter)
+                    delay += std::uniform_int_distribution<uint32_t>(0, m_opts.jitter)(m_rng);
+
+                if(m_opts.reorder > 0.0 && chance(m_rng) < m_opts.reorder)
+                    delay += std::max<uint64_t>(m_opts.delay, 1000);
+
+                if(m_opts.bandwidth) {
+                    const uint64_t now = Bench::now();
+                    d.nextFree = std::max(d.nextFree, now) + (n * 1000000000ULL) / m_opts.bandwidth;
+                    delay += (d.nextFree - now) / 1000;
+                }
+
+                ++m_forwarded;
+
+                if(!delay) {
+                    boost::system::error_code ignored;
+                    d.out.send_to(boost::asio::buffer(d.buf.data(), n), d.to, 0, ignored);
+                } else {
+                    auto data = std::make_shared<std::vector<unsigned char>>(d.buf.begin(), d.buf.begin() + n);
+                    auto timer = std::make_shared<boost::asio::deadline_timer>(m_ios, boost::posix_time::microseconds(delay));
+                    udp::socket &out = d.out;
+                    udp::endpoint to = d.to;
+
+                    timer->async_wait([timer, data, &out, to](const boost::system::error_code &e) {
+                        if(e) return;
+
+                        boost::system::error_code ignored;
+                        out.send_to(boost::asio::buffer(*data), to, 0, ignored);
+                    });
+                }
+
+                receive(d);
+            }
+
+            boost::asio::io_service &m_ios;
+            LinkOptions m_opts;
+
+            udp::socket m_near;
+            udp::socket m_far;
+
+            Direction m_forward;
+            Direction m_backward;
+
+            std::mt19937 m_rng;
+
+            std::atomic<uint64_t> m_forwarded{0};
+            std::atomic<uint64_t> m_dropped{0};
+    };
+
+    /**
+     * One transport with a freshly generated identity.
+     */
+    struct Node {
+        Node(Botan::RandomNumberGenerator &rng, uint16_t port) :
+            endpoint("127.0.0.1", port)
+        {
+            Botan::ElGamal_PrivateKey elgKey(rng, Botan::DL_Group("modp/ietf/2048"));
+            dsaKey = std::make_shared<Botan::DSA_PrivateKey>(rng, DH::getGroup());
+
+            ByteArray elgPubKeyBytes = Botan::BigInt::encode(elgKey.get_y());
+            ByteArray dsaPubKeyBytes = Botan::BigInt::encode(dsaKey->get_y());
+            identity = std::make_shared<RouterIdentity>(elgPubKeyBytes, dsaPubKeyBytes, Certificate());
+
+            transport = std::make_shared<SSU::SSU>(dsaKey, *identity);
+        }
+
+        Endpoint endpoint;
+        std::shared_ptr<Botan::DSA_PrivateKey> dsaKey;
+        std::shared_ptr<RouterIdentity> identity;
+        std::shared_ptr<SSU::SSU> transport;
+    };
+
+    /**
+     * Collects deliveries from all transports.
+     */
+    struct Collector {
+        void established(const RouterHash, bool)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ++numEstablished;
+            cv.notify_all();
+        }
+
+        void received(const RouterHash, const uint32_t, const ByteArray data)
+        {
+            const uint64_t now = Bench::now();
+
+            uint64_t sentAt;
+            if(data.size() < sizeof(sentAt))
+                return;
+            memcpy(&sentAt, data.data(), sizeof(sentAt));
+
+            std::lock_guard<std::mutex> lock(mutex);
+            latency.add(now - sentAt);
+            ++numReceived;
+            lastReceived = now;
+            cv.notify_all();
+        }
+
+        std::mutex mutex;
+        std::condition_variable cv;
+
+        uint64_t numEstablished = 0;
+        uint64_t numReceived = 0;
+        uint64_t lastReceived = 0;
+        Bench::Samples latency;
+    };
+}
+
+int main(int argc, char **argv)
+{
+    namespace po = boost::program_options;
+
+    uint32_t numNodes, numMessages, size, window, timeout;
+    uint16_t basePort;
+    LinkOptions opts;
+
+    po::options_description desc("Options");
+    desc.add_options()
+        ("help,h", "Produce this help message")
+        ("nodes,n", po::value<uint32_t>(&numNodes)->default_value(4), "Number of transports")
+        ("messages,m", po::value<uint32_t>(&numMessages)->default_value(1000), "Messages sent from each transport to each other transport")
+        ("size,s", po::value<uint32_t>(&size)->default_value(1024), "Message size in bytes")
+        ("window,w", po::value<uint32_t>(&window)->default_value(256), "Maximum number of undelivered messages")
+        ("timeout,t", po::value<uint32_t>(&timeout)->default_value(15), "Seconds to wait without progress before giving up")
+        ("port,p", po::value<uint16_t>(&basePort)->default_value(27000), "First UDP port to bind transports to")
+        ("loss", po::value<double>(&opts.loss)->default_value(0.0), "Probability of dropping a packet")
+        ("reorder", po::value<double>(&opts.reorder)->default_value(0.0), "Probability of delaying a packet past its successors")
+        ("delay", po::value<uint32_t>(&opts.delay)->default_value(0), "One way delay in microseconds")
+        ("jitter", po::value<uint32_t>(&opts.jitter)->default_value(0), "Maximum extra random delay in microseconds")
+        ("bandwidth", po::value<uint64_t>(&opts.bandwidth)->default_value(0), "Link bandwidth in bytes per second, 0 for unlimited");
+
+    po::variables_map vm;
+    try {
+        po::store(po::parse_command_line(argc, argv, desc), vm);
+        po::notify(vm);
+    } catch(po::error &e) {
+        std::cerr << "error parsing command line arguments: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if(vm.count("help")) {
+        std::cout << desc << std::endl;
+        return EXIT_SUCCESS;
+    }
+
+    if(numNodes < 2 || size < sizeof(uint64_t)) {
+        std::cerr << "need at least two nodes and messages of at least " << sizeof(uint64_t) << " bytes" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    boost::log::core::get()->set_filter(boost::log::expressions::attr<severity_level>("Severity") >= warning);
+
+    Botan::AutoSeeded_RNG rng;
+    Collector collector;
+
+    std::vector<std::unique_ptr<Node>> nodes;
+    for(uint32_t i = 0; i < numNodes; i++) {
+        nodes.emplace_back(new Node(rng, basePort + i));
+
+        auto& t = nodes.back()->transport;
+        t->registerEstablishedHandler(boost::bind(&Collector::established, &collector, _1, _2));
+        t->registerReceivedHandler(boost::bind(&Collector::received, &collector, _1, _2, _3));
+        t->start(nodes.back()->endpoint);
+    }
+
+    // One relay per pair; the lower numbered node initiates the session.
+    boost::asio::io_service relayService;
+    std::unique_ptr<boost::asio::io_service::work> relayWork(new boost::asio::io_service::work(relayService));
+    std::vector<std::unique_ptr<Link>> links;
+
+    for(uint32_t i = 0; i < numNodes; i++) {
+        for(uint32_t j = i + 1; j < numNodes; j++) {
+            links.emplace_back(new Link(relayService, opts, nodes[i]->endpoint.getUDPEndpoint(), nodes[j]->endpoint.getUDPEndpoint(), i * numNodes + j));
+
+            Mapping am;
+            am.setValue("host", "127.0.0.1");
+            am.setValue("port", std::to_string(links.back()->getNearPort()));
+
+            RouterInfo ri(*nodes[j]->identity, Date(), Mapping());
+            ri.addAddress(RouterAddress(5, Date(0), "SSU", am));
+
+            nodes[i]->transport->connect(ri);
+        }
+    }
+
+    std::thread relayThread([&relayService](){ relayService.run(); });
+
+    const uint64_t numPairs = numNodes * (numNodes - 1) / 2;
+    bool established;
+    {
+        std::unique_lock<std::mutex> lock(collector.mutex);
+        established = collector.cv.wait_for(lock, std::chrono::seconds(timeout), [&]{ return collector.numEstablished >= numPairs * 2; });
+        if(!established)
+            std::cerr << "only " << collector.numEstablished << " of " << numPairs * 2 << " session ends established" << std::endl;
+    }
+
+    if(!established) {
+        nodes.clear();
+        relayService.stop();
+        relayThread.join();
+
+        return EXIT_FAILURE;
+    }
+
+    ByteArray payload(size);
+    std::iota(payload.begin(), payload.end(), 0);
+
+    const uint64_t total = (uint64_t)numMessages * numNodes * (numNodes - 1);
+    uint64_t sent = 0;
+    uint32_t msgId = 1;
+
+    const uint64_t start = Bench::now();
+
+    for(uint32_t m = 0; m < numMessages; m++) {
+        for(uint32_t i = 0; i < numNodes; i++) {
+            for(uint32_t j = 0; j < numNodes; j++) {
+                if(i == j) continue;
+
+                {
+                    std::unique_lock<std::mutex> lock(collector.mutex);
+                    collector.cv.wait_for(lock, std::chrono::seconds(timeout), [&]{ return sent - collector.numReceived < window; });
+                }
+
+                uint64_t now = Bench::now();
+                memcpy(payload.data(), &now, sizeof(now));
+
+                nodes[i]->transport->send(nodes[j]->identity->getHash(), msgId++, payload);
+                ++sent;
+            }
+        }
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(collector.mutex);
+        uint64_t lastCount = collector.numReceived;
+        while(collector.numReceived < total) {
+            collector.cv.wait_for(lock, std::chrono::seconds(timeout));
+            if(collector.numReceived == lastCount)
+                break;
+
+            lastCount = collector.numReceived;
+        }
+    }
+
+    std::unique_lock<std::mutex> lock(collector.mutex);
+
+    const double elapsed = ((collector.lastReceived ? collector.lastReceived : Bench::now()) - start) / 1e9;
+
+    uint64_t fragmentsSent = 0, fragmentsRetransmitted = 0;
+    for(auto& n: nodes) {
+        auto s = n->transport->getStats();
+        fragmentsSent += s.fragmentsSent;
+        fragmentsRetransmitted += s.fragmentsRetransmitted;
+    }
+
+    uint64_t forwarded = 0, dropped = 0;
+    for(auto& l: links) {
+        forwarded += l->getForwarded();
+        dropped += l->getDropped();
+    }
+
+    Bench::report("nodes", numNodes);
+    Bench::report("messages sent", sent);
+    Bench::report("messages delivered", collector.numReceived);
+    Bench::report("delivery ratio", (double)collector.numReceived / sent);
+    Bench::report("elapsed", elapsed, "s");
+    Bench::report("throughput", collector.numReceived / elapsed, "msgs/s");
+    Bench::report("goodput", (collector.numReceived * size) / elapsed / (1024 * 1024), "MiB/s");
+    Bench::report("latency p50", collector.latency.percentile(50) / 1e6, "ms");
+    Bench::report("latency p90", collector.latency.percentile(90) / 1e6, "ms");
+    Bench::report("latency p99", collector.latency.percentile(99) / 1e6, "ms");
+    Bench::report("latency max", collector.latency.max() / 1e6, "ms");
+    Bench::report("fragments sent", fragmentsSent);
+    Bench::report("fragments retransmitted", fragmentsRetransmitted);
+    Bench::report("retransmit ratio", fragmentsSent ? (double)fragmentsRetransmitted / fragmentsSent : 0.0);
+    Bench::report("link packets forwarded", forwarded);
+    Bench::report("link packets dropped", dropped);
+
+    lock.unlock();
+    nodes.clear();
+
+    relayWork.reset();
+    relayService.stop();
+    relayThread.join();
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,180 @@
+/**
+ * @file TunnelBuild.cpp
+ * @brief Measures how many tunnel builds per second we can prepare, that is
+ *  create and encrypt the build records of.
+ *
+ * The records are first secured one tunnel at a time on the calling thread,
+ *  then through an i2pcpp::Tunnel::BuildPreparer with a warm pool of
+ *  precomputed ElGamal keys.
+ */
+#include "Benchmark.h"
+
+#include "tunnel/OutboundTunnel.h"
+#include "tunnel/BuildPreparer.h"
+
+#include <i2pcpp/Log.h>
+
+#include <i2pcpp/datatypes/RouterIdentity.h>
+
+#include <i2pcpp/util/I2PDH.h>
+
+#include <botan/auto_rng.h>
+#include <botan/dl_group.h>
+#include <botan/dsa.h>
+#include <botan/elgamal.h>
+
+#include <boost/asio.hpp>
+#include <boost/log/core.hpp>
+#include <boost/log/expressions.hpp>
+#include <boost/program_options.hpp>
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+using namespace i2pcpp;
+
+namespace {
+    /**
+     * @return \a length hops out of \a peers, starting at \a offset
+     */
+    std::vector<RouterIdentity> getHops(std::vector<RouterIdentity> const &peers, uint32_t offset, uint32_t length)
+    {
+        std::vector<RouterIdentity> hops;
+        for(uint32_t i = 0; i < length; i++)
+            hops.push_back(peers[(offset + i) % peers.size()]);
+
+        return hops;
+    }
+
+    void report(std::string const &name, uint32_t numTunnels, double elapsed, Bench::Samples &latency)
+    {
+        std::cout << name << std::endl;
+        Bench::report("  tunnel builds/s", numTunnels / elapsed);
+        Bench::report("  latency p50", latency.percentile(50) / 1000, "us");
+        Bench::report("  latency p99", latency.percentile(99) / 1000, "us");
+        Bench::report("  latency max", latency.max() / 1000, "us");
+    }
+}
+
+int main(int argc, char **argv)
+{
+    namespace po = boost::program_options;
+
+    uint32_t numTunnels, length, numPeers, threads, ephemerals;
+
+    po::options_description desc("Options");
+    desc.add_options()
+        ("help,h", "Produce this help message")
+        ("tunnels,n", po::value<uint32_t>(&numTunnels)->default_value(200), "Number of tunnels to build")
+        ("length,l", po::value<uint32_t>(&length)->default_value(3), "Number of hops per tunnel")
+        ("peers,p", po::value<uint32_t>(&numPeers)->default_value(16), "Number of distinct peers to build through")
+        ("threads,t", po::value<uint32_t>(&threads)->default_value(std::max(1u, std::thread::hardware_concurrency())), "Number of preparer threads")
+        ("ephemerals,e", po::value<uint32_t>(&ephemerals)->default_value(ElGamal::EphemeralPool::DEFAULT_CAPACITY), "Number of precomputed ElGamal keys to keep ready");
+
+    po::variables_map vm;
+    try {
+        po::store(po::parse_command_line(argc, argv, desc), vm);
+        po::notify(vm);
+    } catch(po::error &e) {
+        std::cerr << "error parsing command line arguments: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if(vm.count("help")) {
+        std::cout << desc << std::endl;
+        return EXIT_SUCCESS;
+    }
+
+    if(!length || numPeers < length) {
+        std::cerr << "need at least one hop and at least as many peers as hops" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    boost::log::core::get()->set_filter(boost::log::expressions::attr<severity_level>("Severity") >= warning);
+
+    Botan::AutoSeeded_RNG rng;
+    const Botan::DL_Group elgGroup("modp/ietf/2048");
+    const Botan::DL_Group dsaGroup = DH::getGroup();
+
+    std::vector<RouterIdentity> peers;
+    for(uint32_t i = 0; i < numPeers; i++) {
+        Botan::ElGamal_PrivateKey elgKey(rng, elgGroup);
+        Botan::DSA_PrivateKey dsaKey(rng, dsaGroup);
+
+        peers.emplace_back(Botan::BigInt::encode(elgKey.get_y()), Botan::BigInt::encode(dsaKey.get_y()), Certificate());
+    }
+
+    const RouterHash replyHash = peers.front().getHash();
+
+    Bench::report("tunnels", numTunnels);
+    Bench::report("hops", length);
+
+    /* One tunnel at a time, on this thread */
+    {
+        Bench::Samples latency;
+        const uint64_t start = Bench::now();
+
+        for(uint32_t i = 0; i < numTunnels; i++) {
+            const uint64_t begin = Bench::now();
+
+            Tunnel::OutboundTunnel t(getHops(peers, i, length), replyHash, i);
+            t.secureRecords();
+
+            latency.add(Bench::now() - begin);
+        }
+
+        report("serial", numTunnels, (Bench::now() - start) / 1e9, latency);
+    }
+
+    /* All at once, through the preparer */
+    {
+        boost::asio::io_service ios;
+        std::unique_ptr<boost::asio::io_service::work> work(new boost::asio::io_service::work(ios));
+        std::thread iosThread([&ios](){ ios.run(); });
+
+        Tunnel::BuildPreparer preparer(ios, threads, ephemerals);
+        preparer.start();
+
+        // Give the preparer time to fill its pool, as it would between builds.
+        while(preparer.getReady() < ephemerals)
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+        std::mutex mutex;
+        std::condition_variable cv;
+        uint32_t done = 0;
+        Bench::Samples latency;
+
+        const uint64_t start = Bench::now();
+
+        for(uint32_t i = 0; i < numTunnels; i++) {
+            const uint64_t begin = Bench::now();
+
+            auto t = std::make_shared<Tunnel::OutboundTunnel>(getHops(peers, i, length), replyHash, i);
+            preparer.submit(t, [&, begin](bool secured) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if(secured)
+                    latency.add(Bench::now() - begin);
+                ++done;
+                cv.notify_all();
+            });
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            while(done < numTunnels)
+                cv.wait_for(lock, std::chrono::milliseconds(100));
+        }
+
+        const double elapsed = (Bench::now() - start) / 1e9;
+
+        preparer.stop();
+        work.reset();
+        iosThread.join();
+
+        report("parallel (" + std::to_string(threads) + " threads)", numTunnels, elapsed, latency);
+        Bench::report("  records without a key", preparer.getStats().misses);
+    }
+
+    return EXIT_SUCCESS;
+}
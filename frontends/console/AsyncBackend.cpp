@@ -0,0 +1,522 @@
+#include "AsyncBackend.h"
+
+#include <i2pcpp/datatypes/Endpoint.h>
+#include <i2pcpp/datatypes/RouterHash.h>
+
+#include <boost/log/attributes/value_extraction.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <ostream>
+#include <stdexcept>
+#include <streambuf>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace i2pcpp;
+
+namespace {
+    /// Longest the writer waits before writing out what it has
+    const std::chrono::milliseconds FLUSH_INTERVAL(100);
+
+    /// Bytes written with a single write() at most
+    const size_t BATCH_SIZE = 64 * 1024;
+
+    const char *SEVERITIES[] = { "debug", "info", "warning", "error", "fatal" };
+
+    /**
+     * A std::streambuf over a fixed buffer which drops whatever does not
+     *  fit, so records can be streamed straight in to their slot.
+     */
+    class FixedBuf : public std::streambuf {
+        public:
+            void reset(char *begin, char *end)
+            {
+                setp(begin, end);
+            }
+
+            char *pos() const
+            {
+                return pptr();
+            }
+
+        protected:
+            int_type overflow(int_type) override
+            {
+                return traits_type::eof();
+            }
+    };
+
+    /**
+     * The stream records are formatted with. One per thread, so its
+     *  locale is set up once rather than for every record.
+     */
+    struct Formatter {
+        FixedBuf buf;
+        std::ostream os;
+
+        Formatter() :
+            os(&buf) {}
+
+        void reset(char *begin, char *end)
+        {
+            buf.reset(begin, end);
+            os.clear();
+        }
+    };
+
+    Formatter& getFormatter()
+    {
+        static thread_local Formatter f;
+        return f;
+    }
+
+    uint64_t getMicros(std::chrono::system_clock::time_point const &t)
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(t.time_since_epoch()).count();
+    }
+
+    /**
+     * Writes "[YYYY-mm-dd HH:MM:SS.ffffff]" for \a micros, the local time
+     *  is only worked out once a second.
+     */
+    void writeTimestamp(std::ostream &os, uint64_t micros)
+    {
+        static thread_local time_t lastSecond = -1;
+        static thread_local char date[24];
+
+        const time_t second = micros / 1000000;
+        if(second != lastSecond) {
+            struct tm tm;
+            localtime_r(&second, &tm);
+            strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", &tm);
+            lastSecond = second;
+        }
+
+        char fraction[8];
+        snprintf(fraction, sizeof(fraction), ".%06u", (unsigned)(micros % 1000000));
+
+        os << '[' << date << fraction << ']';
+    }
+
+    char *writeBE(char *p, uint64_t v, size_t bytes)
+    {
+        for(size_t i = bytes; i > 0; i--)
+            *(p++) = (char)(v >> ((i - 1) * 8));
+
+        return p;
+    }
+
+    /**
+     * Writes a length prefixed string, truncated to what the prefix and
+     *  the space left allow.
+     * @return the position after it, or nullptr if even the prefix does
+     *  not fit
+     */
+    char *writeString(char *p, char *end, const char *s, size_t len)
+    {
+        if(p == end)
+            return nullptr;
+
+        len = std::min({ len, (size_t)255, (size_t)(end - p - 1) });
+        *(p++) = (char)len;
+
+        return std::copy(s, s + len, p);
+    }
+
+    /**
+     * Streams a tag in to \a f as " [value]", or as a name and length
+     *  prefixed value in binary mode. \a count is incremented if the
+     *  record has it.
+     */
+    template<typename T>
+    char *writeTag(Formatter &f, char *p, char *end, boost::log::record_view const &rec, const char *name, bool binary, uint8_t &count)
+    {
+        auto v = boost::log::extract<T>(name, rec);
+        if(!v || !p)
+            return p;
+
+        if(!binary) {
+            f.os << " [" << v.get() << ']';
+            return p;
+        }
+
+        char *value = writeString(p, end, name, strlen(name));
+        if(!value || value + 1 >= end)
+            return p;
+
+        f.reset(value + 1, std::min(value + 256, end));
+        f.os << v.get();
+        *value = (char)(f.buf.pos() - (value + 1));
+        ++count;
+
+        return f.buf.pos();
+    }
+}
+
+AsyncBackend::AsyncBackend(std::string const &file, Options const &options) :
+    m_file(file),
+    m_options(options),
+    m_head(0),
+    m_drained(0),
+    m_dropped(0),
+    m_rotateFailures(0),
+    m_running(true)
+{
+    size_t capacity = 1;
+    while(capacity < m_options.capacity)
+        capacity <<= 1;
+
+    m_slots.reset(new Slot[capacity]);
+    for(size_t i = 0; i < capacity; i++)
+        m_slots[i].seq.store(i, std::memory_order_relaxed);
+    m_mask = capacity - 1;
+
+    if(!m_options.sampleRate)
+        m_options.sampleRate = 1;
+
+    m_batch.reserve(BATCH_SIZE);
+
+    open();
+
+    m_thread = std::thread(&AsyncBackend::run, this);
+}
+
+AsyncBackend::~AsyncBackend()
+{
+    stop();
+}
+
+void AsyncBackend::consume(boost::log::record_view const &rec)
+{
+    if(!m_running.load(std::memory_order_relaxed)) {
+        ++m_dropped;
+        return;
+    }
+
+    if(m_options.overflow == Overflow::SAMPLE && size() > m_mask / 2) {
+        auto sev = boost::log::extract<severity_level>("Severity", rec);
+        if(!sev || sev.get() < warning) {
+            static thread_local uint32_t n = 0;
+            if(++n % m_options.sampleRate) {
+                ++m_dropped;
+                return;
+            }
+        }
+    }
+
+    size_t pos;
+    Slot *s = claim(pos);
+
+    while(!s && m_options.overflow == Overflow::BLOCK && m_running.load(std::memory_order_relaxed)) {
+        m_cv.notify_one();
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+        s = claim(pos);
+    }
+
+    if(!s) {
+        ++m_dropped;
+        return;
+    }
+
+    format(rec, *s);
+    publish(*s, pos);
+
+    if(size() > m_mask / 2)
+        m_cv.notify_one();
+}
+
+void AsyncBackend::stop()
+{
+    if(!m_running.exchange(false))
+        return;
+
+    m_cv.notify_one();
+    m_thread.join();
+
+    if(!m_file.empty())
+        ::close(m_fd);
+}
+
+uint64_t AsyncBackend::getDropped() const
+{
+    return m_dropped;
+}
+
+uint64_t AsyncBackend::getRotateFailures() const
+{
+    return m_rotateFailures;
+}
+
+AsyncBackend::Slot *AsyncBackend::claim(size_t &pos)
+{
+    pos = m_head.load(std::memory_order_relaxed);
+
+    while(true) {
+        Slot &s = m_slots[pos & m_mask];
+        const size_t seq = s.seq.load(std::memory_order_acquire);
+        const intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+
+        if(!diff) {
+            if(m_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                return &s;
+        } else if(diff < 0)
+            return nullptr;
+        else
+            pos = m_head.load(std::memory_order_relaxed);
+    }
+}
+
+void AsyncBackend::publish(Slot &s, size_t pos)
+{
+    s.seq.store(pos + 1, std::memory_order_release);
+}
+
+size_t AsyncBackend::size() const
+{
+    return m_head.load(std::memory_order_relaxed) - m_drained.load(std::memory_order_relaxed);
+}
+
+void AsyncBackend::format(boost::log::record_view const &rec, Slot &s) const
+{
+    Formatter &f = getFormatter();
+
+    const uint64_t micros = getMicros(std::chrono::system_clock::now());
+    auto sev = boost::log::extract<severity_level>("Severity", rec);
+    auto channel = boost::log::extract<std::string>("Channel", rec);
+    auto message = boost::log::extract<std::string>("Message", rec);
+
+    char *begin = s.data;
+    char *end = s.data + sizeof(s.data);
+
+    if(!m_options.binary) {
+        // Leave room for the newline
+        f.reset(begin, end - 1);
+
+        writeTimestamp(f.os, micros);
+        f.os << ' ' << (channel ? channel.get() : std::string()) << '/';
+        if(sev && (size_t)sev.get() < sizeof(SEVERITIES) / sizeof(*SEVERITIES))
+            f.os << SEVERITIES[sev.get()];
+
+        uint8_t count = 0;
+        writeTag<Endpoint>(f, begin, end, rec, "Endpoint", false, count);
+        writeTag<RouterHash>(f, begin, end, rec, "RouterHash", false, count);
+        writeTag<uint32_t>(f, begin, end, rec, "TunnelId", false, count);
+
+        f.os << ": ";
+        if(message)
+            f.os << message.get();
+
+        char *p = f.buf.pos();
+        *(p++) = '\n';
+        s.length = p - begin;
+
+        return;
+    }
+
+    char *p = begin + 2;
+    p = writeBE(p, micros, 8);
+    *(p++) = (char)(sev ? sev.get() : 0);
+
+    const std::string &ch = (channel ? channel.get() : std::string());
+    p = writeString(p, end, ch.data(), ch.size());
+
+    uint8_t count = 0;
+    char *countPos = p++;
+    p = writeTag<Endpoint>(f, p, end, rec, "Endpoint", true, count);
+    p = writeTag<RouterHash>(f, p, end, rec, "RouterHash", true, count);
+    p = writeTag<uint32_t>(f, p, end, rec, "TunnelId", true, count);
+    *countPos = (char)count;
+
+    if(message) {
+        const size_t len = std::min(message.get().size(), (size_t)(end - p));
+        p = std::copy(message.get().data(), message.get().data() + len, p);
+    }
+
+    s.length = p - begin;
+    writeBE(begin, s.length - 2, 2);
+}
+
+void AsyncBackend::run()
+{
+    while(m_running.load(std::memory_order_relaxed)) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait_for(lock, FLUSH_INTERVAL, [this]() {
+                return !m_running.load(std::memory_order_relaxed) || size() > m_mask / 2;
+            });
+        }
+
+        drain();
+        flush();
+    }
+
+    drain();
+    flush();
+}
+
+bool AsyncBackend::drain()
+{
+    bool drained = false;
+
+    while(true) {
+        Slot &s = m_slots[m_tail & m_mask];
+        if(s.seq.load(std::memory_order_acquire) != m_tail + 1)
+            break;
+
+        if(m_batch.size() + s.length > BATCH_SIZE)
+            flush();
+
+        m_batch.insert(m_batch.end(), s.data, s.data + s.length);
+        ++m_batchRecords;
+
+        s.seq.store(m_tail + m_mask + 1, std::memory_order_release);
+        m_drained.store(++m_tail, std::memory_order_relaxed);
+        drained = true;
+    }
+
+    // Reported after the records which were kept around the drops
+    const uint64_t dropped = m_dropped.load(std::memory_order_relaxed);
+    if(dropped != m_reportedDropped) {
+        warn(std::to_string(dropped - m_reportedDropped) + " log records dropped");
+        m_reportedDropped = dropped;
+    }
+
+    return drained;
+}
+
+void AsyncBackend::warn(std::string const &msg)
+{
+    // Under the same severity and format as records, for anything reading the file
+    char buf[512];
+    char *p = buf;
+    const uint64_t micros = getMicros(std::chrono::system_clock::now());
+
+    if(!m_options.binary) {
+        Formatter &f = getFormatter();
+        f.reset(buf, buf + sizeof(buf) - 1);
+        writeTimestamp(f.os, micros);
+        f.os << " L/warning: " << msg;
+        p = f.buf.pos();
+        *(p++) = '\n';
+    } else {
+        p = writeBE(p + 2, micros, 8);
+        *(p++) = (char)warning;
+        p = writeString(p, buf + sizeof(buf), "L", 1);
+        *(p++) = 0;
+
+        const size_t len = std::min(msg.size(), (size_t)(buf + sizeof(buf) - p));
+        p = std::copy(msg.data(), msg.data() + len, p);
+        writeBE(buf, p - buf - 2, 2);
+    }
+
+    if(m_batch.size() + (p - buf) > BATCH_SIZE)
+        flush();
+
+    m_batch.insert(m_batch.end(), buf, p);
+}
+
+void AsyncBackend::flush()
+{
+    if(!m_file.empty()) {
+        const bool full = (m_options.rotateSize && m_written >= m_options.rotateSize);
+        const bool old = (m_options.rotateInterval.count() && std::chrono::steady_clock::now() - m_opened >= m_options.rotateInterval);
+
+        if(full || old)
+            rotate();
+    }
+
+    const char *p = m_batch.data();
+    size_t left = m_batch.size();
+
+    // More than one write() only if the first was cut short
+    while(left) {
+        const ssize_t n = ::write(m_fd, p, left);
+        if(n < 0) {
+            if(errno == EINTR)
+                continue;
+
+            /* The rest of the batch is lost. Its records are counted as
+             * dropped, so they are reported once writing works again.
+             */
+            m_dropped.fetch_add(m_batchRecords, std::memory_order_relaxed);
+            break;
+        }
+
+        p += n;
+        left -= n;
+    }
+
+    m_written += m_batch.size() - left;
+    m_batch.clear();
+    m_batchRecords = 0;
+}
+
+void AsyncBackend::open()
+{
+    m_opened = std::chrono::steady_clock::now();
+
+    if(m_file.empty()) {
+        m_fd = STDERR_FILENO;
+        return;
+    }
+
+    m_fd = openFile();
+    if(m_fd < 0)
+        throw std::runtime_error("could not open log file " + m_file + ": " + strerror(errno));
+}
+
+int AsyncBackend::openFile()
+{
+    const int fd = ::open(m_file.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if(fd < 0)
+        return fd;
+
+    struct stat st;
+    m_written = (fstat(fd, &st) ? 0 : st.st_size);
+
+    return fd;
+}
+
+void AsyncBackend::rotate()
+{
+    const time_t now = time(nullptr);
+    struct tm tm;
+    localtime_r(&now, &tm);
+
+    char suffix[32];
+    strftime(suffix, sizeof(suffix), ".%Y%m%d-%H%M%S", &tm);
+
+    // Files rotated within the same second get a counter
+    std::string name = m_file + suffix;
+    struct stat st;
+    for(unsigned n = 1; !::stat(name.c_str(), &st); n++)
+        name = m_file + suffix + "." + std::to_string(n);
+
+    // If the rename fails the file is reopened and appended to
+    ::rename(m_file.c_str(), name.c_str());
+
+    /* The writer thread can't throw, so if there is no new file it keeps
+     * writing to the old one and tries again when the next rotation is due.
+     */
+    m_opened = std::chrono::steady_clock::now();
+
+    const int fd = openFile();
+    if(fd < 0) {
+        const std::string error = strerror(errno);
+
+        ++m_rotateFailures;
+        m_written = 0;
+
+        warn("could not open log file " + m_file + ": " + error + ", still writing to the old one");
+        return;
+    }
+
+    ::close(m_fd);
+    m_fd = fd;
+}
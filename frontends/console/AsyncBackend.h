@@ -0,0 +1,208 @@
+#ifndef ASYNCBACKEND_H
+#define ASYNCBACKEND_H
+
+#include <i2pcpp/LogLevels.h>
+
+#include <boost/log/core/record_view.hpp>
+#include <boost/log/sinks/basic_sink_backend.hpp>
+#include <boost/log/sinks/frontend_requirements.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace sinks = boost::log::sinks;
+
+/**
+ * A log sink backend which formats records in to a bounded, lock free
+ *  ring of fixed size slots and leaves the writing to a thread of its
+ *  own. The writer drains the ring in batches and hands each batch to
+ *  the output with a single write(). Memory use is fixed by the number
+ *  of slots, whatever the rate of records; what happens to records
+ *  which do not fit is set by the AsyncBackend::Overflow policy.
+ *
+ * Records longer than a slot are truncated.
+ */
+class AsyncBackend : public sinks::basic_sink_backend<sinks::concurrent_feeding> {
+    public:
+        /**
+         * What to do with a record when the ring is full.
+         */
+        enum class Overflow {
+            /// Drop it, the writer reports how many were dropped
+            DROP,
+            /// Wait for the writer to make room
+            BLOCK,
+            /// Once the ring is half full, keep only one in Options::sampleRate
+            ///  records below warning; drop when full
+            SAMPLE
+        };
+
+        struct Options {
+            /// Number of slots, rounded up to a power of two
+            size_t capacity = 4096;
+
+            Overflow overflow = Overflow::DROP;
+            uint32_t sampleRate = 10;
+
+            /**
+             * Write length prefixed binary records instead of text:
+             *  uint16 length of the rest of the record, uint64
+             *  microseconds since the epoch, uint8 severity, uint8
+             *  channel length and channel, uint8 tag count and for each
+             *  tag uint8 name length, name, uint8 value length, value;
+             *  the message takes up the rest. Integers are big endian.
+             */
+            bool binary = false;
+
+            /// Rotate the file once it holds this many bytes, 0 for never
+            uint64_t rotateSize = 0;
+
+            /// Rotate the file once it is this old, 0 for never
+            std::chrono::seconds rotateInterval{0};
+        };
+
+        /**
+         * Starts the writer thread.
+         * @param file the file to append to, or an empty string for
+         *  std::clog's file descriptor. Rotated files are renamed to
+         *  file.YYYYmmdd-HHMMSS, followed by a counter if that exists.
+         */
+        AsyncBackend(std::string const &file, Options const &options);
+        AsyncBackend(const AsyncBackend &) = delete;
+        AsyncBackend& operator=(AsyncBackend &) = delete;
+
+        /**
+         * Stops the writer after it wrote everything left in the ring.
+         */
+        ~AsyncBackend();
+
+        void consume(boost::log::record_view const &rec);
+
+        /**
+         * Writes out everything in the ring and stops the writer thread.
+         *  Records consumed afterwards are dropped.
+         */
+        void stop();
+
+        /**
+         * @return the number of records dropped so far, including those
+         *  which could not be written out
+         */
+        uint64_t getDropped() const;
+
+        /**
+         * @return the number of times the file could not be reopened
+         *  after it was rotated. The records are then written to the
+         *  rotated file until the next rotation is due.
+         */
+        uint64_t getRotateFailures() const;
+
+        /// Bytes in a slot, including its length
+        static const size_t SLOT_SIZE = 1024;
+
+    private:
+        struct Slot {
+            std::atomic<size_t> seq;
+            uint16_t length;
+            char data[SLOT_SIZE - sizeof(std::atomic<size_t>) - sizeof(uint16_t)];
+        };
+
+        /**
+         * Claims the next free slot.
+         * @return the slot, or nullptr if the ring is full
+         */
+        Slot *claim(size_t &pos);
+
+        /**
+         * Hands a claimed slot to the writer.
+         */
+        void publish(Slot &s, size_t pos);
+
+        /**
+         * @return the number of slots in use
+         */
+        size_t size() const;
+
+        /**
+         * Formats \a rec in to \a s according to m_options.
+         */
+        void format(boost::log::record_view const &rec, Slot &s) const;
+
+        void run();
+
+        /**
+         * Moves the published slots to m_batch, writing it out whenever it
+         *  fills up.
+         * @return whether anything was drained
+         */
+        bool drain();
+
+        /**
+         * Writes out m_batch with a single write(), rotating the file
+         *  first if it is due.
+         */
+        void flush();
+
+        /**
+         * Adds a warning from the backend itself to m_batch.
+         */
+        void warn(std::string const &msg);
+
+        /**
+         * Opens the file given by m_file, throwing on failure. Only
+         *  called from the constructor, the writer uses openFile().
+         */
+        void open();
+
+        /**
+         * Opens m_file and sets m_written to its size.
+         * @return the file descriptor, negative if it could not be opened
+         */
+        int openFile();
+
+        /**
+         * Renames the file and opens a new one. Never throws; if the new
+         *  file can't be opened the old one is kept.
+         */
+        void rotate();
+
+        std::string m_file;
+        Options m_options;
+        int m_fd = -1;
+
+        std::unique_ptr<Slot[]> m_slots;
+        size_t m_mask;
+
+        /// Next slot to claim, shared by the producers
+        alignas(64) std::atomic<size_t> m_head;
+
+        /// Next slot to drain, only touched by the writer
+        alignas(64) size_t m_tail = 0;
+        std::atomic<size_t> m_drained;
+
+        std::atomic<uint64_t> m_dropped;
+        uint64_t m_reportedDropped = 0;
+        std::atomic<uint64_t> m_rotateFailures;
+
+        std::vector<char> m_batch;
+
+        /// Number of records in m_batch
+        uint64_t m_batchRecords = 0;
+
+        uint64_t m_written = 0;
+        std::chrono::steady_clock::time_point m_opened;
+
+        std::atomic<bool> m_running;
+        std::mutex m_mutex;
+        std::condition_variable m_cv;
+        std::thread m_thread;
+};
+
+#endif
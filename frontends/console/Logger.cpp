@@ -1,34 +1,13 @@
 #include "Logger.h"
 
-#include <i2pcpp/datatypes/Endpoint.h>
-#include <i2pcpp/datatypes/RouterHash.h>
-
-#include <boost/date_time/posix_time/posix_time.hpp>
-#include <boost/date_time/posix_time/posix_time_io.hpp>
+#include <boost/make_shared.hpp>
 
+#include <boost/log/core.hpp>
 #include <boost/log/expressions.hpp>
-#include <boost/log/sources/global_logger_storage.hpp>
-#include <boost/log/sinks/sync_frontend.hpp>
-#include <boost/log/sinks/text_ostream_backend.hpp>
-#include <boost/log/sinks/text_file_backend.hpp>
-#include <boost/log/attributes/clock.hpp>
-#include <boost/log/attributes/current_thread_id.hpp>
-#include <boost/log/attributes/named_scope.hpp>
-#include <boost/log/attributes/value_extraction.hpp>
-#include <boost/utility/empty_deleter.hpp>
-#include <boost/log/utility/manipulators/add_value.hpp>
-#include <boost/log/support/exception.hpp>
-#include <boost/log/sources/severity_channel_logger.hpp>
-#include <boost/log/sources/record_ostream.hpp>
-#include <boost/log/attributes/constant.hpp>
-#include <boost/log/attributes/scoped_attribute.hpp>
-#include <boost/log/utility/manipulators/add_value.hpp>
-
-#include <sstream>
-#include <locale>
-
-namespace keywords = boost::log::keywords;
-namespace attrs = boost::log::attributes;
+#include <boost/log/sinks/unlocked_frontend.hpp>
+
+#include <ostream>
+
 namespace sinks = boost::log::sinks;
 namespace expr = boost::log::expressions;
 
@@ -55,59 +34,39 @@ namespace i2pcpp {
     }
 }
 
-void Logger::logToConsole(i2pcpp::severity_level log_level)
-{
-    typedef sinks::synchronous_sink<sinks::text_ostream_backend> sink_t;
+boost::shared_ptr<AsyncBackend> Logger::s_backend;
 
-    boost::shared_ptr<sinks::text_ostream_backend> backend = boost::make_shared<sinks::text_ostream_backend>();
-    backend->add_stream(boost::shared_ptr<std::ostream>(&std::clog, boost::empty_deleter()));
-
-    boost::shared_ptr<sink_t> sink(new sink_t(backend));
-    boost::log::core::get()->add_sink(sink);
-    sink->set_filter(expr::attr<severity_level>("Severity") >= log_level);
-    sink->set_formatter(&Logger::formatter);
-
-    boost::log::core::get()->add_global_attribute("Timestamp", attrs::local_clock());
-}
-
-void Logger::logToFile(const std::string &file, i2pcpp::severity_level log_level)
+Logger::~Logger()
 {
     boost::log::core::get()->remove_all_sinks();
 
-    boost::shared_ptr<sinks::text_file_backend> backend = boost::make_shared<sinks::text_file_backend>(keywords::file_name = file);
-    backend->auto_flush(true);
-
-    typedef sinks::synchronous_sink<sinks::text_file_backend> sink_t;
-    boost::shared_ptr<sink_t> sink(new sink_t(backend));
-    boost::log::core::get()->add_sink(sink);
-
-    sink->set_filter(expr::attr<severity_level>("Severity") >= log_level);
-    sink->set_formatter(&Logger::formatter);
+    if(s_backend)
+        s_backend->stop();
 }
 
-void Logger::formatter(boost::log::record_view const &rec, boost::log::formatting_ostream &s)
+void Logger::logToConsole(i2pcpp::severity_level log_level, AsyncBackend::Options const &options)
 {
-    const boost::log::attribute_value_set& attrSet = rec.attribute_values();
-
-    static std::locale loc(std::clog.getloc(), new boost::posix_time::time_facet("%Y-%m-%d %T.%f"));
-    std::stringstream ss;
-    ss.imbue(loc);
-    if(!ss.good()) return;
-    ss << boost::log::extract<boost::posix_time::ptime>("Timestamp", rec);
-    if(!ss.good()) return;
-    s << '[' << ss.str() << ']';
+    setBackend(boost::make_shared<AsyncBackend>("", options), log_level);
+}
 
-    s << ' ' << boost::log::extract<std::string>("Channel", rec);
-    s << '/' << boost::log::extract<severity_level>("Severity", rec);
+void Logger::logToFile(const std::string &file, i2pcpp::severity_level log_level, AsyncBackend::Options const &options)
+{
+    setBackend(boost::make_shared<AsyncBackend>(file, options), log_level);
+}
 
-    if(attrSet.find("Endpoint") != attrSet.end())
-        s << " [" << boost::log::extract<Endpoint>("Endpoint", rec) << ']';
+void Logger::setBackend(boost::shared_ptr<AsyncBackend> const &backend, i2pcpp::severity_level log_level)
+{
+    // The backend takes records from any number of threads without a lock
+    typedef sinks::unlocked_sink<AsyncBackend> sink_t;
 
-    if(attrSet.find("RouterHash") != attrSet.end())
-        s << " [" << boost::log::extract<RouterHash>("RouterHash", rec) << ']';
+    boost::log::core::get()->remove_all_sinks();
+    if(s_backend)
+        s_backend->stop();
 
-    if(attrSet.find("TunnelId") != attrSet.end())
-        s << " [" << boost::log::extract<uint32_t>("TunnelId", rec) << ']';
+    boost::shared_ptr<sink_t> sink(new sink_t(backend));
+    sink->set_filter(expr::attr<severity_level>("Severity") >= log_level);
+    boost::log::core::get()->add_sink(sink);
 
-    s << ": " << rec[expr::smessage];
+    s_backend = backend;
+    Log::setLevel(log_level);
 }
@@ -1,41 +1,33 @@
 #ifndef LOGGER_H
 #define LOGGER_H
 
-#include "StatsBackend.h"
+#include "AsyncBackend.h"
 
-#include <i2pcpp/LogLevels.h>
+#include <i2pcpp/Log.h>
 
 #include <boost/shared_ptr.hpp>
 
 #include <boost/log/sources/record_ostream.hpp>
 #include <boost/log/sources/severity_channel_logger.hpp>
-#include <boost/log/sinks/async_frontend.hpp>
 
 #include <string>
 
-#define I2P_LOG(logger, sev) BOOST_LOG_SEV(logger, sev)
-#define I2P_LOG_TAG(logger, name, value) logger.add_attribute(name, boost::log::attributes::make_constant(value))
-#define I2P_LOG_SCOPED_TAG(logger, name, value) BOOST_LOG_SCOPED_LOGGER_TAG(logger, name, value)
-
-typedef boost::log::sources::severity_channel_logger_mt<i2pcpp::severity_level, std::string> i2p_logger_mt;
+using i2pcpp::i2p_logger_mt;
 
 class Logger {
     public:
-      	static void logToConsole(i2pcpp::severity_level log_level);
-	      static void logToFile(const std::string &file, i2pcpp::severity_level log_level);
+        /**
+         * Writes out what is left of the log and stops the writer.
+         */
+        ~Logger();
 
-        template<typename T>
-        static void addBackendToAsyncSink(boost::shared_ptr<T> backend)
-        {
-            typedef sinks::asynchronous_sink<T> sink_t;
-            boost::shared_ptr<sink_t> sink(new sink_t(backend));
-            boost::log::core::get()->add_sink(sink);
-        }
+        static void logToConsole(i2pcpp::severity_level log_level, AsyncBackend::Options const &options = AsyncBackend::Options());
+        static void logToFile(const std::string &file, i2pcpp::severity_level log_level, AsyncBackend::Options const &options = AsyncBackend::Options());
 
     private:
-        static void formatter(boost::log::record_view const &rec, boost::log::formatting_ostream &s);
+        static void setBackend(boost::shared_ptr<AsyncBackend> const &backend, i2pcpp::severity_level log_level);
 
-        boost::shared_ptr<StatsBackend> m_stats;
+        static boost::shared_ptr<AsyncBackend> s_backend;
 };
 
 #endif
@@ -13,9 +13,6 @@ Server::Server(Endpoint const &ep) :
     m_server.set_open_handler(std::bind(&Server::on_open, this, std::placeholders::_1));
     m_server.set_close_handler(std::bind(&Server::on_close, this, std::placeholders::_1));
 
-    m_stats = boost::make_shared<StatsBackend>();
-    Logger::addBackendToAsyncSink(m_stats);
-
     m_statsTimer.async_wait(boost::bind(&Server::timerCallback, this, boost::asio::placeholders::error));
 }
 
@@ -84,7 +81,7 @@ void Server::broadcastStats(stats_t & stats)
 void Server::timerCallback(const boost::system::error_code &e)
 {
     if(!e) {
-        auto stats = m_stats->getStats();
+        auto stats = m_stats.getStats();
         broadcastStats(stats);
 
         m_statsTimer.expires_at(m_statsTimer.expires_at() + boost::posix_time::time_duration(0, 0, 1));
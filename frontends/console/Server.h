@@ -2,6 +2,7 @@
 #define SERVER_H
 
 #include "Logger.h"
+#include "StatsBackend.h"
 
 #include <i2pcpp/datatypes/Endpoint.h>
 
@@ -46,7 +47,7 @@ class Server {
 
         std::mutex m_connectionsMutex;
 
-        boost::shared_ptr<StatsBackend> m_stats;
+        StatsBackend m_stats;
         boost::asio::deadline_timer m_statsTimer;
 
         i2p_logger_mt m_log;
@@ -1,7 +1,5 @@
 #include "StatsBackend.h"
 
-#include <boost/log/attributes/value_extraction.hpp>
-
 std::string stats_t::json()
 {
     std::string i2np_msgs = "[ {";
@@ -18,58 +16,102 @@ std::string stats_t::json()
     }
     i2np_msgs += "\"0\" : 0 } ] ";
 
+    std::string rejects = "{ ";
+    for ( auto & item : tunnel_rejects ) {
+        rejects += " \"" + item.first + "\" : "+std::to_string(item.second);
+        rejects += ", ";
+    }
+    rejects += "\"0\" : 0 } ";
+
+    std::string queues = "{ ";
+    for ( auto & item : queue_depth ) {
+        queues += " \"" + item.first + "\" : { \"depth\" : " + std::to_string(item.second) +
+                  ", \"dropped\" : " + std::to_string(queue_dropped[item.first]) + " }";
+        queues += ", ";
+    }
+    queues += "\"0\" : 0 } ";
+
+    std::string latencies = "{ ";
+    for ( auto & item : latency ) {
+        latencies += " \"" + item.first + "\" : { \"count\" : " + std::to_string(item.second.count) +
+                     ", \"p50\" : " + std::to_string(item.second.p50) +
+                     ", \"p90\" : " + std::to_string(item.second.p90) +
+                     ", \"p99\" : " + std::to_string(item.second.p99) +
+                     ", \"max\" : " + std::to_string(item.second.max) + " }";
+        latencies += ", ";
+    }
+    latencies += "\"0\" : 0 } ";
+
     return ( "{ \"bandwidth\" : [" + 
              std::to_string(bytes_sent) + "," + std::to_string(bytes_recv) + 
              "], \"peers\" : "+std::to_string(peer_count) +
              ", \"i2np\" : " + i2np_msgs +
-             ", \"tunnels\" : { \"participating\" : "+std::to_string(participating_tunnels) + " } "
+             ", \"outbound_queue\" : " + queues +
+             ", \"latency\" : " + latencies +
+             ", \"outbound_pending\" : { \"bytes\" : " + std::to_string(outbound_pending_bytes) +
+             ", \"expired\" : " + std::to_string(outbound_expired) + " }" +
+             ", \"tunnels\" : { \"participating\" : "+std::to_string(participating_tunnels) +
+             ", \"build_requests\" : " + std::to_string(build_requests) +
+             ", \"build_queue_wait\" : " + std::to_string(build_queue_wait) +
+             ", \"build_accept_rate\" : " + std::to_string(build_accept_rate) +
+             ", \"dropped\" : " + std::to_string(participating_dropped) +
+             ", \"rejects\" : " + rejects + " } "
              "}");
 }
 
-void StatsBackend::consume(boost::log::record_view const& rec)
-{
-    std::lock_guard<std::mutex> lock(m_mutex);
+namespace {
+    /**
+     * Copies the non-zero values of \a metrics whose names start with
+     *  \a prefix and end with \a suffix, keyed by what is in between.
+     */
+    template<typename T>
+    std::unordered_map<std::string, uint32_t> collect(std::map<std::string, T> const &metrics, std::string const &prefix, std::string const &suffix = "")
+    {
+        std::unordered_map<std::string, uint32_t> values;
 
-    
-    if(rec.attribute_values().count("sent")) {
-        m_stats.bytes_sent += boost::log::extract<uint64_t>("sent", rec).get();
-    } else if(rec.attribute_values().count("received")) {
-        m_stats.bytes_recv += boost::log::extract<uint64_t>("received", rec).get();
-    } else if(rec.attribute_values().count("peers")) {
-        m_stats.peer_count = boost::log::extract<uint32_t>("peers", rec).get();
-    } else if(rec.attribute_values().count("i2np_ib")) {
-        std::string msg_type = boost::log::extract<std::string>("i2np_ib", rec).get();
-        if (m_stats.i2np_ib.find(msg_type) == m_stats.i2np_ib.end()) {
-            m_stats.i2np_ib[msg_type] = 0;
-        }
-        m_stats.i2np_ib[msg_type] += 1;
-    } else if(rec.attribute_values().count("i2np_ob")) {
-        std::string msg_type = boost::log::extract<std::string>("i2np_ob", rec).get();
-        if (m_stats.i2np_ob.find(msg_type) == m_stats.i2np_ob.end()) {
-            m_stats.i2np_ob[msg_type] = 0;
+        for(auto itr = metrics.lower_bound(prefix); itr != metrics.end() && !itr->first.compare(0, prefix.size(), prefix); ++itr) {
+            const std::string &name = itr->first;
+            if(!itr->second || name.size() < prefix.size() + suffix.size() || name.compare(name.size() - suffix.size(), suffix.size(), suffix))
+                continue;
+
+            values[name.substr(prefix.size(), name.size() - prefix.size() - suffix.size())] = itr->second;
         }
-        m_stats.i2np_ob[msg_type] += 1;
-    } else if(rec.attribute_values().count("participating")) {
-        m_stats.participating_tunnels = boost::log::extract<uint32_t>("participating", rec).get();
+
+        return values;
+    }
+
+    template<typename T>
+    T get(std::map<std::string, T> const &metrics, std::string const &name, T def = 0)
+    {
+        auto itr = metrics.find(name);
+        return (itr == metrics.end() ? def : itr->second);
     }
 }
 
 stats_t StatsBackend::getStats()
 {
-    std::lock_guard<std::mutex> lock(m_mutex);
+    const i2pcpp::Metrics::Snapshot s = i2pcpp::Metrics::snapshot(true);
+
     stats_t stats;
-    stats.bytes_sent = m_stats.bytes_sent;
-    stats.bytes_recv = m_stats.bytes_recv;
-    stats.peer_count = m_stats.peer_count;
-    stats.participating_tunnels = m_stats.participating_tunnels;
-    stats.i2np_ob = std::unordered_map<std::string, uint32_t>(m_stats.i2np_ob);
-    stats.i2np_ib = std::unordered_map<std::string, uint32_t>(m_stats.i2np_ib);
+    stats.bytes_sent = get(s.counters, "bandwidth.sent");
+    stats.bytes_recv = get(s.counters, "bandwidth.received");
+    stats.peer_count = get(s.gauges, "peers");
+    stats.participating_tunnels = get(s.gauges, "tunnels.participating");
+    stats.build_requests = get(s.gauges, "tunnels.build_requests");
+    stats.build_queue_wait = get(s.gauges, "tunnels.build_queue_wait");
+    stats.build_accept_rate = get<int64_t>(s.gauges, "tunnels.build_accept_rate", 100);
+    stats.participating_dropped = get(s.counters, "tunnels.dropped");
+    stats.tunnel_rejects = collect(s.counters, "tunnels.rejected.");
+    stats.i2np_ib = collect(s.counters, "i2np.received.");
+    stats.i2np_ob = collect(s.counters, "i2np.sent.");
+    stats.queue_depth = collect(s.gauges, "outbound.queue.", ".depth");
+    stats.queue_dropped = collect(s.counters, "outbound.queue.", ".dropped");
+    stats.outbound_pending_bytes = get(s.gauges, "outbound.pending_bytes");
+    stats.outbound_expired = get(s.counters, "outbound.expired");
 
+    const std::string prefix = "latency.";
+    for(auto itr = s.histograms.lower_bound(prefix); itr != s.histograms.end() && !itr->first.compare(0, prefix.size(), prefix); ++itr)
+        stats.latency[itr->first.substr(prefix.size())] = itr->second;
 
-    m_stats.bytes_sent = 0;
-    m_stats.bytes_recv = 0;
-    m_stats.i2np_ob.clear();
-    m_stats.i2np_ib.clear();
-    
     return stats;
 }
@@ -1,39 +1,43 @@
 #ifndef STATSBACKEND_H
 #define STATSBACKEND_H
 
-#include <boost/log/sinks/basic_sink_backend.hpp>
-#include <boost/log/sinks/frontend_requirements.hpp>
+#include <i2pcpp/util/Metrics.h>
 
-#include <mutex>
+#include <map>
 #include <string>
 #include <unordered_map>
 
-namespace sinks = boost::log::sinks;
-
 struct stats_t {
     uint64_t bytes_sent = 0;
     uint64_t bytes_recv = 0;
     uint32_t peer_count = 0;
     uint32_t participating_tunnels = 0;
+    uint32_t build_requests = 0;
+    uint32_t build_queue_wait = 0;
+    uint32_t build_accept_rate = 100;
+    uint32_t participating_dropped = 0;
+    uint32_t outbound_pending_bytes = 0;
+    uint32_t outbound_expired = 0;
+    std::unordered_map<std::string, uint32_t> tunnel_rejects;
     std::unordered_map<std::string, uint32_t> i2np_ib;
     std::unordered_map<std::string, uint32_t> i2np_ob;
+    std::unordered_map<std::string, uint32_t> queue_depth;
+    std::unordered_map<std::string, uint32_t> queue_dropped;
+    std::map<std::string, i2pcpp::Metrics::Histogram::Summary> latency;
     std::string json();
 };
 
-class StatsBackend : public sinks::basic_sink_backend<
-                          sinks::combine_requirements<
-                              sinks::synchronized_feeding
-                          >::type
-                      >
-{
+/**
+ * Reads the statistics shown on the console from the i2pcpp::Metrics
+ *  registry.
+ */
+class StatsBackend {
     public:
-        void consume(boost::log::record_view const& rec);
-
+        /**
+         * Takes a snapshot of the metrics and resets their counters, so
+         *  every call covers the time since the previous one.
+         */
         stats_t getStats();
-
-    private:
-        mutable std::mutex m_mutex;
-        stats_t m_stats;
 };
 
 #endif
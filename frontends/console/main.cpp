@@ -75,6 +75,15 @@ int main(int argc, char **argv)
             ("version,v", "Print application version")
             ("log,l", po::value<string>()->implicit_value("i2p.log"), "Log to file instead of clog")
 					  ("debug,d", "allow debug output");
+
+        po::options_description logDesc("Logging");
+        logDesc.add_options()
+            ("log-buffer", po::value<size_t>()->default_value(4096), "Number of log records buffered for the writer")
+            ("log-overflow", po::value<string>()->default_value("drop"), "What to do when the log buffer is full: drop, block or sample")
+            ("log-sample-rate", po::value<uint32_t>()->default_value(10), "Keep one in this many records below warning when sampling")
+            ("log-binary", "Write binary log records instead of text")
+            ("log-rotate-size", po::value<uint64_t>()->default_value(0), "Rotate the log file after this many megabytes, 0 to disable")
+            ("log-rotate-interval", po::value<uint32_t>()->default_value(0), "Rotate the log file after this many hours, 0 to disable");
 				
         po::options_description dbDesc("Database manipulation");
         dbDesc.add_options()
@@ -91,7 +100,7 @@ int main(int argc, char **argv)
             ("set", po::value<vector<string>>()->multitoken(), "Set a configuration setting (key value)");
 
         po::options_description all_opts;
-        all_opts.add(general).add(dbDesc).add(config);
+        all_opts.add(general).add(logDesc).add(dbDesc).add(config);
 
         po::variables_map vm;
 
@@ -100,6 +109,7 @@ int main(int argc, char **argv)
 
         if(vm.count("help")) {
             cout << general << endl;
+            cout << logDesc << endl;
             cout << dbDesc << endl;
             cout << config << endl;
 
@@ -132,13 +142,30 @@ int main(int argc, char **argv)
         Callbacks cb;
         Router r(db, cb);
 
-        if(vm.count("log")) {
-            // TODO Log rotation, etc
-   					Logger::logToFile(vm["log"].as<string>(), log_level);
-        } else {
-            Logger::logToConsole(log_level);
+        AsyncBackend::Options logOptions;
+        logOptions.capacity = vm["log-buffer"].as<size_t>();
+        logOptions.sampleRate = vm["log-sample-rate"].as<uint32_t>();
+        logOptions.binary = vm.count("log-binary");
+        logOptions.rotateSize = vm["log-rotate-size"].as<uint64_t>() * 1024 * 1024;
+        logOptions.rotateInterval = std::chrono::hours(vm["log-rotate-interval"].as<uint32_t>());
+
+        const string overflow = vm["log-overflow"].as<string>();
+        if(overflow == "drop")
+            logOptions.overflow = AsyncBackend::Overflow::DROP;
+        else if(overflow == "block")
+            logOptions.overflow = AsyncBackend::Overflow::BLOCK;
+        else if(overflow == "sample")
+            logOptions.overflow = AsyncBackend::Overflow::SAMPLE;
+        else {
+            cerr << "unknown log overflow policy: " << overflow << endl;
+            return EXIT_FAILURE;
         }
 
+        if(vm.count("log"))
+            Logger::logToFile(vm["log"].as<string>(), log_level, logOptions);
+        else
+            Logger::logToConsole(log_level, logOptions);
+
         if(vm.count("export")) {
             string file = vm["export"].as<string>();
             ofstream f(file, ios::binary);
@@ -9,6 +9,7 @@
 #include <i2pcpp/datatypes/RouterHash.h>
 
 #include <memory>
+#include <mutex>
 #include <string>
 #include <forward_list>
 #include <unordered_map>
@@ -27,10 +28,32 @@ namespace i2pcpp {
     class RouterInfo;
 
     /**
-     * An utility wrapper for the sqlite3 functionality.
+     * An utility wrapper for the sqlite3 functionality. All members may be
+     *  called from any thread, they share a single connection and its
+     *  prepared statements, so calls are serialized.
      */
     class Database {
         public:
+            /**
+             * The persisted part of a peer's profile.
+             * @see i2pcpp::ProfileManager
+             */
+            struct Profile {
+                uint64_t lastSeen = 0;
+                uint32_t buildSuccess = 0;
+                uint32_t buildFailure = 0;
+                uint32_t connectFailure = 0;
+
+                /// Tunnel build round trip time in milliseconds
+                uint32_t rtt = 0;
+
+                /// Bytes per second received from the peer
+                uint64_t throughput = 0;
+
+                /// When the counters were last decayed, in seconds since the epoch
+                uint64_t lastDecay = 0;
+            };
+
             /**
              * Constructs from a database file given by its name.
              * @param file the name of the database file
@@ -109,9 +132,29 @@ namespace i2pcpp {
              */
             std::forward_list<RouterHash> getAllHashes();
 
+            /**
+             * @return the stored profiles of all known routers
+             */
+            std::unordered_map<RouterHash, Profile> getProfiles();
+
+            /**
+             * Inserts or replaces the stored profiles. Profiles of routers
+             *  we no longer know about are skipped.
+             */
+            void setProfiles(std::unordered_map<RouterHash, Profile> const &profiles);
+
         private:
+            /**
+             * Adds the profile columns which databases created by older
+             *  versions lack.
+             */
+            void migrateProfiles();
+
             std::shared_ptr<sqlite::connection> m_conn;
 
+            /// Guards m_conn and the statement maps
+            mutable std::recursive_mutex m_mutex;
+
             static std::unordered_map<std::string, std::shared_ptr<sqlite::command>> commands;
             static std::unordered_map<std::string, std::shared_ptr<sqlite::query>> queries;
     };
@@ -1,6 +1,6 @@
 /**
  * @file Log.h
- * @brief Defines the i2pcpp::Log class.
+ * @brief Defines the i2pcpp::Log class and the logging macros.
  */
 #ifndef LOG_H
 #define LOG_H
@@ -13,13 +13,65 @@
 #include <boost/log/attributes/scoped_attribute.hpp>
 #include <boost/log/utility/manipulators/add_value.hpp>
 
-#define I2P_LOG(logger, sev) BOOST_LOG_SEV(logger, sev)
+#include <atomic>
+
+/**
+ * Records of a lower severity are compiled out. Set it with the
+ *  I2PCPP_LOG_LEVEL cmake variable, 0 (debug) to 4 (fatal).
+ */
+#ifndef I2PCPP_LOG_LEVEL
+#define I2PCPP_LOG_LEVEL 0
+#endif
+
+/**
+ * Starts a record of severity \a sev. Unless
+ *  i2pcpp::Log::isEnabled(sev), Boost.Log is not called and nothing
+ *  streamed in to the record is evaluated.
+ */
+#define I2P_LOG(logger, sev) \
+    if(!((int)i2pcpp::sev >= I2PCPP_LOG_LEVEL && i2pcpp::Log::isEnabled(i2pcpp::sev))) {} else BOOST_LOG_SEV(logger, i2pcpp::sev)
+
+/**
+ * Starts a record of severity \a sev tagged with \a name. The tag is
+ *  attached to this record only, and only if it is logged, so this is
+ *  what hot paths should use instead of I2P_LOG_SCOPED_TAG, which
+ *  changes the logger's attributes whether anything is logged or not.
+ */
+#define I2P_LOG_TAGGED(logger, sev, name, value) \
+    I2P_LOG(logger, sev) << boost::log::add_value(name, value)
+
 #define I2P_LOG_TAG(logger, name, value) logger.add_attribute(name, boost::log::attributes::make_constant(value))
 #define I2P_LOG_SCOPED_TAG(logger, name, value) BOOST_LOG_SCOPED_LOGGER_TAG(logger, name, value)
 #define I2P_LOG_CHANNEL(ch) boost::log::keywords::channel = ch
 
 namespace i2pcpp {
     typedef boost::log::sources::severity_channel_logger_mt<severity_level, std::string> i2p_logger_mt;
+
+    /**
+     * Holds the lowest severity logged at run time, which the frontend
+     *  sets to match its sinks. I2P_LOG checks it before a record is
+     *  opened, so a record below it costs a relaxed load rather than
+     *  the attribute lookups and filtering of Boost.Log.
+     */
+    class Log {
+        public:
+            static void setLevel(severity_level level)
+            {
+                getLevel().store(level, std::memory_order_relaxed);
+            }
+
+            static bool isEnabled(severity_level level)
+            {
+                return level >= getLevel().load(std::memory_order_relaxed);
+            }
+
+        private:
+            static std::atomic<int>& getLevel()
+            {
+                static std::atomic<int> level(debug);
+                return level;
+            }
+    };
 }
 
 #endif
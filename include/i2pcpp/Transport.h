@@ -18,9 +18,10 @@ namespace i2pcpp {
     class Transport {
         public:
             typedef boost::signals2::signal<void(const RouterHash, bool)> EstablishedSignal;
-            typedef boost::signals2::signal<void(const RouterHash, const uint32_t, const ByteArray)> ReceivedSignal;
+            typedef boost::signals2::signal<void(const RouterHash, const uint32_t, ByteArray const &)> ReceivedSignal;
             typedef boost::signals2::signal<void(const RouterHash)> FailureSignal;
             typedef boost::signals2::signal<void(const RouterHash)> DisconnectedSignal;
+            typedef boost::signals2::signal<void(const RouterHash)> ReadySignal;
 
             Transport() = default;
             Transport(const Transport &) = delete;
@@ -57,6 +58,14 @@ namespace i2pcpp {
              */
             virtual bool isConnected(RouterHash const &rh) const = 0;
 
+            /**
+             * @return the number of messages the transport takes for the
+             *  peer given by its i2pcpp::RouterHash \a rh before they would
+             *  have to wait in it. Once it is used up, the
+             *  i2pcpp::ReadySignal tells when there is room again.
+             */
+            virtual uint32_t getSendWindow(RouterHash const &rh) const;
+
             /**
              * Registers the i2pcpp::EstablishedSignal.
              */
@@ -77,6 +86,11 @@ namespace i2pcpp {
              */
             boost::signals2::connection registerDisconnectedSignal(DisconnectedSignal::slot_type const &ds);
 
+            /**
+             * Registers the i2pcpp::ReadySignal.
+             */
+            boost::signals2::connection registerReadySignal(ReadySignal::slot_type const &rs);
+
             /**
              * stop accepting new peers
              */
@@ -87,6 +101,7 @@ namespace i2pcpp {
             ReceivedSignal m_receivedSignal;
             FailureSignal m_failureSignal;
             DisconnectedSignal m_disconnectedSignal;
+            ReadySignal m_readySignal;
     };
 
     typedef std::shared_ptr<Transport> TransportPtr;
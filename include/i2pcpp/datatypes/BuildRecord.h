@@ -12,7 +12,9 @@
 #include <bitset>
 #include <memory>
 
-namespace Botan { class ElGamal_PrivateKey; }
+namespace Botan { class ElGamal_PrivateKey; class PK_Decryptor; }
+
+namespace i2pcpp { namespace ElGamal { struct Ephemeral; } }
 
 namespace i2pcpp {
     /**
@@ -42,12 +44,28 @@ namespace i2pcpp {
              */
             void encrypt(ByteArray const &encryptionKey);
 
+            /**
+             * Preforms ElGamal encryption using a precomputed ephemeral key,
+             *  which leaves only one modular exponentiation to do.
+             * @param encryptionKey the public key to be used for ElGamal encryption
+             * @param ephemeral an unused i2pcpp::ElGamal::Ephemeral
+             */
+            void encrypt(ByteArray const &encryptionKey, ElGamal::Ephemeral const &ephemeral);
+
             /**
              * Preforms ElGamal decryption on the build record data type.
              * @param key the private key to be used for ElGamal decryption
              */
             void decrypt(std::shared_ptr<const Botan::ElGamal_PrivateKey> key);
 
+            /**
+             * Preforms ElGamal decryption using an existing decryptor. This
+             *  avoids setting up a new decryptor for every record, which is
+             *  what the tunnel build workers rely on.
+             * @param decryptor a "Raw" EME decryptor over our private key
+             */
+            void decrypt(Botan::PK_Decryptor const &decryptor);
+
             /**
              * Preforms AES encryption on the build record data.
              * @param iv the 16 byte initialization vector for AES
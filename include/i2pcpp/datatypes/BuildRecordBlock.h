@@ -0,0 +1,96 @@
+/**
+ * @file BuildRecordBlock.h
+ * @brief Contains the definition of the i2pcpp::BuildRecordBlock type.
+ */
+#ifndef BUILDRECORDBLOCK_H
+#define BUILDRECORDBLOCK_H
+
+#include "BuildRecord.h"
+
+#include <memory>
+#include <vector>
+
+namespace i2pcpp {
+    /**
+     * The build records of a tunnel build message, kept in a single buffer
+     *  in their wire format. Every router a build passes through looks
+     *  for its own record, replaces it and encrypts all of them, so the
+     *  records are worked on in place rather than as separate objects.
+     */
+    class BuildRecordBlock {
+        public:
+            BuildRecordBlock() = default;
+
+            /**
+             * Constructs from the 1 byte record count followed by that many
+             *  records, given by an iterator to its begin and end.
+             * @throw std::runtime_error if the data is too short
+             */
+            BuildRecordBlock(ByteArrayConstItr &begin, ByteArrayConstItr end);
+
+            /**
+             * Constructs from individual i2pcpp::BuildRecord objects.
+             */
+            BuildRecordBlock(std::vector<BuildRecord> const &records);
+
+            /**
+             * Serializes the block as the 1 byte record count followed by
+             *  the records.
+             */
+            ByteArray serialize() const;
+
+            /**
+             * @return the number of records
+             */
+            size_t size() const;
+
+            /**
+             * @return a copy of record \a i
+             */
+            BuildRecord get(size_t i) const;
+
+            /**
+             * Replaces record \a i with \a r.
+             */
+            void set(size_t i, BuildRecord const &r);
+
+            /**
+             * @return the record \a i in its wire format, RECORD_SIZE bytes
+             */
+            unsigned char *getRecord(size_t i);
+            const unsigned char *getRecord(size_t i) const;
+
+            /**
+             * Finds the record whose header, the first 16 bytes of the
+             *  router hash it is for, is \a header.
+             * @return the index of the record, or size() if there is none
+             */
+            size_t find(StaticByteArray<16> const &header) const;
+
+            /**
+             * AES encrypts every record in place, each as a separate CBC
+             *  message, as i2pcpp::BuildRecord::encrypt would.
+             */
+            void encrypt(StaticByteArray<16> const &iv, SessionKey const &key);
+
+            /**
+             * AES decrypts the first \a count records in place.
+             */
+            void decrypt(StaticByteArray<16> const &iv, SessionKey const &key, size_t count);
+
+            /**
+             * AES decrypts every record in place.
+             */
+            void decrypt(StaticByteArray<16> const &iv, SessionKey const &key);
+
+            /// The size of a record: a 16 byte header and 512 bytes of data
+            static const size_t RECORD_SIZE = 528;
+
+        private:
+            ByteArray m_records;
+    };
+
+    typedef std::shared_ptr<BuildRecordBlock> BuildRecordBlockPtr;
+}
+
+#endif
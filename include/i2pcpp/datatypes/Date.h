@@ -40,6 +40,11 @@ namespace i2pcpp {
              */
             ByteArray serialize() const;
 
+            /**
+             * @return the number of milliseconds since the unix epoch
+             */
+            uint64_t getValue() const;
+
         private:
             /// The underlying uint64 representing the timestamp
             uint64_t m_value;
@@ -20,6 +20,17 @@ namespace i2pcpp {
             friend class Context;
 
             public:
+                /**
+                 * Counters kept by the transport since it was started.
+                 */
+                struct Stats {
+                    uint64_t fragmentsSent; ///< Data fragments sent, including retransmissions
+                    uint64_t fragmentsRetransmitted; ///< Data fragments sent again because they were not ACK'd
+                    uint64_t packetsReplayed; ///< Packets dropped by the replay filter
+                    uint64_t packetsSkewed; ///< Packets dropped because of clock skew
+                };
+
+
                 /**
                  * Constructs an SSU transport given a private DSA key and
                  * RouterIdentity. The DSA key is used for signing and the
@@ -53,6 +64,25 @@ namespace i2pcpp {
 
                 bool isConnected(RouterHash const &rh) const;
 
+                /**
+                 * The window is what is left of
+                 *  i2pcpp::SSU::OutboundMessageFragments::MAX_IN_FLIGHT
+                 *  messages which have not been ACK'd yet.
+                 */
+                uint32_t getSendWindow(RouterHash const &rh) const;
+
+                /**
+                 * Sets how long received fragments may wait before they
+                 *  are acknowledged. Zero acknowledges them immediately.
+                 * @param ms the delay in milliseconds
+                 */
+                void setAckDelay(uint32_t ms);
+
+                /**
+                 * @return a snapshot of the transport's counters
+                 */
+                Stats getStats() const;
+
                 /**
                  * Stops the transport. That is, iterates over all connected peers and sends
                  *  them a session destroyed i2pcpp::Destroyed. Then stops the IO service
@@ -0,0 +1,87 @@
+#ifndef ELGAMAL_H
+#define ELGAMAL_H
+
+#include <botan/bigint.h>
+#include <botan/rng.h>
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace i2pcpp {
+    namespace ElGamal {
+        /**
+         * The half of an ElGamal encryption which does not depend on the
+         *  recipient: a random exponent k and g^k mod p. Computing g^k is
+         *  one of the two modular exponentiations of every encryption, so
+         *  these can be prepared ahead of time.
+         * @note Each one must only ever be used for a single encryption.
+         */
+        struct Ephemeral {
+            Botan::BigInt k;
+            Botan::BigInt gk;
+        };
+
+        /**
+         * Generates a new i2pcpp::ElGamal::Ephemeral in the 2048 bit group.
+         */
+        Ephemeral generate(Botan::RandomNumberGenerator &rng);
+
+        /**
+         * Encrypts \a msg for the holder of \a publicKey. The output is the
+         *  same as Botan's "Raw" EME encryptor: g^k followed by m * y^k,
+         *  each 256 bytes.
+         * @param publicKey the recipient's 256 byte public key
+         * @param ephemeral a fresh i2pcpp::ElGamal::Ephemeral
+         * @return the 512 byte ciphertext
+         */
+        std::vector<unsigned char> encrypt(std::vector<unsigned char> const &publicKey, const unsigned char *msg, size_t length, Ephemeral const &ephemeral);
+
+        /**
+         * A thread safe pool of precomputed ephemerals. Idle threads call
+         *  refill() to keep it topped up, so that encryption only has the
+         *  recipient dependent exponentiation left to do.
+         */
+        class EphemeralPool {
+            public:
+                /**
+                 * @param capacity the number of ephemerals to keep ready
+                 */
+                EphemeralPool(size_t capacity = DEFAULT_CAPACITY);
+                EphemeralPool(const EphemeralPool &) = delete;
+                EphemeralPool& operator=(EphemeralPool &) = delete;
+
+                /**
+                 * Takes an ephemeral out of the pool. If the pool is empty, one
+                 *  is generated on the spot.
+                 */
+                Ephemeral take(Botan::RandomNumberGenerator &rng);
+
+                /**
+                 * Generates one ephemeral if the pool is not full.
+                 * @return true if the pool still needs more
+                 */
+                bool refill(Botan::RandomNumberGenerator &rng);
+
+                size_t size() const;
+
+                /**
+                 * @return the number of times take() found the pool empty
+                 */
+                uint64_t getMisses() const;
+
+                static const size_t DEFAULT_CAPACITY = 64;
+
+            private:
+                std::vector<Ephemeral> m_ephemerals;
+                size_t m_capacity;
+
+                std::atomic<uint64_t> m_misses;
+
+                mutable std::mutex m_mutex;
+        };
+    }
+}
+
+#endif
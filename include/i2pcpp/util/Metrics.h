@@ -0,0 +1,207 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+
+namespace i2pcpp {
+    /**
+     * Process wide counters, gauges and histograms. Metrics are looked up
+     *  by name once, which takes a lock, and the returned reference is kept
+     *  by the caller; updating a metric only touches atomics. Names are
+     *  dotted paths, e.g. "i2np.received.TD". Latencies are recorded in
+     *  histograms named "latency.<stage>", in microseconds.
+     */
+    namespace Metrics {
+        /// The number of shards a counter is split in to
+        const size_t NUM_SHARDS = 16;
+
+        /**
+         * @return the shard of the calling thread, between 0 and
+         *  NUM_SHARDS - 1
+         */
+        size_t getShard();
+
+        /**
+         * A monotonically increasing count, split across shards so that
+         *  threads updating it at the same time do not share a cache line.
+         */
+        class Counter {
+            public:
+                Counter() = default;
+                Counter(const Counter &) = delete;
+                Counter& operator=(Counter &) = delete;
+
+                void add(uint64_t n = 1)
+                {
+                    m_shards[getShard()].value.fetch_add(n, std::memory_order_relaxed);
+                }
+
+                /**
+                 * @return the sum over all shards
+                 */
+                uint64_t value() const;
+
+                /**
+                 * Sets the counter to zero.
+                 * @return the value it had, nothing added concurrently is
+                 *  lost
+                 */
+                uint64_t reset();
+
+            private:
+                struct Shard {
+                    std::atomic<uint64_t> value{0};
+                    char pad[64 - sizeof(std::atomic<uint64_t>)];
+                };
+
+                std::array<Shard, NUM_SHARDS> m_shards;
+        };
+
+        /**
+         * A value which is set rather than accumulated, such as a queue
+         *  depth.
+         */
+        class Gauge {
+            public:
+                Gauge() = default;
+                Gauge(const Gauge &) = delete;
+                Gauge& operator=(Gauge &) = delete;
+
+                void set(int64_t v)
+                {
+                    m_value.store(v, std::memory_order_relaxed);
+                }
+
+                void add(int64_t n)
+                {
+                    m_value.fetch_add(n, std::memory_order_relaxed);
+                }
+
+                int64_t value() const
+                {
+                    return m_value.load(std::memory_order_relaxed);
+                }
+
+            private:
+                std::atomic<int64_t> m_value{0};
+        };
+
+        /**
+         * A distribution of values in log-linear buckets: every power of two
+         *  is split in to SUB_BUCKETS equal buckets, so percentiles are
+         *  exact to within 1/SUB_BUCKETS of the value.
+         */
+        class Histogram {
+            public:
+                struct Summary {
+                    uint64_t count = 0;
+                    uint64_t sum = 0;
+                    uint64_t p50 = 0;
+                    uint64_t p90 = 0;
+                    uint64_t p99 = 0;
+                    uint64_t max = 0;
+                };
+
+                Histogram() = default;
+                Histogram(const Histogram &) = delete;
+                Histogram& operator=(Histogram &) = delete;
+
+                void record(uint64_t v);
+
+                /**
+                 * @param reset whether to empty the histogram, values
+                 *  recorded concurrently are kept for the next summary
+                 */
+                Summary summarize(bool reset = false);
+
+                /**
+                 * @return the index of the bucket \a v falls in
+                 */
+                static size_t getBucket(uint64_t v);
+
+                /**
+                 * @return the largest value which falls in \a bucket
+                 */
+                static uint64_t getUpperBound(size_t bucket);
+
+                static const size_t SUB_BUCKET_BITS = 3;
+                static const size_t SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+                static const size_t BUCKET_COUNT = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+            private:
+                std::array<std::atomic<uint64_t>, BUCKET_COUNT> m_buckets = {};
+                std::atomic<uint64_t> m_sum{0};
+                std::atomic<uint64_t> m_max{0};
+        };
+
+        /**
+         * @return the time in microseconds on a monotonic clock, only the
+         *  difference between two calls is meaningful
+         */
+        inline uint64_t now()
+        {
+            return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        /**
+         * Records the time between its construction and its destruction
+         *  in a histogram.
+         */
+        class ScopedTimer {
+            public:
+                explicit ScopedTimer(Histogram &h) :
+                    m_histogram(h),
+                    m_start(now()) {}
+
+                ScopedTimer(const ScopedTimer &) = delete;
+                ScopedTimer& operator=(ScopedTimer &) = delete;
+
+                ~ScopedTimer()
+                {
+                    m_histogram.record(now() - m_start);
+                }
+
+            private:
+                Histogram &m_histogram;
+                uint64_t m_start;
+        };
+
+        /**
+         * The values of all metrics at one point in time.
+         */
+        struct Snapshot {
+            std::map<std::string, uint64_t> counters;
+            std::map<std::string, int64_t> gauges;
+            std::map<std::string, Histogram::Summary> histograms;
+        };
+
+        /**
+         * @return the counter called \a name, created on first use
+         */
+        Counter& counter(std::string const &name);
+
+        /**
+         * @return the gauge called \a name, created on first use
+         */
+        Gauge& gauge(std::string const &name);
+
+        /**
+         * @return the histogram called \a name, created on first use
+         */
+        Histogram& histogram(std::string const &name);
+
+        /**
+         * @param reset whether to zero the counters and empty the
+         *  histograms, so the next snapshot covers only the time since
+         *  this one. Gauges are never reset.
+         */
+        Snapshot snapshot(bool reset = false);
+    }
+}
+
+#endif
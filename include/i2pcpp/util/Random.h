@@ -0,0 +1,55 @@
+#ifndef RANDOM_H
+#define RANDOM_H
+
+#include <botan/rng.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace i2pcpp {
+    /**
+     * Random numbers for the hot paths (IVs, padding, message and tunnel
+     *  IDs). Every thread has its own ChaCha20 generator, seeded from a
+     *  Botan::AutoSeeded_RNG the first time the thread asks for random
+     *  data and reseeded after RESEED_BYTES or RESEED_INTERVAL, so neither
+     *  the operating system nor a lock is involved per call.
+     */
+    namespace Random {
+        /**
+         * Fills \a len bytes at \a buf with random data.
+         */
+        void randomize(unsigned char *buf, size_t len);
+
+        /**
+         * @return a random value of the integral type \a T
+         */
+        template<typename T>
+        T get()
+        {
+            T value;
+            randomize((unsigned char *)&value, sizeof(value));
+            return value;
+        }
+
+        /**
+         * Reseeds the generator of the calling thread.
+         */
+        void reseed();
+
+        /**
+         * @return the Botan::RandomNumberGenerator of the calling thread,
+         *  for the Botan APIs which take one (key generation, signing).
+         *  It is seeded once per thread rather than once per call.
+         */
+        Botan::RandomNumberGenerator& getRNG();
+
+        /// Bytes generated before the ChaCha20 key is reseeded
+        const uint64_t RESEED_BYTES = 1 << 20;
+
+        /// Time after which the ChaCha20 key is reseeded
+        const std::chrono::minutes RESEED_INTERVAL(5);
+    }
+}
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef TOKENBUCKET_H
+#define TOKENBUCKET_H
+
+#include <chrono>
+#include <cstdint>
+
+namespace i2pcpp {
+    /**
+     * A token bucket for shaping traffic to a byte rate.
+     * Tokens accumulate at \a rate bytes per second, up to \a burst bytes.
+     * A rate of zero means unlimited.
+     * @note Not thread safe, callers are expected to serialise access.
+     */
+    class TokenBucket {
+        public:
+            /**
+             * @param rate bytes per second, 0 for unlimited
+             * @param burst the bucket size in bytes, defaults to one
+             *  second worth of tokens
+             */
+            TokenBucket(uint64_t rate = 0, uint64_t burst = 0);
+
+            /**
+             * Takes \a bytes tokens if they are available.
+             * @return false if there were not enough tokens, in which case
+             *  none are taken
+             */
+            bool consume(uint64_t bytes);
+
+            /**
+             * @return true if consume(\a bytes) would succeed now. Nothing
+             *  is taken, so buckets which must all pass can be checked
+             *  before any of them is charged.
+             */
+            bool available(uint64_t bytes);
+
+            /**
+             * Takes \a bytes tokens unconditionally. The bucket may go in to
+             *  debt, up to one bucket's worth, which later consume() calls
+             *  have to pay back first.
+             */
+            void charge(uint64_t bytes);
+
+            void setRate(uint64_t rate, uint64_t burst = 0);
+            uint64_t getRate() const;
+
+        private:
+            typedef std::chrono::steady_clock Clock;
+
+            void refill();
+
+            uint64_t m_rate;
+            int64_t m_burst;
+            int64_t m_tokens;
+            Clock::time_point m_last;
+    };
+}
+
+#endif
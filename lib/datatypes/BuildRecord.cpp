@@ -4,7 +4,9 @@
  */
 #include <i2pcpp/datatypes/BuildRecord.h>
 
-#include <botan/auto_rng.h>
+#include <i2pcpp/util/ElGamal.h>
+#include <i2pcpp/util/Random.h>
+
 #include <botan/pipe.h>
 #include <botan/pk_filts.h>
 #include <botan/lookup.h>
@@ -30,6 +32,11 @@ namespace i2pcpp {
     }
 
     void BuildRecord::encrypt(ByteArray const &encryptionKey)
+    {
+        encrypt(encryptionKey, ElGamal::generate(Random::getRNG()));
+    }
+
+    void BuildRecord::encrypt(ByteArray const &encryptionKey, ElGamal::Ephemeral const &ephemeral)
     {
         // First hash the data
         Botan::Pipe hashPipe(new Botan::Hash_Filter("SHA-256"));
@@ -46,19 +53,19 @@ namespace i2pcpp {
         toEncrypt.insert(toEncrypt.end(), m_data.cbegin(), m_data.cbegin() + 222);
 
         // Perform the encryption
-        Botan::AutoSeeded_RNG rng;
-        Botan::DL_Group group("modp/ietf/2048");
-        Botan::ElGamal_PublicKey elgKey(group, Botan::BigInt(encryptionKey.data(), encryptionKey.size()));
-        Botan::PK_Encryptor *pke = new Botan::PK_Encryptor_EME(elgKey, "Raw");
-        m_data = toStaticByteArray<512>(pke->encrypt(toEncrypt, rng));
+        m_data = toStaticByteArray<512>(ElGamal::encrypt(encryptionKey, toEncrypt.data(), toEncrypt.size(), ephemeral));
     }
 
     void BuildRecord::decrypt(std::shared_ptr<const Botan::ElGamal_PrivateKey> key)
+    {
+        Botan::PK_Decryptor_EME pkd(*key, "Raw");
+        decrypt(pkd);
+    }
+
+    void BuildRecord::decrypt(Botan::PK_Decryptor const &decryptor)
     {
         // Decrypt
-        Botan::DL_Group group("modp/ietf/2048");
-        Botan::PK_Decryptor *pkd = new Botan::PK_Decryptor_EME(*key, "Raw");
-        Botan::secure_vector<Botan::byte> decrypted = pkd->decrypt(m_data.data(), 512);
+        Botan::secure_vector<Botan::byte> decrypted = decryptor.decrypt(m_data.data(), 512);
 
         // Parse
         auto dataItr = decrypted.cbegin();
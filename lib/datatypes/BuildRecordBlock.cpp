@@ -0,0 +1,123 @@
+/**
+ * @file BuildRecordBlock.cpp
+ * @brief Implements BuildRecordBlock.h
+ */
+#include <i2pcpp/datatypes/BuildRecordBlock.h>
+
+#include <i2pcpp/util/xor_buf.h>
+
+#include <botan/aes.h>
+
+#include <array>
+#include <stdexcept>
+
+namespace i2pcpp {
+    BuildRecordBlock::BuildRecordBlock(ByteArrayConstItr &begin, ByteArrayConstItr end)
+    {
+        if(begin == end)
+            throw std::runtime_error("malformed BuildRecordBlock");
+
+        size_t count = *begin++;
+        if((size_t)std::distance(begin, end) < count * RECORD_SIZE)
+            throw std::runtime_error("malformed BuildRecordBlock");
+
+        m_records.assign(begin, begin + count * RECORD_SIZE);
+        begin += count * RECORD_SIZE;
+    }
+
+    BuildRecordBlock::BuildRecordBlock(std::vector<BuildRecord> const &records) :
+        m_records(records.size() * RECORD_SIZE)
+    {
+        for(size_t i = 0; i < records.size(); i++)
+            set(i, records[i]);
+    }
+
+    ByteArray BuildRecordBlock::serialize() const
+    {
+        ByteArray b;
+        b.reserve(1 + m_records.size());
+
+        b.push_back(size());
+        b.insert(b.end(), m_records.cbegin(), m_records.cend());
+
+        return b;
+    }
+
+    size_t BuildRecordBlock::size() const
+    {
+        return m_records.size() / RECORD_SIZE;
+    }
+
+    BuildRecord BuildRecordBlock::get(size_t i) const
+    {
+        ByteArrayConstItr begin = m_records.cbegin() + i * RECORD_SIZE;
+        return BuildRecord(begin, begin + RECORD_SIZE);
+    }
+
+    void BuildRecordBlock::set(size_t i, BuildRecord const &r)
+    {
+        const ByteArray b = r.serialize();
+        std::copy(b.cbegin(), b.cend(), getRecord(i));
+    }
+
+    unsigned char *BuildRecordBlock::getRecord(size_t i)
+    {
+        return m_records.data() + i * RECORD_SIZE;
+    }
+
+    const unsigned char *BuildRecordBlock::getRecord(size_t i) const
+    {
+        return m_records.data() + i * RECORD_SIZE;
+    }
+
+    size_t BuildRecordBlock::find(StaticByteArray<16> const &header) const
+    {
+        for(size_t i = 0; i < size(); i++)
+            if(std::equal(header.cbegin(), header.cend(), getRecord(i)))
+                return i;
+
+        return size();
+    }
+
+    void BuildRecordBlock::encrypt(StaticByteArray<16> const &iv, SessionKey const &key)
+    {
+        Botan::AES_256 cipher;
+        cipher.set_key(key.data(), key.size());
+
+        for(size_t i = 0; i < size(); i++) {
+            unsigned char *block = getRecord(i);
+            const unsigned char *prev = iv.data();
+
+            for(size_t j = 0; j < RECORD_SIZE; j += 16, block += 16) {
+                Botan::xor_buf(block, prev, 16);
+                cipher.encrypt(block);
+                prev = block;
+            }
+        }
+    }
+
+    void BuildRecordBlock::decrypt(StaticByteArray<16> const &iv, SessionKey const &key, size_t count)
+    {
+        Botan::AES_256 cipher;
+        cipher.set_key(key.data(), key.size());
+
+        /* CBC decryption of all blocks of a record can be done at once,
+         * each block is then XORed with the ciphertext before it.
+         */
+        std::array<unsigned char, RECORD_SIZE> plain;
+        for(size_t i = 0; i < std::min(count, size()); i++) {
+            unsigned char *record = getRecord(i);
+
+            cipher.decrypt_n(record, plain.data(), RECORD_SIZE / 16);
+            Botan::xor_buf(plain.data(), iv.data(), 16);
+            Botan::xor_buf(plain.data() + 16, record, RECORD_SIZE - 16);
+
+            std::copy(plain.cbegin(), plain.cend(), record);
+        }
+    }
+
+    void BuildRecordBlock::decrypt(StaticByteArray<16> const &iv, SessionKey const &key)
+    {
+        decrypt(iv, key, size());
+    }
+}
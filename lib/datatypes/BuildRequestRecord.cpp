@@ -6,7 +6,7 @@
 
 #include <i2pcpp/datatypes/RouterIdentity.h>
 
-#include <botan/auto_rng.h>
+#include <i2pcpp/util/Random.h>
 
 namespace i2pcpp {
     BuildRequestRecord::BuildRequestRecord(BuildRecord const &r) :
@@ -18,9 +18,7 @@ namespace i2pcpp {
         m_encryptionKey(local.getEncryptionKey()),
         m_requestTime(std::chrono::duration_cast<std::chrono::hours>(std::chrono::system_clock::now().time_since_epoch()).count())
     {
-        Botan::AutoSeeded_RNG rng;
-
-        rng.randomize((unsigned char *)&m_nextTunnelId, sizeof(m_nextTunnelId));
+        Random::randomize((unsigned char *)&m_nextTunnelId, sizeof(m_nextTunnelId));
 
         randomize();
     }
@@ -243,13 +241,11 @@ namespace i2pcpp {
 
     void BuildRequestRecord::randomize()
     {
-        Botan::AutoSeeded_RNG rng;
-
-        rng.randomize((unsigned char *)&m_tunnelId, sizeof(m_tunnelId));
-        rng.randomize(m_tunnelLayerKey.data(), m_tunnelLayerKey.size());
-        rng.randomize(m_tunnelIVKey.data(), m_tunnelIVKey.size());
-        rng.randomize(m_replyKey.data(), m_replyKey.size());
-        rng.randomize(m_replyIV.data(), m_replyIV.size());
-        rng.randomize((unsigned char *)&m_nextMsgId, sizeof(m_nextMsgId));
+        Random::randomize((unsigned char *)&m_tunnelId, sizeof(m_tunnelId));
+        Random::randomize(m_tunnelLayerKey.data(), m_tunnelLayerKey.size());
+        Random::randomize(m_tunnelIVKey.data(), m_tunnelIVKey.size());
+        Random::randomize(m_replyKey.data(), m_replyKey.size());
+        Random::randomize(m_replyIV.data(), m_replyIV.size());
+        Random::randomize((unsigned char *)&m_nextMsgId, sizeof(m_nextMsgId));
     }
 }
@@ -4,9 +4,10 @@
  */
 #include <i2pcpp/datatypes/BuildResponseRecord.h>
 
+#include <i2pcpp/util/Random.h>
+
 #include <stdexcept>
 
-#include <botan/auto_rng.h>
 #include <botan/pipe.h>
 #include <botan/lookup.h>
 
@@ -39,9 +40,7 @@ namespace i2pcpp {
 
     void BuildResponseRecord::compile()
     {
-        Botan::AutoSeeded_RNG rng;
-
-        rng.randomize(m_data.data() + 16, 495);
+        Random::randomize(m_data.data() + 16, 495);
         m_data[511] = (unsigned char)m_reply;
 
         Botan::Pipe hashPipe(new Botan::Hash_Filter("SHA-256"));
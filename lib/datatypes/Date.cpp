@@ -34,4 +34,9 @@ namespace i2pcpp {
 
         return v;
     }
+
+    uint64_t Date::getValue() const
+    {
+        return m_value;
+    }
 }
@@ -5,11 +5,11 @@
 #include <i2pcpp/datatypes/RouterInfo.h>
 
 #include <i2pcpp/util/I2PDH.h>
+#include <i2pcpp/util/Random.h>
 
 #include <botan/pipe.h>
 #include <botan/pubkey.h>
 #include <botan/pk_filts.h>
-#include <botan/auto_rng.h>
 #include <botan/pipe.h>
 #include <botan/lookup.h>
 #include <botan/dsa.h>
@@ -81,11 +81,10 @@ namespace i2pcpp {
         ByteArray hash(20);
         hashPipe.read(hash.data(), 20);
 
-        Botan::AutoSeeded_RNG rng;
         std::unique_ptr<Botan::PK_Signer> pks(
             new Botan::PK_Signer(*signingKey, "Raw")
         );
-        m_signature = pks->sign_message(hash, rng);
+        m_signature = pks->sign_message(hash, Random::getRNG());
     }
 
     const RouterAddress& RouterInfo::getAddress(const int index) const
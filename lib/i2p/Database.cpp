@@ -20,6 +20,8 @@
 
 #include <boost/tokenizer.hpp>
 
+#include <set>
+
 extern uint8_t _binary_schema_sql_start[];
 extern uintptr_t _binary_schema_sql_size[];
 
@@ -34,6 +36,7 @@ namespace i2pcpp {
             m_conn->exec("PRAGMA foreign_keys=ON");
             m_conn->exec("PRAGMA synchronous=OFF");
             m_conn->exec("PRAGMA temp_store=MEMORY");
+            migrateProfiles();
         } catch(sqlite::sqlite_error &e) {
             throw std::runtime_error("could not open database");
         }
@@ -103,8 +106,28 @@ namespace i2pcpp {
         }
     }
 
+    void Database::migrateProfiles()
+    {
+        static const char *columns[] = { "build_success", "build_failure", "connect_failure", "rtt", "throughput", "last_decay" };
+
+        std::set<std::string> existing;
+        auto q = m_conn->make_query("PRAGMA table_info(profiles)");
+        while(auto r = q->step())
+            existing.insert(r.column<std::string>(1));
+
+        // The table itself is created by createDb()
+        if(existing.empty())
+            return;
+
+        for(auto c: columns)
+            if(!existing.count(c))
+                m_conn->exec(std::string("ALTER TABLE profiles ADD COLUMN \"") + c + "\" INTEGER NOT NULL DEFAULT 0");
+    }
+
     std::string Database::getConfigValue(std::string const &name)
     {
+        std::lock_guard<std::recursive_mutex> lock(m_mutex);
+
         auto q = Database::queries["get_config"];
         statement_guard sg(q, name);
 
@@ -119,11 +142,15 @@ namespace i2pcpp {
 
     void Database::setConfigValue(std::string const &name, std::string const &value)
     {
+        std::lock_guard<std::recursive_mutex> lock(m_mutex);
+
         statement_guard sg(Database::commands["set_config"], name, value, sqlite::exec);
     }
 
     RouterHash Database::getRandomRouter()
     {
+        std::lock_guard<std::recursive_mutex> lock(m_mutex);
+
         // SELECT router_id FROM router_options WHERE router_options.name='caps' AND router_options.value LIKE '%f%' ORDER BY RANDOM() LIMIT 1;
         auto q = Database::queries["get_random_router"];
         statement_guard sg(q);
@@ -139,6 +166,8 @@ namespace i2pcpp {
 
     bool Database::routerExists(RouterHash const &routerHash)
     {
+        std::lock_guard<std::recursive_mutex> lock(m_mutex);
+
         auto q = Database::queries["router_exists"];
         statement_guard sg(q, Base64::encode(routerHash));
 
@@ -149,11 +178,15 @@ namespace i2pcpp {
 
     RouterInfo Database::getRouterInfo(RouterHash const &routerHash)
     {
+        std::lock_guard<std::recursive_mutex> lock(m_mutex);
+
         return getRouterInfo(Base64::encode(routerHash));
     }
 
     RouterInfo Database::getRouterInfo(std::string const &routerHash)
     {
+        std::lock_guard<std::recursive_mutex> lock(m_mutex);
+
         sqlite::transaction_guard<> t(*m_conn);
         auto q = Database::queries["get_router_raw"];
         statement_guard sg(q, routerHash);
@@ -247,6 +280,8 @@ namespace i2pcpp {
 
     void Database::deleteRouter(RouterHash const &rh)
     {
+        std::lock_guard<std::recursive_mutex> lock(m_mutex);
+
         sqlite::transaction_guard<> t(*m_conn);
 
         statement_guard sg1(Database::commands["delete_profile"], rh, sqlite::exec);
@@ -260,6 +295,8 @@ namespace i2pcpp {
 
     void Database::deleteAllRouters()
     {
+        std::lock_guard<std::recursive_mutex> lock(m_mutex);
+
         sqlite::transaction_guard<> t(*m_conn);
 
         statement_guard sg1(Database::commands["truncate_profiles"], sqlite::exec);
@@ -273,6 +310,8 @@ namespace i2pcpp {
 
     void Database::setRouterInfo(std::vector<RouterInfo> const &routers)
     {
+        std::lock_guard<std::recursive_mutex> lock(m_mutex);
+
         sqlite::transaction_guard<> t(*m_conn);
 
         for(auto& r: routers)
@@ -283,6 +322,8 @@ namespace i2pcpp {
 
     void Database::setRouterInfo(RouterInfo const &info)
     {
+        std::lock_guard<std::recursive_mutex> lock(m_mutex);
+
         sqlite::recursive_transaction t(*m_conn);
 
         t.begin();
@@ -318,6 +359,8 @@ namespace i2pcpp {
 
     std::forward_list<RouterHash> Database::getAllHashes()
     {
+        std::lock_guard<std::recursive_mutex> lock(m_mutex);
+
         std::forward_list<RouterHash> hashes;
 
         auto q = m_conn->make_query("SELECT id FROM routers_raw");
@@ -330,4 +373,38 @@ namespace i2pcpp {
 
         return hashes;
     }
+
+    std::unordered_map<RouterHash, Database::Profile> Database::getProfiles()
+    {
+        std::lock_guard<std::recursive_mutex> lock(m_mutex);
+
+        std::unordered_map<RouterHash, Profile> profiles;
+
+        auto q = m_conn->make_query("SELECT router_id, IFNULL(last_seen, 0), build_success, build_failure, connect_failure, rtt, throughput, last_decay FROM profiles");
+
+        while(auto r = q->step()) {
+            std::string rhStr;
+            Profile p;
+            r >> rhStr >> p.lastSeen >> p.buildSuccess >> p.buildFailure >> p.connectFailure >> p.rtt >> p.throughput >> p.lastDecay;
+            profiles[toRouterHash(Base64::decode(rhStr))] = p;
+        }
+
+        return profiles;
+    }
+
+    void Database::setProfiles(std::unordered_map<RouterHash, Profile> const &profiles)
+    {
+        std::lock_guard<std::recursive_mutex> lock(m_mutex);
+
+        sqlite::transaction_guard<> t(*m_conn);
+
+        auto c = m_conn->make_command("INSERT OR REPLACE INTO profiles(router_id, last_seen, build_success, build_failure, connect_failure, rtt, throughput, last_decay) SELECT ?, ?, ?, ?, ?, ?, ?, ? WHERE EXISTS (SELECT 1 FROM routers_raw WHERE id = ?)");
+
+        for(auto& p: profiles) {
+            std::string rh = Base64::encode(p.first);
+            statement_guard sg(c, rh, p.second.lastSeen, p.second.buildSuccess, p.second.buildFailure, p.second.connectFailure, p.second.rtt, p.second.throughput, p.second.lastDecay, rh, sqlite::exec);
+        }
+
+        t.commit();
+    }
 }
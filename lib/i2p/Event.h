@@ -0,0 +1,82 @@
+/**
+ * @file Event.h
+ * @brief Defines the i2pcpp::Event template.
+ */
+#ifndef EVENT_H
+#define EVENT_H
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace i2pcpp {
+    /**
+     * A typed event with any number of handlers, invoked in the order they
+     *  were connected. Handlers are connected once while the router starts
+     *  and events are then invoked for every message, so the handler list
+     *  is immutable: connecting copies it and swaps the new list in, and
+     *  invoking is a single atomic load of the current one. Replaced lists
+     *  are kept until the event is destroyed, since an invocation on
+     *  another thread may still be walking them. Arguments are passed to
+     *  every handler by const reference, never copied.
+     */
+    template<typename... Args>
+    class Event {
+        public:
+            typedef std::function<void(Args const &...)> Handler;
+            typedef void result_type;
+
+            Event()
+            {
+                m_lists.emplace_back(new const std::vector<Handler>());
+                m_handlers = m_lists.back().get();
+            }
+            Event(const Event &) = delete;
+            Event& operator=(Event &) = delete;
+
+            /**
+             * Adds \a h to the handlers called when the event is invoked.
+             */
+            void connect(Handler h)
+            {
+                std::lock_guard<std::mutex> lock(m_connectMutex);
+
+                std::unique_ptr<std::vector<Handler>> handlers(new std::vector<Handler>(*m_handlers.load()));
+                handlers->push_back(std::move(h));
+
+                m_handlers.store(handlers.get(), std::memory_order_release);
+                m_lists.push_back(std::move(handlers));
+            }
+
+            /**
+             * Calls every handler with \a args on the current thread.
+             */
+            void operator()(Args const &... args) const
+            {
+                const auto handlers = m_handlers.load(std::memory_order_acquire);
+                for(auto& h: *handlers)
+                    h(args...);
+            }
+
+            /**
+             * @return true if no handlers are connected
+             */
+            bool empty() const
+            {
+                return m_handlers.load(std::memory_order_acquire)->empty();
+            }
+
+        private:
+            std::atomic<const std::vector<Handler> *> m_handlers;
+
+            /// Every list m_handlers has pointed to, the last is the current one
+            std::vector<std::unique_ptr<const std::vector<Handler>>> m_lists;
+
+            /// Serializes connect() only, invoking never takes it
+            std::mutex m_connectMutex;
+    };
+}
+
+#endif
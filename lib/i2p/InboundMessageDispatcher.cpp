@@ -10,12 +10,12 @@
 #include "i2np/DatabaseStore.h"
 
 #include <i2pcpp/util/gzip.h>
+#include <i2pcpp/util/Random.h>
 #include <i2pcpp/datatypes/RouterInfo.h>
 
 #include <boost/bind.hpp>
 #include <boost/asio.hpp>
 
-#include <botan/auto_rng.h>
 #include <botan/pipe.h>
 
 #include <iomanip>
@@ -31,75 +31,93 @@ namespace i2pcpp {
         m_variableTunnelBuildReplyHandler(ctx),
         m_tunnelDataHandler(ctx),
         m_tunnelGatewayHandler(ctx),
-        m_log(I2P_LOG_CHANNEL("IMD")) {}
+        m_parseTime(Metrics::histogram("latency.i2np.parse")),
+        m_handlerTime(Metrics::histogram("latency.i2np.handler")),
+        m_log(I2P_LOG_CHANNEL("IMD"))
+    {
+        for(size_t i = 0; i < m_received.size(); i++)
+            m_received[i] = &Metrics::counter("i2np.received." + I2NP::Message::getTypeString((I2NP::Message::Type)i));
+    }
 
 
-    void InboundMessageDispatcher::messageReceived(RouterHash const from, uint32_t const msgId, ByteArray data)
+    void InboundMessageDispatcher::messageReceived(RouterHash const from, uint32_t const msgId, ByteArray const &data)
     {
-        I2P_LOG_SCOPED_TAG(m_log, "RouterHash", from);
+        I2P_LOG_TAGGED(m_log, debug, "RouterHash", from) << "received data: " << data;
 
-        I2P_LOG(m_log, debug) << "received data: " << data;
+        m_ctx.getProfileManager().received(from, data.size());
 
         I2NP::MessagePtr m;
-        if(msgId)
-            m = I2NP::Message::fromBytes(msgId, data, false);
-        else
-            m = I2NP::Message::fromBytes(0, data);
+        {
+            Metrics::ScopedTimer t(m_parseTime);
 
-        if(m) {
-            I2P_LOG(m_log, info) << boost::log::add_value("i2np_ib", m->getTypeString());
+            if(msgId)
+                m = I2NP::Message::fromBytes(msgId, data, false);
+            else
+                m = I2NP::Message::fromBytes(0, data);
+        }
 
+        if(m) {
+            m_received[(unsigned char)m->getType()]->add();
+
+            /* Handlers are bound by reference, they are shared by all
+             * threads running the io_service. Messages whose handlers
+             * change shared state are serialized on the strand of their
+             * subsystem, tunnel data is handled on any thread. They are
+             * called through handleMessage() so their run time is recorded.
+             */
             switch(m->getType())
             {
                 case I2NP::Message::Type::DELIVERY_STATUS:
-                    m_ios.post(boost::bind(&Handlers::Message::handleMessage, m_deliveryStatusHandler, from, m));
+                    m_ios.post(boost::bind(&InboundMessageDispatcher::handleMessage, this, boost::ref(m_deliveryStatusHandler), from, m));
                     break;
 
                 case I2NP::Message::Type::DB_STORE:
-                    m_ios.post(boost::bind(&Handlers::Message::handleMessage, m_dbStoreHandler, from, m));
+                    m_ctx.getDatabaseStrand().post(boost::bind(&InboundMessageDispatcher::handleMessage, this, boost::ref(m_dbStoreHandler), from, m));
                     break;
 
                 case I2NP::Message::Type::DB_SEARCH_REPLY:
-                    m_ios.post(boost::bind(&Handlers::Message::handleMessage, m_dbSearchReplyHandler, from, m));
+                    m_ctx.getDHTStrand().post(boost::bind(&InboundMessageDispatcher::handleMessage, this, boost::ref(m_dbSearchReplyHandler), from, m));
                     break;
 
                 case I2NP::Message::Type::VARIABLE_TUNNEL_BUILD:
-                    m_ios.post(boost::bind(&Handlers::Message::handleMessage, m_variableTunnelBuildHandler, from, m));
+                    m_ctx.getTunnelStrand().post(boost::bind(&InboundMessageDispatcher::handleMessage, this, boost::ref(m_variableTunnelBuildHandler), from, m));
                     break;
 
                 case I2NP::Message::Type::VARIABLE_TUNNEL_BUILD_REPLY:
-                    m_ios.post(boost::bind(&Handlers::Message::handleMessage, m_variableTunnelBuildReplyHandler, from, m));
+                    m_ctx.getTunnelStrand().post(boost::bind(&InboundMessageDispatcher::handleMessage, this, boost::ref(m_variableTunnelBuildReplyHandler), from, m));
                     break;
 
                 case I2NP::Message::Type::TUNNEL_DATA:
-                    m_ios.post(boost::bind(&Handlers::Message::handleMessage, m_tunnelDataHandler, from, m));
+                    m_ios.post(boost::bind(&InboundMessageDispatcher::handleMessage, this, boost::ref(m_tunnelDataHandler), from, m));
                     break;
 
                 case I2NP::Message::Type::TUNNEL_GATEWAY:
-                    m_ios.post(boost::bind(&Handlers::Message::handleMessage, m_tunnelGatewayHandler, from, m));
+                    m_ios.post(boost::bind(&InboundMessageDispatcher::handleMessage, this, boost::ref(m_tunnelGatewayHandler), from, m));
                     break;
 
                 case I2NP::Message::Type::GARLIC:
                     break;
 
                 default:
-                    I2P_LOG(m_log, error) << "dropping unhandled message of type " << (int)m->getType();
+                    I2P_LOG_TAGGED(m_log, error, "RouterHash", from) << "dropping unhandled message of type " << (int)m->getType();
                     break;
             }           
         }
     }
 
+    void InboundMessageDispatcher::handleMessage(Handlers::Message &handler, RouterHash const from, I2NP::MessagePtr const msg)
+    {
+        Metrics::ScopedTimer t(m_handlerTime);
+        handler.handleMessage(from, msg);
+    }
+
     void InboundMessageDispatcher::connectionEstablished(RouterHash const rh, bool inbound)
     {
         I2P_LOG_SCOPED_TAG(m_log, "RouterHash", rh);
         I2P_LOG(m_log, info) << "session established";
 
         if(inbound) {
-            Botan::AutoSeeded_RNG rng;
-            uint32_t msgId;
-            rng.randomize((unsigned char *)&msgId, sizeof(msgId));
-
-            I2NP::MessagePtr m(new I2NP::DeliveryStatus(msgId, Date(2)));
+            I2NP::MessagePtr m(new I2NP::DeliveryStatus(Random::get<uint32_t>(), Date(2)));
             m_ctx.getOutMsgDisp().sendMessage(rh, m);
 
             // TODO Get this out of here
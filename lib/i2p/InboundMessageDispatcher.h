@@ -17,11 +17,17 @@
 
 #include <i2pcpp/datatypes/RouterHash.h>
 
+#include <i2pcpp/util/Metrics.h>
+
+#include <array>
+
 namespace boost { namespace asio { class io_service; } }
 
 namespace i2pcpp {
     /**
      * Dispatches inbound messages to the correct i2pcpp::Handlers.
+     * Handlers may be called from any thread running the
+     *  boost::asio::io_service.
      */
     class InboundMessageDispatcher {
         public:
@@ -39,7 +45,7 @@ namespace i2pcpp {
              * @param msgId the ID of the original outbound message
              * @param data the actual received data
              */
-            void messageReceived(RouterHash const from, uint32_t const msgId, ByteArray data);
+            void messageReceived(RouterHash const from, uint32_t const msgId, ByteArray const &data);
 
             /**
              * Called when a connection with a router has been established.
@@ -56,6 +62,11 @@ namespace i2pcpp {
             void connectionFailure(RouterHash const rh);
 
         private:
+            /**
+             * Calls \a handler for \a msg and records how long it took.
+             */
+            void handleMessage(Handlers::Message &handler, RouterHash const from, I2NP::MessagePtr const msg);
+
             boost::asio::io_service& m_ios;
             RouterContext& m_ctx;
 
@@ -67,6 +78,12 @@ namespace i2pcpp {
             Handlers::TunnelData m_tunnelDataHandler;
             Handlers::TunnelGateway m_tunnelGatewayHandler;
 
+            /// Messages received, indexed by their type
+            std::array<Metrics::Counter *, 256> m_received;
+
+            Metrics::Histogram &m_parseTime;
+            Metrics::Histogram &m_handlerTime;
+
             i2p_logger_mt m_log;
     };
 }
@@ -13,9 +13,44 @@
 namespace i2pcpp {
     OutboundMessageDispatcher::OutboundMessageDispatcher(RouterContext &ctx) :
         m_ctx(ctx),
-        m_log(I2P_LOG_CHANNEL("OMD")) {}
+        m_log(I2P_LOG_CHANNEL("OMD"))
+    {
+        for(size_t i = 0; i < m_sent.size(); i++)
+            m_sent[i] = &Metrics::counter("i2np.sent." + I2NP::Message::getTypeString((I2NP::Message::Type)i));
+
+        for(size_t i = 0; i < m_queueWait.size(); i++)
+            m_queueWait[i] = &Metrics::histogram(std::string("latency.outbound.queue_wait.") + OutboundQueue::getName((OutboundQueue::Priority)i));
+    }
+
+    void OutboundMessageDispatcher::begin()
+    {
+        try {
+            uint64_t bandwidth = std::stoull(m_ctx.getDatabase()->getConfigValue("outbound_bandwidth"));
+
+            std::lock_guard<std::mutex> lock(m_bucketMutex);
+            m_bucket.setRate(bandwidth);
+        } catch(std::exception &) {
+            I2P_LOG(m_log, debug) << "no outbound bandwidth limit configured";
+        }
+    }
 
     void OutboundMessageDispatcher::sendMessage(RouterHash const &to, I2NP::MessagePtr const &msg)
+    {
+        send(to, msg, false);
+    }
+
+    bool OutboundMessageDispatcher::shapeParticipating(std::size_t bytes)
+    {
+        std::lock_guard<std::mutex> lock(m_bucketMutex);
+        return m_bucket.consume(bytes);
+    }
+
+    void OutboundMessageDispatcher::sendParticipating(RouterHash const &to, I2NP::MessagePtr const &msg)
+    {
+        send(to, msg, true);
+    }
+
+    void OutboundMessageDispatcher::send(RouterHash const &to, I2NP::MessagePtr const &msg, bool participating)
     {
         if(!m_transport) throw std::logic_error("No transport registered");
 
@@ -25,28 +60,83 @@ namespace i2pcpp {
             return;
         }
 
+        const OutboundQueue::Priority priority = OutboundQueue::classify(*msg, participating);
+
+        // SSU is the only transport implemented, so use the short header
+        ByteArray data = msg->toBytes(false);
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            if(!m_queue.push(to, priority, msg, std::move(data))) {
+                I2P_LOG_SCOPED_TAG(m_log, "RouterHash", to);
+                I2P_LOG(m_log, debug) << "outbound queue full, dropping " << OutboundQueue::getName(priority) << " message";
+                return;
+            }
+        }
+
+        /* Everything waits in the queue, even when connected, so that
+         * the classes are scheduled against each other whenever the
+         * transport can't take it all.
+         */
         if(m_transport->isConnected(to)) {
-            I2P_LOG(m_log, info) << boost::log::add_value("i2np_ob", (std::string) msg->getTypeString());
-            // SSU is the only transport implemented, so use the short header
-            m_transport->send(to, msg->getMsgId(), msg->toBytes(false));
-        } else {
-            I2P_LOG_SCOPED_TAG(m_log, "RouterHash", to);
-            I2P_LOG(m_log, debug) << "not connected, queueing message";
+            flush(to);
+            return;
+        }
+
+        I2P_LOG_SCOPED_TAG(m_log, "RouterHash", to);
+        I2P_LOG(m_log, debug) << "not connected, queueing message";
+
+        if(m_ctx.getDatabase()->routerExists(to))
+            m_transport->connect(m_ctx.getDatabase()->getRouterInfo(to));
+        else {
+            I2P_LOG(m_log, debug) << "RouterInfo not in DB, creating search job";
+            bool result = m_ctx.getDHT()->lookup(to);
+            if(!result) {
+                I2P_LOG(m_log, error) << "could not find a good place to start search, aborting";
+
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_queue.erase(to);
+            }
+        }
+    }
+
+    void OutboundMessageDispatcher::flush(RouterHash const &to)
+    {
+        struct Outgoing {
+            I2NP::MessagePtr msg;
+            ByteArray data;
+        };
 
+        const uint32_t window = m_transport->getSendWindow(to);
+
+        std::vector<Outgoing> outgoing;
+        {
             std::lock_guard<std::mutex> lock(m_mutex);
-            m_pending.insert(MapType::value_type(to, msg));
-
-            if(m_ctx.getDatabase()->routerExists(to))
-                m_transport->connect(m_ctx.getDatabase()->getRouterInfo(to));
-            else {
-                I2P_LOG(m_log, debug) << "RouterInfo not in DB, creating search job";
-                bool result = m_ctx.getDHT()->lookup(to);
-                if(!result) {
-                    I2P_LOG(m_log, error) << "could not find a good place to start search, aborting";
-                    m_pending.erase(to);
+
+            OutboundQueue::Priority priority;
+            ByteArray data;
+            uint64_t waited;
+            while(outgoing.size() < window) {
+                I2NP::MessagePtr msg = m_queue.pop(to, priority, data, waited);
+                if(!msg)
+                    break;
+
+                m_sent[(unsigned char)msg->getType()]->add();
+                m_queueWait[(size_t)priority]->record(waited);
+
+                // Participating traffic was charged when it was shaped
+                if(priority != OutboundQueue::Priority::PARTICIPATING) {
+                    std::lock_guard<std::mutex> lock(m_bucketMutex);
+                    m_bucket.charge(data.size());
                 }
+
+                outgoing.push_back({ std::move(msg), std::move(data) });
             }
         }
+
+        for(auto& o: outgoing)
+            m_transport->send(to, o.msg->getMsgId(), o.data);
     }
 
     void OutboundMessageDispatcher::registerTransport(TransportPtr const &t)
@@ -61,24 +151,21 @@ namespace i2pcpp {
 
     void OutboundMessageDispatcher::connected(RouterHash const rh)
     {
-        std::lock_guard<std::mutex> lock(m_mutex);
-
-        auto bucket = m_pending.equal_range(rh);
-        for(auto itr = bucket.first; itr != bucket.second; ++itr) {
+        if(getQueued(rh)) {
             I2P_LOG(m_log, debug) << "connected to peer, flushing queue";
-
-            // Short header, as above
-            m_transport->send(itr->first, itr->second->getMsgId(), itr->second->toBytes(false));
+            flush(rh);
         }
-        // we have succeeded and flushed data, we are no longer pending
-        m_pending.erase(rh);
     }
 
-    void OutboundMessageDispatcher::dhtSuccess(DHT::Kademlia::key_type const k, DHT::Kademlia::value_type const v)
+    void OutboundMessageDispatcher::ready(RouterHash const rh)
     {
-        std::lock_guard<std::mutex> lock(m_mutex);
+        if(getQueued(rh))
+            flush(rh);
+    }
 
-        if(m_pending.count(v)) {
+    void OutboundMessageDispatcher::dhtSuccess(DHT::Kademlia::key_type const, DHT::Kademlia::value_type const v)
+    {
+        if(getQueued(v)) {
             I2P_LOG_SCOPED_TAG(m_log, "RouterHash", v);
             I2P_LOG(m_log, debug) << "DHT lookup succeeded, connecting to peer";
 
@@ -90,11 +177,61 @@ namespace i2pcpp {
     {
         std::lock_guard<std::mutex> lock(m_mutex);
 
-        if(m_pending.count(k)) {
+        if(m_queue.contains(k)) {
             I2P_LOG_SCOPED_TAG(m_log, "RouterHash", k);
             I2P_LOG(m_log, debug) << "DHT lookup failed, tossing queued messages";
 
-            m_pending.erase(k);
+            m_queue.erase(k);
+        }
+    }
+
+    void OutboundMessageDispatcher::connectionFailure(RouterHash const rh)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if(m_queue.contains(rh)) {
+            I2P_LOG_SCOPED_TAG(m_log, "RouterHash", rh);
+            I2P_LOG(m_log, debug) << "connection failed, tossing queued messages";
+
+            m_queue.erase(rh);
         }
     }
+
+    bool OutboundMessageDispatcher::getQueued(RouterHash const &rh) const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_queue.contains(rh);
+    }
+
+    OutboundQueue::Stats OutboundMessageDispatcher::getQueueStats() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_queue.getStats();
+    }
+
+    void OutboundMessageDispatcher::reportStats()
+    {
+        OutboundQueue::Stats stats;
+        OutboundQueue::Stats last;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_queue.expire();
+            stats = m_queue.getStats();
+            last = m_lastQueueStats;
+            m_lastQueueStats = stats;
+        }
+
+        uint64_t expired = 0;
+        for(size_t i = 0; i < OutboundQueue::NUM_PRIORITIES; i++) {
+            const uint64_t dropped = (stats.dropped[i] - last.dropped[i]) + (stats.expired[i] - last.expired[i]);
+            expired += stats.expired[i] - last.expired[i];
+
+            const std::string name = OutboundQueue::getName((OutboundQueue::Priority)i);
+            Metrics::gauge("outbound.queue." + name + ".depth").set(stats.depth[i]);
+            Metrics::counter("outbound.queue." + name + ".dropped").add(dropped);
+        }
+
+        Metrics::gauge("outbound.pending_bytes").set(stats.bytes);
+        Metrics::counter("outbound.expired").add(expired);
+    }
 }
@@ -7,14 +7,22 @@
 
 #include "../../include/i2pcpp/Transport.h"
 
+#include "OutboundQueue.h"
+
 #include "dht/Kademlia.h"
 
 #include <i2pcpp/Log.h>
 
 #include <i2pcpp/datatypes/RouterHash.h>
 
+#include <i2pcpp/util/Metrics.h>
+#include <i2pcpp/util/TokenBucket.h>
+
+#include <array>
+
 #include <unordered_map>
 #include <mutex>
+#include <vector>
 
 namespace i2pcpp {
     namespace I2NP { class Message; typedef std::shared_ptr<Message> MessagePtr; }
@@ -23,11 +31,14 @@ namespace i2pcpp {
 
     /**
      * Dispatches outbound messages to the correct i2pcpp::Transport object.
+     * Messages go through an i2pcpp::OutboundQueue, where they wait by
+     *  priority class while the peer is being looked up and connected to,
+     *  and while the transport's send window for the peer is used up.
+     *  The queue's weighted round robin decides what goes out first once
+     *  the window opens again.
      */
     class OutboundMessageDispatcher {
         public:
-            typedef std::unordered_multimap<RouterHash, I2NP::MessagePtr> MapType;
-
             /**
              * Constructs from a reference to a reference to the i2pcpp::RouterContext.
              */
@@ -35,16 +46,41 @@ namespace i2pcpp {
             OutboundMessageDispatcher(const OutboundMessageDispatcher &) = delete;
             OutboundMessageDispatcher& operator=(OutboundMessageDispatcher &) = delete;
 
+            /**
+             * Reads the outbound bandwidth limit from the database.
+             */
+            void begin();
+
             /**
              * Sends (dispatches) a message to the transport object.
              * If there is currently no connection with the router given by
              *  \a to, queues the message for sending and preforms a DHT lookup.
+             * The message is dropped if its class of the queue is full.
              * @param to the i2pcpp::RouterHash of the router to send the
              *  message to
              * @param msg pointer the i2pcpp::I2NP::Message to send
              */
             void sendMessage(RouterHash const &to, I2NP::MessagePtr const &msg);
 
+            /**
+             * Charges \a bytes of participating tunnel traffic against the
+             *  outbound bandwidth limit. Our own traffic is always charged
+             *  first, so participating traffic only gets what it leaves.
+             * This should be called before any expensive processing of the
+             *  traffic is done.
+             * @return false if the limit is exhausted and the traffic should
+             *  be dropped
+             */
+            bool shapeParticipating(std::size_t bytes);
+
+            /**
+             * Sends a message on behalf of a participating tunnel. Unlike
+             *  sendMessage(), the message is not charged against the outbound
+             *  bandwidth limit, shapeParticipating() must have been called
+             *  for it already.
+             */
+            void sendParticipating(RouterHash const &to, I2NP::MessagePtr const &msg);
+
             /**
              * Registers an i2pcpp::Transport object to which we may dispatch
              *  messages.
@@ -65,6 +101,12 @@ namespace i2pcpp {
              */
             void connected(RouterHash const rh);
 
+            /**
+             * Called when the transport has room for more messages to the
+             *  router given by \a rh. Sends what is queued for it.
+             */
+            void ready(RouterHash const rh);
+
             /**
              * Called when the DHT lookup was succesful.
              * Tries to connect to the value that was extracted from the DHT.
@@ -83,14 +125,57 @@ namespace i2pcpp {
              */
             void dhtFailure(DHT::Kademlia::key_type const k);
 
+            /**
+             * Called when connecting to the router given by \a rh failed.
+             * Removes all of the pending (queued) messages for it.
+             */
+            void connectionFailure(RouterHash const rh);
+
+            /**
+             * @return the depth and drop counters of the outbound queue
+             */
+            OutboundQueue::Stats getQueueStats() const;
+
+            /**
+             * Drops expired messages from the outbound queue, then logs the
+             *  depth of each class, the messages it dropped since the last
+             *  call and the bytes still pending, as statistics.
+             */
+            void reportStats();
+
         private:
+            void send(RouterHash const &to, I2NP::MessagePtr const &msg, bool participating);
+
+            /**
+             * Sends what is queued for \a to, in the order the queue
+             *  schedules it, as far as the transport's send window allows.
+             *  The messages are taken under m_mutex and handed to the
+             *  transport once it is released, so it must not be held.
+             */
+            void flush(RouterHash const &to);
+
+            /**
+             * @return whether there are messages queued for \a rh
+             */
+            bool getQueued(RouterHash const &rh) const;
+
             RouterContext& m_ctx;
             TransportPtr m_transport;
 
-            MapType m_pending;
+            OutboundQueue m_queue;
+            OutboundQueue::Stats m_lastQueueStats = {};
+
+            /// Messages sent, indexed by their type
+            std::array<Metrics::Counter *, 256> m_sent;
+
+            /// Time messages spent in m_queue, indexed by their class
+            std::array<Metrics::Histogram *, OutboundQueue::NUM_PRIORITIES> m_queueWait;
 
             mutable std::mutex m_mutex;
 
+            TokenBucket m_bucket;
+            mutable std::mutex m_bucketMutex;
+
             i2p_logger_mt m_log;
     };
 }
@@ -0,0 +1,210 @@
+/**
+ * @file OutboundQueue.cpp
+ * @brief Implements OutboundQueue.h
+ */
+#include "OutboundQueue.h"
+
+#include "i2np/Message.h"
+
+#include <algorithm>
+
+namespace i2pcpp {
+    /// Messages a class may send in turn before the next class is served
+    static const std::array<uint32_t, OutboundQueue::NUM_PRIORITIES> WEIGHTS = {{ 8, 4, 2, 1 }};
+
+    /// Maximum number of messages queued per peer and class
+    static const std::array<size_t, OutboundQueue::NUM_PRIORITIES> DEPTHS = {{ 64, 64, 128, 128 }};
+
+    /// Milliseconds a message may wait before it's no longer worth sending
+    static const std::array<uint32_t, OutboundQueue::NUM_PRIORITIES> MAX_AGES = {{ 10000, 10000, 5000, 2000 }};
+
+    OutboundQueue::Priority OutboundQueue::classify(I2NP::Message const &msg, bool participating)
+    {
+        if(participating)
+            return Priority::PARTICIPATING;
+
+        switch(msg.getType()) {
+            case I2NP::Message::Type::DELIVERY_STATUS:
+            case I2NP::Message::Type::TUNNEL_BUILD:
+            case I2NP::Message::Type::TUNNEL_BUILD_REPLY:
+            case I2NP::Message::Type::VARIABLE_TUNNEL_BUILD:
+            case I2NP::Message::Type::VARIABLE_TUNNEL_BUILD_REPLY:
+                return Priority::CONTROL;
+
+            case I2NP::Message::Type::DB_STORE:
+            case I2NP::Message::Type::DB_LOOKUP:
+            case I2NP::Message::Type::DB_SEARCH_REPLY:
+                return Priority::NETDB;
+
+            default:
+                return Priority::TUNNEL;
+        }
+    }
+
+    const char *OutboundQueue::getName(Priority p)
+    {
+        switch(p) {
+            case Priority::CONTROL:
+                return "control";
+
+            case Priority::NETDB:
+                return "netdb";
+
+            case Priority::TUNNEL:
+                return "tunnel";
+
+            case Priority::PARTICIPATING:
+                return "participating";
+        }
+
+        return "unknown";
+    }
+
+    OutboundQueue::PeerQueue::PeerQueue() :
+        credit(WEIGHTS[0]) {}
+
+    OutboundQueue::OutboundQueue(size_t maxPeerBytes, size_t maxBytes) :
+        m_maxPeerBytes(maxPeerBytes),
+        m_maxBytes(maxBytes) {}
+
+    bool OutboundQueue::push(RouterHash const &to, Priority p, I2NP::MessagePtr const &msg, ByteArray data)
+    {
+        const size_t i = (size_t)p;
+        const Clock::time_point now = Clock::now();
+
+        PeerQueue &q = m_peers[to];
+        expire(q, i, now);
+
+        if(q.classes[i].size() >= DEPTHS[i] || q.bytes + data.size() > m_maxPeerBytes || m_stats.bytes + data.size() > m_maxBytes) {
+            ++m_stats.dropped[i];
+
+            if(q.bytes == 0)
+                m_peers.erase(to);
+
+            return false;
+        }
+
+        /* The message may expire before its class would give up on it,
+         * for example when it has been forwarded to us.
+         */
+        Clock::time_point expires = now + std::chrono::milliseconds(MAX_AGES[i]);
+        const int64_t validFor = (int64_t)msg->getExpiration() - std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        if(validFor < MAX_AGES[i] / 1000)
+            expires = now + std::chrono::seconds(std::max<int64_t>(validFor, 0));
+
+        q.bytes += data.size();
+        m_stats.bytes += data.size();
+        ++m_stats.depth[i];
+
+        q.classes[i].push_back({ msg, std::move(data), expires, now });
+
+        return true;
+    }
+
+    I2NP::MessagePtr OutboundQueue::pop(RouterHash const &to, Priority &p, ByteArray &data, uint64_t &waited)
+    {
+        auto itr = m_peers.find(to);
+        if(itr == m_peers.end())
+            return I2NP::MessagePtr();
+
+        PeerQueue &q = itr->second;
+        const Clock::time_point now = Clock::now();
+
+        /* Starting with the class being served, every class is looked at
+         * once with fresh credit, so a message is found if there is one.
+         */
+        for(size_t n = 0; n <= NUM_PRIORITIES; n++) {
+            auto& c = q.classes[q.current];
+            expire(q, q.current, now);
+
+            if(!c.empty() && q.credit) {
+                --q.credit;
+                --m_stats.depth[q.current];
+
+                Entry &e = c.front();
+                q.bytes -= e.data.size();
+                m_stats.bytes -= e.data.size();
+
+                I2NP::MessagePtr msg = std::move(e.msg);
+                data = std::move(e.data);
+                waited = std::chrono::duration_cast<std::chrono::microseconds>(now - e.queued).count();
+                c.pop_front();
+                p = (Priority)q.current;
+
+                return msg;
+            }
+
+            q.current = (q.current + 1) % NUM_PRIORITIES;
+            q.credit = WEIGHTS[q.current];
+        }
+
+        m_peers.erase(itr);
+
+        return I2NP::MessagePtr();
+    }
+
+    bool OutboundQueue::contains(RouterHash const &to) const
+    {
+        return m_peers.count(to) > 0;
+    }
+
+    void OutboundQueue::erase(RouterHash const &to)
+    {
+        auto itr = m_peers.find(to);
+        if(itr == m_peers.end())
+            return;
+
+        for(size_t i = 0; i < NUM_PRIORITIES; i++) {
+            m_stats.depth[i] -= itr->second.classes[i].size();
+            m_stats.dropped[i] += itr->second.classes[i].size();
+        }
+
+        m_stats.bytes -= itr->second.bytes;
+
+        m_peers.erase(itr);
+    }
+
+    void OutboundQueue::expire()
+    {
+        const Clock::time_point now = Clock::now();
+
+        for(auto itr = m_peers.begin(); itr != m_peers.end();) {
+            for(size_t i = 0; i < NUM_PRIORITIES; i++)
+                expire(itr->second, i, now);
+
+            if(!itr->second.bytes && std::all_of(itr->second.classes.cbegin(), itr->second.classes.cend(), [](std::deque<Entry> const &c) { return c.empty(); }))
+                itr = m_peers.erase(itr);
+            else
+                ++itr;
+        }
+    }
+
+    OutboundQueue::Stats OutboundQueue::getStats() const
+    {
+        return m_stats;
+    }
+
+    void OutboundQueue::expire(PeerQueue &q, size_t i, Clock::time_point const &now)
+    {
+        /* Messages of a class usually expire in the order they were
+         * queued, but a forwarded one may expire before those ahead of it.
+         */
+        auto& c = q.classes[i];
+        for(auto itr = c.begin(); itr != c.end();) {
+            if(now >= itr->expires) {
+                itr = remove(q, i, itr);
+                ++m_stats.expired[i];
+            } else
+                ++itr;
+        }
+    }
+
+    std::deque<OutboundQueue::Entry>::iterator OutboundQueue::remove(PeerQueue &q, size_t i, std::deque<Entry>::iterator itr)
+    {
+        q.bytes -= itr->data.size();
+        m_stats.bytes -= itr->data.size();
+        --m_stats.depth[i];
+
+        return q.classes[i].erase(itr);
+    }
+}
@@ -0,0 +1,170 @@
+/**
+ * @file OutboundQueue.h
+ * @brief Defines the i2pcpp::OutboundQueue class.
+ */
+#ifndef OUTBOUNDQUEUE_H
+#define OUTBOUNDQUEUE_H
+
+#include <i2pcpp/datatypes/ByteArray.h>
+#include <i2pcpp/datatypes/RouterHash.h>
+
+#include <array>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <unordered_map>
+
+namespace i2pcpp {
+    namespace I2NP { class Message; typedef std::shared_ptr<Message> MessagePtr; }
+
+    /**
+     * Per peer queues of outbound messages, one for each priority class.
+     * Each class is bounded and drops new messages when full, as does
+     *  each peer and the queue as a whole once they hold too many bytes.
+     *  Messages which expired, or waited longer than their class allows,
+     *  are dropped instead of sent. The classes are served by weighted
+     *  round robin, so lower classes are slowed down but never starved.
+     * Messages are serialized when they are queued, so their size is
+     *  known and they are ready to be handed to the transport.
+     * @note Not thread safe, callers are expected to serialise access.
+     */
+    class OutboundQueue {
+        public:
+            /**
+             * The priority classes, highest first.
+             */
+            enum class Priority {
+                /// Tunnel builds and replies, delivery status
+                CONTROL = 0,
+                /// Database lookups, stores and search replies
+                NETDB = 1,
+                /// Traffic of our own tunnels
+                TUNNEL = 2,
+                /// Traffic of tunnels we participate in
+                PARTICIPATING = 3
+            };
+
+            static const size_t NUM_PRIORITIES = 4;
+
+            /**
+             * Per class counters. Depth is the current number of queued
+             *  messages over all peers, the rest are cumulative.
+             */
+            struct Stats {
+                std::array<uint64_t, NUM_PRIORITIES> depth;
+                std::array<uint64_t, NUM_PRIORITIES> dropped;
+                std::array<uint64_t, NUM_PRIORITIES> expired;
+
+                /// Bytes currently queued over all peers
+                uint64_t bytes;
+            };
+
+            /**
+             * @param maxPeerBytes the most bytes queued for a single peer
+             * @param maxBytes the most bytes queued for all peers together
+             */
+            OutboundQueue(size_t maxPeerBytes = DEFAULT_MAX_PEER_BYTES, size_t maxBytes = DEFAULT_MAX_BYTES);
+
+            /**
+             * @param participating whether \a msg is sent on behalf of a
+             *  tunnel we participate in
+             * @return the class \a msg belongs in
+             */
+            static Priority classify(I2NP::Message const &msg, bool participating);
+
+            /**
+             * @return the name of \a p, for logs and statistics
+             */
+            static const char *getName(Priority p);
+
+            /**
+             * Queues \a msg, serialized as \a data, for \a to.
+             * @return false if the class, the peer or the queue was full
+             *  and \a msg was dropped
+             */
+            bool push(RouterHash const &to, Priority p, I2NP::MessagePtr const &msg, ByteArray data);
+
+            /**
+             * Takes the next message for \a to, skipping the ones which
+             *  expired in the queue.
+             * @param p set to the class of the returned message
+             * @param data set to the serialized message
+             * @param waited set to the time the message spent in the
+             *  queue, in microseconds
+             * @return the message, or nullptr if there are none left
+             */
+            I2NP::MessagePtr pop(RouterHash const &to, Priority &p, ByteArray &data, uint64_t &waited);
+
+            /**
+             * @return whether there are messages queued for \a to
+             */
+            bool contains(RouterHash const &to) const;
+
+            /**
+             * Drops all messages queued for \a to.
+             */
+            void erase(RouterHash const &to);
+
+            /**
+             * Drops the expired messages of every peer, and forgets the
+             *  peers which have none left.
+             */
+            void expire();
+
+            Stats getStats() const;
+
+            /// Default per peer limit, in bytes
+            static const size_t DEFAULT_MAX_PEER_BYTES = 256 * 1024;
+
+            /// Default limit for all peers together, in bytes
+            static const size_t DEFAULT_MAX_BYTES = 8 * 1024 * 1024;
+
+        private:
+            typedef std::chrono::steady_clock Clock;
+
+            struct Entry {
+                I2NP::MessagePtr msg;
+                ByteArray data;
+
+                /// The earlier of the message's expiration and its class' maximum wait
+                Clock::time_point expires;
+
+                Clock::time_point queued;
+            };
+
+            struct PeerQueue {
+                /**
+                 * Starts with the credit of the first class, so that it is
+                 *  served first.
+                 */
+                PeerQueue();
+
+                std::array<std::deque<Entry>, NUM_PRIORITIES> classes;
+                size_t bytes = 0;
+
+                /// The class being served and how many more it may send
+                size_t current = 0;
+                uint32_t credit;
+            };
+
+            /**
+             * Drops the expired messages of class \a i of \a q.
+             */
+            void expire(PeerQueue &q, size_t i, Clock::time_point const &now);
+
+            /**
+             * Drops the message at \a itr of class \a i of \a q.
+             * @return the message after it
+             */
+            std::deque<Entry>::iterator remove(PeerQueue &q, size_t i, std::deque<Entry>::iterator itr);
+
+            size_t m_maxPeerBytes;
+            size_t m_maxBytes;
+
+            std::unordered_map<RouterHash, PeerQueue> m_peers;
+
+            Stats m_stats = {};
+    };
+}
+
+#endif
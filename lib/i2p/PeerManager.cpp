@@ -10,6 +10,8 @@
 
 #include <i2pcpp/datatypes/RouterInfo.h>
 
+#include <i2pcpp/util/Metrics.h>
+
 
 namespace i2pcpp {
     PeerManager::PeerManager(boost::asio::io_service &ios, RouterContext &ctx) :
@@ -27,12 +29,12 @@ namespace i2pcpp {
 
     void PeerManager::connected(const RouterHash rh)
     {
-        // TODO Ding the peer's profile
+        m_ctx.getProfileManager().connected(rh);
     }
 
     void PeerManager::failure(const RouterHash rh)
     {
-        // TODO Ding the peer's profile
+        m_ctx.getProfileManager().connectFailed(rh);
     }
 
     void PeerManager::disconnected(const RouterHash rh)
@@ -46,7 +48,8 @@ namespace i2pcpp {
             uint32_t numPeers = m_ctx.getOutMsgDisp().getTransport()->numPeers();
 
             I2P_LOG(m_log, debug) << "current number of peers: " << numPeers;
-            I2P_LOG(m_log, debug) << boost::log::add_value("peers", (uint32_t) numPeers);
+            Metrics::gauge("peers").set(numPeers);
+            m_ctx.getOutMsgDisp().reportStats();
             int32_t gap = minPeers - numPeers;
             for(int32_t i = 0; i < gap; i++)
                 m_ctx.getOutMsgDisp().getTransport()->connect(m_ctx.getProfileManager().getPeer());
@@ -8,12 +8,344 @@
 
 #include <i2pcpp/datatypes/RouterInfo.h>
 
+#include <boost/bind.hpp>
+
+#include <algorithm>
+#include <ctime>
+
 namespace i2pcpp {
-    ProfileManager::ProfileManager(RouterContext &ctx) :
-        m_ctx(ctx) {}
+    ProfileManager::ProfileManager(boost::asio::io_service &ios, RouterContext &ctx) :
+        m_ctx(ctx),
+        m_rng(std::random_device()()),
+        m_timer(ios, boost::posix_time::time_duration(0, 0, UPDATE_INTERVAL)),
+        m_log(I2P_LOG_CHANNEL("PrM")) {}
+
+    void ProfileManager::begin()
+    {
+        try {
+            auto stored = m_ctx.getDatabase()->getProfiles();
+
+            const uint64_t now = std::time(nullptr);
+
+            // Counters also decay while we are not running
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for(auto& s: stored) {
+                Profile &p = m_profiles[s.first];
+                static_cast<Database::Profile &>(p) = s.second;
+                decay(p, now);
+            }
+
+            updateTiers();
+
+            I2P_LOG(m_log, info) << "loaded " << m_profiles.size() << " profiles";
+        } catch(std::exception &e) {
+            I2P_LOG(m_log, error) << "could not load profiles: " << e.what();
+        }
+
+        m_timer.async_wait(boost::bind(&ProfileManager::callback, this, boost::asio::placeholders::error));
+    }
+
+    void ProfileManager::save()
+    {
+        std::unordered_map<RouterHash, Database::Profile> profiles;
+
+        try {
+            auto db = m_ctx.getDatabase();
+            auto hashes = db->getAllHashes();
+            const std::unordered_set<RouterHash> known(hashes.begin(), hashes.end());
+
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+
+                const std::size_t before = m_profiles.size();
+                for(auto itr = m_profiles.begin(); itr != m_profiles.end();) {
+                    if(!known.count(itr->first)) {
+                        itr = m_profiles.erase(itr);
+                        continue;
+                    }
+
+                    profiles[itr->first] = itr->second;
+                    ++itr;
+                }
+
+                if(m_profiles.size() != before) {
+                    I2P_LOG(m_log, debug) << "dropped " << (before - m_profiles.size()) << " profiles of forgotten routers";
+                    updateTiers();
+                }
+            }
+
+            db->setProfiles(profiles);
+        } catch(std::exception &e) {
+            I2P_LOG(m_log, error) << "could not save profiles: " << e.what();
+        }
+    }
 
     const RouterInfo ProfileManager::getPeer()
     {
-        return m_ctx.getDatabase()->getRouterInfo(m_ctx.getDatabase()->getRandomRouter());
+        auto db = m_ctx.getDatabase();
+
+        for(uint32_t attempts = 0; attempts < PEER_ATTEMPTS; ++attempts) {
+            RouterHash rh = db->getRandomRouter();
+
+            std::unique_lock<std::mutex> lock(m_mutex);
+            auto itr = m_profiles.find(rh);
+            if(itr == m_profiles.end() || !isFailing(itr->second)) {
+                lock.unlock();
+                return db->getRouterInfo(rh);
+            }
+        }
+
+        return db->getRouterInfo(db->getRandomRouter());
+    }
+
+    std::vector<RouterIdentity> ProfileManager::getHops(std::size_t count, Tier tier)
+    {
+        std::vector<RouterIdentity> hops;
+        std::unordered_set<RouterHash> chosen = { m_ctx.getIdentity()->getHash() };
+
+        std::vector<RouterHash> fast, highCapacity, notFailing;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if(tier == Tier::FAST)
+                fast = m_fast;
+            if(tier != Tier::NOT_FAILING)
+                highCapacity = m_highCapacity;
+            notFailing = m_notFailing;
+
+            std::shuffle(fast.begin(), fast.end(), m_rng);
+            std::shuffle(highCapacity.begin(), highCapacity.end(), m_rng);
+            std::shuffle(notFailing.begin(), notFailing.end(), m_rng);
+        }
+
+        choose(fast, count, chosen, hops);
+        choose(highCapacity, count, chosen, hops);
+        choose(notFailing, count, chosen, hops);
+
+        /* Not enough profiled peers yet, so try routers at random. Those
+         * which are known to be failing are skipped.
+         */
+        for(std::size_t attempts = 0; hops.size() < count && attempts < count * 4; ++attempts) {
+            try {
+                const RouterInfo ri = getPeer();
+                if(chosen.insert(ri.getIdentity().getHash()).second)
+                    hops.push_back(ri.getIdentity());
+            } catch(std::exception &e) {
+                I2P_LOG(m_log, warning) << "could not select a peer: " << e.what();
+            }
+        }
+
+        return hops;
+    }
+
+    void ProfileManager::buildSucceeded(RouterHash const &rh, uint32_t rtt)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Profile &p = getProfile(rh);
+
+        ++p.buildSuccess;
+        p.lastSeen = std::time(nullptr);
+        p.rtt = (p.rtt ? (p.rtt * 3 + rtt) / 4 : rtt);
+    }
+
+    void ProfileManager::buildFailed(RouterHash const &rh)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++getProfile(rh).buildFailure;
+    }
+
+    void ProfileManager::buildTimedOut(std::vector<RouterHash> const &hops)
+    {
+        if(hops.empty())
+            return;
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::uniform_int_distribution<std::size_t> dist(0, hops.size() - 1);
+
+        ++getProfile(hops[dist(m_rng)]).buildFailure;
+    }
+
+    void ProfileManager::connected(RouterHash const &rh)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Profile &p = getProfile(rh);
+
+        p.consecutiveFailures = 0;
+        p.lastSeen = std::time(nullptr);
+    }
+
+    void ProfileManager::connectFailed(RouterHash const &rh)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Profile &p = getProfile(rh);
+
+        ++p.connectFailure;
+        ++p.consecutiveFailures;
+    }
+
+    void ProfileManager::received(RouterHash const &rh, std::size_t bytes)
+    {
+        ReceivedShard &s = m_received[Metrics::getShard()];
+        std::lock_guard<std::mutex> lock(s.mutex);
+        Received &r = s.peers[rh];
+
+        r.bytes += bytes;
+        r.lastSeen = std::time(nullptr);
+    }
+
+    void ProfileManager::callback(const boost::system::error_code &e)
+    {
+        if(e)
+            return;
+
+        std::unordered_map<RouterHash, Received> received;
+        for(auto& s: m_received) {
+            std::unordered_map<RouterHash, Received> peers;
+            {
+                std::lock_guard<std::mutex> lock(s.mutex);
+                peers.swap(s.peers);
+            }
+
+            for(auto& p: peers) {
+                Received &r = received[p.first];
+                r.bytes += p.second.bytes;
+                r.lastSeen = std::max(r.lastSeen, p.second.lastSeen);
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            for(auto& r: received) {
+                Profile &prof = getProfile(r.first);
+                prof.lastSeen = std::max(prof.lastSeen, r.second.lastSeen);
+            }
+
+            const uint64_t now = std::time(nullptr);
+            for(auto& p: m_profiles) {
+                Profile &prof = p.second;
+                auto itr = received.find(p.first);
+                uint64_t rate = (itr != received.end() ? itr->second.bytes / UPDATE_INTERVAL : 0);
+
+                prof.throughput = (prof.throughput * 3 + rate) / 4;
+                decay(prof, now);
+            }
+
+            updateTiers();
+
+            I2P_LOG(m_log, debug) << "tiers: " << m_fast.size() << " fast, " << m_highCapacity.size() << " high capacity, " << m_notFailing.size() << " not failing";
+        }
+
+        if(++m_updates % SAVE_EVERY == 0)
+            save();
+
+        m_timer.expires_at(m_timer.expires_at() + boost::posix_time::time_duration(0, 0, UPDATE_INTERVAL));
+        m_timer.async_wait(boost::bind(&ProfileManager::callback, this, boost::asio::placeholders::error));
+    }
+
+    void ProfileManager::updateTiers()
+    {
+        m_notFailing.clear();
+        m_highCapacity.clear();
+        m_fast.clear();
+
+        std::vector<double> capacities;
+        for(auto& p: m_profiles) {
+            if(isFailing(p.second))
+                continue;
+
+            m_notFailing.push_back(p.first);
+            capacities.push_back(getCapacity(p.second));
+        }
+
+        if(capacities.empty())
+            return;
+
+        auto mid = capacities.begin() + capacities.size() / 2;
+        std::nth_element(capacities.begin(), mid, capacities.end());
+        const double median = *mid;
+
+        /* A peer is only high capacity once it has actually accepted a
+         * tunnel from us and does better than both the median and a coin flip.
+         */
+        for(auto& rh: m_notFailing) {
+            Profile const &p = m_profiles[rh];
+            double capacity = getCapacity(p);
+
+            if(p.buildSuccess && capacity >= median && capacity >= 0.5)
+                m_highCapacity.push_back(rh);
+        }
+
+        m_fast = m_highCapacity;
+        std::sort(m_fast.begin(), m_fast.end(), [this](RouterHash const &a, RouterHash const &b) {
+            Profile const &pa = m_profiles[a];
+            Profile const &pb = m_profiles[b];
+
+            if(pa.throughput != pb.throughput)
+                return pa.throughput > pb.throughput;
+
+            return pa.rtt < pb.rtt;
+        });
+
+        if(m_fast.size() > FAST_PEERS)
+            m_fast.resize(FAST_PEERS);
+    }
+
+    void ProfileManager::decay(Profile &p, uint64_t now)
+    {
+        if(!p.lastDecay || now < p.lastDecay) {
+            p.lastDecay = now;
+            return;
+        }
+
+        const uint64_t halvings = (now - p.lastDecay) / DECAY_HALF_LIFE;
+        if(!halvings)
+            return;
+
+        for(uint32_t *c: { &p.buildSuccess, &p.buildFailure, &p.connectFailure, &p.consecutiveFailures })
+            *c = (halvings < 32 ? *c >> halvings : 0);
+
+        // The remainder counts towards the next halving
+        p.lastDecay += halvings * DECAY_HALF_LIFE;
+    }
+
+    double ProfileManager::getCapacity(Profile const &p)
+    {
+        // Laplace smoothing, so that a single result doesn't decide
+        return (p.buildSuccess + 1.0) / (p.buildSuccess + p.buildFailure + 2.0);
+    }
+
+    bool ProfileManager::isFailing(Profile const &p)
+    {
+        if(p.consecutiveFailures >= MAX_CONNECT_FAILURES)
+            return true;
+
+        return (p.buildFailure >= MIN_FAILING_BUILDS && getCapacity(p) * 100 < MIN_CAPACITY);
+    }
+
+    ProfileManager::Profile& ProfileManager::getProfile(RouterHash const &rh)
+    {
+        auto r = m_profiles.emplace(rh, Profile());
+        if(r.second)
+            r.first->second.lastDecay = std::time(nullptr);
+
+        return r.first->second;
+    }
+
+    void ProfileManager::choose(std::vector<RouterHash> const &from, std::size_t count, std::unordered_set<RouterHash> &chosen, std::vector<RouterIdentity> &hops)
+    {
+        auto db = m_ctx.getDatabase();
+        for(auto& rh: from) {
+            if(hops.size() >= count)
+                break;
+
+            if(!chosen.insert(rh).second)
+                continue;
+
+            try {
+                hops.push_back(db->getRouterInfo(rh).getIdentity());
+            } catch(std::exception &e) {
+                // The router has been removed from the netDb
+            }
+        }
     }
 }
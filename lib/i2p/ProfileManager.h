@@ -5,30 +5,220 @@
 #ifndef PROFILEMANAGER_H
 #define PROFILEMANAGER_H
 
+#include "../../include/i2pcpp/Database.h"
+
+#include <i2pcpp/Log.h>
+
+#include <i2pcpp/datatypes/RouterHash.h>
+
+#include <i2pcpp/util/Metrics.h>
+
+#include <boost/asio.hpp>
+
+#include <array>
+#include <mutex>
+#include <random>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
 namespace i2pcpp {
     class RouterContext;
     class RouterInfo;
+    class RouterIdentity;
 
     /**
-     * Manages peer profiles. Allows random peer selection.
+     * Manages peer profiles. Keeps track of how peers perform when we
+     *  build tunnels through them and connect to them, and uses this to
+     *  select peers for tunnels.
+     * Profiles are kept in memory and periodically written to the
+     *  i2pcpp::Database.
      */
     class ProfileManager {
         public:
+            /**
+             * The build and connection counters of a profile decay, they
+             *  are halved every DECAY_HALF_LIFE. Recent results outweigh
+             *  old ones, and a failing peer is tried again eventually.
+             */
+            struct Profile : Database::Profile {
+                /// Connection failures since the last successful connection
+                uint32_t consecutiveFailures = 0;
+            };
+
+            /**
+             * The groups of peers used for peer selection. Each tier is a
+             *  subset of the next.
+             */
+            enum class Tier {
+                FAST,           ///< the highest capacity peers with the best throughput
+                HIGH_CAPACITY,  ///< peers which accept more tunnels than the median
+                NOT_FAILING     ///< all peers which are not currently failing
+            };
+
             /**
              * Constructs from a reference to the i2pcpp::RouterContext.
              */
-            ProfileManager(RouterContext &ctx);
+            ProfileManager(boost::asio::io_service &ios, RouterContext &ctx);
             ProfileManager(const ProfileManager &) = delete;
             ProfileManager& operator=(ProfileManager &) = delete;
 
             /**
-             * Randomly selects a peer and returns its RI.
+             * Loads the stored profiles and starts the periodic tier
+             *  calculation and persistence.
+             */
+            void begin();
+
+            /**
+             * Writes the profiles to the database. Profiles of routers
+             *  which are no longer in the database are dropped.
+             */
+            void save();
+
+            /**
+             * Randomly selects a peer which is not failing and returns its RI.
              * @return the i2pcpp::RouterInfo structure of the peer
              */
             const RouterInfo getPeer();
 
+            /**
+             * Selects \a count distinct peers, other than ourselves, to be
+             *  used as the hops of a tunnel. Peers are taken from \a tier
+             *  first, then from the larger tiers, and finally from the
+             *  routers we have no profile for yet.
+             * @return the identities of the peers, fewer than \a count if
+             *  not enough peers could be found
+             */
+            std::vector<RouterIdentity> getHops(std::size_t count, Tier tier = Tier::HIGH_CAPACITY);
+
+            /**
+             * Records that a tunnel built through \a rh succeeded, taking
+             *  \a rtt milliseconds.
+             */
+            void buildSucceeded(RouterHash const &rh, uint32_t rtt);
+
+            /**
+             * Records that a tunnel built through \a rh failed.
+             */
+            void buildFailed(RouterHash const &rh);
+
+            /**
+             * Records that a tunnel built through \a hops timed out. Any
+             *  one of them may have dropped the request, so a single hop,
+             *  chosen at random, is charged with the failure.
+             */
+            void buildTimedOut(std::vector<RouterHash> const &hops);
+
+            /**
+             * Records that we connected to \a rh.
+             */
+            void connected(RouterHash const &rh);
+
+            /**
+             * Records that connecting to \a rh failed.
+             */
+            void connectFailed(RouterHash const &rh);
+
+            /**
+             * Records that we received \a bytes from \a rh. Does not
+             *  take the profile lock, the bytes are folded in to the
+             *  profile on the next tier calculation.
+             */
+            void received(RouterHash const &rh, std::size_t bytes);
+
+            /**
+             * Halves the counters of \a p once for every DECAY_HALF_LIFE
+             *  that has passed since they were last decayed. A profile
+             *  which was never decayed starts counting at \a now.
+             * @param now seconds since the epoch
+             */
+            static void decay(Profile &p, uint64_t now);
+
+            /**
+             * @return the estimated build success rate of \a p
+             */
+            static double getCapacity(Profile const &p);
+
+            /**
+             * @return true if \a p should not be used for tunnels
+             */
+            static bool isFailing(Profile const &p);
+
+            /**
+             * Number of consecutive connection failures after which a peer
+             *  is considered to be failing.
+             */
+            static const uint32_t MAX_CONNECT_FAILURES = 3;
+
+            /// Number of random routers getPeer() tries before settling for a failing one
+            static const uint32_t PEER_ATTEMPTS = 5;
+
+            /// Minimum build success rate, in percent, of a peer that is not failing
+            static const uint32_t MIN_CAPACITY = 10;
+
+            /// Number of failed builds before a peer can be considered failing
+            static const uint32_t MIN_FAILING_BUILDS = 5;
+
+            /// Maximum number of peers in the fast tier
+            static const uint32_t FAST_PEERS = 30;
+
+            /// Seconds between tier calculations
+            static const uint32_t UPDATE_INTERVAL = 30;
+
+            /// Number of tier calculations between saves to the database
+            static const uint32_t SAVE_EVERY = 10;
+
+            /// Seconds after which the counters of a profile are halved
+            static const uint32_t DECAY_HALF_LIFE = 3600;
+
         private:
+            struct Received {
+                uint64_t bytes = 0;
+                uint64_t lastSeen = 0;
+            };
+
+            /**
+             * Traffic received since the last tier calculation. Each
+             *  thread reports to its own Metrics shard.
+             */
+            struct ReceivedShard {
+                std::mutex mutex;
+                std::unordered_map<RouterHash, Received> peers;
+            };
+
+            /**
+             * Recalculates the throughput estimates and the tiers.
+             */
+            void callback(const boost::system::error_code &e);
+
+            void updateTiers();
+
+            Profile& getProfile(RouterHash const &rh);
+
+            /**
+             * Appends up to \a count peers from \a from that have not been
+             *  chosen yet to \a hops.
+             */
+            void choose(std::vector<RouterHash> const &from, std::size_t count, std::unordered_set<RouterHash> &chosen, std::vector<RouterIdentity> &hops);
+
             RouterContext& m_ctx; ///< Reference to the router context
+
+            std::unordered_map<RouterHash, Profile> m_profiles;
+
+            std::array<ReceivedShard, Metrics::NUM_SHARDS> m_received;
+
+            std::vector<RouterHash> m_fast;
+            std::vector<RouterHash> m_highCapacity;
+            std::vector<RouterHash> m_notFailing;
+
+            std::minstd_rand m_rng;
+
+            mutable std::mutex m_mutex;
+
+            boost::asio::deadline_timer m_timer;
+            uint32_t m_updates = 0;
+
+            i2p_logger_mt m_log;
     };
 }
 
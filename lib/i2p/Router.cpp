@@ -16,7 +16,9 @@
 #include <botan/botan.h>
 #include <boost/asio.hpp>
 
+#include <algorithm>
 #include <thread>
+#include <vector>
 
 namespace i2pcpp {
     struct Router::RouterImpl {
@@ -27,7 +29,7 @@ namespace i2pcpp {
 
         boost::asio::io_service ios;
         boost::asio::io_service::work work;
-        std::thread serviceThread;
+        std::vector<std::thread> serviceThreads;
 
         RouterContext ctx;
 
@@ -44,8 +46,9 @@ namespace i2pcpp {
 
     Router::~Router()
     {
-        if(m_impl->serviceThread.joinable())
-            m_impl->serviceThread.join();
+        for(auto& t: m_impl->serviceThreads)
+            if(t.joinable())
+                t.join();
     }
 
     void Router::initialize()
@@ -70,6 +73,9 @@ namespace i2pcpp {
         t->registerDisconnectedSignal(boost::bind(
             &PeerManager::disconnected, boost::ref(m_impl->ctx.getPeerManager()), _1
         ));
+        t->registerReadySignal(boost::bind(
+            &OutboundMessageDispatcher::ready, boost::ref(m_impl->ctx.getOutMsgDisp()), _1
+        ));
 
         m_impl->ctx.getOutMsgDisp().registerTransport(t);
     }
@@ -78,17 +84,31 @@ namespace i2pcpp {
     {
         I2P_LOG(m_impl->log, info) << "local router hash: " << m_impl->ctx.getIdentity()->getHash();
 
-        m_impl->serviceThread = std::thread([&](){
-            while(1) {
-                try {
-                    m_impl->ios.run();
-                    break;
-                } catch(std::exception &e) {
-                    // TODO Backtrace
-                    I2P_LOG(m_impl->log, error) << "exception in service thread: " << e.what();
+        /* Handlers of different subsystems and all tunnel data run in
+         * parallel, those which must not are kept apart by the strands
+         * of the i2pcpp::RouterContext.
+         */
+        uint32_t numThreads = std::max(2u, std::thread::hardware_concurrency());
+        try {
+            numThreads = std::stoul(m_impl->ctx.getDatabase()->getConfigValue("router_threads"));
+        } catch(std::exception &e) {}
+
+        numThreads = std::max<uint32_t>(numThreads, 1);
+        I2P_LOG(m_impl->log, debug) << "starting " << numThreads << " service threads";
+
+        for(uint32_t i = 0; i < numThreads; i++) {
+            m_impl->serviceThreads.emplace_back([&](){
+                while(1) {
+                    try {
+                        m_impl->ios.run();
+                        break;
+                    } catch(std::exception &e) {
+                        // TODO Backtrace
+                        I2P_LOG(m_impl->log, error) << "exception in service thread: " << e.what();
+                    }
                 }
-            }
-        });
+            });
+        }
 
         /* Peer conected */
         m_impl->ctx.getSignals().registerPeerConnected(boost::bind(
@@ -111,6 +131,10 @@ namespace i2pcpp {
         m_impl->ctx.getSignals().registerConnectionFailure(boost::bind(
             &PeerManager::failure, boost::ref(m_impl->ctx.getPeerManager()), _1
         ));
+        m_impl->ctx.getSignals().registerConnectionFailure(boost::bind(
+            &OutboundMessageDispatcher::connectionFailure,
+            boost::ref(m_impl->ctx.getOutMsgDisp()), _1
+        ));
 
         m_impl->ctx.getSignals().registerSearchReply(boost::bind(
             &DHT::SearchManager::searchReply,
@@ -145,6 +169,8 @@ namespace i2pcpp {
             boost::ref(m_impl->ctx.getOutMsgDisp()), _1
         ));
 
+        m_impl->ctx.getOutMsgDisp().begin();
+        m_impl->ctx.getProfileManager().begin();
         m_impl->ctx.getPeerManager().begin();
         m_impl->ctx.getTunnelManager().begin();
         m_impl->running = true;
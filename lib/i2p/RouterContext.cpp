@@ -16,11 +16,14 @@ namespace i2pcpp {
     RouterContext::RouterContext(std::shared_ptr<Database> const &db, boost::asio::io_service &ios) :
         m_db(db),
         m_ios(ios),
+        m_tunnelStrand(ios),
+        m_dhtStrand(ios),
+        m_databaseStrand(ios),
         m_inMsgDispatcher(ios, *this),
         m_outMsgDispatcher(*this),
-        m_signals(ios),
+        m_signals(m_tunnelStrand, m_dhtStrand),
         m_tunnelManager(ios, *this),
-        m_profileManager(*this),
+        m_profileManager(ios, *this),
         m_peerManager(ios, *this)
     {
         // Load the private keys from the database
@@ -104,9 +107,25 @@ namespace i2pcpp {
         return m_ios;
     }
 
+    boost::asio::io_service::strand& RouterContext::getTunnelStrand()
+    {
+        return m_tunnelStrand;
+    }
+
+    boost::asio::io_service::strand& RouterContext::getDHTStrand()
+    {
+        return m_dhtStrand;
+    }
+
+    boost::asio::io_service::strand& RouterContext::getDatabaseStrand()
+    {
+        return m_databaseStrand;
+    }
+
     void RouterContext::gracefulShutdown()
     {
         m_tunnelManager.gracefulShutdown();
         m_peerManager.gracefulShutdown();
+        m_profileManager.save();
     }
 }
@@ -101,11 +101,35 @@ namespace i2pcpp {
              */
             boost::asio::io_service& getIoService();
 
+            /**
+             * Handlers posted through a strand never run concurrently with
+             *  each other, even with several threads running the
+             *  boost::asio::io_service.
+             * @return the strand serializing tunnel building and pool
+             *  maintenance
+             */
+            boost::asio::io_service::strand& getTunnelStrand();
+
+            /**
+             * @return the strand serializing DHT searches and their replies
+             */
+            boost::asio::io_service::strand& getDHTStrand();
+
+            /**
+             * @return the strand serializing handlers which write to the
+             *  i2pcpp::Database
+             */
+            boost::asio::io_service::strand& getDatabaseStrand();
+
             void gracefulShutdown();
 
         private:
             boost::asio::io_service& m_ios;
 
+            boost::asio::io_service::strand m_tunnelStrand;
+            boost::asio::io_service::strand m_dhtStrand;
+            boost::asio::io_service::strand m_databaseStrand;
+
             /// Private key for ElGamal encryption
             std::shared_ptr<Botan::ElGamal_PrivateKey> m_encryptionKey;
 
@@ -4,76 +4,76 @@
  */
 #include "Signals.h"
 
-#include <boost/asio.hpp>
+#include <boost/bind.hpp>
 
 namespace i2pcpp {
     void Signals::invokeDatabaseStore(RouterHash const &from, StaticByteArray<32> const &k, bool isRouterInfo)
     {
-        m_ios.post(boost::bind(boost::ref(m_databaseStore), from, k, isRouterInfo));
+        m_dhtStrand.post(boost::bind(boost::ref(m_databaseStore), from, k, isRouterInfo));
     }
 
-    boost::signals2::connection Signals::registerDatabaseStore(DatabaseStore::slot_type const &dbsh)
+    void Signals::registerDatabaseStore(DatabaseStore::Handler const &dbsh)
     {
-        return m_databaseStore.connect(dbsh);
+        m_databaseStore.connect(dbsh);
     }
 
-    void Signals::invokeTunnelRecordsReceived(const uint32_t msgId, const std::list<BuildRecordPtr> &records)
+    void Signals::invokeTunnelRecordsReceived(const uint32_t msgId, BuildRecordBlockPtr const &records)
     {
-        m_ios.post(boost::bind(boost::ref(m_buildTunnelRequest), msgId, records));
+        m_tunnelStrand.post(boost::bind(boost::ref(m_buildTunnelRequest), msgId, records));
     }
 
-    boost::signals2::connection Signals::registerTunnelRecordsReceived(BuildTunnelRequest::slot_type const &btrh)
+    void Signals::registerTunnelRecordsReceived(BuildTunnelRequest::Handler const &btrh)
     {
-        return m_buildTunnelRequest.connect(btrh);
+        m_buildTunnelRequest.connect(btrh);
     }
 
     void Signals::invokePeerConnected(RouterHash const &rh)
     {
-        m_ios.post(boost::bind(boost::ref(m_peerConnected), rh));
+        m_dhtStrand.post(boost::bind(boost::ref(m_peerConnected), rh));
     }
 
-    boost::signals2::connection Signals::registerPeerConnected(PeerConnected::slot_type const &pch)
+    void Signals::registerPeerConnected(PeerConnected::Handler const &pch)
     {
-        return m_peerConnected.connect(pch);
+        m_peerConnected.connect(pch);
     }
 
     void Signals::invokeConnectionFailure(RouterHash const &rh)
     {
-        m_ios.post(boost::bind(boost::ref(m_connectionFailure), rh));
+        m_dhtStrand.post(boost::bind(boost::ref(m_connectionFailure), rh));
     }
 
-    boost::signals2::connection Signals::registerConnectionFailure(ConnectionFailure::slot_type const &cfh)
+    void Signals::registerConnectionFailure(ConnectionFailure::Handler const &cfh)
     {
-        return m_connectionFailure.connect(cfh);
+        m_connectionFailure.connect(cfh);
     }
 
     void Signals::invokeSearchReply(RouterHash const &from, StaticByteArray<32> const &query, std::list<RouterHash> const &hashes)
     {
-        m_ios.post(boost::bind(boost::ref(m_searchReply), from, query, hashes));
+        m_dhtStrand.post(boost::bind(boost::ref(m_searchReply), from, query, hashes));
     }
 
-    boost::signals2::connection Signals::registerSearchReply(SearchReply::slot_type const &srh)
+    void Signals::registerSearchReply(SearchReply::Handler const &srh)
     {
-        return m_searchReply.connect(srh);
+        m_searchReply.connect(srh);
     }
 
     void Signals::invokeTunnelGatewayData(RouterHash const &from, uint32_t const tunnelId, ByteArray const &data)
     {
-        m_ios.post(boost::bind(boost::ref(m_tunnelGatewayData), from, tunnelId, data));
+        m_tunnelGatewayData(from, tunnelId, data);
     }
 
-    boost::signals2::connection Signals::registerTunnelGatewayData(TunnelGatewayData::slot_type const &tgdh)
+    void Signals::registerTunnelGatewayData(TunnelGatewayData::Handler const &tgdh)
     {
-        return m_tunnelGatewayData.connect(tgdh);
+        m_tunnelGatewayData.connect(tgdh);
     }
 
     void Signals::invokeTunnelData(RouterHash const &from, uint32_t const tunnelId, StaticByteArray<1024> const &data)
     {
-        m_ios.post(boost::bind(boost::ref(m_tunnelData), from, tunnelId, data));
+        m_tunnelData(from, tunnelId, data);
     }
 
-    boost::signals2::connection Signals::registerTunnelData(TunnelData::slot_type const &tdh)
+    void Signals::registerTunnelData(TunnelData::Handler const &tdh)
     {
-        return m_tunnelData.connect(tdh);
+        m_tunnelData.connect(tdh);
     }
 }
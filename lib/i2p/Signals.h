@@ -5,55 +5,69 @@
 #ifndef SIGNALS_H
 #define SIGNALS_H
 
-#include <i2pcpp/datatypes/BuildRecord.h>
+#include "Event.h"
+
+#include <i2pcpp/datatypes/BuildRecordBlock.h>
 #include <i2pcpp/datatypes/RouterHash.h>
 
-#include <boost/signals2.hpp>
+#include <boost/asio.hpp>
 
-namespace boost { namespace asio { class io_service; } }
+#include <list>
 
 namespace i2pcpp {
+    /**
+     * The events subsystems use to notify each other. Most are posted to
+     *  the strand of the subsystem handling them. Tunnel data and tunnel
+     *  gateway events are invoked directly on the calling thread, which is
+     *  already running a message handler.
+     */
     class Signals {
         public:
             /**
-             * Signal invoked upon storage in the database.
+             * Event invoked upon storage in the database.
              */
-            typedef boost::signals2::signal<void(const RouterHash, const StaticByteArray<32>, bool)> DatabaseStore;
+            typedef Event<RouterHash, StaticByteArray<32>, bool> DatabaseStore;
 
             /**
-             * Signal invoked upon receival of a tunnel build request.
+             * Event invoked upon receival of a tunnel build request.
              */
-            typedef boost::signals2::signal<void(const uint32_t, std::list<BuildRecordPtr>)> BuildTunnelRequest;
+            typedef Event<uint32_t, BuildRecordBlockPtr> BuildTunnelRequest;
 
             /**
-             * Signal invoked upon connection of a peer.
+             * Event invoked upon connection of a peer.
              */
-            typedef boost::signals2::signal<void(const RouterHash)> PeerConnected;
+            typedef Event<RouterHash> PeerConnected;
 
             /**
-             * Signal invoked upon failure of connection.
+             * Event invoked upon failure of connection.
              */
-            typedef boost::signals2::signal<void(const RouterHash)> ConnectionFailure;
+            typedef Event<RouterHash> ConnectionFailure;
 
             /**
-             * Signal invoked upon response to a DHT search operation.
+             * Event invoked upon response to a DHT search operation.
              */
-            typedef boost::signals2::signal<void(const RouterHash, const StaticByteArray<32>, const std::list<RouterHash>)> SearchReply;
+            typedef Event<RouterHash, StaticByteArray<32>, std::list<RouterHash>> SearchReply;
 
             /**
-             * Signal invoked upon receival of tunnel gateway data.
+             * Event invoked upon receival of tunnel gateway data.
              */
-            typedef boost::signals2::signal<void(const RouterHash, const uint32_t, const ByteArray)> TunnelGatewayData;
+            typedef Event<RouterHash, uint32_t, ByteArray> TunnelGatewayData;
 
             /**
-             * Signal invoked upon receival of tunnel data.
+             * Event invoked upon receival of tunnel data.
              */
-            typedef boost::signals2::signal<void(const RouterHash, const uint32_t, const StaticByteArray<1024>)> TunnelData;
+            typedef Event<RouterHash, uint32_t, StaticByteArray<1024>> TunnelData;
 
             /**
-             * Constructs from a reference to an I/O service.
+             * Constructs from the strands of the subsystems whose events
+             *  must not be handled concurrently.
+             * @param tunnelStrand the strand tunnel build records are
+             *  handled on
+             * @param dhtStrand the strand DHT related events are handled on
              */
-            Signals(boost::asio::io_service &ios) : m_ios(ios) {}
+            Signals(boost::asio::io_service::strand &tunnelStrand, boost::asio::io_service::strand &dhtStrand) :
+                m_tunnelStrand(tunnelStrand),
+                m_dhtStrand(dhtStrand) {}
             Signals(const Signals &) = delete;
             Signals& operator=(Signals &) = delete;
 
@@ -66,46 +80,46 @@ namespace i2pcpp {
             void invokeDatabaseStore(RouterHash const &from, StaticByteArray<32> const &k, bool isRouterInfo = true);
 
             /**
-             * Registers an i2pcpp::Signals::DatabaseStore signal handler.
+             * Registers an i2pcpp::Signals::DatabaseStore event handler.
              */
-            boost::signals2::connection registerDatabaseStore(DatabaseStore::slot_type const &dbsh);
+            void registerDatabaseStore(DatabaseStore::Handler const &dbsh);
 
             /**
              * Invokes the tunnel records received event.
              * @param msgId the message identifier of the original outbound message
-             * @param records a list of pointers to i2pcpp::BuildRecord objects
+             * @param records the received i2pcpp::BuildRecordBlock
              */
-            void invokeTunnelRecordsReceived(uint32_t const msgId, std::list<BuildRecordPtr> const &records);
+            void invokeTunnelRecordsReceived(uint32_t const msgId, BuildRecordBlockPtr const &records);
 
             /**
-             * Registers an i2pcpp::Signals::TunnelRecordsReceived signal handler.
+             * Registers an i2pcpp::Signals::TunnelRecordsReceived event handler.
              */
-            boost::signals2::connection registerTunnelRecordsReceived(BuildTunnelRequest::slot_type const &btrh);
+            void registerTunnelRecordsReceived(BuildTunnelRequest::Handler const &btrh);
 
             /**
-             * Invokes the peer connected signal.
+             * Invokes the peer connected event.
              * @param rh the i2pcpp::RouterHash of the peer.
              */
             void invokePeerConnected(RouterHash const &rh);
 
             /**
-             * Registers an i2pcpp::Signals::PeerConnected signal handler.
+             * Registers an i2pcpp::Signals::PeerConnected event handler.
              */
-            boost::signals2::connection registerPeerConnected(PeerConnected::slot_type const &pch);
+            void registerPeerConnected(PeerConnected::Handler const &pch);
 
             /**
-             * Invokes the connection failure signal.
+             * Invokes the connection failure event.
              * @param rh the i2pcpp::RouterHash of the peer we failed to connect to
              */
             void invokeConnectionFailure(RouterHash const &rh);
 
             /**
-             * Registers an i2pcpp::Signals::ConnectionFailure signal handler.
+             * Registers an i2pcpp::Signals::ConnectionFailure event handler.
              */
-            boost::signals2::connection registerConnectionFailure(ConnectionFailure::slot_type const &cfh);
+            void registerConnectionFailure(ConnectionFailure::Handler const &cfh);
 
             /**
-             * Invokes the DHT search reply signal.
+             * Invokes the DHT search reply event.
              * @param from the i2pcpp::RouterHash of the sending peer
              * @param query the 32 byte query
              * @param hashes a list of i2pcpp::RouterHashes returned by the search
@@ -113,12 +127,12 @@ namespace i2pcpp {
             void invokeSearchReply(RouterHash const &from, StaticByteArray<32> const &query, std::list<RouterHash> const &hashes);
 
             /**
-             * Registers an i2pcpp::Signals::SearchReply signal handler.
+             * Registers an i2pcpp::Signals::SearchReply event handler.
              */
-            boost::signals2::connection registerSearchReply(SearchReply::slot_type const &srh);
+            void registerSearchReply(SearchReply::Handler const &srh);
 
             /**
-             * Invokes the tunnel gateway data signal.
+             * Invokes the tunnel gateway data event on the calling thread.
              * @param from the i2pcpp::RouterHash of the router that sent the data
              * @param tunnelId the ID of the associated tunnel
              * @param data the received data
@@ -126,12 +140,12 @@ namespace i2pcpp {
             void invokeTunnelGatewayData(RouterHash const &from, uint32_t const tunnelId, ByteArray const &data);
 
             /**
-             * Registers an i2pcpp::Signals::TunnelGatewayData signal handler.
+             * Registers an i2pcpp::Signals::TunnelGatewayData event handler.
              */
-            boost::signals2::connection registerTunnelGatewayData(TunnelGatewayData::slot_type const &tgdh);
+            void registerTunnelGatewayData(TunnelGatewayData::Handler const &tgdh);
 
             /**
-             * Invokes the tunnel data signal.
+             * Invokes the tunnel data event on the calling thread.
              * @param from the i2pcpp::RouterHash of the router that sent the data
              * @param tunnelId the ID of the associated tunnel
              * @param data the 1024 bytes of received data
@@ -139,12 +153,13 @@ namespace i2pcpp {
             void invokeTunnelData(RouterHash const &from, uint32_t const tunnelId, StaticByteArray<1024> const &data);
 
             /**
-             * Registers an i2pcpp::Signals::TunnelData signal handler.
+             * Registers an i2pcpp::Signals::TunnelData event handler.
              */
-            boost::signals2::connection registerTunnelData(TunnelData::slot_type const &tdh);
+            void registerTunnelData(TunnelData::Handler const &tdh);
 
         private:
-            boost::asio::io_service& m_ios;
+            boost::asio::io_service::strand& m_tunnelStrand;
+            boost::asio::io_service::strand& m_dhtStrand;
 
             DatabaseStore m_databaseStore;
             BuildTunnelRequest m_buildTunnelRequest;
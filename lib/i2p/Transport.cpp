@@ -4,9 +4,17 @@
  */
 #include "../../include/i2pcpp/Transport.h"
 
+#include <cstdint>
+
 namespace i2pcpp {
     Transport::~Transport() {}
 
+    uint32_t Transport::getSendWindow(RouterHash const &) const
+    {
+        // Transports without a limit take everything right away
+        return UINT32_MAX;
+    }
+
     boost::signals2::connection Transport::registerEstablishedHandler(EstablishedSignal::slot_type const &eh)
     {
         return m_establishedSignal.connect(eh);
@@ -26,4 +34,9 @@ namespace i2pcpp {
     {
         return m_disconnectedSignal.connect(ds);
     }
+
+    boost::signals2::connection Transport::registerReadySignal(ReadySignal::slot_type const &rs)
+    {
+        return m_readySignal.connect(rs);
+    }
 }
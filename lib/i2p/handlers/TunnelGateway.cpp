@@ -18,8 +18,7 @@ namespace i2pcpp {
         {
             std::shared_ptr<I2NP::TunnelGateway> tg = std::dynamic_pointer_cast<I2NP::TunnelGateway>(msg);
 
-            I2P_LOG_SCOPED_TAG(m_log, "RouterHash", from);
-            I2P_LOG(m_log, debug) << "received TunnelGateway message";
+            I2P_LOG_TAGGED(m_log, debug, "RouterHash", from) << "received TunnelGateway message";
 
             m_ctx.getSignals().invokeTunnelGatewayData(from, tg->getTunnelId(), tg->getData());
         }
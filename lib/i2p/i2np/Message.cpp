@@ -14,9 +14,12 @@
 #include "TunnelGateway.h"
 #include "Garlic.h"
 
+#include <i2pcpp/util/Random.h>
+
 #include <botan/pipe.h>
 #include <botan/lookup.h>
-#include <botan/auto_rng.h>
+
+#include <chrono>
 
 namespace i2pcpp {
     namespace I2NP {
@@ -48,13 +51,10 @@ namespace i2pcpp {
                 b.insert(b.begin(), m_msgId >> 16);
                 b.insert(b.begin(), m_msgId >> 24);
             } else {
-                // m_expiration?
-                uint32_t expiration = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count() + 60;
-
-                b.insert(b.begin(), expiration);
-                b.insert(b.begin(), expiration >> 8);
-                b.insert(b.begin(), expiration >> 16);
-                b.insert(b.begin(), expiration >> 24);
+                b.insert(b.begin(), m_expiration);
+                b.insert(b.begin(), m_expiration >> 8);
+                b.insert(b.begin(), m_expiration >> 16);
+                b.insert(b.begin(), m_expiration >> 24);
             }
 
             b.insert(b.begin(), (unsigned char)getType());
@@ -67,6 +67,11 @@ namespace i2pcpp {
             return m_msgId;
         }
 
+        uint32_t Message::getExpiration() const
+        {
+            return m_expiration;
+        }
+
         Message::Type Message::getType() const
         {
             auto& ti = typeid(*this);
@@ -103,7 +108,11 @@ namespace i2pcpp {
 
         std::string Message::getTypeString() const
         {
-            auto type = getType();
+            return getTypeString(getType());
+        }
+
+        std::string Message::getTypeString(Type type)
+        {
             switch(type) {
             case Type::DB_LOOKUP: return "DBL";
             case Type::DELIVERY_STATUS: return "DS";
@@ -114,7 +123,7 @@ namespace i2pcpp {
             case Type::TUNNEL_DATA: return "TD";
             case Type::TUNNEL_GATEWAY: return "TG";
             case Type::GARLIC: return "G";
-            default: "X";
+            default: return "X";
             }
         }
 
@@ -140,6 +149,8 @@ namespace i2pcpp {
 
                 if(end - dataItr != size)
                     throw std::runtime_error("error parsing I2NP message");
+
+                expiration = longExpiration.getValue() / 1000;
             } else
                 expiration = parseUint32(dataItr);
 
@@ -192,14 +203,22 @@ namespace i2pcpp {
             return m;
         }
 
-        Message::Message()
+        /**
+         * @return the expiration for a message created now
+         */
+        static uint32_t defaultExpiration()
         {
-            Botan::AutoSeeded_RNG rng;
+            return std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count() + Message::DEFAULT_EXPIRATION;
+        }
 
-            rng.randomize((unsigned char *)&m_msgId, sizeof(m_msgId));
+        Message::Message() :
+            m_expiration(defaultExpiration())
+        {
+            Random::randomize((unsigned char *)&m_msgId, sizeof(m_msgId));
         }
 
         Message::Message(uint32_t msgId) :
-            m_msgId(msgId) {}
+            m_msgId(msgId),
+            m_expiration(defaultExpiration()) {}
     }
 }
@@ -60,6 +60,12 @@ namespace i2pcpp {
                  */
                 uint32_t getMsgId() const;
 
+                /**
+                 * @return the expiration of the message, in seconds since
+                 *  the unix epoch
+                 */
+                uint32_t getExpiration() const;
+
                 /**
                  * @return the type of the message
                  * @throw std::runtime_error if the type could not be obtained
@@ -68,6 +74,11 @@ namespace i2pcpp {
                 Type getType() const;
                 std::string getTypeString() const;
 
+                /**
+                 * @return the short name of \a type, "X" if it is unknown
+                 */
+                static std::string getTypeString(Type type);
+
                 /**
                  * Converts an i2pcpp::ByteArray to an i2pcpp::I2NP::Message object.
                  * That is, deserializes.
@@ -79,6 +90,9 @@ namespace i2pcpp {
                  */
                 static std::shared_ptr<Message> fromBytes(uint32_t msgId, ByteArray const &data, bool standardHeader = true);
 
+                /// Seconds a message we create is valid for
+                static const uint32_t DEFAULT_EXPIRATION = 60;
+
             protected:
                 /**
                  * Default constructs. Generates a random message identifier.
@@ -12,6 +12,10 @@ namespace i2pcpp {
             m_tunnelId(tunnelId),
             m_data(data) {}
 
+        TunnelGateway::TunnelGateway(uint32_t const tunnelId, ByteArray &&data) :
+            m_tunnelId(tunnelId),
+            m_data(std::move(data)) {}
+
         uint32_t TunnelGateway::getTunnelId() const
         {
             return m_tunnelId;
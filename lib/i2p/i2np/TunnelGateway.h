@@ -27,6 +27,12 @@ namespace i2pcpp {
                  */
                 TunnelGateway(uint32_t const tunnelId, ByteArray const &data);
 
+                /**
+                 * Constructs from a \a tunnelId, taking ownership of \a data
+                 *  rather than copying it.
+                 */
+                TunnelGateway(uint32_t const tunnelId, ByteArray &&data);
+
                 /**
                  * @return the tunnel identifier associated with this message
                  */
@@ -7,9 +7,7 @@
 
 #include "Message.h"
 
-#include <i2pcpp/datatypes/BuildRecord.h>
-
-#include <list>
+#include <i2pcpp/datatypes/BuildRecordBlock.h>
 
 namespace i2pcpp {
     namespace I2NP {
@@ -30,20 +28,19 @@ namespace i2pcpp {
         class VariableTunnelBuild : public Message {
             public:
                 /**
-                 * Constructs from a std::list of pointers to i2pcpp::BuildRecord objects.
+                 * Constructs from an i2pcpp::BuildRecordBlock.
                  */
-                VariableTunnelBuild(std::list<BuildRecordPtr> buildRecords);
+                VariableTunnelBuild(BuildRecordBlockPtr const &buildRecords);
 
                 /**
-                 * Constructs from a \a msgId and a std::list of pointers to
-                 *  i2pcpp::BuildRecord objects.
+                 * Constructs from a \a msgId and an i2pcpp::BuildRecordBlock.
                  */
-                VariableTunnelBuild(uint32_t msgId, std::list<BuildRecordPtr> buildRecords);
+                VariableTunnelBuild(uint32_t msgId, BuildRecordBlockPtr const &buildRecords);
 
                 /**
-                 * @return the std::list of pointers to i2pcpp::BuildRecord objects
+                 * @return the i2pcpp::BuildRecordBlock holding the records
                  */
-                std::list<BuildRecordPtr> getRecords() const;
+                BuildRecordBlockPtr getRecords() const;
 
                 /**
                  * Converts an i2pcpp::ByteArray to an i2pcpp::I2NP::VariableTunnelBuild
@@ -64,7 +61,7 @@ namespace i2pcpp {
                 ByteArray compile() const;
 
             private:
-                std::list<BuildRecordPtr> m_buildRecords;
+                BuildRecordBlockPtr m_buildRecords;
         };
     }
 }
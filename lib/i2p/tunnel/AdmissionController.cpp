@@ -0,0 +1,120 @@
+#include "AdmissionController.h"
+
+namespace i2pcpp {
+    namespace Tunnel {
+        AdmissionController::AdmissionController() :
+            m_rng(std::random_device()()) {}
+
+        void AdmissionController::setLimits(Limits const &limits)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_limits = limits;
+        }
+
+        AdmissionController::Limits AdmissionController::getLimits() const
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_limits;
+        }
+
+        void AdmissionController::update(uint64_t bandwidth, uint32_t queueWait)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_bandwidth = bandwidth;
+            m_queueWait = queueWait;
+        }
+
+        BuildResponseRecord::Reply AdmissionController::admit(uint32_t participating)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            auto reply = decide(participating);
+            record(reply);
+
+            return reply;
+        }
+
+        AdmissionController::Stats AdmissionController::getStats() const
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_stats;
+        }
+
+        std::string AdmissionController::getReplyString(BuildResponseRecord::Reply reply)
+        {
+            switch(reply) {
+                case BuildResponseRecord::Reply::SUCCESS:
+                    return "success";
+
+                case BuildResponseRecord::Reply::PROBABALISTIC_REJECT:
+                    return "probabilistic";
+
+                case BuildResponseRecord::Reply::TRANSIENT_OVERLOAD:
+                    return "overload";
+
+                case BuildResponseRecord::Reply::BANDWIDTH:
+                    return "bandwidth";
+
+                case BuildResponseRecord::Reply::CRITICAL:
+                    return "critical";
+            }
+
+            return "unknown";
+        }
+
+        BuildResponseRecord::Reply AdmissionController::decide(uint32_t participating)
+        {
+            if(participating >= m_limits.maxParticipating)
+                return BuildResponseRecord::Reply::TRANSIENT_OVERLOAD;
+
+            if(m_queueWait > m_limits.maxQueueWait)
+                return BuildResponseRecord::Reply::TRANSIENT_OVERLOAD;
+
+            /* Assume a new tunnel will carry as much as the average existing
+             * one, and refuse it if that would take us over budget.
+             */
+            if(m_limits.bandwidth) {
+                uint64_t perTunnel = (participating ? m_bandwidth / participating : 0);
+                if(m_bandwidth + perTunnel > m_limits.bandwidth)
+                    return BuildResponseRecord::Reply::BANDWIDTH;
+            }
+
+            /* Between the soft limit and the hard cap, reject with a
+             * probability that grows linearly towards the cap.
+             */
+            uint32_t soft = (uint64_t)m_limits.maxParticipating * SOFT_LIMIT / 100;
+            if(participating > soft) {
+                std::uniform_int_distribution<uint32_t> dist(soft, m_limits.maxParticipating - 1);
+                if(dist(m_rng) < participating)
+                    return BuildResponseRecord::Reply::PROBABALISTIC_REJECT;
+            }
+
+            return BuildResponseRecord::Reply::SUCCESS;
+        }
+
+        void AdmissionController::record(BuildResponseRecord::Reply reply)
+        {
+            switch(reply) {
+                case BuildResponseRecord::Reply::SUCCESS:
+                    ++m_stats.accepted;
+                    break;
+
+                case BuildResponseRecord::Reply::PROBABALISTIC_REJECT:
+                    ++m_stats.probabilistic;
+                    break;
+
+                case BuildResponseRecord::Reply::TRANSIENT_OVERLOAD:
+                    ++m_stats.overload;
+                    break;
+
+                case BuildResponseRecord::Reply::BANDWIDTH:
+                    ++m_stats.bandwidth;
+                    break;
+
+                case BuildResponseRecord::Reply::CRITICAL:
+                    ++m_stats.critical;
+                    break;
+            }
+        }
+    }
+}
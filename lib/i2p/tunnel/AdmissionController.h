@@ -0,0 +1,94 @@
+#ifndef TUNNELADMISSIONCONTROLLER_H
+#define TUNNELADMISSIONCONTROLLER_H
+
+#include <i2pcpp/datatypes/BuildResponseRecord.h>
+
+#include <mutex>
+#include <random>
+
+namespace i2pcpp {
+    namespace Tunnel {
+        /**
+         * Decides whether we accept a request to participate in a tunnel,
+         *  based on the number of tunnels we already participate in, the
+         *  bandwidth they use and how long build requests are waiting for
+         *  a worker. The answer is the reply code to put in our
+         *  i2pcpp::BuildResponseRecord.
+         */
+        class AdmissionController {
+            public:
+                struct Limits {
+                    /// Hard cap on the number of participating tunnels
+                    uint32_t maxParticipating = DEFAULT_MAX_PARTICIPATING;
+
+                    /// Bytes per second available to participating tunnels, 0 for no limit
+                    uint64_t bandwidth = 0;
+
+                    /// Maximum average build queue wait in milliseconds
+                    uint32_t maxQueueWait = DEFAULT_MAX_QUEUE_WAIT;
+                };
+
+                /**
+                 * Cumulative counters of decisions, by reply code.
+                 */
+                struct Stats {
+                    uint64_t accepted;
+                    uint64_t probabilistic;
+                    uint64_t overload;
+                    uint64_t bandwidth;
+                    uint64_t critical;
+                };
+
+                AdmissionController();
+                AdmissionController(const AdmissionController &) = delete;
+                AdmissionController& operator=(AdmissionController &) = delete;
+
+                void setLimits(Limits const &limits);
+                Limits getLimits() const;
+
+                /**
+                 * Updates the observed load.
+                 * @param bandwidth bytes per second currently relayed for
+                 *  participating tunnels
+                 * @param queueWait the average build queue wait in milliseconds
+                 */
+                void update(uint64_t bandwidth, uint32_t queueWait);
+
+                /**
+                 * Decides on a request, given that we currently participate
+                 *  in \a participating tunnels, and records the decision.
+                 */
+                BuildResponseRecord::Reply admit(uint32_t participating);
+
+                Stats getStats() const;
+
+                /**
+                 * @return a short name for \a reply, suitable for stats
+                 */
+                static std::string getReplyString(BuildResponseRecord::Reply reply);
+
+                static const uint32_t DEFAULT_MAX_PARTICIPATING = 2500;
+                static const uint32_t DEFAULT_MAX_QUEUE_WAIT = 1000;
+
+                /// Percentage of the hard cap above which requests are rejected at random
+                static const uint32_t SOFT_LIMIT = 80;
+
+            private:
+                BuildResponseRecord::Reply decide(uint32_t participating);
+                void record(BuildResponseRecord::Reply reply);
+
+                Limits m_limits;
+
+                uint64_t m_bandwidth = 0;
+                uint32_t m_queueWait = 0;
+
+                Stats m_stats = {};
+
+                std::minstd_rand m_rng;
+
+                mutable std::mutex m_mutex;
+        };
+    }
+}
+
+#endif
@@ -0,0 +1,140 @@
+#include "BuildPreparer.h"
+
+#include <i2pcpp/util/make_unique.h>
+#include <i2pcpp/util/Random.h>
+
+namespace i2pcpp {
+    namespace Tunnel {
+        BuildPreparer::BuildPreparer(boost::asio::io_service &ios, uint32_t threads, uint32_t ephemerals) :
+            m_ios(ios),
+            m_numThreads(threads),
+            m_ephemerals(ephemerals),
+            m_refilling(false),
+            m_tunnels(0),
+            m_records(0),
+            m_failed(0),
+            m_log(boost::log::keywords::channel = "TBP") {}
+
+        BuildPreparer::~BuildPreparer()
+        {
+            stop();
+        }
+
+        void BuildPreparer::start()
+        {
+            if(m_threads.size())
+                return;
+
+            m_workIos.reset();
+            m_work = std::make_unique<boost::asio::io_service::work>(m_workIos);
+
+            for(uint32_t i = 0; i < m_numThreads; i++)
+                m_threads.emplace_back(&BuildPreparer::run, this);
+
+            m_refilling = true;
+            m_workIos.post(std::bind(&BuildPreparer::refill, this));
+
+            I2P_LOG(m_log, debug) << "started " << m_numThreads << " tunnel build preparers";
+        }
+
+        void BuildPreparer::stop()
+        {
+            if(!m_threads.size())
+                return;
+
+            m_work.reset();
+            m_workIos.stop();
+
+            for(auto& t: m_threads)
+                t.join();
+
+            m_threads.clear();
+            m_refilling = false;
+        }
+
+        void BuildPreparer::submit(TunnelPtr const &t, CompletionHandler handler)
+        {
+            const size_t numHops = t->getNumHops();
+            if(!numHops) {
+                m_ios.post(std::bind(handler, true));
+                return;
+            }
+
+            auto job = std::make_shared<Job>();
+            job->tunnel = t;
+            job->handler = std::move(handler);
+            job->remaining = numHops;
+            job->failed = false;
+
+            for(size_t i = 0; i < numHops; i++)
+                m_workIos.post(std::bind(&BuildPreparer::secure, this, job, i));
+        }
+
+        size_t BuildPreparer::getReady() const
+        {
+            return m_ephemerals.size();
+        }
+
+        BuildPreparer::Stats BuildPreparer::getStats() const
+        {
+            return { m_tunnels, m_records, m_failed, m_ephemerals.getMisses() };
+        }
+
+        void BuildPreparer::run()
+        {
+            try {
+                m_workIos.run();
+            } catch(std::exception &e) {
+                I2P_LOG(m_log, error) << "exception in tunnel build preparer: " << e.what();
+            }
+        }
+
+        void BuildPreparer::secure(JobPtr const &job, size_t hop)
+        {
+            try {
+                job->tunnel->secureRecord(hop, m_ephemerals.take(Random::getRNG()));
+                ++m_records;
+            } catch(std::exception &e) {
+                I2P_LOG(m_log, error) << "error securing build record: " << e.what();
+                job->failed = true;
+            }
+
+            if(!m_refilling.exchange(true))
+                m_workIos.post(std::bind(&BuildPreparer::refill, this));
+
+            if(--job->remaining)
+                return;
+
+            // This was the last hop, the AES layers can go on now
+            if(!job->failed) {
+                try {
+                    job->tunnel->layerRecords();
+                } catch(std::exception &e) {
+                    I2P_LOG(m_log, error) << "error layering build records: " << e.what();
+                    job->failed = true;
+                }
+            }
+
+            if(job->failed)
+                ++m_failed;
+            else
+                ++m_tunnels;
+
+            m_ios.post(std::bind(job->handler, !job->failed));
+        }
+
+        void BuildPreparer::refill()
+        {
+            try {
+                if(m_ephemerals.refill(Random::getRNG())) {
+                    m_workIos.post(std::bind(&BuildPreparer::refill, this));
+                    return;
+                }
+            } catch(std::exception &e) {
+                I2P_LOG(m_log, error) << "error generating ElGamal ephemeral: " << e.what();
+            }
+
+            m_refilling = false;
+        }
+    }
+}
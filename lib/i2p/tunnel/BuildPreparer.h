@@ -0,0 +1,124 @@
+#ifndef TUNNELBUILDPREPARER_H
+#define TUNNELBUILDPREPARER_H
+
+#include "Tunnel.h"
+
+#include <i2pcpp/Log.h>
+
+#include <i2pcpp/util/ElGamal.h>
+
+#include <boost/asio.hpp>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace i2pcpp {
+    namespace Tunnel {
+        /**
+         * A pool of threads which secure the build records of our own
+         *  tunnels before they are sent. Each hop's ElGamal encryption is a
+         *  separate job, so the hops of one tunnel and the records of
+         *  tunnels being built at the same time are all encrypted in
+         *  parallel, away from the router's io_service.
+         * When there are no builds to do the workers precompute ElGamal
+         *  ephemeral keys, which halves the work left for each record.
+         */
+        class BuildPreparer {
+            public:
+                /**
+                 * Called on the router io_service once all records of the
+                 *  tunnel have been secured, with false if any of them
+                 *  could not be. The tunnel can not be sent in that case.
+                 */
+                typedef std::function<void(bool)> CompletionHandler;
+
+                /**
+                 * Cumulative counters, callers diff them to obtain rates.
+                 */
+                struct Stats {
+                    uint64_t tunnels;
+                    uint64_t records;
+                    uint64_t failed;
+
+                    /// Records which had to generate their own ephemeral key
+                    uint64_t misses;
+                };
+
+                /**
+                 * @param ios the io_service completion handlers are posted to
+                 * @param threads the number of worker threads
+                 * @param ephemerals the number of ElGamal ephemeral keys to
+                 *  keep ready
+                 */
+                BuildPreparer(boost::asio::io_service &ios, uint32_t threads = DEFAULT_THREADS, uint32_t ephemerals = ElGamal::EphemeralPool::DEFAULT_CAPACITY);
+                BuildPreparer(const BuildPreparer &) = delete;
+                BuildPreparer& operator=(BuildPreparer &) = delete;
+                ~BuildPreparer();
+
+                /**
+                 * Starts the worker threads, which begin filling the
+                 *  ephemeral key pool.
+                 */
+                void start();
+
+                /**
+                 * Stops the worker threads. Tunnels still being prepared are
+                 *  discarded.
+                 */
+                void stop();
+
+                /**
+                 * Queues the records of \a t to be secured.
+                 */
+                void submit(TunnelPtr const &t, CompletionHandler handler);
+
+                /**
+                 * @return the number of ephemeral keys currently ready
+                 */
+                size_t getReady() const;
+
+                Stats getStats() const;
+
+                static const uint32_t DEFAULT_THREADS = 2;
+
+            private:
+                /**
+                 * A tunnel whose records are being secured.
+                 */
+                struct Job {
+                    TunnelPtr tunnel;
+                    CompletionHandler handler;
+
+                    std::atomic<uint32_t> remaining;
+                    std::atomic<bool> failed;
+                };
+
+                typedef std::shared_ptr<Job> JobPtr;
+
+                void run();
+                void secure(JobPtr const &job, size_t hop);
+                void refill();
+
+                boost::asio::io_service &m_ios;
+                boost::asio::io_service m_workIos;
+                std::unique_ptr<boost::asio::io_service::work> m_work;
+                std::vector<std::thread> m_threads;
+
+                uint32_t m_numThreads;
+
+                ElGamal::EphemeralPool m_ephemerals;
+                std::atomic<bool> m_refilling;
+
+                std::atomic<uint64_t> m_tunnels;
+                std::atomic<uint64_t> m_records;
+                std::atomic<uint64_t> m_failed;
+
+                i2p_logger_mt m_log;
+        };
+    }
+}
+
+#endif
@@ -0,0 +1,124 @@
+#include "BuildWorkerPool.h"
+
+#include <i2pcpp/util/make_unique.h>
+
+#include <botan/pubkey.h>
+#include <botan/elgamal.h>
+
+namespace i2pcpp {
+    namespace Tunnel {
+        /// The decryptor owned by the current worker thread
+        static thread_local const Botan::PK_Decryptor *t_decryptor = nullptr;
+
+        BuildWorkerPool::BuildWorkerPool(boost::asio::io_service &ios, uint32_t threads, uint32_t maxDepth) :
+            m_ios(ios),
+            m_numThreads(threads),
+            m_maxDepth(maxDepth),
+            m_depth(0),
+            m_processed(0),
+            m_rejected(0),
+            m_failed(0),
+            m_queueWait(0),
+            m_dropped(Metrics::counter("tunnels.build_workers.dropped")),
+            m_errors(Metrics::counter("tunnels.build_workers.failed")),
+            m_log(boost::log::keywords::channel = "TBW") {}
+
+        BuildWorkerPool::~BuildWorkerPool()
+        {
+            stop();
+        }
+
+        void BuildWorkerPool::start(std::shared_ptr<const Botan::ElGamal_PrivateKey> const &key)
+        {
+            if(m_threads.size())
+                return;
+
+            m_key = key;
+            m_workIos.reset();
+            m_work = std::make_unique<boost::asio::io_service::work>(m_workIos);
+
+            for(uint32_t i = 0; i < m_numThreads; i++)
+                m_threads.emplace_back(&BuildWorkerPool::run, this);
+
+            I2P_LOG(m_log, debug) << "started " << m_numThreads << " tunnel build workers";
+        }
+
+        void BuildWorkerPool::stop()
+        {
+            if(!m_threads.size())
+                return;
+
+            m_work.reset();
+            m_workIos.stop();
+
+            for(auto& t: m_threads)
+                t.join();
+
+            m_threads.clear();
+            m_depth = 0;
+        }
+
+        bool BuildWorkerPool::submit(BuildRecordPtr const &record, CompletionHandler handler)
+        {
+            if(++m_depth > m_maxDepth) {
+                --m_depth;
+                ++m_rejected;
+                m_dropped.add();
+                return false;
+            }
+
+            m_workIos.post(std::bind(&BuildWorkerPool::process, this, record, std::move(handler), Clock::now()));
+
+            return true;
+        }
+
+        uint32_t BuildWorkerPool::getDepth() const
+        {
+            return m_depth;
+        }
+
+        BuildWorkerPool::Stats BuildWorkerPool::getStats() const
+        {
+            return { m_processed, m_rejected, m_failed, m_queueWait };
+        }
+
+        void BuildWorkerPool::run()
+        {
+            Botan::PK_Decryptor_EME decryptor(*m_key, "Raw");
+            t_decryptor = &decryptor;
+
+            /* process() catches what a request throws, this only keeps the
+             * thread alive if something slips past it.
+             */
+            for(;;) {
+                try {
+                    m_workIos.run();
+                    break;
+                } catch(std::exception &e) {
+                    I2P_LOG(m_log, error) << "exception in tunnel build worker: " << e.what();
+                }
+            }
+
+            t_decryptor = nullptr;
+        }
+
+        void BuildWorkerPool::process(BuildRecordPtr const &record, CompletionHandler const &handler, Clock::time_point const &queued)
+        {
+            --m_depth;
+            m_queueWait += std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - queued).count();
+
+            try {
+                auto req = std::make_shared<BuildRequestRecord>(*record);
+                req->decrypt(*t_decryptor);
+                req->parse();
+
+                ++m_processed;
+                m_ios.post(std::bind(handler, req));
+            } catch(std::exception &e) {
+                I2P_LOG(m_log, debug) << "error decrypting build request record: " << e.what();
+                ++m_failed;
+                m_errors.add();
+            }
+        }
+    }
+}
@@ -0,0 +1,125 @@
+#ifndef TUNNELBUILDWORKERPOOL_H
+#define TUNNELBUILDWORKERPOOL_H
+
+#include <i2pcpp/Log.h>
+#include <i2pcpp/util/Metrics.h>
+
+#include <i2pcpp/datatypes/BuildRecord.h>
+#include <i2pcpp/datatypes/BuildRequestRecord.h>
+
+#include <boost/asio.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace Botan { class ElGamal_PrivateKey; }
+
+namespace i2pcpp {
+    namespace Tunnel {
+        /**
+         * A small, bounded pool of threads which perform the ElGamal
+         *  decryption of tunnel build request records. This keeps the most
+         *  expensive operation we do on behalf of other routers off the
+         *  router's io_service.
+         * Each worker owns a single decryptor for the lifetime of the
+         *  thread. Once \a maxDepth requests are waiting new requests are
+         *  refused immediately rather than queued.
+         * A request which fails for whatever reason is counted and logged,
+         *  the worker carries on with the next one.
+         */
+        class BuildWorkerPool {
+            public:
+                /**
+                 * Called on the router io_service with the decrypted and
+                 *  parsed record.
+                 */
+                typedef std::function<void(BuildRequestRecordPtr)> CompletionHandler;
+
+                /**
+                 * Cumulative counters, callers diff them to obtain rates.
+                 */
+                struct Stats {
+                    uint64_t processed;
+                    uint64_t rejected;
+                    uint64_t failed;
+
+                    /// Total time spent queued by processed records, in microseconds
+                    uint64_t queueWait;
+                };
+
+                /**
+                 * @param ios the io_service completion handlers are posted to
+                 * @param threads the number of worker threads
+                 * @param maxDepth the number of queued requests beyond which
+                 *  new requests are rejected
+                 */
+                BuildWorkerPool(boost::asio::io_service &ios, uint32_t threads = DEFAULT_THREADS, uint32_t maxDepth = DEFAULT_MAX_DEPTH);
+                BuildWorkerPool(const BuildWorkerPool &) = delete;
+                BuildWorkerPool& operator=(BuildWorkerPool &) = delete;
+                ~BuildWorkerPool();
+
+                /**
+                 * Starts the worker threads.
+                 * @param key our ElGamal private key
+                 */
+                void start(std::shared_ptr<const Botan::ElGamal_PrivateKey> const &key);
+
+                /**
+                 * Stops the worker threads. Requests still queued are discarded.
+                 */
+                void stop();
+
+                /**
+                 * Queues \a record for decryption.
+                 * @return false if the queue is full and the record was dropped
+                 */
+                bool submit(BuildRecordPtr const &record, CompletionHandler handler);
+
+                /**
+                 * @return the number of records currently waiting for a worker
+                 */
+                uint32_t getDepth() const;
+
+                Stats getStats() const;
+
+                static const uint32_t DEFAULT_THREADS = 2;
+                static const uint32_t DEFAULT_MAX_DEPTH = 64;
+
+            private:
+                typedef std::chrono::steady_clock Clock;
+
+                void run();
+                void process(BuildRecordPtr const &record, CompletionHandler const &handler, Clock::time_point const &queued);
+
+                boost::asio::io_service &m_ios;
+                boost::asio::io_service m_workIos;
+                std::unique_ptr<boost::asio::io_service::work> m_work;
+                std::vector<std::thread> m_threads;
+
+                std::shared_ptr<const Botan::ElGamal_PrivateKey> m_key;
+
+                uint32_t m_numThreads;
+                uint32_t m_maxDepth;
+
+                std::atomic<uint32_t> m_depth;
+                std::atomic<uint64_t> m_processed;
+                std::atomic<uint64_t> m_rejected;
+                std::atomic<uint64_t> m_failed;
+                std::atomic<uint64_t> m_queueWait;
+
+                /// Requests refused because the queue was full
+                Metrics::Counter &m_dropped;
+
+                /// Requests which could not be decrypted or parsed
+                Metrics::Counter &m_errors;
+
+                i2p_logger_mt m_log;
+        };
+    }
+}
+
+#endif
@@ -4,8 +4,7 @@
 #include "FollowOnFragment.h"
 
 #include <i2pcpp/util/make_unique.h>
-
-#include <botan/auto_rng.h>
+#include <i2pcpp/util/Random.h>
 
 namespace i2pcpp {
     namespace Tunnel {
@@ -56,9 +55,7 @@ namespace i2pcpp {
             if(first->mustFragment(data.size(), maxSize)) {
                 first->setFragmented(true);
 
-                uint32_t msgId = 0;
-                Botan::AutoSeeded_RNG rng;
-                rng.randomize((unsigned char *)&msgId, sizeof(msgId));
+                const uint32_t msgId = Random::get<uint32_t>();
                 first->setMsgId(msgId);
 
                 auto pos = data.cbegin();
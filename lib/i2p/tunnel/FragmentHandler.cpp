@@ -1,13 +1,15 @@
 #include "FragmentHandler.h"
 
-#include "FirstFragment.h"
-
 #include "../RouterContext.h"
 
 #include "../i2np/TunnelGateway.h"
 
+#include <i2pcpp/datatypes/RouterIdentity.h>
+
 #include <i2pcpp/util/make_unique.h>
 
+#include <tuple>
+
 namespace i2pcpp {
     namespace Tunnel {
         FragmentHandler::FragmentHandler(boost::asio::io_service &ios, RouterContext &ctx) :
@@ -15,103 +17,114 @@ namespace i2pcpp {
             m_ctx(ctx),
             m_log(boost::log::keywords::channel = "FH") {}
 
-        void FragmentHandler::receiveFragments(std::list<FragmentPtr> fragments)
+        void FragmentHandler::receiveFragments(std::vector<FragmentView> const &fragments)
         {
             I2P_LOG(m_log, debug) << "got " << fragments.size() << " fragments";
-            for(auto& f: fragments) {
-                uint32_t msgId = f->getMsgId();
 
-                if(typeid(*f) == typeid(FirstFragment)) {
-                    I2P_LOG(m_log, debug) << "first fragment";
+            /* Completed messages are sent once the states are unlocked. */
+            std::vector<Delivery> complete;
 
-                    auto ff = std::unique_ptr<FirstFragment>(dynamic_cast<FirstFragment *>(f.release()));
-                    if(!ff->isFragmented()) {
+            {
+                std::lock_guard<std::mutex> lock(m_statesMutex);
+
+                for(auto& f: fragments) {
+                    if(f.first && !f.fragmented) {
                         I2P_LOG(m_log, debug) << "not fragmented";
 
                         // We received a first fragment with no further fragments -- send it right out
-                        I2NP::MessagePtr tg(new I2NP::TunnelGateway(ff->getTunnelId(), ff->getPayload()));
-                        m_ctx.getOutMsgDisp().sendMessage(ff->getToHash(), tg);
-                    } else {
-                        I2P_LOG(m_log, debug) << "fragmented";
+                        Delivery d = { f.mode, f.tunnelId, RouterHash(), 0, ByteArray(f.payload, f.payload + f.size) };
+                        if(f.toHash)
+                            std::copy(f.toHash, f.toHash + d.toHash.size(), d.toHash.begin());
 
-                        std::lock_guard<std::mutex> lock(m_statesMutex);
+                        complete.push_back(std::move(d));
+                        continue;
+                    }
 
-                        auto itr = m_states.find(msgId);
-                        if(itr != m_states.end())
-                            m_states[msgId].setFirstFragment(std::move(ff));
-                        else {
-                            FragmentState s;
-                            s.setFirstFragment(std::move(ff));
+                    auto r = m_states.emplace(std::piecewise_construct, std::forward_as_tuple(f.msgId), std::forward_as_tuple());
+                    FragmentState &s = r.first->second;
 
-                            auto timer = std::make_unique<boost::asio::deadline_timer>(m_ios, boost::posix_time::time_duration(0, 2, 0));
-                            timer->async_wait(boost::bind(&FragmentHandler::timerCallback, this, boost::asio::placeholders::error, msgId));
-                            s.setTimer(std::move(timer));
+                    if(r.second) {
+                        auto timer = std::make_unique<boost::asio::deadline_timer>(m_ios, boost::posix_time::time_duration(0, 2, 0));
+                        timer->async_wait(boost::bind(&FragmentHandler::timerCallback, this, boost::asio::placeholders::error, f.msgId));
+                        s.setTimer(std::move(timer));
+                    }
 
-                            m_states[msgId] = std::move(s);
-                        }
+                    if(!s.add(f)) {
+                        I2P_LOG(m_log, debug) << "duplicate fragment " << (int)f.fragNum << " of message " << f.msgId;
+                        continue;
                     }
-                } else {
-                    I2P_LOG(m_log, debug) << "follow on fragment";
-
-                    auto fof = std::unique_ptr<FollowOnFragment>(dynamic_cast<FollowOnFragment *>(f.release()));
-
-                    std::lock_guard<std::mutex> lock(m_statesMutex);
-                    auto itr = m_states.find(msgId);
-                    if(itr != m_states.end())
-                        m_states[msgId].addFollowOnFragment(std::move(*fof));
-                    else {
-                        FragmentState s;
-                        s.addFollowOnFragment(std::move(*fof));
-                        m_states[msgId] = std::move(s);
+
+                    if(s.isComplete()) {
+                        I2P_LOG(m_log, debug) << "all fragments received";
+
+                        complete.push_back({ s.getDeliveryMode(), s.getTunnelId(), s.getToHash(), f.msgId, s.compile() });
+                        m_states.erase(r.first);
                     }
                 }
+            }
 
-                checkAndFlush(msgId);
+            for(auto& d: complete) {
+                try {
+                    deliver(d);
+                } catch(std::exception &e) {
+                    I2P_LOG(m_log, error) << "error delivering reassembled message: " << e.what();
+                }
             }
         }
 
-        void FragmentHandler::checkAndFlush(uint32_t msgId)
+        void FragmentHandler::deliver(Delivery &d)
         {
-            std::lock_guard<std::mutex> lock(m_statesMutex);
-
-            if(m_states[msgId].isComplete()) {
-                I2P_LOG(m_log, debug) << "all fragments received";
+            switch(d.mode) {
+                case FirstFragment::DeliveryMode::LOCAL:
+                    {
+                        I2P_LOG(m_log, debug) << "destination: local";
+
+                        /* Arrived through one of our own inbound tunnels. The
+                         * message has its standard header, which the
+                         * dispatcher only parses when given no ID.
+                         */
+                        m_ios.post(boost::bind(&InboundMessageDispatcher::messageReceived, boost::ref(m_ctx.getInMsgDisp()), m_ctx.getIdentity()->getHash(), 0, std::move(d.data)));
+                    }
 
-                auto& ff = m_states[msgId].getFirstFragment();
-                switch(ff->getDeliveryMode()) {
-                    case FirstFragment::DeliveryMode::TUNNEL:
-                        {
-                            I2P_LOG(m_log, debug) << "destination: tunnel";
+                    break;
 
-                            I2NP::MessagePtr tg(new I2NP::TunnelGateway(ff->getTunnelId(), m_states[msgId].compile()));
-                            m_ctx.getOutMsgDisp().sendMessage(ff->getToHash(), tg);
-                        }
+                case FirstFragment::DeliveryMode::TUNNEL:
+                    {
+                        I2P_LOG(m_log, debug) << "destination: tunnel";
 
-                        break;
+                        I2NP::MessagePtr tg(new I2NP::TunnelGateway(d.tunnelId, std::move(d.data)));
+                        m_ctx.getOutMsgDisp().sendMessage(d.toHash, tg);
+                    }
 
-                    case FirstFragment::DeliveryMode::ROUTER:
-                        {
-                            I2P_LOG(m_log, debug) << "destination: router";
+                    break;
 
-                            I2NP::MessagePtr msg = I2NP::Message::fromBytes(msgId, m_states[msgId].compile());
-                            if(!msg)
-                                throw std::runtime_error("error sending router message as an endpoint");
+                case FirstFragment::DeliveryMode::ROUTER:
+                    {
+                        I2P_LOG(m_log, debug) << "destination: router";
 
-                            m_ctx.getOutMsgDisp().sendMessage(ff->getToHash(), msg);
+                        I2NP::MessagePtr msg = I2NP::Message::fromBytes(d.msgId, d.data);
+                        if(!msg) {
+                            I2P_LOG(m_log, error) << "error sending router message as an endpoint";
+                            break;
                         }
 
-                        break;
+                        m_ctx.getOutMsgDisp().sendMessage(d.toHash, msg);
+                    }
 
-                    default:
-                        break;
-                }
+                    break;
 
-                m_states.erase(msgId);
+                default:
+                    I2P_LOG(m_log, debug) << "unhandled delivery mode, dropping";
+                    break;
             }
         }
 
         void FragmentHandler::timerCallback(const boost::system::error_code& e, const uint32_t msgId)
         {
+            // The state was completed and erased, and a new one may have the same ID.
+            if(e == boost::asio::error::operation_aborted)
+                return;
+
             std::lock_guard<std::mutex> lock(m_statesMutex);
 
             m_states.erase(msgId);
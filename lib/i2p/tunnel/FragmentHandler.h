@@ -7,6 +7,7 @@
 
 #include <unordered_map>
 #include <mutex>
+#include <vector>
 
 namespace i2pcpp {
     class RouterContext;
@@ -19,20 +20,31 @@ namespace i2pcpp {
                 FragmentHandler& operator=(FragmentHandler &) = delete;
 
                 /**
-                 * Collects a list of fragments we've received. All fragments go
-                 * in to a corresponding i2pcpp::Tunnel::FragmentState based on
-                 * message ID. FragmentStates are deleted after two minutes.
+                 * Collects the fragments of a tunnel message we've received.
+                 * Fragmented messages are reassembled in a corresponding
+                 * i2pcpp::Tunnel::FragmentState based on message ID, which is
+                 * deleted after two minutes. Completed messages are sent to
+                 * their intended destination.
                  */
-                void receiveFragments(std::list<FragmentPtr> fragments);
+                void receiveFragments(std::vector<FragmentView> const &fragments);
 
             private:
                 /**
-                 * Checks whether all the fragments for a particular \a msgId have
-                 * been received. If so, the fragments are compiled in to a single
-                 * byte array, wrapped in an i2pcpp::I2NP::Message, and sent to the
-                 * intended destination.
+                 * A reassembled message and where it is to be delivered.
                  */
-                void checkAndFlush(uint32_t msgId);
+                struct Delivery {
+                    FirstFragment::DeliveryMode mode;
+                    uint32_t tunnelId;
+                    RouterHash toHash;
+                    uint32_t msgId;
+                    ByteArray data;
+                };
+
+                /**
+                 * Wraps the message in an i2pcpp::I2NP::Message and sends it
+                 * to the intended destination.
+                 */
+                void deliver(Delivery &d);
 
                 /**
                  * Erases the i2pcpp::Tunnel::FragmentState for a given \a msgId.
@@ -1,62 +1,92 @@
 #include "FragmentState.h"
 
+#include <stdexcept>
+
 namespace i2pcpp {
     namespace Tunnel {
-        void FragmentState::setFirstFragment(std::unique_ptr<FirstFragment> ff)
+        bool FragmentState::add(FragmentView const &f)
         {
-            if(!m_firstFragment)
-                m_firstFragment = std::move(ff);
-            else
-                throw std::runtime_error("multiple first fragments in state");
-        }
+            if(m_received[f.fragNum])
+                return false;
 
-        void FragmentState::addFollowOnFragment(FollowOnFragment fof)
-        {
-            uint8_t thisFragNum = fof.getFragNum();
-            if(fof.isLast()) {
+            if(f.first) {
+                m_fragmented = f.fragmented;
+                m_mode = f.mode;
+                m_tunnelId = f.tunnelId;
+                if(f.toHash)
+                    std::copy(f.toHash, f.toHash + m_toHash.size(), m_toHash.begin());
+            } else if(f.last) {
                 if(m_lastFragNum)
-                    throw std::runtime_error("multiple last fragments with the same fragment number in state");
-                m_lastFragNum = thisFragNum;
+                    return false;
+
+                m_lastFragNum = f.fragNum;
             }
 
-            if(std::none_of(m_followOnFragments.cbegin(), m_followOnFragments.cend(), [thisFragNum](const FollowOnFragment &x) { return x.getFragNum() == thisFragNum; }))
-                m_followOnFragments.push_back(std::move(fof));
+            if(m_data.size() + f.size > UINT16_MAX)
+                throw std::runtime_error("reassembled message is too large");
+
+            /* Fragments are appended in the order they arrive. Only when
+             * one arrives before a fragment with a lower number does the
+             * message need to be put in order when it's complete.
+             */
+            if((m_received >> f.fragNum).any())
+                m_inOrder = false;
+
+            m_extents[f.fragNum] = { (uint16_t)m_data.size(), f.size };
+            m_data.insert(m_data.end(), f.payload, f.payload + f.size);
+            m_received.set(f.fragNum);
+
+            return true;
         }
 
         bool FragmentState::isComplete() const
         {
             // We didn't get the first fragment yet
-            if(!m_firstFragment)
+            if(!m_received[0])
                 return false;
 
             // We got the first fragment, and we aren't waiting for anything else
-            if(!m_firstFragment->isFragmented())
+            if(!m_fragmented)
                 return true;
 
-            // We ARE waiting for something else, but we haven't gotten anything yet
+            // We ARE waiting for something else, but we haven't gotten the last fragment yet
             if(m_lastFragNum == 0)
                 return false;
 
-            // We don't have everything yet and are expecting more
-            return (m_followOnFragments.size() == m_lastFragNum);
+            // We have the first and last fragments, everything between them and nothing after
+            return (m_received.count() == (size_t)m_lastFragNum + 1 && (m_received >> (m_lastFragNum + 1)).none());
         }
 
         ByteArray FragmentState::compile()
         {
-            m_followOnFragments.sort([](const FollowOnFragment &f1, const FollowOnFragment &f2) { return f1.getFragNum() < f2.getFragNum(); } );
+            if(m_inOrder)
+                return std::move(m_data);
 
-            ByteArray ret = m_firstFragment->getPayload();
-            for(auto& f: m_followOnFragments) {
-                ByteArray p = f.getPayload();
-                ret.insert(ret.end(), p.cbegin(), p.cend());
+            ByteArray ret;
+            ret.reserve(m_data.size());
+
+            const uint8_t last = m_fragmented ? m_lastFragNum : 0;
+            for(uint8_t i = 0; i <= last; i++) {
+                auto begin = m_data.cbegin() + m_extents[i].offset;
+                ret.insert(ret.end(), begin, begin + m_extents[i].size);
             }
 
             return ret;
         }
 
-        const std::unique_ptr<FirstFragment>& FragmentState::getFirstFragment() const
+        FirstFragment::DeliveryMode FragmentState::getDeliveryMode() const
+        {
+            return m_mode;
+        }
+
+        uint32_t FragmentState::getTunnelId() const
+        {
+            return m_tunnelId;
+        }
+
+        const RouterHash& FragmentState::getToHash() const
         {
-            return m_firstFragment;
+            return m_toHash;
         }
 
         void FragmentState::setTimer(std::unique_ptr<boost::asio::deadline_timer> t)
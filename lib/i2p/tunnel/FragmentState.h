@@ -1,26 +1,35 @@
 #ifndef TUNNELFRAGMENTSTATE_H
 #define TUNNELFRAGMENTSTATE_H
 
-#include "FirstFragment.h"
-#include "FollowOnFragment.h"
+#include "FragmentView.h"
+
+#include <i2pcpp/datatypes/RouterHash.h>
 
 #include <boost/asio.hpp>
 
-#include <list>
+#include <array>
+#include <bitset>
 
 namespace i2pcpp {
     namespace Tunnel {
+        /**
+         * Reassembles the fragments of one I2NP message. Fragment payloads
+         *  are appended, as they arrive, to a single buffer; when they
+         *  arrived in order that buffer is the finished message. The buffer
+         *  only grows with the fragments actually received, so a state
+         *  waiting out its timeout for fragments that never come stays
+         *  small.
+         */
         class FragmentState {
             public:
-                /**
-                 * Sets the first fragment for this state.
-                 */
-                void setFirstFragment(std::unique_ptr<FirstFragment> ff);
+                FragmentState() = default;
 
                 /**
-                 * Adds a follow on fragment for this state.
+                 * Copies the payload of \a f in to the message.
+                 * @return false if a fragment with the same number, or a
+                 *  second last fragment, was already received
                  */
-                void addFollowOnFragment(FollowOnFragment fof);
+                bool add(FragmentView const &f);
 
                 /**
                  * @return true if all the fragments for a message have been
@@ -29,15 +38,18 @@ namespace i2pcpp {
                 bool isComplete() const;
 
                 /**
-                 * Compiles all the received fragments in to one i2pcpp::ByteArray.
+                 * Moves the reassembled message out of this state. Must only
+                 *  be called once isComplete() is true.
                  */
                 ByteArray compile();
 
                 /**
-                 * Returns the first fragment in this state. This is needed because
-                 * the first fragment contains delivery instructions.
+                 * The delivery instructions, which come with the first
+                 *  fragment.
                  */
-                const std::unique_ptr<FirstFragment>& getFirstFragment() const;
+                FirstFragment::DeliveryMode getDeliveryMode() const;
+                uint32_t getTunnelId() const;
+                const RouterHash& getToHash() const;
 
                 /**
                  * Sets a timer for this state.
@@ -45,10 +57,25 @@ namespace i2pcpp {
                 void setTimer(std::unique_ptr<boost::asio::deadline_timer> t);
 
             private:
+                /// Where a fragment's payload is in m_data
+                struct Extent {
+                    uint16_t offset;
+                    uint16_t size;
+                };
+
+                ByteArray m_data;
+                std::array<Extent, 64> m_extents;
+                std::bitset<64> m_received;
+
+                /// Whether every fragment so far arrived after the one before it
+                bool m_inOrder = true;
+
+                bool m_fragmented = false;
                 uint8_t m_lastFragNum = 0;
 
-                std::unique_ptr<FirstFragment> m_firstFragment = nullptr;
-                std::list<FollowOnFragment> m_followOnFragments;
+                FirstFragment::DeliveryMode m_mode = FirstFragment::DeliveryMode::LOCAL;
+                uint32_t m_tunnelId = 0;
+                RouterHash m_toHash;
 
                 std::unique_ptr<boost::asio::deadline_timer> m_timer;
         };
@@ -0,0 +1,85 @@
+#include "FragmentView.h"
+
+#include <stdexcept>
+
+namespace i2pcpp {
+    namespace Tunnel {
+        static uint32_t readUint32(const unsigned char *&pos)
+        {
+            uint32_t x = ((uint32_t)pos[0] << 24) | ((uint32_t)pos[1] << 16) | ((uint32_t)pos[2] << 8) | pos[3];
+            pos += 4;
+
+            return x;
+        }
+
+        FragmentView FragmentView::parse(const unsigned char *&pos, const unsigned char *end)
+        {
+            if(end - pos < 3)
+                throw std::runtime_error("could not parse fragment");
+
+            FragmentView f = {};
+
+            const unsigned char flag = *pos++;
+            if(flag & 0x80) {
+                if(end - pos < 6)
+                    throw std::runtime_error("malformed followon fragment");
+
+                f.fragNum = (flag & 0x7e) >> 1;
+                f.last = flag & 0x01;
+                f.msgId = readUint32(pos);
+
+                if(!f.fragNum)
+                    throw std::runtime_error("malformed followon fragment");
+            } else {
+                f.first = true;
+                f.mode = (FirstFragment::DeliveryMode)((flag >> 5) & 0x03);
+                f.fragmented = flag & (1 << 3);
+
+                /* The delivery instructions, the message ID and the size must
+                 * all be there before any of them is read.
+                 */
+                ptrdiff_t needed = 2 + (f.fragmented ? 4 : 0);
+                switch(f.mode) {
+                    case FirstFragment::DeliveryMode::LOCAL:
+                        break;
+
+                    case FirstFragment::DeliveryMode::TUNNEL:
+                        needed += 4 + 32;
+                        break;
+
+                    case FirstFragment::DeliveryMode::ROUTER:
+                        needed += 32;
+                        break;
+
+                    default:
+                        throw std::runtime_error("unhandled first fragment delivery mode");
+                }
+
+                if(end - pos < needed)
+                    throw std::runtime_error("malformed first fragment");
+
+                if(f.mode == FirstFragment::DeliveryMode::TUNNEL)
+                    f.tunnelId = readUint32(pos);
+
+                if(f.mode != FirstFragment::DeliveryMode::LOCAL) {
+                    f.toHash = pos;
+                    pos += 32;
+                }
+
+                if(f.fragmented)
+                    f.msgId = readUint32(pos);
+            }
+
+            f.size = ((uint16_t)pos[0] << 8) | pos[1];
+            pos += 2;
+
+            if(end - pos < f.size)
+                throw std::runtime_error("malformed fragment");
+
+            f.payload = pos;
+            pos += f.size;
+
+            return f;
+        }
+    }
+}
@@ -0,0 +1,48 @@
+#ifndef TUNNELFRAGMENTVIEW_H
+#define TUNNELFRAGMENTVIEW_H
+
+#include "FirstFragment.h"
+
+#include <cstdint>
+
+namespace i2pcpp {
+    namespace Tunnel {
+        /**
+         * A fragment as it lies in a received, decrypted tunnel message.
+         * Nothing is copied out of the message: the payload and to hash
+         *  point in to it, so the message must outlive the view.
+         */
+        struct FragmentView {
+            /// Whether this is a first fragment, as opposed to a follow on
+            bool first;
+
+            /// 0 for a first fragment, 1 to 63 for a follow on fragment
+            uint8_t fragNum;
+
+            /// For a first fragment, whether follow on fragments will come
+            bool fragmented;
+
+            /// For a follow on fragment, whether it is the last one
+            bool last;
+
+            /// The message ID, 0 for an unfragmented first fragment
+            uint32_t msgId;
+
+            /// The delivery instructions, only set in a first fragment
+            FirstFragment::DeliveryMode mode;
+            uint32_t tunnelId;
+            const unsigned char *toHash;
+
+            const unsigned char *payload;
+            uint16_t size;
+
+            /**
+             * Parses the fragment at \a pos and advances \a pos past it.
+             * @throw std::runtime_error if the fragment is malformed
+             */
+            static FragmentView parse(const unsigned char *&pos, const unsigned char *end);
+        };
+    }
+}
+
+#endif
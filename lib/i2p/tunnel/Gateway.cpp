@@ -0,0 +1,107 @@
+#include "Gateway.h"
+
+#include "FirstFragment.h"
+#include "FollowOnFragment.h"
+
+#include <i2pcpp/util/make_unique.h>
+#include <i2pcpp/util/Random.h>
+
+namespace i2pcpp {
+    namespace Tunnel {
+        bool Gateway::add(ByteArray data)
+        {
+            if(data.size() > MAX_MESSAGE_SIZE)
+                return false;
+
+            m_queued += data.size();
+
+            m_queue.push_back({ std::move(data), 0, 0, 0 });
+
+            return true;
+        }
+
+        size_t Gateway::getQueued() const
+        {
+            return m_queued;
+        }
+
+        bool Gateway::empty() const
+        {
+            return m_queue.empty();
+        }
+
+        std::vector<std::list<FragmentPtr>> Gateway::pack(bool all)
+        {
+            std::vector<std::list<FragmentPtr>> messages;
+
+            while(!m_queue.empty() && (all || m_queued >= MAX_PAYLOAD))
+                messages.push_back(packOne());
+
+            return messages;
+        }
+
+        std::list<FragmentPtr> Gateway::packOne()
+        {
+            std::list<FragmentPtr> fragments;
+            uint16_t space = MAX_PAYLOAD;
+
+            while(!m_queue.empty()) {
+                Pending &p = m_queue.front();
+                auto pos = p.data.cbegin() + p.offset;
+                const auto end = p.data.cend();
+
+                if(!p.offset) {
+                    auto ff = std::make_unique<FirstFragment>();
+
+                    if(ff->mustFragment(p.data.size(), space)) {
+                        /* Don't start a message in the last few bytes,
+                         * unless it could go nowhere else.
+                         */
+                        if(space <= FRAGMENT_HEADER_SIZE || (fragments.size() && space < MAX_PAYLOAD / 4))
+                            break;
+
+                        p.msgId = Random::get<uint32_t>();
+
+                        ff->setFragmented(true);
+                        ff->setMsgId(p.msgId);
+                        p.fragNum = 1;
+                    }
+
+                    ff->setPayload(pos, end, space);
+                    space -= ff->size();
+                    fragments.push_back(std::move(ff));
+                } else {
+                    if(space <= FRAGMENT_HEADER_SIZE)
+                        break;
+
+                    std::unique_ptr<FollowOnFragment> fof;
+                    try {
+                        fof = std::make_unique<FollowOnFragment>(p.msgId, p.fragNum++);
+                    } catch(std::exception &e) {
+                        m_queued -= p.data.size() - p.offset;
+                        m_queue.pop_front();
+                        throw;
+                    }
+
+                    fof->setPayload(pos, end, space);
+                    if(pos == end)
+                        fof->setLast(true);
+
+                    space -= fof->size();
+                    fragments.push_back(std::move(fof));
+                }
+
+                const size_t packed = std::distance(p.data.cbegin(), pos) - p.offset;
+                m_queued -= packed;
+                p.offset += packed;
+
+                if(pos != end)
+                    break;
+
+                m_queue.pop_front();
+            }
+
+            return fragments;
+        }
+    }
+}
@@ -0,0 +1,87 @@
+#ifndef TUNNELGATEWAY_H
+#define TUNNELGATEWAY_H
+
+#include "Fragment.h"
+
+#include <i2pcpp/datatypes/ByteArray.h>
+
+#include <deque>
+#include <list>
+#include <vector>
+
+namespace i2pcpp {
+    namespace Tunnel {
+        /**
+         * Queues the I2NP messages to be sent in to a tunnel we are the
+         *  gateway of, and packs them in to as few tunnel messages as
+         *  possible. The first and follow on fragments of several messages
+         *  share one tunnel message, and a message which does not fit in the
+         *  space left is split across it and the next.
+         * @note Not thread safe, callers are expected to serialise access.
+         */
+        class Gateway {
+            public:
+                /**
+                 * Queues \a data to be sent.
+                 * @return false if \a data is larger than MAX_MESSAGE_SIZE,
+                 *  in which case it is dropped
+                 */
+                bool add(ByteArray data);
+
+                /**
+                 * @return the number of payload bytes still to be sent
+                 */
+                size_t getQueued() const;
+
+                bool empty() const;
+
+                /**
+                 * Packs the queued messages in to tunnel messages.
+                 * @param all if false, queued data which would not fill a
+                 *  whole tunnel message is kept for a later call
+                 * @return the fragments of each tunnel message, ready to be
+                 *  passed to i2pcpp::Tunnel::Message
+                 */
+                std::vector<std::list<FragmentPtr>> pack(bool all);
+
+                /// The space for fragments in a tunnel message
+                static const uint16_t MAX_PAYLOAD = 1003;
+
+                /// The header of a fragmented first fragment or a follow on fragment
+                static const uint16_t FRAGMENT_HEADER_SIZE = 7;
+
+                /// The highest follow on fragment number
+                static const uint8_t MAX_FRAGMENT_NUMBER = 63;
+
+                /**
+                 * The largest message which is sure to fit in the follow on
+                 *  fragments alone, whatever space its first fragment gets.
+                 */
+                static const size_t MAX_MESSAGE_SIZE = MAX_FRAGMENT_NUMBER * (MAX_PAYLOAD - FRAGMENT_HEADER_SIZE);
+
+            private:
+                /**
+                 * A queued message and how much of it was already packed.
+                 */
+                struct Pending {
+                    ByteArray data;
+                    size_t offset;
+
+                    uint32_t msgId;
+                    uint8_t fragNum;
+                };
+
+                /**
+                 * Packs fragments in to one tunnel message. A message which
+                 *  can not be packed is dropped from the queue before the
+                 *  exception is passed on.
+                 */
+                std::list<FragmentPtr> packOne();
+
+                std::deque<Pending> m_queue;
+                size_t m_queued = 0;
+        };
+    }
+}
+
+#endif
@@ -1,6 +1,8 @@
 #include "InboundTunnel.h"
 
-#include <botan/auto_rng.h>
+#include <i2pcpp/util/Random.h>
+
+#include <algorithm>
 
 #include <i2pcpp/datatypes/RouterIdentity.h>
 
@@ -11,35 +13,64 @@ namespace i2pcpp {
             /* Zero hop tunnel */
             if(hops.empty()) {
                 m_state = State::OPERATIONAL;
+
+                m_tunnelId = Random::get<uint32_t>();
+                m_gateway = myHash;
+                m_gatewayTunnelId = m_tunnelId;
                 return;
             }
 
-            uint32_t lastTunnelId;
-            RouterHash lastRouterHash;
-            BuildRequestRecordPtr h;
+            /* The records are created from the endpoint backwards, then
+             * put in the order they're sent through.
+             */
+            m_hops.reserve(hops.size());
 
-            for(int i = 0; i < hops.size(); i++) {
+            for(size_t i = 0; i < hops.size(); i++) {
                 if(!i) {
-                    h = std::make_shared<BuildRequestRecord>(hops[i], myHash);
-                    m_tunnelId = h->getNextTunnelId();
-                    m_nextMsgId = h->getNextMsgId();
+                    m_hops.emplace_back(hops[i], myHash);
+                    m_tunnelId = m_hops.back().getNextTunnelId();
+                    m_nextMsgId = m_hops.back().getNextMsgId();
                 } else
-                    h = std::make_shared<BuildRequestRecord>(hops[i], lastRouterHash, lastTunnelId);
-
-                lastTunnelId = h->getTunnelId();
-                lastRouterHash = h->getLocalHash();
-
-                m_hops.push_front(h);
+                    m_hops.emplace_back(hops[i], m_hops.back().getLocalHash(), m_hops.back().getTunnelId());
             }
 
-            std::static_pointer_cast<BuildRequestRecord>(m_hops.front())->setType(BuildRequestRecord::Type::GATEWAY);
+            std::reverse(m_hops.begin(), m_hops.end());
+
+            m_hops.front().setType(BuildRequestRecord::Type::GATEWAY);
 
-            secureRecords();
+            m_gateway = m_hops.front().getLocalHash();
+            m_gatewayTunnelId = m_hops.front().getTunnelId();
         }
 
         Tunnel::Direction InboundTunnel::getDirection() const
         {
             return Direction::INBOUND;
         }
+
+        RouterHash InboundTunnel::getGateway() const
+        {
+            return m_gateway;
+        }
+
+        uint32_t InboundTunnel::getGatewayTunnelId() const
+        {
+            return m_gatewayTunnelId;
+        }
+
+        void InboundTunnel::decrypt(Message &msg) const
+        {
+            /* Every hop, from the gateway onwards, added its layer with
+             * Message::encrypt, so they're removed in reverse order.
+             */
+            for(auto itr = m_hops.crbegin(); itr != m_hops.crend(); ++itr) {
+                SessionKey k1 = itr->getTunnelIVKey();
+                Botan::SymmetricKey ivKey(k1.data(), k1.size());
+
+                SessionKey k2 = itr->getTunnelLayerKey();
+                Botan::SymmetricKey layerKey(k2.data(), k2.size());
+
+                msg.decrypt(ivKey, layerKey);
+            }
+        }
     }
 }
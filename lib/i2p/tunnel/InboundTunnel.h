@@ -2,6 +2,7 @@
 #define TUNNELINBOUNDTUNNEL_H
 
 #include "Tunnel.h"
+#include "Message.h"
 
 #include <vector>
 
@@ -12,7 +13,8 @@ namespace i2pcpp {
                 /**
                  * Constructs an inbound tunnel given the current router
                  * hash \a myHash and the router identities of the hops
-                 * for the tunnel.
+                 * for the tunnel. The build records still have to be
+                 * secured before they are sent.
                  */
                 InboundTunnel(RouterHash const &myHash, std::vector<RouterIdentity> const &hops = {});
 
@@ -20,6 +22,28 @@ namespace i2pcpp {
                  * Returns the direction of this tunnel (always inbound).
                  */
                 Tunnel::Direction getDirection() const;
+
+                /**
+                 * @return the i2pcpp::RouterHash of the gateway, to which
+                 *  messages for this tunnel are sent
+                 */
+                RouterHash getGateway() const;
+
+                /**
+                 * @return the tunnel ID messages for this tunnel are sent
+                 *  to the gateway with
+                 */
+                uint32_t getGatewayTunnelId() const;
+
+                /**
+                 * Removes the layers of encryption the hops added to \a msg,
+                 *  which arrived at us, the endpoint, through this tunnel.
+                 */
+                void decrypt(Message &msg) const;
+
+            private:
+                RouterHash m_gateway;
+                uint32_t m_gatewayTunnelId;
         };
     }
 }
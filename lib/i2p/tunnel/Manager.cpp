@@ -18,62 +18,140 @@
 
 #include <botan/auto_rng.h>
 
+#include <boost/bind.hpp>
+
 namespace i2pcpp {
     namespace Tunnel {
+        // Bound to a const reference by std::chrono::seconds
+        const uint32_t Manager::BUILD_TIMEOUT;
+
         Manager::Manager(boost::asio::io_service &ios, RouterContext &ctx) :
             m_ios(ios),
             m_ctx(ctx),
+            m_strand(ctx.getTunnelStrand()),
             m_fragmentHandler(ios, ctx),
-            m_graceful(false),
+            m_buildWorkers(ios),
+            m_buildPreparer(ios),
+            m_participatingBytes(0),
+            m_participatingDropped(Metrics::counter("tunnels.dropped")),
+            m_cryptoTime(Metrics::histogram("latency.tunnel.crypto")),
+            m_tunnelBandwidth(DEFAULT_TUNNEL_BANDWIDTH),
+            m_gatewayDelay(DEFAULT_GATEWAY_DELAY),
             m_timer(m_ios, boost::posix_time::time_duration(0, 0, 1)),
-            m_log(boost::log::keywords::channel = "TM") {}
+            m_log(boost::log::keywords::channel = "TM"),
+            m_graceful(false) {}
 
         void Manager::begin()
         {
-            m_timer.async_wait(boost::bind(&Manager::callback, this, boost::asio::placeholders::error));
+            AdmissionController::Limits limits;
+            limits.maxParticipating = getConfigValue("max_participating_tunnels", limits.maxParticipating);
+            limits.bandwidth = getConfigValue("participating_bandwidth", limits.bandwidth);
+            limits.maxQueueWait = getConfigValue("max_build_queue_wait", limits.maxQueueWait);
+            m_admission.setLimits(limits);
+
+            {
+                std::lock_guard<std::mutex> lock(m_participatingMutex);
+                m_participatingBucket.setRate(limits.bandwidth);
+                m_tunnelBandwidth = getConfigValue("participating_tunnel_bandwidth", DEFAULT_TUNNEL_BANDWIDTH);
+                m_gatewayDelay = getConfigValue("gateway_batch_delay", DEFAULT_GATEWAY_DELAY);
+            }
+
+            m_buildWorkers.start(m_ctx.getEncryptionKey());
+            m_buildPreparer.start();
+
+            /* Replies to outbound tunnel builds come back through an
+             * exploratory inbound tunnel, or to us directly through a zero
+             * hop inbound tunnel until there is one.
+             */
+            m_replyTunnel = std::make_shared<InboundTunnel>(m_ctx.getIdentity()->getHash());
+            {
+                std::lock_guard<std::mutex> lock(m_tunnelsMutex);
+                m_tunnels[m_replyTunnel->getTunnelId()] = m_replyTunnel;
+            }
+
+            Pool::Settings exploratory;
+            exploratory.name = "exploratory";
+            exploratory.inboundQuantity = exploratory.outboundQuantity = getConfigValue("exploratory_quantity", exploratory.inboundQuantity);
+            exploratory.inboundLength = exploratory.outboundLength = getConfigValue("exploratory_length", exploratory.inboundLength);
+            exploratory.tier = ProfileManager::Tier::NOT_FAILING;
+            m_exploratory = createPool(exploratory);
+
+            m_lastCallback = std::chrono::steady_clock::now();
+            m_timer.async_wait(m_strand.wrap(boost::bind(&Manager::callback, this, boost::asio::placeholders::error)));
         }
 
-        void Manager::receiveRecords(uint32_t const msgId, std::list<BuildRecordPtr> records)
+        void Manager::receiveRecords(uint32_t const msgId, BuildRecordBlockPtr records)
         {
             I2P_LOG(m_log, debug) << "recieve records";
-            bool tunnelSuccess = false;
-            TunnelPtr t;
+
             /* First check to see if we have a pending tunnel for this msgId */
+            PendingTunnel pt;
             {
                 std::lock_guard<std::mutex> lock(m_pendingMutex);
                 auto itr = m_pending.find(msgId);
                 if(itr != m_pending.end()) {
-                    t = itr->second;
+                    pt = std::move(itr->second);
+                    m_pending.erase(itr);
+                }
+            }
 
-                    if(t->getState() != Tunnel::State::REQUESTED) {
-                        I2P_LOG(m_log, debug) << "found Tunnel with matching tunnel ID, but was not requested";
-                        // reject
-                        return;
-                    }
-                    
-                    t->handleResponses(records);
-                    if(t->getState() == Tunnel::State::OPERATIONAL) {
-                        I2P_LOG(m_log, debug) << "tunnel is operational";
-                        
-                        std::lock_guard<std::mutex> lock(m_tunnelsMutex);
-                        m_tunnels[t->getTunnelId()] = std::move(t);
-                        
-                        tunnelSuccess = true;
-                    } else {
-                        I2P_LOG(m_log, debug) << "failed to build tunnel";
-                    }
+            if(pt.tunnel) {
+                TunnelPtr t = pt.tunnel;
 
-                    m_pending.erase(itr);
-                    /*
-                     * call tunnel build hooks
-                     */
-                    auto tunnelId = t->getTunnelId();
-                    if (tunnelSuccess) {
-                        m_ios.post(boost::bind(&Manager::onTunnelBuildSuccess, this, tunnelId));
-                    } else {
-                        m_ios.post(boost::bind(&Manager::onTunnelBuildFailure, this, tunnelId));
-                    }
+                if(t->getState() != Tunnel::State::REQUESTED) {
+                    I2P_LOG(m_log, debug) << "found Tunnel with matching tunnel ID, but was not requested";
+
+                    if(auto pool = pt.pool.lock())
+                        pool->buildFinished(t->getDirection(), TunnelPtr(), pt.sent);
+
+                    return;
                 }
+
+                bool tunnelSuccess = false;
+                std::vector<BuildResponseRecord::Reply> replies;
+                try {
+                    replies = t->handleResponses(*records);
+                    tunnelSuccess = (t->getState() == Tunnel::State::OPERATIONAL);
+                } catch(std::exception &e) {
+                    I2P_LOG(m_log, debug) << "error handling build responses: " << e.what();
+                }
+
+                /* Credit the hops which agreed and charge the ones which
+                 * refused. If the reply couldn't be read at all, we can't
+                 * tell who is to blame and charge all of them.
+                 */
+                auto rtt = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - pt.sent).count();
+                auto hops = t->getHops();
+                for(size_t i = 0; i < hops.size(); i++) {
+                    if(i < replies.size() && replies[i] == BuildResponseRecord::Reply::SUCCESS)
+                        m_ctx.getProfileManager().buildSucceeded(hops[i], rtt);
+                    else
+                        m_ctx.getProfileManager().buildFailed(hops[i]);
+                }
+
+                auto tunnelId = t->getTunnelId();
+                if(tunnelSuccess) {
+                    I2P_LOG(m_log, debug) << "tunnel is operational";
+
+                    std::lock_guard<std::mutex> lock(m_tunnelsMutex);
+                    m_tunnels[tunnelId] = t;
+                } else {
+                    I2P_LOG(m_log, debug) << "failed to build tunnel";
+                }
+
+                if(auto pool = pt.pool.lock())
+                    pool->buildFinished(t->getDirection(), (tunnelSuccess ? t : TunnelPtr()), pt.sent);
+
+                /*
+                 * call tunnel build hooks
+                 */
+                if (tunnelSuccess) {
+                    m_ios.post(boost::bind(&Manager::onTunnelBuildSuccess, this, tunnelId));
+                } else {
+                    m_ios.post(boost::bind(&Manager::onTunnelBuildFailure, this, tunnelId));
+                }
+
+                return;
             }
 
             /* If we don't, then check to see if any of the records have a truncated
@@ -83,8 +161,8 @@ namespace i2pcpp {
             StaticByteArray<16> myTruncatedHash;
             std::copy(myHash.cbegin(), myHash.cbegin() + 16, myTruncatedHash.begin());
 
-            auto itr = std::find_if(records.begin(), records.end(), [myTruncatedHash](BuildRecordPtr const &r) { return (myTruncatedHash == r->getHeader()); });
-            if(itr != records.end()) {
+            size_t index = records->find(myTruncatedHash);
+            if(index < records->size()) {
                 I2P_LOG(m_log, debug) << "found BRR with our identity";
                 
                 if (m_graceful) {
@@ -93,94 +171,124 @@ namespace i2pcpp {
                     return;
                 }
 
-                /* We found a record that belongs to us. Let's decrypt and parse it. */
-                auto req = std::make_shared<BuildRequestRecord>(**itr);
-                req->decrypt(m_ctx.getEncryptionKey());
-                req->parse();
-                
+                /* We found a record that belongs to us. Hand it to the build workers
+                 * to decrypt and parse, processing continues in handleRequest().
+                 */
+                auto record = std::make_shared<BuildRecord>(records->get(index));
+                if(!m_buildWorkers.submit(record, boost::bind(&Manager::handleRequest, this, records, index, _1))) {
+                    I2P_LOG(m_log, debug) << "rejecting tunnel participation request: build queue full";
+                    Metrics::counter("tunnels.rejected.dropped").add();
+                    // reject
+                    return;
+                }
+            }
+        }
+
+        void Manager::handleRequest(BuildRecordBlockPtr const &records, size_t index, BuildRequestRecordPtr const &req)
+        {
+            BuildResponseRecord::Reply reply;
+            {
                 std::lock_guard<std::mutex> lock(m_participatingMutex);
                 if(m_participating.count(req->getTunnelId()) > 0) {
                     I2P_LOG(m_log, debug) << "rejecting tunnel participation request: tunnel ID in use";
                     // reject
                     return;
                 }
-                
-                //XXX: does this leak?
-                auto timer = std::make_unique<boost::asio::deadline_timer>(m_ios, boost::posix_time::time_duration(0, 10, 0));
-                timer->async_wait(boost::bind(&Manager::timerCallback, this, boost::asio::placeholders::error, true, req->getTunnelId()));
 
-                auto p = std::make_pair(req, std::move(timer));
-                m_participating[req->getTunnelId()] = std::move(p);
+                reply = m_admission.admit(m_participating.size());
+                if(reply == BuildResponseRecord::Reply::SUCCESS) {
+                    //XXX: does this leak?
+                    auto timer = std::make_unique<boost::asio::deadline_timer>(m_ios, boost::posix_time::time_duration(0, 10, 0));
+                    timer->async_wait(boost::bind(&Manager::timerCallback, this, boost::asio::placeholders::error, true, req->getTunnelId()));
+
+                    ParticipatingTunnel pt;
+                    pt.hop = req;
+                    pt.timer = std::move(timer);
+                    pt.bucket.setRate(m_tunnelBandwidth);
+                    m_participating[req->getTunnelId()] = std::move(pt);
+                }
+            }
 
-                /* Now we generate a SUCCESS reponse which will get sent to the next hop in the chain. */
-                BuildResponseRecordPtr resp;
-                resp = std::make_shared<BuildResponseRecord>(BuildResponseRecord::Reply::SUCCESS);
-                resp->compile();
-                *itr = std::move(resp); // This replaces our request record with the response in-place.
+            if(reply != BuildResponseRecord::Reply::SUCCESS) {
+                std::string reason = AdmissionController::getReplyString(reply);
+                I2P_LOG(m_log, debug) << "rejecting tunnel participation request: " << reason;
+                Metrics::counter("tunnels.rejected." + reason).add();
+            }
 
-                for(auto& x: records)
-                    x->encrypt(req->getReplyIV(), req->getReplyKey());
+            /* Now we generate a reponse which will get sent to the next hop in the chain. */
+            BuildResponseRecord resp(reply);
+            resp.compile();
+            records->set(index, resp); // This replaces our request record with the response in-place.
 
-                /* If we're the endpoint, wrap the records in a Tunnel Gateway message before
-                 * sending it to the next hop.
-                 */
-                if(req->getType() == BuildRequestRecord::Type::ENDPOINT) {
-                    I2P_LOG(m_log, debug) << "forwarding BRRs to IBGW: " << req->getNextHash() << ", tunnel ID: " << req->getNextTunnelId() << ", nextMsgId: " << req->getNextMsgId();
+            records->encrypt(req->getReplyIV(), req->getReplyKey());
 
-                    I2NP::MessagePtr vtbr(new I2NP::VariableTunnelBuildReply(req->getNextMsgId(), records));
-                    I2NP::MessagePtr tg(new I2NP::TunnelGateway(req->getNextTunnelId(), vtbr->toBytes()));
-                    m_ctx.getOutMsgDisp().sendMessage(req->getNextHash(), tg);
-                } else {
-                    I2P_LOG(m_log, debug) << "forwarding BRRs to next hop: " << req->getNextHash() << ", tunnel ID: " << req->getNextTunnelId() << ", nextMsgId: " << req->getNextMsgId();
+            /* If we're the endpoint, wrap the records in a Tunnel Gateway message before
+             * sending it to the next hop.
+             */
+            if(req->getType() == BuildRequestRecord::Type::ENDPOINT) {
+                I2P_LOG(m_log, debug) << "forwarding BRRs to IBGW: " << req->getNextHash() << ", tunnel ID: " << req->getNextTunnelId() << ", nextMsgId: " << req->getNextMsgId();
 
-                    I2NP::MessagePtr vtb(new I2NP::VariableTunnelBuild(req->getNextMsgId(), records));
-                    m_ctx.getOutMsgDisp().sendMessage(req->getNextHash(), vtb);
-                }
+                I2NP::MessagePtr vtbr(new I2NP::VariableTunnelBuildReply(req->getNextMsgId(), records));
+                I2NP::MessagePtr tg(new I2NP::TunnelGateway(req->getNextTunnelId(), vtbr->toBytes()));
+                m_ctx.getOutMsgDisp().sendMessage(req->getNextHash(), tg);
+            } else {
+                I2P_LOG(m_log, debug) << "forwarding BRRs to next hop: " << req->getNextHash() << ", tunnel ID: " << req->getNextTunnelId() << ", nextMsgId: " << req->getNextMsgId();
+
+                I2NP::MessagePtr vtb(new I2NP::VariableTunnelBuild(req->getNextMsgId(), records));
+                m_ctx.getOutMsgDisp().sendMessage(req->getNextHash(), vtb);
             }
         }
 
-        void Manager::receiveGatewayData(RouterHash const from, uint32_t const tunnelId, ByteArray const data)
+        void Manager::receiveGatewayData(RouterHash const &from, uint32_t const tunnelId, ByteArray const &data)
         {
-            I2P_LOG_SCOPED_TAG(m_log, "TunnelId", tunnelId);
-            I2P_LOG(m_log, debug) << "received " << data.size() << " bytes of gateway data";
+            I2P_LOG_TAGGED(m_log, debug, "TunnelId", tunnelId) << "received " << data.size() << " bytes of gateway data";
 
+            /* The data is queued and packed under the lock, the layer
+             * encryption and sending are done once it is released.
+             */
+            BuildRequestRecordPtr hop;
+            std::vector<std::list<FragmentPtr>> messages;
             {
                 std::lock_guard<std::mutex> lock(m_participatingMutex);
                 auto itr = m_participating.find(tunnelId);
                 if(itr != m_participating.end()) {
-                    BuildRequestRecordPtr hop = itr->second.first;
+                    if(itr->second.hop->getType() != BuildRequestRecord::Type::GATEWAY) {
+                        I2P_LOG_TAGGED(m_log, debug, "TunnelId", tunnelId) << "data is for a tunnel which is not a gateway, dropping";
+                        return;
+                    }
 
-                    if(hop->getType() != BuildRequestRecord::Type::GATEWAY) {
-                        I2P_LOG(m_log, debug) << "data is for a tunnel which is not a gateway, dropping";
+                    if(!shape(itr->second, data.size())) {
+                        I2P_LOG_TAGGED(m_log, debug, "TunnelId", tunnelId) << "tunnel is over its bandwidth budget, dropping";
                         return;
                     }
 
-                    I2P_LOG(m_log, debug) << "data is for a known tunnel, encrypting and forwarding";
-                    SessionKey k1 = hop->getTunnelIVKey();
-                    Botan::SymmetricKey ivKey(k1.data(), k1.size());
-                    SessionKey k2 = hop->getTunnelLayerKey();
-                    Botan::SymmetricKey layerKey(k2.data(), k2.size());
+                    I2P_LOG_TAGGED(m_log, debug, "TunnelId", tunnelId) << "data is for a known tunnel, queueing at the gateway";
 
-                    auto fragments = Fragment::fragmentMessage(data);
-                    I2P_LOG(m_log, debug) << "we have " << fragments.size() << " fragments";
+                    ParticipatingTunnel &pt = itr->second;
+                    if(!pt.gateway.add(data)) {
+                        I2P_LOG_TAGGED(m_log, debug, "TunnelId", tunnelId) << "message is too large for a tunnel, dropping";
+                        return;
+                    }
 
-                    for(auto& f: fragments) {
-                        I2P_LOG(m_log, debug) << "fragment: " << f->compile();
+                    hop = pt.hop;
+                    messages = pt.gateway.pack(!m_gatewayDelay);
 
-                        std::list<FragmentPtr> x;
-                        x.push_back(std::move(f)); // This may or may not be unsafe
+                    if(!pt.gateway.empty() && !pt.gatewayPending) {
+                        if(!pt.gatewayTimer)
+                            pt.gatewayTimer = std::make_unique<boost::asio::deadline_timer>(m_ios);
 
-                        Message msg(x);
-                        msg.compile();
-                        msg.encrypt(ivKey, layerKey);
-                        I2NP::MessagePtr td(new I2NP::TunnelData(hop->getNextTunnelId(), msg.getEncryptedData()));
-                        m_ctx.getOutMsgDisp().sendMessage(hop->getNextHash(), td);
+                        pt.gatewayTimer->expires_from_now(boost::posix_time::milliseconds(m_gatewayDelay));
+                        pt.gatewayTimer->async_wait(boost::bind(&Manager::gatewayCallback, this, boost::asio::placeholders::error, tunnelId));
+                        pt.gatewayPending = true;
                     }
-
-                    return;
                 }
             }
 
+            if(hop) {
+                flushGateway(hop, messages);
+                return;
+            }
+
             {
                 std::lock_guard<std::mutex> lock(m_tunnelsMutex);
                 auto itr = m_tunnels.find(tunnelId);
@@ -188,7 +296,7 @@ namespace i2pcpp {
                     TunnelPtr t = itr->second;
 
                     if(t->getDirection() == Tunnel::Direction::INBOUND && t->getState() == Tunnel::State::OPERATIONAL) {
-                        I2P_LOG(m_log, debug) << "data is for one of our own tunnels, recirculating";
+                        I2P_LOG_TAGGED(m_log, debug, "TunnelId", tunnelId) << "data is for one of our own tunnels, recirculating";
                         std::shared_ptr<InboundTunnel> ibt = std::dynamic_pointer_cast<InboundTunnel>(t);
 
                         m_ios.post(boost::bind(&InboundMessageDispatcher::messageReceived, boost::ref(m_ctx.getInMsgDisp()), from, 0, data));
@@ -197,160 +305,460 @@ namespace i2pcpp {
             }
         }
 
-        void Manager::receiveData(RouterHash const from, uint32_t const tunnelId, StaticByteArray<1024> const data)
+        void Manager::receiveData(RouterHash const &from, uint32_t const tunnelId, StaticByteArray<1024> const &data)
         {
 
-            I2P_LOG_SCOPED_TAG(m_log, "TunnelId", tunnelId);
-            I2P_LOG(m_log, debug) << "received " << data.size() << " bytes of tunnel data";
+            I2P_LOG_TAGGED(m_log, debug, "TunnelId", tunnelId) << "received " << data.size() << " bytes of tunnel data";
+
+            /* Only the lookup and the shaping need the lock, the layer
+             * encryption is done without it so tunnel data is relayed by
+             * all threads at once.
+             */
+            BuildRequestRecordPtr hop;
+            {
+                std::lock_guard<std::mutex> lock(m_participatingMutex);
+
+                auto itr = m_participating.find(tunnelId);
+                if(itr != m_participating.end()) {
+                    I2P_LOG_TAGGED(m_log, debug, "TunnelId", tunnelId) << "data is for a known tunnel";
 
-            std::lock_guard<std::mutex> lock(m_participatingMutex);
+                    if(!shape(itr->second, data.size())) {
+                        I2P_LOG_TAGGED(m_log, debug, "TunnelId", tunnelId) << "tunnel is over its bandwidth budget, dropping";
+                        return;
+                    }
 
-            auto itr = m_participating.find(tunnelId);
-            if(itr != m_participating.end()) {
-                I2P_LOG(m_log, debug) << "data is for a known tunnel";
+                    hop = itr->second.hop;
+                }
+            }
 
-                BuildRequestRecordPtr hop = itr->second.first;
+            if(!hop) {
+                receiveOwnData(tunnelId, data);
+                return;
+            }
 
-                SessionKey k1 = hop->getTunnelIVKey();
-                Botan::SymmetricKey ivKey(k1.data(), k1.size());
+            SessionKey k1 = hop->getTunnelIVKey();
+            Botan::SymmetricKey ivKey(k1.data(), k1.size());
 
-                SessionKey k2 = hop->getTunnelLayerKey();
-                Botan::SymmetricKey layerKey(k2.data(), k2.size());
+            SessionKey k2 = hop->getTunnelLayerKey();
+            Botan::SymmetricKey layerKey(k2.data(), k2.size());
 
-                Message msg(data);
+            Message msg(data);
+            {
+                Metrics::ScopedTimer t(m_cryptoTime);
                 msg.encrypt(ivKey, layerKey);
+            }
 
-                switch(hop->getType()) {
-                    case BuildRequestRecord::Type::PARTICIPANT:
-                        {
-                            I2P_LOG(m_log, debug) << "we are a participant, forwarding";
+            switch(hop->getType()) {
+                case BuildRequestRecord::Type::PARTICIPANT:
+                    {
+                        I2P_LOG_TAGGED(m_log, debug, "TunnelId", tunnelId) << "we are a participant, forwarding";
 
-                            I2NP::MessagePtr td(new I2NP::TunnelData(hop->getNextTunnelId(), msg.getEncryptedData()));
-                            m_ctx.getOutMsgDisp().sendMessage(hop->getNextHash(), td);
-                        }
+                        I2NP::MessagePtr td(new I2NP::TunnelData(hop->getNextTunnelId(), msg.getEncryptedData()));
+                        m_ctx.getOutMsgDisp().sendParticipating(hop->getNextHash(), td);
+                    }
 
-                        break;
+                    break;
 
-                    case BuildRequestRecord::Type::ENDPOINT:
-                        {
-                            I2P_LOG(m_log, debug) << "we are an endpoint, sending to fragment handler";
+                case BuildRequestRecord::Type::ENDPOINT:
+                    {
+                        I2P_LOG_TAGGED(m_log, debug, "TunnelId", tunnelId) << "we are an endpoint, sending to fragment handler";
 
-                            m_fragmentHandler.receiveFragments(msg.parse());
-                        }
+                        m_fragmentHandler.receiveFragments(msg.parse());
+                    }
 
-                        break;
+                    break;
+
+                default:
+                    break;
+            }
+        }
 
-                    default:
-                        break;
+        void Manager::receiveOwnData(uint32_t const tunnelId, StaticByteArray<1024> const &data)
+        {
+            std::shared_ptr<InboundTunnel> t;
+            {
+                std::lock_guard<std::mutex> lock(m_tunnelsMutex);
+                auto itr = m_tunnels.find(tunnelId);
+                if(itr != m_tunnels.end() && itr->second->getDirection() == Tunnel::Direction::INBOUND)
+                    t = std::static_pointer_cast<InboundTunnel>(itr->second);
+            }
+
+            if(!t) {
+                I2P_LOG_TAGGED(m_log, debug, "TunnelId", tunnelId) << "data is for an unknown tunnel, dropping";
+                return;
+            }
+
+            I2P_LOG_TAGGED(m_log, debug, "TunnelId", tunnelId) << "we are the endpoint of one of our own tunnels, sending to fragment handler";
+
+            Message msg(data);
+            {
+                Metrics::ScopedTimer timer(m_cryptoTime);
+                t->decrypt(msg);
+            }
+
+            m_fragmentHandler.receiveFragments(msg.parse());
+        }
+
+        void Manager::flushGateway(BuildRequestRecordPtr const &hop, std::vector<std::list<FragmentPtr>> &messages)
+        {
+            if(messages.empty())
+                return;
+
+            SessionKey k1 = hop->getTunnelIVKey();
+            Botan::SymmetricKey ivKey(k1.data(), k1.size());
+            SessionKey k2 = hop->getTunnelLayerKey();
+            Botan::SymmetricKey layerKey(k2.data(), k2.size());
+
+            I2P_LOG(m_log, debug) << "sending " << messages.size() << " tunnel messages from the gateway";
+
+            for(auto& fragments: messages) {
+                Message msg(fragments);
+                msg.compile();
+                {
+                    Metrics::ScopedTimer timer(m_cryptoTime);
+                    msg.encrypt(ivKey, layerKey);
                 }
-            } else
-                I2P_LOG(m_log, debug) << "data is for an unknown tunnel, dropping";
+
+                I2NP::MessagePtr td(new I2NP::TunnelData(hop->getNextTunnelId(), msg.getEncryptedData()));
+                m_ctx.getOutMsgDisp().sendParticipating(hop->getNextHash(), td);
+            }
+        }
+
+        void Manager::gatewayCallback(const boost::system::error_code &e, uint32_t tunnelId)
+        {
+            if(e)
+                return;
+
+            BuildRequestRecordPtr hop;
+            std::vector<std::list<FragmentPtr>> messages;
+            {
+                std::lock_guard<std::mutex> lock(m_participatingMutex);
+
+                auto itr = m_participating.find(tunnelId);
+                if(itr == m_participating.end())
+                    return;
+
+                itr->second.gatewayPending = false;
+                hop = itr->second.hop;
+                messages = itr->second.gateway.pack(true);
+            }
+
+            flushGateway(hop, messages);
         }
 
         void Manager::timerCallback(const boost::system::error_code &e, bool participating, uint32_t tunnelId)
         {
             if(participating) {
                 std::lock_guard<std::mutex> lock(m_participatingMutex);
-                m_participating.erase(tunnelId);
+                auto itr = m_participating.find(tunnelId);
+                if(itr != m_participating.end()) {
+                    I2P_LOG_SCOPED_TAG(m_log, "TunnelId", tunnelId);
+                    I2P_LOG(m_log, debug) << "participating tunnel expired, relayed " << itr->second.messages << " messages (" << itr->second.bytes << " bytes), dropped " << itr->second.dropped;
+
+                    m_participating.erase(itr);
+                }
             } else {
                 std::lock_guard<std::mutex> lock(m_tunnelsMutex);
                 m_tunnels.erase(tunnelId);
             }
         }
 
-        void Manager::tunnelBuildExpireCallback(const boost::system::error_code & e, uint32_t tunnelId)
+        bool Manager::shape(ParticipatingTunnel &t, std::size_t bytes)
+        {
+            ++t.messages;
+            t.bytes += bytes;
+            m_participatingBytes += bytes;
+
+            /* Endpoints hand their traffic to the fragment handler, which is
+             * sent as our own, so only traffic we forward is charged against
+             * the outbound budget here.
+             */
+            bool forward = (t.hop->getType() != BuildRequestRecord::Type::ENDPOINT);
+
+            /* Only charge the buckets once all of them have room, so that a
+             * message dropped by one does not use up the budget of the
+             * others. Both of ours are guarded by m_participatingMutex, the
+             * dispatcher's is checked and charged in one step, last.
+             */
+            if(t.bucket.available(bytes) && m_participatingBucket.available(bytes) &&
+                    (!forward || m_ctx.getOutMsgDisp().shapeParticipating(bytes))) {
+                t.bucket.consume(bytes);
+                m_participatingBucket.consume(bytes);
+
+                return true;
+            }
+
+            ++t.dropped;
+            m_participatingDropped.add();
+
+            return false;
+        }
+
+        void Manager::tunnelBuildExpireCallback(const boost::system::error_code & e, uint32_t msgId)
         {
+            // The timer is cancelled when the build completes
+            if(e)
+                return;
+
+            PendingTunnel pt;
+            {
+                std::lock_guard<std::mutex> lock(m_pendingMutex);
+                auto itr = m_pending.find(msgId);
+                if(itr == m_pending.end())
+                    return;
+
+                pt = std::move(itr->second);
+                m_pending.erase(itr);
+            }
+
+            auto tunnelId = pt.tunnel->getTunnelId();
             I2P_LOG(m_log, info) << "tunnel build with tunnelId " << std::to_string(tunnelId) << " timed out";
+
+            m_ctx.getProfileManager().buildTimedOut(pt.tunnel->getHops());
+
+            if(auto pool = pt.pool.lock())
+                pool->buildFinished(pt.tunnel->getDirection(), TunnelPtr(), pt.sent);
+
             m_ios.post(boost::bind(&Manager::onTunnelBuildTimeout, this, tunnelId));
-            
+        }
+
+        void Manager::buildNotSent(uint32_t msgId)
+        {
+            PendingTunnel pt;
+            {
+                std::lock_guard<std::mutex> lock(m_pendingMutex);
+                auto itr = m_pending.find(msgId);
+                if(itr == m_pending.end())
+                    return;
+
+                pt = std::move(itr->second);
+                m_pending.erase(itr);
+            }
+
+            // None of the hops saw the request, so none of them are charged
+            auto tunnelId = pt.tunnel->getTunnelId();
+            I2P_LOG(m_log, error) << "could not secure the build records of tunnel " << std::to_string(tunnelId) << ", not sending";
+
+            if(auto pool = pt.pool.lock())
+                pool->buildFinished(pt.tunnel->getDirection(), TunnelPtr(), pt.sent);
+
+            m_ios.post(boost::bind(&Manager::onTunnelBuildFailure, this, tunnelId));
         }
 
         void Manager::callback(const boost::system::error_code &e)
         {
+            // Rates are per second over the time since the last callback
+            const auto now = std::chrono::steady_clock::now();
+            const double elapsed = std::max(std::chrono::duration<double>(now - m_lastCallback).count(), 0.001);
+            m_lastCallback = now;
+
             auto count = getParticipatingTunnelCount();
-            I2P_LOG(m_log, info) << boost::log::add_value("participating", (uint32_t) count);
+            Metrics::gauge("tunnels.participating").set(count);
             I2P_LOG(m_log, debug) << "we have " << std::to_string(count) << " participating tunnels";
 
+            auto stats = m_buildWorkers.getStats();
+            auto processed = stats.processed - m_lastBuildStats.processed;
+            auto wait = (processed ? (stats.queueWait - m_lastBuildStats.queueWait) / processed : 0);
+            m_lastBuildStats = stats;
+
+            auto admission = m_admission.getStats();
+            auto accepted = admission.accepted - m_lastAdmissionStats.accepted;
+            auto decided = accepted +
+                (admission.probabilistic - m_lastAdmissionStats.probabilistic) +
+                (admission.overload - m_lastAdmissionStats.overload) +
+                (admission.bandwidth - m_lastAdmissionStats.bandwidth) +
+                (admission.critical - m_lastAdmissionStats.critical);
+            m_lastAdmissionStats = admission;
+
+            m_admission.update((uint64_t)(m_participatingBytes.exchange(0) / elapsed), wait / 1000);
+
+            Metrics::gauge("tunnels.build_requests").set((int64_t)(processed / elapsed));
+            Metrics::gauge("tunnels.build_queue_wait").set(wait / 1000);
+            Metrics::gauge("tunnels.build_accept_rate").set(decided ? accepted * 100 / decided : 100);
+            I2P_LOG(m_log, debug) << "processed " << processed << " build requests, " << stats.rejected << " rejected in total, average queue wait " << wait << "us";
+
+            auto prepared = m_buildPreparer.getStats();
+            I2P_LOG(m_log, debug) << "prepared " << prepared.tunnels << " tunnel builds, " << prepared.misses << " records had no precomputed ElGamal key, " << m_buildPreparer.getReady() << " ready";
+
+            maintainPools();
+
             if ( count == 0 && m_graceful ) { 
                 I2P_LOG(m_log, info) << "no more participating tunnels, we can now die";
                
             } else {
-                m_timer.expires_at(m_timer.expires_at() + boost::posix_time::time_duration(0, 0, 5));
-                m_timer.async_wait(boost::bind(&Manager::callback, this, boost::asio::placeholders::error));
+                m_timer.expires_at(m_timer.expires_at() + boost::posix_time::seconds(CALLBACK_INTERVAL));
+                m_timer.async_wait(m_strand.wrap(boost::bind(&Manager::callback, this, boost::asio::placeholders::error)));
             }
         
         }
 
-        void Manager::createTunnel()
+        uint32_t Manager::buildIBTunnel(std::vector<RouterIdentity> & hops)
         {
-            I2P_LOG(m_log, debug) << "creating tunnel";
-            std::vector<RouterIdentity> hops = { m_ctx.getProfileManager().getPeer().getIdentity() };
-            /*
-            auto z = std::make_shared<InboundTunnel>(m_ctx.getIdentity()->getHash());
-            auto t = std::make_shared<OutboundTunnel>(hops, m_ctx.getIdentity()->getHash(), z->getTunnelId());
-            //auto t = std::make_shared<InboundTunnel>(m_ctx.getIdentity().getHash(), hops);
-            m_tunnels[t->getTunnelId()] = z;
-            m_pending[t->getNextMsgId()] = t;
-
-            I2NP::MessagePtr vtb(new I2NP::VariableTunnelBuild(t->getRecords()));
-            m_ctx.getOutMsgDisp().sendMessage(t->getDownstream(), vtb);
-            */
+            I2P_LOG(m_log, info) << "build IB tunnel";
+
+            auto tun = std::make_shared<InboundTunnel>(m_ctx.getIdentity()->getHash(), hops);
+            sendBuild(tun, PoolPtr());
+
+            return tun->getTunnelId();
         }
 
-        uint32_t Manager::buildIBTunnel(std::vector<RouterIdentity> & hops)
+        uint32_t Manager::buildOBTunnel(std::vector<RouterIdentity> & hops, RouterHash const & reply, uint32_t reply_tunnel_id )
         {
             I2P_LOG(m_log, info) << "build OB tunnel";
 
-            auto my_hash = m_ctx.getIdentity()->getHash();
-            auto tun = std::make_shared<InboundTunnel>(my_hash ,hops);
+            auto tun = std::make_shared<OutboundTunnel>(hops, reply, reply_tunnel_id);
+            sendBuild(tun, PoolPtr());
+
+            return tun->getTunnelId();
+        }
+
+        PoolPtr Manager::createPool(Pool::Settings const &settings)
+        {
+            auto pool = std::make_shared<Pool>(settings);
             {
-                std::lock_guard<std::mutex> lock_tunnels(m_tunnelsMutex);
-                m_tunnels[tun->getTunnelId()] = tun;
+                std::lock_guard<std::mutex> lock(m_poolsMutex);
+                m_pools.push_back(pool);
             }
+
+            m_strand.post(boost::bind(&Manager::maintainPools, this));
+
+            return pool;
+        }
+
+        void Manager::destroyPool(PoolPtr const &pool)
+        {
             {
-                std::lock_guard<std::mutex> lock_pending(m_pendingMutex);
-                m_pending[tun->getTunnelId()] = tun;
-            }
-
-            auto tunnelId = tun->getTunnelId();
-            
-            I2NP::MessagePtr vtb(new I2NP::VariableTunnelBuild(tun->getRecords()));
-            m_ctx.getOutMsgDisp().sendMessage(tun->getDownstream(), vtb);
-            
-            // bug?
-            boost::asio::deadline_timer tunnel_expire_timer(m_ios, boost::posix_time::time_duration(0,0,60));
-            tunnel_expire_timer.async_wait(boost::bind(&Manager::tunnelBuildExpireCallback, this, boost::asio::placeholders::error, tunnelId));
-            
-            return tun->getTunnelId();
-            
+                std::lock_guard<std::mutex> lock(m_poolsMutex);
+                m_pools.erase(std::remove(m_pools.begin(), m_pools.end(), pool), m_pools.end());
+            }
+
+            std::lock_guard<std::mutex> lock(m_tunnelsMutex);
+            for(auto id: pool->clear())
+                m_tunnels.erase(id);
         }
 
-        uint32_t Manager::buildOBTunnel(std::vector<RouterIdentity> & hops, RouterHash const & reply, uint32_t reply_tunnel_id )
+        PoolPtr Manager::getExploratoryPool() const
         {
-            I2P_LOG(m_log, info) << "build OB tunnel";
+            return m_exploratory;
+        }
 
-            auto tun = std::make_shared<OutboundTunnel>(hops, reply, reply_tunnel_id);
+        void Manager::maintainPools()
+        {
+            std::vector<PoolPtr> pools;
             {
-                std::lock_guard<std::mutex> lock_tunnels(m_tunnelsMutex);
-                m_tunnels[tun->getTunnelId()] = tun;
+                std::lock_guard<std::mutex> lock(m_poolsMutex);
+                pools = m_pools;
+            }
+
+            for(auto& pool: pools) {
+                auto expired = pool->expire();
+                if(expired.size()) {
+                    std::lock_guard<std::mutex> lock(m_tunnelsMutex);
+                    for(auto id: expired)
+                        m_tunnels.erase(id);
+                }
+
+                if(m_graceful)
+                    continue;
+
+                for(auto d: { Tunnel::Direction::INBOUND, Tunnel::Direction::OUTBOUND }) {
+                    for(uint32_t n = pool->getBuildsNeeded(d); n; --n) {
+                        try {
+                            if(!build(pool, d))
+                                break;
+                        } catch(std::exception &e) {
+                            I2P_LOG(m_log, error) << "exception building tunnel for pool " << pool->getSettings().name << ": " << e.what();
+                            break;
+                        }
+                    }
+                }
             }
+        }
+
+        bool Manager::build(PoolPtr const &pool, Tunnel::Direction d)
+        {
+            const uint32_t length = pool->getLength(d);
+            auto hops = m_ctx.getProfileManager().getHops(length, pool->getSettings().tier);
+            if(hops.size() < length) {
+                I2P_LOG(m_log, debug) << "not enough peers to build a tunnel for pool " << pool->getSettings().name;
+                return false;
+            }
+
+            RouterHash myHash = m_ctx.getIdentity()->getHash();
+
+            TunnelPtr t;
+            if(d == Tunnel::Direction::INBOUND)
+                t = std::make_shared<InboundTunnel>(myHash, hops);
+            else {
+                /* The reply tunnel has to outlive the build, spreading the
+                 * replies over the exploratory inbound tunnels.
+                 */
+                auto reply = std::dynamic_pointer_cast<InboundTunnel>(m_exploratory->select(Tunnel::Direction::INBOUND, std::chrono::seconds(BUILD_TIMEOUT)));
+                if(!reply)
+                    reply = m_replyTunnel;
+
+                t = std::make_shared<OutboundTunnel>(hops, reply->getGateway(), reply->getGatewayTunnelId());
+            }
+
+            pool->buildStarted(d);
+
+            /* Zero hop tunnels need no build */
+            if(t->getState() == Tunnel::State::OPERATIONAL) {
+                {
+                    std::lock_guard<std::mutex> lock(m_tunnelsMutex);
+                    m_tunnels[t->getTunnelId()] = t;
+                }
+
+                pool->buildFinished(d, t, Pool::Clock::now());
+                return true;
+            }
+
+            I2P_LOG(m_log, debug) << "building tunnel for pool " << pool->getSettings().name;
+            sendBuild(t, pool);
+
+            return true;
+        }
+
+        void Manager::sendBuild(TunnelPtr const &t, PoolPtr const &pool)
+        {
+            const uint32_t msgId = t->getNextMsgId();
+
+            auto timer = std::make_unique<boost::asio::deadline_timer>(m_ios, boost::posix_time::time_duration(0, 0, BUILD_TIMEOUT));
+            timer->async_wait(boost::bind(&Manager::tunnelBuildExpireCallback, this, boost::asio::placeholders::error, msgId));
+
             {
-                std::lock_guard<std::mutex> lock_pending(m_pendingMutex);
-                m_pending[tun->getTunnelId()] = tun;
+                std::lock_guard<std::mutex> lock(m_pendingMutex);
+                PendingTunnel pt;
+                pt.tunnel = t;
+                pt.pool = pool;
+                pt.timer = std::move(timer);
+                pt.sent = std::chrono::steady_clock::now();
+                m_pending[msgId] = std::move(pt);
             }
-    
-            auto tunnelId = tun->getTunnelId();
 
-            I2NP::MessagePtr vtb(new I2NP::VariableTunnelBuild(tun->getRecords()));
-            m_ctx.getOutMsgDisp().sendMessage(tun->getDownstream(), vtb);
-        
-            // bug?
-            boost::asio::deadline_timer tunnel_expire_timer(m_ios, boost::posix_time::time_duration(0,0,60));
-            tunnel_expire_timer.async_wait(boost::bind(&Manager::tunnelBuildExpireCallback, this, boost::asio::placeholders::error, tunnelId));
-            
-            return tun->getTunnelId();
+            /* The records are encrypted by the preparer threads and sent
+             * from the router thread once they're all done.
+             */
+            m_buildPreparer.submit(t, [this, t, msgId](bool secured) {
+                if(!secured) {
+                    buildNotSent(msgId);
+                    return;
+                }
+
+                I2NP::MessagePtr vtb(new I2NP::VariableTunnelBuild(t->getRecords()));
+                m_ctx.getOutMsgDisp().sendMessage(t->getDownstream(), vtb);
+            });
         }
-        
+
+        uint64_t Manager::getConfigValue(std::string const &name, uint64_t def)
+        {
+            try {
+                return std::stoull(m_ctx.getDatabase()->getConfigValue(name));
+            } catch(std::exception &e) {
+                return def;
+            }
+        }
+
         uint32_t Manager::getParticipatingTunnelCount()
         {
 
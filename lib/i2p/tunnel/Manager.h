@@ -2,18 +2,31 @@
 #define TUNNELMANAGER_H
 
 #include "Tunnel.h"
+#include "InboundTunnel.h"
 #include "FragmentHandler.h"
+#include "Gateway.h"
+#include "BuildWorkerPool.h"
+#include "BuildPreparer.h"
+#include "AdmissionController.h"
+#include "Pool.h"
 
 #include <i2pcpp/Log.h>
 
 #include <i2pcpp/datatypes/BuildRecord.h>
+#include <i2pcpp/datatypes/BuildRecordBlock.h>
 #include <i2pcpp/datatypes/BuildRequestRecord.h>
 #include <i2pcpp/datatypes/BuildResponseRecord.h>
 
+#include <i2pcpp/util/Metrics.h>
+#include <i2pcpp/util/TokenBucket.h>
+
 #include <boost/asio.hpp>
 
+#include <atomic>
+#include <chrono>
 #include <mutex>
 #include <unordered_map>
+#include <vector>
 
 namespace i2pcpp {
     class RouterContext;
@@ -33,23 +46,25 @@ namespace i2pcpp {
                  * result of a tunnel we created, the tunnel's status is set
                  * accordingly.
                  */
-                void receiveRecords(uint32_t const msgId, std::list<BuildRecordPtr> records);
+                void receiveRecords(uint32_t const msgId, BuildRecordBlockPtr records);
 
                 /**
                  * Checks to see if \a tunnelId is a valid, established tunnel. If so,
-                 * \a data is fragmented in to on first fragment and zero or more
-                 * follow on fragments. All the fragments are then sent one by one to
-                 * the next hop in the tunnel.
+                 * \a data is queued at the tunnel's i2pcpp::Tunnel::Gateway. Full
+                 * tunnel messages are sent right away, the rest after at most the
+                 * gateway batch delay, packed together with whatever else was
+                 * queued in the meantime.
                  */
-                void receiveGatewayData(RouterHash const from, uint32_t const tunnelId, ByteArray const data);
+                void receiveGatewayData(RouterHash const &from, uint32_t const tunnelId, ByteArray const &data);
 
                 /**
                  * Checks to see if the \a tunnelId is valid. If we are a participatory
                  * tunnel, the \a data is merely forwarded to the next hop. If we are
-                 * an endpoint, the \a data is sent to the i2pcpp::Tunnel::FragmentHandler
+                 * an endpoint, of someone else's tunnel or of one of our own inbound
+                 * tunnels, the \a data is sent to the i2pcpp::Tunnel::FragmentHandler
                  * for further processing.
                  */
-                void receiveData(RouterHash const from, uint32_t const tunnelId, StaticByteArray<1024> const data);
+                void receiveData(RouterHash const &from, uint32_t const tunnelId, StaticByteArray<1024> const &data);
 
                 /**
                  * Build a tunnel over a set of Routers
@@ -58,9 +73,26 @@ namespace i2pcpp {
                 uint32_t buildIBTunnel(std::vector<RouterIdentity> & hops);
                 uint32_t buildOBTunnel(std::vector<RouterIdentity> & hops, RouterHash const & replyTo, uint32_t reply_tunnel);
 
-                virtual void onTunnelBuildSuccess(uint32_t tunnelId) {}
-                virtual void onTunnelBuildFailure(uint32_t tunnelId) {}
-                virtual void onTunnelBuildTimeout(uint32_t tunnelId) {}
+                /**
+                 * Creates a pool of our own tunnels, which is kept full by
+                 *  building and replacing tunnels in the background.
+                 */
+                PoolPtr createPool(Pool::Settings const &settings);
+
+                /**
+                 * Stops maintaining \a pool and forgets its tunnels.
+                 */
+                void destroyPool(PoolPtr const &pool);
+
+                /**
+                 * @return the pool of exploratory tunnels, used for our own
+                 *  tunnel builds
+                 */
+                PoolPtr getExploratoryPool() const;
+
+                virtual void onTunnelBuildSuccess(uint32_t) {}
+                virtual void onTunnelBuildFailure(uint32_t) {}
+                virtual void onTunnelBuildTimeout(uint32_t) {}
 
                 /**
                  * count participating tunnels
@@ -68,29 +100,170 @@ namespace i2pcpp {
                 uint32_t getParticipatingTunnelCount();
 
                 void gracefulShutdown();
+
+                /// Seconds to wait for a reply to a tunnel build
+                static const uint32_t BUILD_TIMEOUT = 60;
+
+                /// Seconds between two runs of the periodic callback
+                static const uint32_t CALLBACK_INTERVAL = 5;
+
+                /// Default per tunnel limit for participating traffic, in bytes per second
+                static const uint64_t DEFAULT_TUNNEL_BANDWIDTH = 128 * 1024;
+
+                /// Default time gateway data waits to be packed with more, in milliseconds
+                static const uint32_t DEFAULT_GATEWAY_DELAY = 100;
+
             private:
+                /**
+                 * A tunnel we participate in, along with its traffic
+                 *  accounting and shaping state.
+                 */
+                struct ParticipatingTunnel {
+                    BuildRequestRecordPtr hop;
+                    std::unique_ptr<boost::asio::deadline_timer> timer;
+                    TokenBucket bucket;
+
+                    /// Data waiting to be sent, if we are the gateway
+                    Gateway gateway;
+                    std::unique_ptr<boost::asio::deadline_timer> gatewayTimer;
+                    bool gatewayPending = false;
+
+                    uint64_t messages = 0;
+                    uint64_t bytes = 0;
+                    uint64_t dropped = 0;
+                };
+
+                /**
+                 * A tunnel of ours waiting for its build reply.
+                 */
+                struct PendingTunnel {
+                    TunnelPtr tunnel;
+                    std::weak_ptr<Pool> pool;
+                    std::unique_ptr<boost::asio::deadline_timer> timer;
+                    std::chrono::steady_clock::time_point sent;
+                };
+
+                /**
+                 * Continues processing of a participation request once our
+                 *  record, at \a index in \a records, has been decrypted and
+                 *  parsed in to \a req by a build worker. Runs on the router
+                 *  io_service.
+                 */
+                void handleRequest(BuildRecordBlockPtr const &records, size_t index, BuildRequestRecordPtr const &req);
+
+                /**
+                 * Accounts for \a bytes of traffic on the participating tunnel
+                 *  \a t and checks them against the per tunnel, participating
+                 *  and outbound bandwidth limits. Must be called with
+                 *  m_participatingMutex held, before the traffic is encrypted.
+                 * @return false if the traffic should be dropped
+                 */
+                bool shape(ParticipatingTunnel &t, std::size_t bytes);
+
+                /**
+                 * Handles \a data which arrived at us, the endpoint, through
+                 *  one of our own inbound tunnels.
+                 */
+                void receiveOwnData(uint32_t const tunnelId, StaticByteArray<1024> const &data);
+
+                /**
+                 * Encrypts the tunnel messages packed by the gateway of a
+                 *  tunnel and sends them to \a hop. Must be called without
+                 *  m_participatingMutex held; the messages are packed under
+                 *  it, by i2pcpp::Tunnel::Gateway::pack.
+                 */
+                void flushGateway(BuildRequestRecordPtr const &hop, std::vector<std::list<FragmentPtr>> &messages);
+
+                /**
+                 * Sends what is queued at the gateway of \a tunnelId once
+                 *  the batch delay has passed.
+                 */
+                void gatewayCallback(const boost::system::error_code &e, uint32_t tunnelId);
+
                 /**
                  * Deletes the \a tunnelId.
                  */
                 void timerCallback(const boost::system::error_code &e, bool participating, uint32_t tunnelId);
                 void callback(const boost::system::error_code &e);
-                void tunnelBuildExpireCallback(const boost::system::error_code & e, uint32_t tunnelId);
-                void createTunnel();
+                void tunnelBuildExpireCallback(const boost::system::error_code & e, uint32_t msgId);
+
+                /**
+                 * Gives up on the build \a msgId, whose records could not be
+                 *  secured, right away rather than waiting for it to time out.
+                 */
+                void buildNotSent(uint32_t msgId);
+
+                /**
+                 * Expires old tunnels from every pool and starts the builds
+                 *  needed to keep them full.
+                 */
+                void maintainPools();
+
+                /**
+                 * Builds a tunnel in direction \a d for \a pool, with hops
+                 *  chosen by the i2pcpp::ProfileManager.
+                 * @return false if there were not enough peers to choose from
+                 */
+                bool build(PoolPtr const &pool, Tunnel::Direction d);
+
+                /**
+                 * Secures the build records of \a t, sends the build request
+                 *  and waits for the reply.
+                 */
+                void sendBuild(TunnelPtr const &t, PoolPtr const &pool);
+
+                /**
+                 * @return the configuration value \a name, or \a def if it
+                 *  is not set
+                 */
+                uint64_t getConfigValue(std::string const &name, uint64_t def);
 
                 boost::asio::io_service &m_ios;
                 RouterContext &m_ctx;
 
-                std::unordered_map<uint32_t, TunnelPtr> m_pending;
+                /// Serializes build replies, the timer and pool maintenance
+                boost::asio::io_service::strand &m_strand;
+
+                std::unordered_map<uint32_t, PendingTunnel> m_pending;
                 std::unordered_map<uint32_t, TunnelPtr> m_tunnels;
-                std::unordered_map<uint32_t, std::pair<BuildRequestRecordPtr, std::unique_ptr<boost::asio::deadline_timer>>> m_participating;
+                std::unordered_map<uint32_t, ParticipatingTunnel> m_participating;
 
                 mutable std::mutex m_pendingMutex;
                 mutable std::mutex m_tunnelsMutex;
                 mutable std::mutex m_participatingMutex;
 
+                std::vector<PoolPtr> m_pools;
+                mutable std::mutex m_poolsMutex;
+                PoolPtr m_exploratory;
+
+                /// Takes build replies while there are no exploratory inbound tunnels
+                std::shared_ptr<InboundTunnel> m_replyTunnel;
+
                 FragmentHandler m_fragmentHandler;
 
+                BuildWorkerPool m_buildWorkers;
+                BuildPreparer m_buildPreparer;
+                BuildWorkerPool::Stats m_lastBuildStats = {};
+
+                AdmissionController m_admission;
+                AdmissionController::Stats m_lastAdmissionStats = {};
+
+                /// Bytes relayed for participating tunnels since the last callback
+                std::atomic<uint64_t> m_participatingBytes;
+
+                /// Participating traffic dropped by the bandwidth limits
+                Metrics::Counter &m_participatingDropped;
+
+                /// Time taken by the layer encryption of participating traffic
+                Metrics::Histogram &m_cryptoTime;
+
+                /// Shapes the participating traffic of all tunnels combined
+                TokenBucket m_participatingBucket;
+                uint64_t m_tunnelBandwidth;
+                uint32_t m_gatewayDelay;
+
                 boost::asio::deadline_timer m_timer;
+                std::chrono::steady_clock::time_point m_lastCallback;
 
                 i2p_logger_mt m_log;
                 bool m_graceful;
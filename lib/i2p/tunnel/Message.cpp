@@ -1,10 +1,10 @@
 #include "Message.h"
 
 #include <i2pcpp/util/make_unique.h>
+#include <i2pcpp/util/Random.h>
 
 #include <botan/pipe.h>
 #include <botan/lookup.h>
-#include <botan/auto_rng.h>
 
 #include <stdexcept>
 #include <cmath>
@@ -22,8 +22,7 @@ namespace i2pcpp {
         Message::Message(std::list<FragmentPtr> &fragments) :
             m_fragments(std::move(fragments))
         {
-            Botan::AutoSeeded_RNG rng;
-            rng.randomize(m_iv.data(), m_iv.size());
+            Random::randomize(m_iv.data(), m_iv.size());
 
             for(auto& f: m_fragments)
                 m_payloadSize += f->size();
@@ -34,21 +33,22 @@ namespace i2pcpp {
             calculateChecksum();
         }
 
-        std::list<FragmentPtr> Message::parse() const
+        std::vector<FragmentView> Message::parse() const
         {
             if(!verifyChecksum())
                 throw std::runtime_error("invalid checksum in tunnel message");
 
-            ByteArray data = toByteArray(m_encrypted);
-            auto pos = data.cbegin() + 4;
-            auto end = data.cend();
+            const unsigned char *pos = m_encrypted.data() + 4;
+            const unsigned char *end = m_encrypted.data() + m_encrypted.size();
 
             pos = std::find(pos, end, 0x00);
+            if(pos == end)
+                throw std::runtime_error("no padding terminator in tunnel message");
             ++pos; // 0x00 at the end
 
-            std::list<FragmentPtr> fragments;
+            std::vector<FragmentView> fragments;
             while(pos != end)
-                fragments.push_back(Fragment::parse(pos, end));
+                fragments.push_back(FragmentView::parse(pos, end));
 
             return fragments;
         }
@@ -100,6 +100,41 @@ namespace i2pcpp {
             ivCipherPipe2.read(m_iv.data(), m_iv.size());
         }
 
+        void Message::decrypt(Botan::SymmetricKey const &ivKey, Botan::SymmetricKey const &layerKey)
+        {
+            // Recover the IV the data was encrypted with, see encrypt()
+            Botan::Pipe ivCipherPipe(get_cipher("AES-256/ECB/NoPadding", ivKey, Botan::DECRYPTION));
+
+            ivCipherPipe.process_msg(m_iv.data(), m_iv.size());
+
+            if(ivCipherPipe.remaining() != m_iv.size())
+                throw std::runtime_error("Did not get 16 bytes back");
+
+            Botan::secure_vector<Botan::byte> v(16);
+            ivCipherPipe.read(v.data(), v.size());
+
+            Botan::InitializationVector iv(v);
+
+            Botan::Pipe dataCipherPipe(get_cipher("AES-256/CBC/NoPadding", layerKey, iv, Botan::DECRYPTION));
+
+            dataCipherPipe.process_msg(m_encrypted.data(), m_encrypted.size());
+
+            if(dataCipherPipe.remaining() != m_encrypted.size())
+                throw std::runtime_error("Did not get 1008 bytes back");
+
+            dataCipherPipe.read(m_encrypted.data(), m_encrypted.size());
+
+            // And the IV this layer was given
+            Botan::Pipe ivCipherPipe2(get_cipher("AES-256/ECB/NoPadding", ivKey, Botan::DECRYPTION));
+
+            ivCipherPipe2.process_msg(v);
+
+            if(ivCipherPipe2.remaining() != m_iv.size())
+                throw std::runtime_error("Did not get 16 bytes back");
+
+            ivCipherPipe2.read(m_iv.data(), m_iv.size());
+        }
+
         void Message::compile()
         {
             m_encrypted[0] = m_checksum >> 24;
@@ -108,10 +143,9 @@ namespace i2pcpp {
             m_encrypted[3] = m_checksum;
 
             // Pad the message
-            Botan::AutoSeeded_RNG rng;
             auto padStart = m_encrypted.begin() + 4;
             auto padEnd = padStart + (1008 - 4 - 1 - m_payloadSize);
-            rng.randomize((StaticByteArray<1008>::value_type *)padStart, padEnd - padStart);
+            Random::randomize((StaticByteArray<1008>::value_type *)padStart, padEnd - padStart);
             std::replace_if(padStart, padEnd, [](const ByteArray::value_type &x) { return x == 0x00; }, 0xff);
             *padEnd = 0x00; // last byte must be zero
             auto pos = padEnd + 1;
@@ -2,6 +2,7 @@
 #define TUNNELMESSAGE_H
 
 #include "Fragment.h"
+#include "FragmentView.h"
 
 #include "../i2np/Message.h"
 
@@ -12,6 +13,7 @@
 
 #include <array>
 #include <list>
+#include <vector>
 
 namespace i2pcpp {
     namespace Tunnel {
@@ -30,10 +32,11 @@ namespace i2pcpp {
 
                 /**
                  * After the Message has been decrypted, this method will
-                 * parse the data.
-                 * @return a list of i2pcpp::Tunnel::FragmentPtr
+                 * parse the data. The fragments are not copied out of the
+                 * message, so it must outlive the returned views.
+                 * @return a view of each fragment, in the order they appear
                  */
-                std::list<FragmentPtr> parse() const;
+                std::vector<FragmentView> parse() const;
 
                 /**
                  * @return the encrypted message, if it was set previously.
@@ -45,6 +48,12 @@ namespace i2pcpp {
                  */
                 void encrypt(Botan::SymmetricKey const &ivKey, Botan::SymmetricKey const &layerKey);
 
+                /**
+                 * Removes the layer of encryption added by
+                 * i2pcpp::Tunnel::Message::encrypt with the same keys.
+                 */
+                void decrypt(Botan::SymmetricKey const &ivKey, Botan::SymmetricKey const &layerKey);
+
                 /**
                  * Compiles the fragments together in preparation for
                  * encryption.
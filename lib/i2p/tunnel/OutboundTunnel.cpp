@@ -1,5 +1,9 @@
 #include "OutboundTunnel.h"
 
+#include <i2pcpp/util/Random.h>
+
+#include <algorithm>
+
 #include <i2pcpp/datatypes/RouterIdentity.h>
 
 namespace i2pcpp {
@@ -9,31 +13,31 @@ namespace i2pcpp {
             /* Zero hop tunnel */
             if(hops.empty()) {
                 m_state = State::OPERATIONAL;
+
+                m_tunnelId = Random::get<uint32_t>();
                 return;
             }
 
-            uint32_t lastTunnelId;
-            RouterHash lastRouterHash;
+            /* The records are created from the endpoint backwards, then
+             * put in the order they're sent through.
+             */
+            m_hops.reserve(hops.size());
 
             for(int i = hops.size() - 1; i >= 0; i--) {
-                BuildRequestRecordPtr h;
-
-                if(i == hops.size() - 1) {
-                    h = std::make_shared<BuildRequestRecord>(hops[i], replyHash);
-                    h->setType(BuildRequestRecord::Type::ENDPOINT);
-                    h->setNextTunnelId(replyTunnelId);
-                    m_tunnelId = h->getNextTunnelId();
-                    m_nextMsgId = h->getNextMsgId();
+                if(i == (int)hops.size() - 1) {
+                    m_hops.emplace_back(hops[i], replyHash);
+
+                    BuildRequestRecord &h = m_hops.back();
+                    h.setType(BuildRequestRecord::Type::ENDPOINT);
+                    h.setNextTunnelId(replyTunnelId);
+                    m_tunnelId = h.getNextTunnelId();
+                    m_nextMsgId = h.getNextMsgId();
                 } else {
-                    h = std::make_shared<BuildRequestRecord>(hops[i], lastRouterHash, lastTunnelId);
+                    m_hops.emplace_back(hops[i], m_hops.back().getLocalHash(), m_hops.back().getTunnelId());
                 }
-                lastTunnelId = h->getTunnelId();
-                lastRouterHash = h->getLocalHash();
-
-                m_hops.push_front(h);
             }
 
-            secureRecords();
+            std::reverse(m_hops.begin(), m_hops.end());
         }
 
         Tunnel::Direction OutboundTunnel::getDirection() const
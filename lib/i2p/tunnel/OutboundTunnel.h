@@ -11,6 +11,7 @@ namespace i2pcpp {
             public:
                 /**
                  * Constructs an outbound tunnel given a vector of RouterIdentities \a hops, a \a replyHash, and a \a replyTunnelId.
+                 * The build records still have to be secured before they are sent.
                  */
                 OutboundTunnel(std::vector<RouterIdentity> const &hops, RouterHash const &replyHash, uint32_t const replyTunnelId);
 
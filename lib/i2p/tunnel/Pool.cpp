@@ -0,0 +1,119 @@
+#include "Pool.h"
+
+#include <algorithm>
+
+namespace i2pcpp {
+    namespace Tunnel {
+        // Bound to const references by std::chrono::seconds
+        const uint32_t Pool::LIFETIME;
+        const uint32_t Pool::REBUILD_AHEAD;
+
+        Pool::Pool(Settings const &settings) :
+            m_settings(settings) {}
+
+        Pool::Settings const &Pool::getSettings() const
+        {
+            return m_settings;
+        }
+
+        uint32_t Pool::getLength(Tunnel::Direction d) const
+        {
+            return (d == Tunnel::Direction::INBOUND ? m_settings.inboundLength : m_settings.outboundLength);
+        }
+
+        void Pool::buildStarted(Tunnel::Direction d)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            ++getSide(d).pending;
+        }
+
+        void Pool::buildFinished(Tunnel::Direction d, TunnelPtr const &t, Clock::time_point sent)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            Side &s = getSide(d);
+
+            if(s.pending)
+                --s.pending;
+
+            if(t)
+                s.ready.push_back({ t, sent + std::chrono::seconds(LIFETIME) });
+        }
+
+        std::vector<uint32_t> Pool::expire()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            std::vector<uint32_t> expired;
+            auto now = Clock::now();
+
+            for(Side *s: { &m_inbound, &m_outbound }) {
+                auto itr = std::partition(s->ready.begin(), s->ready.end(), [now](Entry const &e) { return e.expires > now; });
+                for(auto i = itr; i != s->ready.end(); ++i)
+                    expired.push_back(i->tunnel->getTunnelId());
+
+                s->ready.erase(itr, s->ready.end());
+            }
+
+            return expired;
+        }
+
+        std::vector<uint32_t> Pool::clear()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            std::vector<uint32_t> removed;
+
+            for(Side *s: { &m_inbound, &m_outbound }) {
+                for(auto& e: s->ready)
+                    removed.push_back(e.tunnel->getTunnelId());
+
+                s->ready.clear();
+            }
+
+            return removed;
+        }
+
+        uint32_t Pool::getBuildsNeeded(Tunnel::Direction d) const
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            Side const &s = getSide(d);
+
+            const uint32_t quantity = (d == Tunnel::Direction::INBOUND ? m_settings.inboundQuantity : m_settings.outboundQuantity);
+            const auto cutoff = Clock::now() + std::chrono::seconds(REBUILD_AHEAD);
+
+            uint32_t lasting = std::count_if(s.ready.cbegin(), s.ready.cend(), [cutoff](Entry const &e) { return e.expires > cutoff; });
+            uint32_t have = lasting + s.pending;
+
+            return (have < quantity ? quantity - have : 0);
+        }
+
+        TunnelPtr Pool::select(Tunnel::Direction d, Clock::duration lasting)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            Side &s = getSide(d);
+            const auto cutoff = Clock::now() + lasting;
+
+            for(size_t i = 0; i < s.ready.size(); i++) {
+                Entry const &e = s.ready[s.next++ % s.ready.size()];
+                if(e.expires > cutoff)
+                    return e.tunnel;
+            }
+
+            return TunnelPtr();
+        }
+
+        uint32_t Pool::getCount(Tunnel::Direction d) const
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return getSide(d).ready.size();
+        }
+
+        Pool::Side& Pool::getSide(Tunnel::Direction d)
+        {
+            return (d == Tunnel::Direction::INBOUND ? m_inbound : m_outbound);
+        }
+
+        Pool::Side const &Pool::getSide(Tunnel::Direction d) const
+        {
+            return (d == Tunnel::Direction::INBOUND ? m_inbound : m_outbound);
+        }
+    }
+}
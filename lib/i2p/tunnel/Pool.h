@@ -0,0 +1,133 @@
+#ifndef TUNNELPOOL_H
+#define TUNNELPOOL_H
+
+#include "Tunnel.h"
+
+#include "../ProfileManager.h"
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace i2pcpp {
+    namespace Tunnel {
+        /**
+         * Keeps a number of ready inbound and outbound tunnels of our own.
+         * The pool only does the bookkeeping: the i2pcpp::Tunnel::Manager
+         *  periodically asks it how many tunnels to build, builds them,
+         *  and reports the results back. Tunnels are replaced ahead of
+         *  their expiry so that senders never have to wait for a build.
+         */
+        class Pool {
+            public:
+                typedef std::chrono::steady_clock Clock;
+
+                struct Settings {
+                    std::string name;
+
+                    uint32_t inboundQuantity = 2;
+                    uint32_t inboundLength = 2;
+
+                    uint32_t outboundQuantity = 2;
+                    uint32_t outboundLength = 2;
+
+                    /// The peers to build the tunnels through
+                    ProfileManager::Tier tier = ProfileManager::Tier::FAST;
+                };
+
+                Pool(Settings const &settings);
+                Pool(const Pool &) = delete;
+                Pool& operator=(Pool &) = delete;
+
+                Settings const &getSettings() const;
+
+                /**
+                 * @return the number of hops for tunnels in direction \a d
+                 */
+                uint32_t getLength(Tunnel::Direction d) const;
+
+                /**
+                 * Records that a build for a tunnel in direction \a d has
+                 *  been sent.
+                 */
+                void buildStarted(Tunnel::Direction d);
+
+                /**
+                 * Records that a build for direction \a d has completed.
+                 * @param t the tunnel if it is now operational, or nullptr if
+                 *  the build failed or timed out
+                 * @param sent when the build request was sent. The hops
+                 *  start their timers when they receive it, so the lifetime
+                 *  of the tunnel is counted from then.
+                 */
+                void buildFinished(Tunnel::Direction d, TunnelPtr const &t, Clock::time_point sent);
+
+                /**
+                 * Removes tunnels which have reached the end of their lifetime.
+                 * @return the IDs of the removed tunnels
+                 */
+                std::vector<uint32_t> expire();
+
+                /**
+                 * Removes all tunnels.
+                 * @return the IDs of the removed tunnels
+                 */
+                std::vector<uint32_t> clear();
+
+                /**
+                 * @return the number of builds to start for direction \a d
+                 *  so that the pool stays full, counting tunnels which are
+                 *  about to expire as already gone
+                 */
+                uint32_t getBuildsNeeded(Tunnel::Direction d) const;
+
+                /**
+                 * Selects one of the ready tunnels in direction \a d. Tunnels
+                 *  are handed out in turn to spread the load across them.
+                 * @param lasting how long the tunnel must stay usable for,
+                 *  tunnels expiring sooner are skipped
+                 * @return the tunnel, or nullptr if none are ready
+                 */
+                TunnelPtr select(Tunnel::Direction d, Clock::duration lasting = Clock::duration::zero());
+
+                /**
+                 * @return the number of ready tunnels in direction \a d
+                 */
+                uint32_t getCount(Tunnel::Direction d) const;
+
+                /// Seconds a tunnel may be used for after its build was sent
+                static const uint32_t LIFETIME = 600;
+
+                /// Seconds before expiry at which a replacement is built
+                static const uint32_t REBUILD_AHEAD = 120;
+
+            private:
+                struct Entry {
+                    TunnelPtr tunnel;
+                    Clock::time_point expires;
+                };
+
+                struct Side {
+                    std::vector<Entry> ready;
+                    uint32_t pending = 0;
+                    uint32_t next = 0;
+                };
+
+                Side& getSide(Tunnel::Direction d);
+                Side const &getSide(Tunnel::Direction d) const;
+
+                Settings m_settings;
+
+                Side m_inbound;
+                Side m_outbound;
+
+                mutable std::mutex m_mutex;
+        };
+
+        typedef std::shared_ptr<Pool> PoolPtr;
+    }
+}
+
+#endif
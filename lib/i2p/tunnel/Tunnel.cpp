@@ -4,6 +4,9 @@
 
 #include <i2pcpp/datatypes/BuildResponseRecord.h>
 
+#include <i2pcpp/util/ElGamal.h>
+#include <i2pcpp/util/Random.h>
+
 namespace i2pcpp {
     namespace Tunnel {
         Tunnel::State Tunnel::getState() const
@@ -16,14 +19,23 @@ namespace i2pcpp {
             return m_tunnelId;
         }
 
-        std::list<BuildRecordPtr> Tunnel::getRecords() const
+        BuildRecordBlockPtr Tunnel::getRecords() const
         {
-            return m_hops;
+            return std::make_shared<BuildRecordBlock>(std::vector<BuildRecord>(m_hops.cbegin(), m_hops.cend()));
         }
 
         RouterHash Tunnel::getDownstream() const
         {
-            return std::static_pointer_cast<BuildRequestRecord>(m_hops.front())->getLocalHash();
+            return m_hops.front().getLocalHash();
+        }
+
+        std::vector<RouterHash> Tunnel::getHops() const
+        {
+            std::vector<RouterHash> hops;
+            for(auto& h: m_hops)
+                hops.push_back(h.getLocalHash());
+
+            return hops;
         }
 
         uint32_t Tunnel::getNextMsgId() const
@@ -31,55 +43,81 @@ namespace i2pcpp {
             return m_nextMsgId;
         }
 
-        void Tunnel::handleResponses(std::list<BuildRecordPtr> const &records)
+        std::vector<BuildResponseRecord::Reply> Tunnel::handleResponses(BuildRecordBlock const &records)
         {
-            bool allgood = true;
+            if(records.size() < m_hops.size())
+                throw std::runtime_error("too few records in tunnel build reply");
 
-            auto itr = m_hops.crbegin();
-            ++itr;
+            BuildRecordBlock replies = records;
 
-            for(; itr != m_hops.crend(); ++itr) {
-                BuildRequestRecordPtr h = std::static_pointer_cast<BuildRequestRecord>(*itr);
+            /* Every hop encrypted all records with its reply key after
+             * writing its own reply. Going backwards, removing the layer of
+             * hop i leaves the record of hop i in the clear, and the
+             * records after it have no more layers to remove.
+             */
+            std::vector<BuildResponseRecord::Reply> result(m_hops.size());
+            bool allgood = true;
+
+            for(size_t i = m_hops.size(); i--;) {
+                BuildRequestRecord const &h = m_hops[i];
 
-                for(auto r: records)
-                    r->decrypt(h->getReplyIV(), h->getReplyKey());
+                replies.decrypt(h.getReplyIV(), h.getReplyKey(), i + 1);
 
-                for(auto r: records) {
-                    BuildResponseRecord resp = *r;
+                BuildResponseRecord resp = replies.get(i);
+                try {
                     resp.parse();
-                    if(resp.getReply() == BuildResponseRecord::Reply::SUCCESS) {
-                        // TODO Record the success in the router's profile.
-                    } else {
-                        // TODO Record the failure in the router's profile.
-                        allgood = false;
-                    }
+                    result[i] = resp.getReply();
+                } catch(std::exception &e) {
+                    I2P_LOG(m_log, debug) << "invalid build reply from hop " << i << ": " << e.what();
+                    result[i] = BuildResponseRecord::Reply::CRITICAL;
                 }
+
+                if(result[i] != BuildResponseRecord::Reply::SUCCESS)
+                    allgood = false;
             }
-        if(allgood)
+
+            if(allgood)
                 m_state = Tunnel::State::OPERATIONAL;
             else
                 m_state = Tunnel::State::FAILED;
+
+            return result;
         }
 
         void Tunnel::secureRecords()
         {
-            for(auto itr = m_hops.cbegin(); itr != m_hops.cend(); ++itr) {
-                BuildRequestRecordPtr h = std::static_pointer_cast<BuildRequestRecord>(*itr);
+            for(size_t i = 0; i < m_hops.size(); i++)
+                secureRecord(i, ElGamal::generate(Random::getRNG()));
 
-                const RouterHash hopHash = h->getLocalHash();
-                StaticByteArray<16> truncatedHash;
-                std::copy(hopHash.cbegin(), hopHash.cbegin() + 16, truncatedHash.begin());
-                h->setHeader(truncatedHash);
+            layerRecords();
+        }
 
-                h->compile();
-                h->encrypt(h->getEncryptionKey());
+        size_t Tunnel::getNumHops() const
+        {
+            return m_hops.size();
+        }
 
-                std::list<BuildRecordPtr>::const_reverse_iterator ritr(itr);
-                for(; ritr != m_hops.crend(); ++ritr) {
-                    BuildRequestRecordPtr r = std::static_pointer_cast<BuildRequestRecord>(*ritr);
-                    h->decrypt(r->getReplyIV(), r->getReplyKey());
-                }
-            }
+        void Tunnel::secureRecord(size_t i, ElGamal::Ephemeral const &ephemeral)
+        {
+            BuildRequestRecord &h = m_hops[i];
+
+            const RouterHash hopHash = h.getLocalHash();
+            StaticByteArray<16> truncatedHash;
+            std::copy(hopHash.cbegin(), hopHash.cbegin() + 16, truncatedHash.begin());
+            h.setHeader(truncatedHash);
+
+            h.compile();
+            h.encrypt(h.getEncryptionKey(), ephemeral);
+        }
+
+        void Tunnel::layerRecords()
+        {
+            /* Undo, in advance, the layers the hops before each hop will
+             * add, so that each hop receives its record as encrypted to it.
+             */
+            for(size_t i = 1; i < m_hops.size(); i++)
+                for(size_t j = i; j--;)
+                    m_hops[i].decrypt(m_hops[j].getReplyIV(), m_hops[j].getReplyKey());
         }
     }
 }
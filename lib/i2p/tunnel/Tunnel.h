@@ -3,13 +3,17 @@
 
 #include <i2pcpp/Log.h>
 
+#include <i2pcpp/datatypes/BuildRecordBlock.h>
 #include <i2pcpp/datatypes/BuildRequestRecord.h>
+#include <i2pcpp/datatypes/BuildResponseRecord.h>
 
 #include <boost/asio.hpp>
 
-#include <list>
+#include <vector>
 
 namespace i2pcpp {
+    namespace ElGamal { struct Ephemeral; }
+
     namespace Tunnel {
         class Tunnel {
             public:
@@ -46,10 +50,10 @@ namespace i2pcpp {
                 uint32_t getTunnelId() const;
 
                 /**
-                 * @return the build request records which are used to construct
-                 * this tunnel.
+                 * @return a copy of the build request records which are used
+                 * to construct this tunnel, to be sent.
                  */
-                std::list<BuildRecordPtr> getRecords() const;
+                BuildRecordBlockPtr getRecords() const;
 
                 /**
                  * @return the i2pcpp::RouterHash of the peer to whom the build
@@ -57,31 +61,65 @@ namespace i2pcpp {
                  */
                 RouterHash getDownstream() const;
 
+                /**
+                 * @return the i2pcpp::RouterHash of each hop, in the order
+                 * the build records are sent through them.
+                 */
+                std::vector<RouterHash> getHops() const;
+
                 /**
                  * @return the next message ID of the tunnel.
                  */
                 uint32_t getNextMsgId() const;
 
                 /**
-                 * Attempts to decrypt the received build record replies and
-                 * set the tunnel state accordingly.
+                 * Decrypts the received build record replies and sets the
+                 * tunnel state accordingly. Each hop's layer is removed once,
+                 * and only from the records it covers, and each hop's reply
+                 * is read from the record in its own position.
+                 * A record which fails verification counts as
+                 * i2pcpp::BuildResponseRecord::Reply::CRITICAL.
+                 * @return the reply of each hop, in the order of getHops()
+                 * @throw std::runtime_error if there are fewer records than hops
                  */
-                void handleResponses(std::list<BuildRecordPtr> const &records);
+                std::vector<BuildResponseRecord::Reply> handleResponses(BuildRecordBlock const &records);
 
                 /**
                  * Sets a timer on the tunnel (for creation timeout).
                  */
                 void setTimer(std::unique_ptr<boost::asio::deadline_timer> t);
 
-            protected:
-                Tunnel() = default;
-
                 /**
                  * Encrypts this tunnel's build records according to the spec.
+                 * This must be done before the records are sent, either by
+                 *  calling this or by handing the tunnel to an
+                 *  i2pcpp::Tunnel::BuildPreparer.
                  */
                 void secureRecords();
 
-                std::list<BuildRecordPtr> m_hops;
+                /**
+                 * @return the number of hops
+                 */
+                size_t getNumHops() const;
+
+                /**
+                 * Compiles the record of hop \a i and ElGamal encrypts it to
+                 *  the hop. This is the expensive part of securing a tunnel's
+                 *  records and the hops of a tunnel can be done in parallel.
+                 */
+                void secureRecord(size_t i, ElGamal::Ephemeral const &ephemeral);
+
+                /**
+                 * Applies the AES layers of the earlier hops to each record.
+                 *  Must be called once all records have been secured.
+                 */
+                void layerRecords();
+
+            protected:
+                Tunnel() = default;
+
+                /// The request record of each hop, in the order they're sent through
+                std::vector<BuildRequestRecord> m_hops;
                 State m_state = State::REQUESTED;
                 uint32_t m_tunnelId;
                 uint32_t m_nextMsgId;
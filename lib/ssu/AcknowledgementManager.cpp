@@ -13,21 +13,46 @@ namespace i2pcpp {
     namespace SSU {
         AcknowledgementManager::AcknowledgementManager(Context &c) :
             m_context(c),
-            m_timer(m_context.ios, boost::posix_time::time_duration(0, 0, 1)),
-            m_log(I2P_LOG_CHANNEL("AM"))
+            m_delay(boost::posix_time::milliseconds(DEFAULT_DELAY)),
+            m_timer(m_context.ios),
+            m_log(I2P_LOG_CHANNEL("AM")) {}
+
+        void AcknowledgementManager::fragmentReceived(RouterHash const &rh, const uint32_t msgId)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            m_dirty[rh].insert(msgId);
+
+            if(!m_scheduled) {
+                m_scheduled = true;
+                m_timer.expires_from_now(m_delay);
+                m_timer.async_wait(boost::bind(&AcknowledgementManager::flushAckCallback, this, boost::asio::placeholders::error));
+            }
+        }
+
+        void AcknowledgementManager::setDelay(boost::posix_time::time_duration const &delay)
         {
-            m_timer.async_wait(boost::bind(&AcknowledgementManager::flushAckCallback, this, boost::asio::placeholders::error));
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_delay = delay;
         }
 
         void AcknowledgementManager::flushAckCallback(const boost::system::error_code& e)
         {
-            std::lock_guard<std::mutex> lock(m_context.packetHandler.m_imf.m_mutex);
-            auto& stateTable = m_context.packetHandler.m_imf.m_states;
+            if(e) return;
 
-            for(auto itr = stateTable.get<1>().cbegin(); itr != stateTable.get<1>().cend();) {
-                std::lock_guard<std::mutex> lock(m_context.peers.getMutex());
+            std::unordered_map<RouterHash, std::unordered_set<uint32_t>> dirty;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                dirty.swap(m_dirty);
+                m_scheduled = false;
+            }
+
+            std::lock_guard<std::mutex> peersLock(m_context.peers.getMutex());
+            std::lock_guard<std::mutex> imfLock(m_context.packetHandler.m_imf.m_mutex);
+            auto& stateTable = m_context.packetHandler.m_imf.m_states.get<0>();
 
-                auto hashToAckFor = itr->hash;
+            for(auto& d: dirty) {
+                auto const &hashToAckFor = d.first;
 
                 if(!m_context.peers.peerExists(hashToAckFor))
                     continue;
@@ -35,16 +60,23 @@ namespace i2pcpp {
                 CompleteAckList completeAckList;
                 PartialAckList partialAckList;
 
-                while(itr != stateTable.get<1>().cend() && itr->hash == hashToAckFor) {
-                    I2P_LOG(m_log, debug) << "sending ack to " << hashToAckFor << " for msgId " << std::hex << itr->msgId << std::dec;
+                for(auto msgId: d.second) {
+                    auto itr = stateTable.find(msgId);
+                    if(itr == stateTable.end() || itr->hash != hashToAckFor) {
+                        // A retransmission of a message we already ACK'd
+                        if(m_context.packetHandler.m_imf.m_completed.contains(hashToAckFor, msgId))
+                            completeAckList.push_back(msgId);
 
-                    if(itr->state.allFragmentsReceived()) {
-                        completeAckList.push_back(itr->msgId);
-                        stateTable.get<1>().erase(itr++);
-                    } else {
-                        partialAckList[itr->msgId] = itr->state.getFragmentsReceived();
-                        ++itr;
+                        continue;
                     }
+
+                    I2P_LOG(m_log, debug) << "sending ack to " << hashToAckFor << " for msgId " << std::hex << msgId << std::dec;
+
+                    if(itr->state.allFragmentsReceived()) {
+                        completeAckList.push_back(msgId);
+                        stateTable.erase(itr);
+                    } else
+                        partialAckList[msgId] = itr->state.getFragmentsReceived();
                 }
 
                 if(completeAckList.size() || partialAckList.size()) {
@@ -56,9 +88,6 @@ namespace i2pcpp {
                     m_context.sendPacket(p);
                 }
             }
-
-            m_timer.expires_at(m_timer.expires_at() + boost::posix_time::time_duration(0, 0, 1));
-            m_timer.async_wait(boost::bind(&AcknowledgementManager::flushAckCallback, this, boost::asio::placeholders::error));
         }
     }
 }
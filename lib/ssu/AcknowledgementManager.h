@@ -7,14 +7,25 @@
 
 #include <i2pcpp/Log.h>
 
+#include <i2pcpp/datatypes/RouterHash.h>
+
 #include <boost/asio.hpp>
 
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+
 namespace i2pcpp {
     namespace SSU {
         class Context;
 
         /**
          * Manages acknowledgment (ACK) of receieved data.
+         * Peers with messages to acknowledge are kept in a dirty list, so a
+         *  flush only touches those peers. A flush is scheduled when the
+         *  first fragment arrives after the previous flush, and runs after
+         *  a short delay so that fragments arriving close together are
+         *  acknowledged in a single packet.
          */
         class AcknowledgementManager {
             public:
@@ -27,20 +38,48 @@ namespace i2pcpp {
                 AcknowledgementManager(const AcknowledgementManager &) = delete;
                 AcknowledgementManager& operator=(AcknowledgementManager &) = delete;
 
+                /**
+                 * Marks message \a msgId from the peer given by \a rh as
+                 *  needing an ACK and schedules a flush if none is pending.
+                 * Should be called for every received fragment, including
+                 *  duplicates, since a duplicate means our ACK was lost.
+                 */
+                void fragmentReceived(RouterHash const &rh, const uint32_t msgId);
+
+                /**
+                 * Sets the time between the first unacknowledged fragment and
+                 *  the flush. A delay of zero sends ACKs as soon as the IO
+                 *  service gets to them.
+                 */
+                void setDelay(boost::posix_time::time_duration const &delay);
+
+                /// Default ACK delay, in milliseconds
+                static const uint32_t DEFAULT_DELAY = 100;
+
             private:
                 /**
-                 * For each peer, sends a data packet to acknowedge the fragments
-                 *  (both partial and complete) that have been received from it.
-                 * This is invoked exactly once every second.
+                 * For each peer in the dirty list, sends a data packet to
+                 *  acknowledge the fragments (both partial and complete) that
+                 *  have been received from it.
                  */
                 void flushAckCallback(const boost::system::error_code& e);
 
                 /// Reference to the i2pcpp::SSU::Context object.
                 Context& m_context;
 
+                /// Message IDs awaiting an ACK, per peer
+                std::unordered_map<RouterHash, std::unordered_set<uint32_t>> m_dirty;
+
+                /// True if the timer is running
+                bool m_scheduled = false;
+
+                boost::posix_time::time_duration m_delay;
+
                 /// Timer to invoke the ACK callback.
                 boost::asio::deadline_timer m_timer;
 
+                mutable std::mutex m_mutex;
+
                 i2p_logger_mt m_log;
         };
     }
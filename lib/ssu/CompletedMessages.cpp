@@ -0,0 +1,47 @@
+/**
+ * @file CompletedMessages.cpp
+ * @brief Implements CompletedMessages.h.
+ */
+#include "CompletedMessages.h"
+
+namespace i2pcpp {
+    namespace SSU {
+        CompletedMessages::CompletedMessages(std::chrono::seconds ttl, size_t capacity) :
+            m_ttl(ttl),
+            m_capacity(capacity) {}
+
+        void CompletedMessages::insert(RouterHash const &rh, const uint32_t msgId, Clock::time_point now)
+        {
+            expire(now);
+
+            m_entries[msgId] = { rh, now };
+            m_order.emplace_back(msgId, now);
+        }
+
+        bool CompletedMessages::contains(RouterHash const &rh, const uint32_t msgId, Clock::time_point now) const
+        {
+            auto itr = m_entries.find(msgId);
+            if(itr == m_entries.end())
+                return false;
+
+            return itr->second.hash == rh && now - itr->second.time < m_ttl;
+        }
+
+        size_t CompletedMessages::size() const
+        {
+            return m_entries.size();
+        }
+
+        void CompletedMessages::expire(Clock::time_point now)
+        {
+            while(!m_order.empty() && (now - m_order.front().second >= m_ttl || m_order.size() >= m_capacity)) {
+                // A message ID inserted again has a newer entry in the map
+                auto itr = m_entries.find(m_order.front().first);
+                if(itr != m_entries.end() && itr->second.time == m_order.front().second)
+                    m_entries.erase(itr);
+
+                m_order.pop_front();
+            }
+        }
+    }
+}
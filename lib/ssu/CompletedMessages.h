@@ -0,0 +1,81 @@
+/**
+ * @file CompletedMessages.h
+ * @brief Defines the i2pcpp::SSU::CompletedMessages class.
+ */
+#ifndef SSUCOMPLETEDMESSAGES_H
+#define SSUCOMPLETEDMESSAGES_H
+
+#include <i2pcpp/datatypes/RouterHash.h>
+
+#include <chrono>
+#include <deque>
+#include <unordered_map>
+
+namespace i2pcpp {
+    namespace SSU {
+        /**
+         * Remembers the IDs of the messages which were recently reassembled
+         *  and delivered, so that fragments the sender retransmits after
+         *  our state is gone (for example because our ACK was lost) are
+         *  not delivered a second time.
+         * Entries are kept for a fixed time and their number is capped,
+         *  the oldest entries are forgotten first.
+         * @note Not thread safe, callers are expected to serialise access.
+         */
+        class CompletedMessages {
+            public:
+                typedef std::chrono::steady_clock Clock;
+
+                /**
+                 * @param ttl how long a message ID is remembered
+                 * @param capacity the maximum number of message IDs remembered
+                 */
+                CompletedMessages(std::chrono::seconds ttl, size_t capacity);
+                CompletedMessages(const CompletedMessages &) = delete;
+                CompletedMessages& operator=(CompletedMessages &) = delete;
+
+                /**
+                 * Records that the message \a msgId from \a rh was delivered.
+                 */
+                void insert(RouterHash const &rh, const uint32_t msgId, Clock::time_point now = Clock::now());
+
+                /**
+                 * @return true if the message \a msgId from \a rh was
+                 *  delivered recently
+                 */
+                bool contains(RouterHash const &rh, const uint32_t msgId, Clock::time_point now = Clock::now()) const;
+
+                /**
+                 * @return the number of message IDs remembered
+                 */
+                size_t size() const;
+
+                /// Seconds a message ID is remembered, well past the last retransmission
+                static const uint32_t TTL = 60;
+
+                /// Maximum number of message IDs remembered
+                static const size_t CAPACITY = 16384;
+
+            private:
+                struct Entry {
+                    RouterHash hash;
+                    Clock::time_point time;
+                };
+
+                /**
+                 * Forgets the entries older than the TTL and, if there are
+                 *  still more than \a capacity - 1, the oldest ones.
+                 */
+                void expire(Clock::time_point now);
+
+                /// Message IDs in the order they were inserted
+                std::deque<std::pair<uint32_t, Clock::time_point>> m_order;
+                std::unordered_map<uint32_t, Entry> m_entries;
+
+                Clock::duration m_ttl;
+                size_t m_capacity;
+        };
+    }
+}
+
+#endif
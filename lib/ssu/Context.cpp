@@ -11,12 +11,15 @@ namespace i2pcpp {
             receivedSignal(s.m_receivedSignal),
             failureSignal(s.m_failureSignal),
             disconnectedSignal(s.m_disconnectedSignal),
+            readySignal(s.m_readySignal),
             socket(ios),
             peers(*this),
             packetHandler(*this, ri.getHash()),
             establishmentManager(*this, dsaPrivKey, ri),
             ackManager(*this),
             omf(*this),
+            bytesSent(Metrics::counter("bandwidth.sent")),
+            bytesReceived(Metrics::counter("bandwidth.received")),
             log(boost::log::keywords::channel = "SSU") {}
 
         void Context::sendPacket(PacketPtr const &p)
@@ -42,15 +45,14 @@ namespace i2pcpp {
             if(!e && n > 0) {
                 Endpoint ep(senderEndpoint);
 
-                I2P_LOG_SCOPED_TAG(log, "Endpoint", ep);
-                I2P_LOG(log, debug) << "received " << n << " bytes";
-                I2P_LOG(log, debug) << boost::log::add_value("received", (uint64_t)n);
+                I2P_LOG_TAGGED(log, debug, "Endpoint", ep) << "received " << n << " bytes";
+                bytesReceived.add(n);
 
                 if(n >= Packet::MIN_PACKET_LEN) {
                     auto p = std::make_shared<Packet>(ep, receiveBuf.data(), n);
                     ios.post(boost::bind(&PacketHandler::packetReceived, &packetHandler, p));
                 } else
-                    I2P_LOG(log, debug) << "dropping short packet";
+                    I2P_LOG_TAGGED(log, debug, "Endpoint", ep) << "dropping short packet";
                 socket.async_receive_from(
                         boost::asio::buffer(receiveBuf.data(), receiveBuf.size()),
                         senderEndpoint,
@@ -68,9 +70,13 @@ namespace i2pcpp {
 
         void Context::dataSent(const boost::system::error_code& e, size_t n, boost::asio::ip::udp::endpoint ep)
         {
-            I2P_LOG_SCOPED_TAG(log, "Endpoint", Endpoint(ep));
-            I2P_LOG(log, debug) << "sent " << n << " bytes";
-            I2P_LOG(log, debug) << boost::log::add_value("sent", (uint64_t)n);
+            if(e) {
+                I2P_LOG_TAGGED(log, error, "Endpoint", Endpoint(ep)) << "error sending: " << e.message();
+                return;
+            }
+
+            I2P_LOG_TAGGED(log, debug, "Endpoint", Endpoint(ep)) << "sent " << n << " bytes";
+            bytesSent.add(n);
         }
 
         void Context::disconnect(RouterHash const &rh)
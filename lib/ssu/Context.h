@@ -12,6 +12,8 @@
 
 #include <i2pcpp/Log.h>
 
+#include <i2pcpp/util/Metrics.h>
+
 #include <boost/asio.hpp>
 
 #include <thread>
@@ -62,6 +64,7 @@ namespace i2pcpp {
             Transport::ReceivedSignal &receivedSignal;
             Transport::FailureSignal &failureSignal;
             Transport::DisconnectedSignal &disconnectedSignal;
+            Transport::ReadySignal &readySignal;
 
             boost::asio::io_service ios;
             boost::asio::ip::udp::socket socket;
@@ -86,6 +89,10 @@ namespace i2pcpp {
             /// Manages sending of outbound messages
             OutboundMessageFragments omf;
 
+            /// Bytes sent and received on the socket
+            Metrics::Counter &bytesSent;
+            Metrics::Counter &bytesReceived;
+
             /// Logging object
             i2p_logger_mt log;
         };
@@ -34,11 +34,12 @@ namespace i2pcpp {
             return es;
         }
 
-        void EstablishmentManager::createState(Endpoint const &ep, RouterIdentity const &ri)
+        void EstablishmentManager::createState(Endpoint const &ep, RouterIdentity const &ri, bool rekey)
         {
             std::lock_guard<std::mutex> lock(m_stateTableMutex);
 
             auto es = std::make_shared<EstablishmentState>(m_privKey, m_identity, ep, ri);
+            es->setRekey(rekey);
             m_stateTable[ep] = es;
 
             sendRequest(es);
@@ -87,7 +88,8 @@ namespace i2pcpp {
                         const RouterHash &rh = es->getTheirIdentity().getHash();
                         I2P_LOG_SCOPED_TAG(m_log, "RouterHash", rh);
                         I2P_LOG(m_log, debug) << "sent session confirmed";
-                        m_context.ios.post(boost::bind(boost::ref(m_context.establishedSignal), rh, (es->getDirection() == EstablishmentState::Direction::INBOUND)));
+                        if(!es->isRekey())
+                            m_context.ios.post(boost::bind(boost::ref(m_context.establishedSignal), rh, (es->getDirection() == EstablishmentState::Direction::INBOUND)));
                         delState(ep);
                     }
                     break;
@@ -99,9 +101,14 @@ namespace i2pcpp {
 
                 case EstablishmentState::State::UNKNOWN:
                 case EstablishmentState::State::FAILURE:
-                    I2P_LOG(m_log, info) << "establishment failed";
-                    if(es->getDirection() == EstablishmentState::Direction::OUTBOUND)
-                        m_context.ios.post(boost::bind(boost::ref(m_context.failureSignal), es->getTheirIdentity().getHash()));
+                    if(es->isRekey()) {
+                        // The session carries on with the keys it has
+                        I2P_LOG(m_log, info) << "rekey failed, keeping the current session keys";
+                    } else {
+                        I2P_LOG(m_log, info) << "establishment failed";
+                        if(es->getDirection() == EstablishmentState::Direction::OUTBOUND)
+                            m_context.ios.post(boost::bind(boost::ref(m_context.failureSignal), es->getTheirIdentity().getHash()));
+                    }
 
                     delState(ep);
                     break;
@@ -195,7 +202,7 @@ namespace i2pcpp {
             state->setMacKey(newMacKey);
 
             Endpoint ep = state->getTheirEndpoint();
-            PeerState ps(ep, state->getTheirIdentity().getHash());
+            PeerState ps(ep, state->getTheirIdentity(), true);
             ps.setCurrentSessionKey(state->getSessionKey());
             ps.setCurrentMacKey(state->getMacKey());
 
@@ -225,16 +232,27 @@ namespace i2pcpp {
                 I2P_LOG(m_log, debug) << "confirmation signature verification succeeded";
 
             Endpoint ep = state->getTheirEndpoint();
-            PeerState ps(ep, state->getTheirIdentity().getHash());
+            PeerState ps(ep, state->getTheirIdentity(), false);
             ps.setCurrentSessionKey(state->getSessionKey());
             ps.setCurrentMacKey(state->getMacKey());
 
             std::lock_guard<std::mutex> lock(m_context.peers.getMutex());
             m_context.peers.addPeer(std::move(ps));
 
+            if(state->isRekey()) {
+                /* The initiator keeps the new keys pending until it sees us
+                 * use them, so tell it straight away rather than waiting
+                 * for the next data packet.
+                 */
+                PacketPtr p = PacketBuilder::buildData(ep, false, CompleteAckList(), PartialAckList(), std::vector<PacketBuilder::FragmentPtr>());
+                p->encrypt(state->getSessionKey(), state->getMacKey());
+                m_context.sendPacket(p);
+            }
+
             delState(ep);
 
-            m_context.ios.post(boost::bind(boost::ref(m_context.establishedSignal), state->getTheirIdentity().getHash(), (state->getDirection() == EstablishmentState::Direction::INBOUND)));
+            if(!state->isRekey())
+                m_context.ios.post(boost::bind(boost::ref(m_context.establishedSignal), state->getTheirIdentity().getHash(), (state->getDirection() == EstablishmentState::Direction::INBOUND)));
         }
     }
 }
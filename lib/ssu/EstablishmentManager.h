@@ -45,9 +45,12 @@ namespace i2pcpp {
                 EstablishmentStatePtr createState(Endpoint const &ep);
 
                 /**
-                 * Creates a state for a given i2pcpp::Endpoint \a ep.
+                 * Creates a state for a given i2pcpp::Endpoint \a ep and
+                 *  sends the session request.
+                 * @param rekey whether this replaces the keys of an existing
+                 *  session, set before the request is sent
                  */
-                void createState(Endpoint const &ep, RouterIdentity const &ri);
+                void createState(Endpoint const &ep, RouterIdentity const &ri, bool rekey = false);
 
                 /**
                  * @return true if there exists a state for the i2pcpp::Endpoint
@@ -5,9 +5,9 @@
 #include "EstablishmentState.h"
 
 #include <i2pcpp/util/I2PDH.h>
+#include <i2pcpp/util/Random.h>
 #include <i2pcpp/datatypes/RouterIdentity.h>
 
-#include <botan/auto_rng.h>
 #include <botan/pk_filts.h>
 #include <botan/dsa.h>
 #include <botan/dh.h>
@@ -22,10 +22,9 @@ namespace i2pcpp {
             m_macKey(m_sessionKey),
             m_theirEndpoint(ep)
         {
-            Botan::AutoSeeded_RNG rng;
             Botan::DL_Group dh_group("modp/ietf/2048");
 
-            m_dhKey = new Botan::DH_PrivateKey(rng, dh_group);
+            m_dhKey = new Botan::DH_PrivateKey(Random::getRNG(), dh_group);
         }
 
         EstablishmentState::EstablishmentState(std::shared_ptr<const Botan::DSA_PrivateKey> const &dsaKey, RouterIdentity const &myIdentity, Endpoint const &ep, RouterIdentity const &theirIdentity) :
@@ -37,10 +36,9 @@ namespace i2pcpp {
             m_theirEndpoint(ep),
             m_theirIdentity(std::make_shared<RouterIdentity>(theirIdentity))
         {
-            Botan::AutoSeeded_RNG rng;
             Botan::DL_Group dh_group("modp/ietf/2048");
 
-            m_dhKey = new Botan::DH_PrivateKey(rng, dh_group);
+            m_dhKey = new Botan::DH_PrivateKey(Random::getRNG(), dh_group);
         }
 
         EstablishmentState::~EstablishmentState()
@@ -187,16 +185,15 @@ namespace i2pcpp {
             ByteArray hash(20);
             hashPipe.read(hash.data(), 20);
 
-            Botan::AutoSeeded_RNG rng;
             Botan::PK_Signer *pks = new Botan::PK_Signer(*m_dsaKey, "Raw");
-            ByteArray signature = pks->sign_message(hash, rng);
+            ByteArray signature = pks->sign_message(hash, Random::getRNG());
 
             unsigned char padSize = 16 - (signature.size() % 16);
             if(padSize < 16)
                 signature.insert(signature.end(), padSize, padSize);
 
             Botan::SymmetricKey encKey(m_dhSecret.data(), 32);
-            m_iv = Botan::InitializationVector(rng, 16);
+            m_iv = Botan::InitializationVector(Random::getRNG(), 16);
             Botan::Pipe encPipe(get_cipher("AES-256/CBC/NoPadding", encKey, m_iv, Botan::ENCRYPTION));
             encPipe.process_msg(signature.data(), signature.size());
 
@@ -244,11 +241,10 @@ namespace i2pcpp {
             ByteArray hash(20);
             hashPipe.read(hash.data(), 20);
 
-            Botan::AutoSeeded_RNG rng;
             std::unique_ptr<Botan::PK_Signer> pks(
                 new Botan::PK_Signer(*m_dsaKey, "Raw")
             );
-            ByteArray signature = pks->sign_message(hash, rng);
+            ByteArray signature = pks->sign_message(hash, Random::getRNG());
 
             return signature;
         }
@@ -301,7 +297,6 @@ namespace i2pcpp {
             ByteArray hash(20);
             hashPipe.read(hash.data(), 20);
 
-            Botan::AutoSeeded_RNG rng;
             std::unique_ptr<Botan::PK_Verifier> pkv(
                 new Botan::PK_Verifier(dsaKey, "Raw")
             );
@@ -371,5 +366,15 @@ namespace i2pcpp {
         {
             return m_dhSecret;
         }
+
+        bool EstablishmentState::isRekey() const
+        {
+            return m_rekey;
+        }
+
+        void EstablishmentState::setRekey(bool rekey)
+        {
+            m_rekey = rekey;
+        }
     }
 }
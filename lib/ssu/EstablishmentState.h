@@ -221,6 +221,17 @@ namespace i2pcpp {
                  */
                 const ByteArray& getDHSecret() const;
 
+                /**
+                 * @return true if this establishment replaces the keys of a
+                 *  session that already exists
+                 */
+                bool isRekey() const;
+
+                /**
+                 * Marks this establishment as rekeying an existing session.
+                 */
+                void setRekey(bool rekey);
+
             private:
                 /// The current state, by default State::UNKNOWN
                 State m_state = State::UNKNOWN;
@@ -255,6 +266,8 @@ namespace i2pcpp {
                 uint32_t m_relayTag;
                 uint32_t m_signatureTimestamp;
                 ByteArray m_signature;
+
+                bool m_rekey = false;
         };
 
         typedef std::shared_ptr<EstablishmentState> EstablishmentStatePtr;
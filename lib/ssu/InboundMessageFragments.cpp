@@ -12,6 +12,7 @@
 #include <botan/pipe.h>
 #include <botan/filters.h>
 
+#include <memory>
 #include <string>
 #include <bitset>
 #include <iomanip>
@@ -20,12 +21,12 @@ namespace i2pcpp {
     namespace SSU {
         InboundMessageFragments::InboundMessageFragments(Context &c) :
             m_context(c),
+            m_completed(std::chrono::seconds(CompletedMessages::TTL), CompletedMessages::CAPACITY),
+            m_reassemblyTime(Metrics::histogram("latency.ssu.reassembly")),
             m_log(I2P_LOG_CHANNEL("IMF")) {}
 
         void InboundMessageFragments::receiveData(RouterHash const &rh, ByteArrayConstItr &begin, ByteArrayConstItr end)
         {
-            I2P_LOG_SCOPED_TAG(m_log, "RouterHash", rh);
-
             if(std::distance(begin, end) < 1) throw std::runtime_error("malformed SSU data message: 0 length");
             std::bitset<8> flag = *(begin++);
 
@@ -38,7 +39,7 @@ namespace i2pcpp {
                     uint32_t msgId = parseUint32(begin);
 
                     std::lock_guard<std::mutex> lock(m_context.omf.m_mutex);
-                    m_context.omf.delState(msgId);
+                    m_context.omf.ackState(msgId);
                 }
             }
 
@@ -67,48 +68,51 @@ namespace i2pcpp {
                     } while(*(begin++) & (1 << 7));
 
                     if(itr != m_context.omf.m_states.end() && itr->second.allFragmentsAckd())
-                        m_context.omf.delState(msgId);
+                        m_context.omf.ackState(msgId);
                 }
             }
 
             if(std::distance(begin, end) < 1) throw std::runtime_error("malformed SSU data message: no body");
             unsigned char numFragments = *(begin++);
-            I2P_LOG(m_log, debug) << "number of fragments: " << std::to_string(numFragments);
+            I2P_LOG_TAGGED(m_log, debug, "RouterHash", rh) << "number of fragments: " << std::to_string(numFragments);
 
             for(int i = 0; i < numFragments; i++) {
                 if(std::distance(begin, end) < 7) throw std::runtime_error("malformed SSU data message: length of body < 7");
                 uint32_t msgId = parseUint32(begin);
-                I2P_LOG(m_log, debug) << "fragment[" << i << "] message id: " << std::hex << msgId << std::dec;
+                I2P_LOG_TAGGED(m_log, debug, "RouterHash", rh) << "fragment[" << i << "] message id: " << std::hex << msgId << std::dec;
 
                 uint32_t fragInfo = (begin[0] << 16) | (begin[1] << 8) | (begin[2]);
                 begin += 3;
 
                 uint16_t fragNum = fragInfo >> 17;
-                I2P_LOG(m_log, debug) << "fragment[" << i << "] fragment #: " << fragNum;
+                I2P_LOG_TAGGED(m_log, debug, "RouterHash", rh) << "fragment[" << i << "] fragment #: " << fragNum;
 
                 bool isLast = (fragInfo & 0x010000);
-                I2P_LOG(m_log, debug) << "fragment[" << i << "] isLast: " << isLast;
+                I2P_LOG_TAGGED(m_log, debug, "RouterHash", rh) << "fragment[" << i << "] isLast: " << isLast;
 
                 uint16_t fragSize = fragInfo & ((1 << 14) - 1);
-                I2P_LOG(m_log, debug) << "fragment[" << i << "] size: " << fragSize;
+                I2P_LOG_TAGGED(m_log, debug, "RouterHash", rh) << "fragment[" << i << "] size: " << fragSize;
 
                 if(std::distance(begin, end) < fragSize) throw std::runtime_error("malformed SSU data message: length < fragSize");
-                ByteArray fragData(begin, begin + fragSize);
-                I2P_LOG(m_log, debug) << "fragment[" << i << "] data: " << fragData;
 
                 std::lock_guard<std::mutex> lock(m_mutex);
                 auto itr = m_states.get<0>().find(msgId);
-                if(itr == m_states.get<0>().end()) {
+                if(itr != m_states.get<0>().end())
+                    m_states.get<0>().modify(itr, AddFragment(*this, fragNum, begin, begin + fragSize, isLast));
+                else if(m_completed.contains(rh, msgId)) {
+                    // Still ACK'd below, the sender evidently missed our ACK
+                    I2P_LOG_TAGGED(m_log, debug, "RouterHash", rh) << "dropping fragment of delivered message " << std::hex << msgId << std::dec;
+                } else {
                     InboundMessageState ims(rh, msgId);
-                    ims.addFragment(fragNum, fragData, isLast);
+                    if(ims.addFragment(fragNum, begin, begin + fragSize, isLast))
+                        checkAndPost(msgId, ims);
 
-                    checkAndPost(msgId, ims);
                     addState(msgId, rh, std::move(ims));
-                } else {
-                    m_states.get<0>().modify(itr, AddFragment(fragNum, fragData, isLast));
-
-                    checkAndPost(msgId, itr->state);
                 }
+
+                m_context.ackManager.fragmentReceived(rh, msgId);
+
+                begin += fragSize;
             }
         }
 
@@ -138,26 +142,39 @@ namespace i2pcpp {
             }
         }
 
-        inline void InboundMessageFragments::checkAndPost(const uint32_t msgId, InboundMessageState const &ims)
+        inline void InboundMessageFragments::checkAndPost(const uint32_t msgId, InboundMessageState &ims)
         {
             if(ims.allFragmentsReceived()) {
-                const ByteArray& data = ims.assemble();
-                if(data.size())
-                    m_context.ios.post(boost::bind(boost::ref(m_context.receivedSignal), ims.getRouterHash(), msgId, data));
+                m_completed.insert(ims.getRouterHash(), msgId);
+
+                // Messages which fit in one fragment would only add zeroes
+                if(ims.getFragmentsReceived().count() > 1)
+                    m_reassemblyTime.record(Metrics::now() - ims.getCreated());
+
+                // The buffer is moved, not copied, all the way to the handlers
+                auto data = std::make_shared<const ByteArray>(ims.assemble());
+                if(data->size()) {
+                    Transport::ReceivedSignal &signal = m_context.receivedSignal;
+                    const RouterHash rh = ims.getRouterHash();
+                    m_context.ios.post([&signal, rh, msgId, data]() { signal(rh, msgId, *data); });
+                }
             }
         }
 
         InboundMessageFragments::ContainerEntry::ContainerEntry(InboundMessageState ims) :
             state(std::move(ims)) {}
 
-        InboundMessageFragments::AddFragment::AddFragment(const uint8_t fragNum, ByteArray const &data, bool isLast) :
+        InboundMessageFragments::AddFragment::AddFragment(InboundMessageFragments &imf, const uint8_t fragNum, ByteArrayConstItr begin, ByteArrayConstItr end, bool isLast) :
+            m_imf(imf),
             m_fragNum(fragNum),
-            m_data(data),
+            m_begin(begin),
+            m_end(end),
             m_isLast(isLast) {}
 
         void InboundMessageFragments::AddFragment::operator()(ContainerEntry &ce)
         {
-            ce.state.addFragment(m_fragNum, m_data, m_isLast);
+            if(ce.state.addFragment(m_fragNum, m_begin, m_end, m_isLast))
+                m_imf.checkAndPost(ce.msgId, ce.state);
         }
     }
 }
@@ -5,9 +5,11 @@
 #ifndef SSUINBOUNDMESSAGEFRAGMENTS_H
 #define SSUINBOUNDMESSAGEFRAGMENTS_H
 
+#include "CompletedMessages.h"
 #include "InboundMessageState.h"
 
 #include <i2pcpp/Log.h>
+#include <i2pcpp/util/Metrics.h>
 
 #include <i2pcpp/datatypes/ByteArray.h>
 
@@ -81,10 +83,12 @@ namespace i2pcpp {
 
                 /**
                  * Checks whether all fragements for a given state \a ims have
-                 *  been receieved and, if so, posts to the IO service that the
-                 *  received signal (in i2pcpp::UDPTransport) should be invoked.
+                 *  been receieved and, if so, moves the message out of it,
+                 *  remembers it as completed and posts to the IO service that
+                 *  the received signal (in i2pcpp::UDPTransport) should be
+                 *  invoked.
                  */
-                void checkAndPost(const uint32_t msgId, InboundMessageState const &ims);
+                void checkAndPost(const uint32_t msgId, InboundMessageState &ims);
 
                 /**
                  * Defines the structure used for an entry in the
@@ -107,17 +111,21 @@ namespace i2pcpp {
                  */
                 class AddFragment {
                     public:
-                        AddFragment(const uint8_t fragNum, ByteArray const &data, bool isLast);
+                        AddFragment(InboundMessageFragments &imf, const uint8_t fragNum, ByteArrayConstItr begin, ByteArrayConstItr end, bool isLast);
 
                         /**
                          * Adds the fragment to the state of the given
-                         *  InboundMessageFragments::ContainerEntry.
+                         *  InboundMessageFragments::ContainerEntry and, if
+                         *  it was not a duplicate, calls
+                         *  InboundMessageFragments::checkAndPost.
                          */
                         void operator()(ContainerEntry &ce);
 
                     private:
+                        InboundMessageFragments& m_imf;
                         uint8_t m_fragNum;
-                        ByteArray m_data;
+                        ByteArrayConstItr m_begin;
+                        ByteArrayConstItr m_end;
                         bool m_isLast;
                 };
 
@@ -135,10 +143,15 @@ namespace i2pcpp {
 
                 StateContainer m_states;
 
+                /// Messages already delivered, whose late fragments are dropped
+                CompletedMessages m_completed;
+
                 mutable std::mutex m_mutex;
 
+                /// Time from the first to the last fragment of a fragmented message
+                Metrics::Histogram &m_reassemblyTime;
+
                 i2p_logger_mt m_log;
-                // TODO Decaying bloom filter
         };
     }
 }
@@ -4,48 +4,71 @@
  */
 #include "InboundMessageState.h"
 
+#include <i2pcpp/util/Metrics.h>
+
+#include <algorithm>
+
 namespace i2pcpp {
     namespace SSU {
         InboundMessageState::InboundMessageState(RouterHash const &rh, const uint32_t msgId) :
             m_routerHash(rh),
-            m_msgId(msgId) {}
+            m_msgId(msgId),
+            m_created(Metrics::now()) {}
 
-        void InboundMessageState::addFragment(const uint8_t fragNum, ByteArray const &data, bool isLast)
+        bool InboundMessageState::addFragment(const uint8_t fragNum, ByteArrayConstItr begin, ByteArrayConstItr end, bool isLast)
         {
-            if(m_gotLast && fragNum > m_lastFragment)
-                return; // TODO Exception -- trying to give us a fragment greater than last
+            if(fragNum >= MAX_FRAGMENTS || m_received[fragNum])
+                return false;
+
+            if(m_gotLast && (fragNum > m_lastFragment || isLast))
+                return false;
 
-            if(fragNum < m_fragments.size() && m_fragments[fragNum])
-                return; // TODO Exception -- already got thsi fragment
+            const uint16_t size = std::distance(begin, end);
 
             if(isLast) {
+                if((m_received >> (fragNum + 1)).any())
+                    return false;
+
                 m_gotLast = true;
                 m_lastFragment = fragNum;
-            }
+                m_lastSize = size;
 
-            if(m_fragments.size() < (uint8_t)(fragNum + 1))
-                m_fragments.resize(fragNum + 1);
+                if(fragNum && !m_fragmentSize) {
+                    // We don't know where it goes yet, keep it at the front
+                    // until the first non-last fragment arrives.
+                    m_buffer.assign(begin, end);
+                    m_received[fragNum] = true;
+                    ++m_numReceived;
 
-            auto f = std::make_shared<ByteArray>(data);
-            m_fragments[fragNum] = f;
+                    return true;
+                }
+            } else {
+                if(!size)
+                    return false;
 
-            m_byteTotal += data.size();
-        }
+                if(!m_fragmentSize) {
+                    m_fragmentSize = size;
 
-        ByteArray InboundMessageState::assemble() const
-        {
-            ByteArray dst(m_byteTotal);
-
-            auto itr = dst.begin();
-            for(auto& fp: m_fragments)
-            {
-                if(fp) {
-                    copy(fp->cbegin(), fp->cend(), itr);
-                    itr += fp->size();
-                }
+                    if(m_gotLast && m_lastFragment) {
+                        // Move the stashed last fragment to its offset
+                        const size_t offset = m_lastFragment * m_fragmentSize;
+                        m_buffer.resize(offset + m_lastSize);
+                        std::copy_backward(m_buffer.begin(), m_buffer.begin() + m_lastSize, m_buffer.end());
+                    }
+                } else if(size != m_fragmentSize)
+                    return false;
             }
 
-            return dst;
+            write(fragNum, begin, end);
+            m_received[fragNum] = true;
+            ++m_numReceived;
+
+            return true;
+        }
+
+        ByteArray InboundMessageState::assemble()
+        {
+            return std::move(m_buffer);
         }
 
         RouterHash InboundMessageState::getRouterHash() const
@@ -60,23 +83,31 @@ namespace i2pcpp {
 
         bool InboundMessageState::allFragmentsReceived() const
         {
-            if(!m_gotLast) return false;
+            return m_gotLast && m_numReceived == m_lastFragment + 1;
+        }
 
-            for(auto f: m_fragments)
-                if(!f)
-                    return false;
+        std::bitset<128> const &InboundMessageState::getFragmentsReceived() const
+        {
+            return m_received;
+        }
 
-            return true;
+        uint64_t InboundMessageState::getCreated() const
+        {
+            return m_created;
         }
 
-        std::vector<bool> InboundMessageState::getFragmentsReceived() const
+        void InboundMessageState::write(const uint8_t fragNum, ByteArrayConstItr begin, ByteArrayConstItr end)
         {
-            std::vector<bool> v(m_fragments.size());
+            const size_t offset = fragNum * m_fragmentSize;
+
+            size_t total = offset + std::distance(begin, end);
+            if(m_gotLast)
+                total = m_lastFragment * m_fragmentSize + m_lastSize;
 
-            for(unsigned int i = 0; i < m_fragments.size(); i++)
-                v[i] = (m_fragments[i] != ByteArrayPtr());
+            if(m_buffer.size() < total)
+                m_buffer.resize(total);
 
-            return v;
+            std::copy(begin, end, m_buffer.begin() + offset);
         }
     }
 }
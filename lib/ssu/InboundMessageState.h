@@ -6,12 +6,19 @@
 #define SSUINBOUNDMESSAGESTATE_H
 
 #include <i2pcpp/datatypes/RouterHash.h>
+#include <i2pcpp/datatypes/ByteArray.h>
+
+#include <bitset>
 
 namespace i2pcpp {
     namespace SSU {
         /**
          * Stores the state of a message that has been received
          *  (partially or funny) or is to be received.
+         * Fragments are written straight into a single buffer at their
+         *  final offset. Every fragment but the last has the same size, so
+         *  the offset of fragment i is i times that size. Which fragments
+         *  have arrived is tracked in a fixed size bitmap.
          */
         class InboundMessageState {
             public:
@@ -20,18 +27,23 @@ namespace i2pcpp {
                 /**
                  * Adds a fragment to the message we are receiving.
                  * @param fragNum the ID of the fragment
-                 * @param data the actual fragment data
+                 * @param begin iterator to the begin of the fragment data
+                 * @param end iterator to the end of the fragment data
                  * @param isLast true indicates that his packet is the last,
                  *  false otherwise
-                 * @todo add exceptions
+                 * @return true if the fragment was added, false if it is a
+                 *  duplicate or inconsistent with the fragments we already have
                  */
-                void addFragment(const uint8_t fragNum, ByteArray const &data, bool isLast);
+                bool addFragment(const uint8_t fragNum, ByteArrayConstItr begin, ByteArrayConstItr end, bool isLast);
 
                 /**
-                 * Merges all fragments into a single i2pcpp::ByteArray containing
-                 *  all of the message's data.
+                 * Moves the reassembled message out of this object. No data
+                 *  is copied. Only the received bitmap is kept afterwards, so
+                 *  this should be called once, after
+                 *  i2pcpp::SSU::InboundMessageState::allFragmentsReceived
+                 *  returns true.
                  */
-                ByteArray assemble() const;
+                ByteArray assemble();
 
                 /**
                  * @return the i2pcpp::RouterHash of the sending router
@@ -51,22 +63,42 @@ namespace i2pcpp {
                 bool allFragmentsReceived() const;
 
                 /**
-                 * @return a std::vector<bool> where the element at index i
-                 *  is a boolean that indicates whether fragment i has been
-                 *  received (true if this is the case).
+                 * @return a bitmap where bit i indicates whether fragment i
+                 *  has been received.
                  */
-                std::vector<bool> getFragmentsReceived() const;
+                std::bitset<128> const &getFragmentsReceived() const;
+
+                /**
+                 * @return the time the first fragment was received, as
+                 *  given by i2pcpp::Metrics::now
+                 */
+                uint64_t getCreated() const;
+
+                /// Maximum number of fragments in a message (7 bit fragment number)
+                static const uint8_t MAX_FRAGMENTS = 128;
 
             private:
+                /**
+                 * Copies fragment data into the buffer at the offset of
+                 *  fragment \a fragNum, growing the buffer if needed.
+                 */
+                void write(const uint8_t fragNum, ByteArrayConstItr begin, ByteArrayConstItr end);
+
                 RouterHash m_routerHash; ///< i2pcpp::RouterHash of the sending router
 
                 uint32_t m_msgId; ///< ID of associatedmessage
                 bool m_gotLast = false;
-                uint8_t m_lastFragment;
-                uint32_t m_byteTotal = 0;
+                uint8_t m_lastFragment = 0;
+                uint16_t m_lastSize = 0;
+                uint16_t m_fragmentSize = 0; ///< Size of every fragment except the last
+                uint8_t m_numReceived = 0;
+                uint64_t m_created;
+
+                /// Bit i is set if fragment i has been received
+                std::bitset<128> m_received;
 
-                /// Stores pointers to the fragment data
-                std::vector<ByteArrayPtr> m_fragments;
+                /// Message data, fragments are written at their final offset
+                ByteArray m_buffer;
         };
 
         typedef std::shared_ptr<InboundMessageState> InboundMessageStatePtr;
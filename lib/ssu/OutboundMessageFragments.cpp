@@ -11,6 +11,9 @@
 namespace i2pcpp {
     namespace SSU {
         OutboundMessageFragments::OutboundMessageFragments(Context &c) :
+            m_fragmentsSent(0),
+            m_fragmentsRetransmitted(0),
+            m_ackTime(Metrics::histogram("latency.ssu.ack_rtt")),
             m_context(c) {}
 
         void OutboundMessageFragments::sendData(PeerState const &ps, uint32_t const msgId, ByteArray const &data)
@@ -18,19 +21,68 @@ namespace i2pcpp {
             auto timer = std::make_unique<boost::asio::deadline_timer>(m_context.ios, boost::posix_time::time_duration(0, 0, 2));
             timer->async_wait(boost::bind(&OutboundMessageFragments::timerCallback, this, boost::asio::placeholders::error, ps, msgId));
 
-            OutboundMessageState oms(msgId, data);
+            OutboundMessageState oms(msgId, data, ps.getHash());
             oms.setTimer(std::move(timer));
 
             std::lock_guard<std::mutex> lock(m_mutex);
             uint32_t tmp = msgId;
-            m_states.emplace(std::make_pair(std::move(tmp), std::move(oms)));
+            if(m_states.emplace(std::make_pair(std::move(tmp), std::move(oms))).second)
+                ++m_inFlight[ps.getHash()];
 
             m_context.ios.post(boost::bind(&OutboundMessageFragments::sendDataCallback, this, ps, msgId));
         }
 
+        uint64_t OutboundMessageFragments::getFragmentsSent() const
+        {
+            return m_fragmentsSent;
+        }
+
+        uint64_t OutboundMessageFragments::getFragmentsRetransmitted() const
+        {
+            return m_fragmentsRetransmitted;
+        }
+
+        uint32_t OutboundMessageFragments::getInFlight(RouterHash const &rh) const
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            auto itr = m_inFlight.find(rh);
+            return (itr != m_inFlight.end() ? itr->second : 0);
+        }
+
         void OutboundMessageFragments::delState(const uint32_t msgId)
         {
-            m_states.erase(msgId);
+            auto itr = m_states.find(msgId);
+            if(itr != m_states.end())
+                release(itr);
+        }
+
+        void OutboundMessageFragments::ackState(const uint32_t msgId)
+        {
+            auto itr = m_states.find(msgId);
+            if(itr == m_states.end())
+                return;
+
+            if(itr->second.getFirstSent())
+                m_ackTime.record(Metrics::now() - itr->second.getFirstSent());
+
+            release(itr);
+        }
+
+        void OutboundMessageFragments::release(std::map<uint32_t, OutboundMessageState>::iterator itr)
+        {
+            const RouterHash to = itr->second.getTo();
+            m_states.erase(itr);
+
+            auto peer = m_inFlight.find(to);
+            if(peer == m_inFlight.end())
+                return;
+
+            if(peer->second-- >= MAX_IN_FLIGHT)
+                m_context.ios.post(boost::bind(boost::ref(m_context.readySignal), to));
+
+            if(!peer->second)
+                m_inFlight.erase(peer);
         }
 
         void OutboundMessageFragments::sendDataCallback(PeerState ps, uint32_t const msgId)
@@ -55,6 +107,7 @@ namespace i2pcpp {
                 PacketPtr p = PacketBuilder::buildData(ps.getEndpoint(), false, CompleteAckList(), PartialAckList(), fragList);
                 p->encrypt(ps.getCurrentSessionKey(), ps.getCurrentMacKey());
                 m_context.sendPacket(p);
+                ++m_fragmentsSent;
 
                 if(!oms.allFragmentsSent())
                     m_context.ios.post(boost::bind(&OutboundMessageFragments::sendDataCallback, this, ps, msgId));
@@ -71,7 +124,7 @@ namespace i2pcpp {
                     OutboundMessageState& oms = itr->second;
 
                     if(oms.getTries() > 5) {
-                        m_states.erase(msgId);
+                        release(itr);
                         return;
                     }
 
@@ -85,6 +138,8 @@ namespace i2pcpp {
                         PacketPtr p = PacketBuilder::buildData(ps.getEndpoint(), false, CompleteAckList(), PartialAckList(), fragList);
                         p->encrypt(ps.getCurrentSessionKey(), ps.getCurrentMacKey());
                         m_context.sendPacket(p);
+                        ++m_fragmentsSent;
+                        ++m_fragmentsRetransmitted;
 
                         oms.incrementTries();
 
@@ -7,7 +7,11 @@
 
 #include "OutboundMessageState.h"
 
+#include <i2pcpp/util/Metrics.h>
+
+#include <atomic>
 #include <mutex>
+#include <unordered_map>
 
 namespace i2pcpp {
     namespace SSU {
@@ -34,6 +38,32 @@ namespace i2pcpp {
                  */
                 void sendData(PeerState const &ps, uint32_t const msgId, ByteArray const &data);
 
+                /**
+                 * @return the number of data fragments sent, including
+                 *  retransmissions
+                 */
+                uint64_t getFragmentsSent() const;
+
+                /**
+                 * @return the number of data fragments that were
+                 *  retransmitted because they were not ACK'd in time
+                 */
+                uint64_t getFragmentsRetransmitted() const;
+
+                /**
+                 * @return the number of messages to \a rh which have been
+                 *  sent but not ACK'd or given up on yet
+                 */
+                uint32_t getInFlight(RouterHash const &rh) const;
+
+                /**
+                 * Number of messages in flight to a peer at which the
+                 *  transport asks to be sent no more. Messages sent beyond
+                 *  it still go out, the limit is for the dispatcher, which
+                 *  then decides which of its queued messages go first.
+                 */
+                static const uint32_t MAX_IN_FLIGHT = 16;
+
             private:
                 /**
                  * Removes a state from the states std::map, OutboundMessageFragments::m_states.
@@ -41,6 +71,22 @@ namespace i2pcpp {
                  */
                 void delState(const uint32_t msgId);
 
+                /**
+                 * Removes the state of a message which has been ACK'd
+                 *  completely and records the time since its first fragment
+                 *  was sent. Unknown message IDs, such as duplicate ACKs,
+                 *  are ignored.
+                 * @param msgId the message ID of the state to be deleted
+                 */
+                void ackState(const uint32_t msgId);
+
+                /**
+                 * Removes the state at \a itr and signals the transport has
+                 *  room again if its peer had reached MAX_IN_FLIGHT. Must be
+                 *  called with m_mutex held.
+                 */
+                void release(std::map<uint32_t, OutboundMessageState>::iterator itr);
+
                 /**
                  * Iterates over all of the states and sends the (incomplete) messages
                  *  using the i2pcpp::UDPTranport. If not all of the fragments have
@@ -59,8 +105,17 @@ namespace i2pcpp {
 
                 std::map<uint32_t, OutboundMessageState> m_states;
 
+                /// Messages in flight to each peer which has any
+                std::unordered_map<RouterHash, uint32_t> m_inFlight;
+
                 mutable std::mutex m_mutex;
 
+                std::atomic<uint64_t> m_fragmentsSent;
+                std::atomic<uint64_t> m_fragmentsRetransmitted;
+
+                /// Time from sending the first fragment of a message to its ACK
+                Metrics::Histogram &m_ackTime;
+
                 Context& m_context;
         };
     }
@@ -5,12 +5,14 @@
 #include "OutboundMessageState.h"
 
 #include <i2pcpp/Log.h>
+#include <i2pcpp/util/Metrics.h>
 
 namespace i2pcpp {
     namespace SSU {
-        OutboundMessageState::OutboundMessageState(uint32_t msgId, ByteArray const &data) :
+        OutboundMessageState::OutboundMessageState(uint32_t msgId, ByteArray const &data, RouterHash const &to) :
             m_msgId(msgId),
             m_data(data),
+            m_to(to),
             m_fragments() {}
 
         void OutboundMessageState::fragment()
@@ -69,6 +71,9 @@ namespace i2pcpp {
                 return;
 
             m_fragments[fragNum].second.sent = true;
+
+            if(!m_firstSent)
+                m_firstSent = Metrics::now();
         }
 
         void OutboundMessageState::markFragmentAckd(const uint8_t fragNum)
@@ -105,6 +110,11 @@ namespace i2pcpp {
             return m_msgId;
         }
 
+        RouterHash OutboundMessageState::getTo() const
+        {
+            return m_to;
+        }
+
         void OutboundMessageState::incrementTries()
         {
             ++m_tries;
@@ -115,6 +125,11 @@ namespace i2pcpp {
             return m_tries;
         }
 
+        uint64_t OutboundMessageState::getFirstSent() const
+        {
+            return m_firstSent;
+        }
+
         void OutboundMessageState::setTimer(std::unique_ptr<boost::asio::deadline_timer> t)
         {
             m_timer = std::move(t);
@@ -10,6 +10,7 @@
 #include <boost/asio.hpp>
 
 #include <i2pcpp/datatypes/ByteArray.h>
+#include <i2pcpp/datatypes/RouterHash.h>
 
 #include <vector>
 #include <utility>
@@ -30,7 +31,7 @@ namespace i2pcpp {
                 };
                 typedef std::pair<PacketBuilder::FragmentPtr, FragmentFlags> FragmentState;
 
-                OutboundMessageState(uint32_t msgId, ByteArray const &data);
+                OutboundMessageState(uint32_t msgId, ByteArray const &data, RouterHash const &to);
                 OutboundMessageState(OutboundMessageState &&) = default;
 
                 /**
@@ -69,6 +70,12 @@ namespace i2pcpp {
                  */
                 uint32_t getMsgId() const;
 
+                /**
+                 * @return the i2pcpp::RouterHash of the peer the message is
+                 *  sent to
+                 */
+                RouterHash getTo() const;
+
                 /**
                  * Increases the amount of times we tried to send.
                  */
@@ -79,6 +86,12 @@ namespace i2pcpp {
                  */
                 uint8_t getTries() const;
 
+                /**
+                 * @return the time the first fragment was sent, as given by
+                 *  i2pcpp::Metrics::now, or 0 if none was sent yet
+                 */
+                uint64_t getFirstSent() const;
+
                 void setTimer(std::unique_ptr<boost::asio::deadline_timer> t);
                 boost::asio::deadline_timer& getTimer();
 
@@ -87,8 +100,10 @@ namespace i2pcpp {
 
                 uint32_t m_msgId;
                 ByteArray m_data;
+                RouterHash m_to;
                 std::vector<FragmentState> m_fragments;
                 uint8_t m_tries = 0;
+                uint64_t m_firstSent = 0;
 
                 std::unique_ptr<boost::asio::deadline_timer> m_timer;
         };
@@ -4,12 +4,12 @@
  */
 #include "Packet.h"
 
-#include <botan/auto_rng.h>
 #include <botan/pipe.h>
 #include <botan/md5.h>
 
 #include <i2pcpp/util/I2PHMAC.h>
 #include <i2pcpp/util/Base64.h>
+#include <i2pcpp/util/Random.h>
 
 namespace i2pcpp {
     namespace SSU {
@@ -64,10 +64,10 @@ namespace i2pcpp {
 
         void Packet::encrypt(SessionKey const &sk, SessionKey const &mk)
         {
-            Botan::AutoSeeded_RNG rng;
-            Botan::InitializationVector iv(rng, 16);
+            unsigned char iv[16];
+            Random::randomize(iv, sizeof(iv));
 
-            encrypt(iv, sk, mk);
+            encrypt(Botan::InitializationVector(iv, sizeof(iv)), sk, mk);
         }
 
         void Packet::encrypt(Botan::InitializationVector const &iv, SessionKey const &sk, SessionKey const &mk)
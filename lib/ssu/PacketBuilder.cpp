@@ -11,6 +11,7 @@
 
 #include <i2pcpp/datatypes/RouterIdentity.h>
 
+#include <algorithm>
 #include <chrono>
 
 namespace i2pcpp {
@@ -142,7 +143,10 @@ namespace i2pcpp {
                 ba.insert(ba.end(), m.first);
 
                 size_t numBits = m.second.size();
-                size_t steps = std::ceil(numBits / 7.0);
+                while(numBits && !m.second[numBits - 1])
+                    --numBits;
+
+                size_t steps = std::max<size_t>(std::ceil(numBits / 7.0), 1);
 
                 for(size_t i = 0; i < steps; i++) {
                     uint8_t byte = 0;
@@ -150,7 +154,8 @@ namespace i2pcpp {
                     if((i + 1) < steps)
                         byte |= (1 << 7);
 
-                    for(int j = 6, k = (i * 7); j >= 0 && k < numBits; j--, k++) {
+                    size_t k = i * 7;
+                    for(int j = 6; j >= 0 && k < numBits; j--, k++) {
                         if(m.second[k])
                             byte |= (1 << j);
                     }
@@ -7,6 +7,7 @@
 
 #include <i2pcpp/datatypes/ByteArray.h>
 
+#include <bitset>
 #include <vector>
 #include <map>
 
@@ -18,7 +19,7 @@ namespace i2pcpp {
         class EstablishmentState; typedef std::shared_ptr<EstablishmentState> EstablishmentStatePtr;
 
         typedef std::vector<uint32_t> CompleteAckList;
-        typedef std::map<uint32_t, std::vector<bool>> PartialAckList;
+        typedef std::map<uint32_t, std::bitset<128>> PartialAckList;
 
         /**
          * Class with static methods to build i2pcpp::SSU::Packet objects.
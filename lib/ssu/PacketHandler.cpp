@@ -7,24 +7,29 @@
 #include "EstablishmentState.h"
 #include "Context.h"
 
+#include <chrono>
+
 namespace i2pcpp {
     namespace SSU {
         PacketHandler::PacketHandler(Context &c, SessionKey const &sk) :
             m_context(c),
             m_inboundKey(sk),
             m_imf(c),
+            m_establishmentFilter(ReplayFilter::ESTABLISHMENT_BITS, ReplayFilter::ESTABLISHMENT_CAPACITY, std::chrono::seconds(ReplayFilter::WINDOW)),
+            m_replayed(0),
+            m_skewed(0),
+            m_decryptTime(Metrics::histogram("latency.ssu.decrypt")),
             m_log(I2P_LOG_CHANNEL("PH")) {}
 
         void PacketHandler::packetReceived(PacketPtr p)
         {
-            I2P_LOG_SCOPED_TAG(m_log, "Endpoint", p->getEndpoint());
-
             auto ep = p->getEndpoint();
 
             std::lock_guard<std::mutex> lock(m_context.peers.getMutex());
 
             if(m_context.peers.peerExists(ep)) {
-                handlePacket(p, m_context.peers.getPeer(ep));
+                PeerState ps = m_context.peers.getPeer(ep);
+                handlePacket(p, ps);
             } else if( m_context.acceptingNewPeers ){
                 EstablishmentStatePtr es = m_context.establishmentManager.getState(ep);
                 if(es)
@@ -32,36 +37,73 @@ namespace i2pcpp {
                 else
                     handlePacket(p);
             } else {
-                I2P_LOG(m_log, debug) << "dropping inbound request from remote peer, graceful shutdown initiated";
+                I2P_LOG_TAGGED(m_log, debug, "Endpoint", ep) << "dropping inbound request from remote peer, graceful shutdown initiated";
             }
         }
 
-        void PacketHandler::handlePacket(PacketPtr const &packet, PeerState const &state)
+        void PacketHandler::handlePacket(PacketPtr const &packet, PeerState &state)
         {
-            if(!packet->verify(state.getCurrentMacKey())) {
-                I2P_LOG(m_log, error) << "packet verification failed";
+            if(isReplay(packet, state.getReplayFilter()))
                 return;
+
+            SessionKey sessionKey = state.getCurrentSessionKey();
+
+            if(packet->verify(state.getCurrentMacKey())) {
+                if(!state.keysConfirmed())
+                    m_context.peers.confirmKeys(state.getHash());
+            } else if(state.hasPendingKeys() && packet->verify(state.getNextMacKey())) {
+                // The peer got our SessionConfirmed and switched
+                I2P_LOG_TAGGED(m_log, debug, "Endpoint", packet->getEndpoint()) << "peer switched to the new session keys";
+                sessionKey = state.getNextSessionKey();
+                m_context.peers.confirmKeys(state.getHash());
+            } else if(state.inGraceWindow() && packet->verify(state.getPreviousMacKey()))
+                sessionKey = state.getPreviousSessionKey();
+            else {
+                // The peer may be establishing a new session with us
+                EstablishmentStatePtr es = m_context.establishmentManager.getState(state.getEndpoint());
+                if(es)
+                    handlePacket(packet, es);
+                else if(m_context.acceptingNewPeers) {
+                    PacketPtr p = packet;
+                    handlePacket(p);
+                }
+
+                return;
+            }
+
+            state.getReplayFilter().insert(packet->getData().data() + 16);
+
+            if(m_context.peers.touchPeer(state.getHash()) && !m_context.establishmentManager.stateExists(state.getEndpoint())) {
+                if(state.hasPendingKeys())
+                    I2P_LOG_TAGGED(m_log, info, "Endpoint", packet->getEndpoint()) << "peer never used the keys of the last rekey, rekeying again";
+                else
+                    I2P_LOG_TAGGED(m_log, debug, "Endpoint", packet->getEndpoint()) << "rekeying session";
+
+                m_context.establishmentManager.createState(state.getEndpoint(), state.getIdentity(), true);
             }
 
-            m_context.peers.resetPeerTimer(state.getHash());
+            {
+                Metrics::ScopedTimer t(m_decryptTime);
+                packet->decrypt(sessionKey);
+            }
 
-            packet->decrypt(state.getCurrentSessionKey());
             ByteArray &data = packet->getData();
 
             auto dataItr = data.cbegin();
             unsigned char flag = *(dataItr++);
             Packet::PayloadType ptype = (Packet::PayloadType)(flag >> 4);
 
-            dataItr += 4; // TODO validate timestamp
+            if(!checkTimestamp(packet, dataItr))
+                return;
 
             switch(ptype) {
                 case Packet::PayloadType::DATA:
-                    I2P_LOG(m_log, debug) << "data packet received";
+                    I2P_LOG_TAGGED(m_log, debug, "Endpoint", packet->getEndpoint()) << "data packet received";
                     m_imf.receiveData(state.getHash(), dataItr, data.cend());
                     break;
 
                 case Packet::PayloadType::SESSION_DESTROY:
-                    I2P_LOG(m_log, debug) << "received session destroy";
+                    I2P_LOG_TAGGED(m_log, debug, "Endpoint", packet->getEndpoint()) << "received session destroy";
                     handleSessionDestroyed(state);
                     break;
 
@@ -72,12 +114,17 @@ namespace i2pcpp {
 
         void PacketHandler::handlePacket(PacketPtr const &packet, EstablishmentStatePtr const &state)
         {
+            if(isReplay(packet, m_establishmentFilter))
+                return;
+
             if(!packet->verify(state->getMacKey())) {
-                I2P_LOG(m_log, error) << "packet verification failed";
+                I2P_LOG_TAGGED(m_log, error, "Endpoint", packet->getEndpoint()) << "packet verification failed";
                 return;
             }
 
             ByteArray &data = packet->getData();
+            m_establishmentFilter.insert(data.data() + 16);
+
             if(state->getDirection() == EstablishmentState::Direction::OUTBOUND)
                 state->setIV(data.begin() + 16, data.begin() + 32);
 
@@ -88,7 +135,8 @@ namespace i2pcpp {
             unsigned char flag = *(begin++);
             Packet::PayloadType ptype = (Packet::PayloadType)(flag >> 4);
 
-            begin += 4; // TODO validate timestamp
+            if(!checkTimestamp(packet, begin))
+                return;
 
             switch(ptype) {
                 case Packet::PayloadType::SESSION_CREATED:
@@ -100,7 +148,7 @@ namespace i2pcpp {
                     break;
 
                 case Packet::PayloadType::SESSION_DESTROY:
-                    I2P_LOG(m_log, debug) << "received session destroy";
+                    I2P_LOG_TAGGED(m_log, debug, "Endpoint", packet->getEndpoint()) << "received session destroy";
                     handleSessionDestroyed(state);
                     break;
 
@@ -113,11 +161,16 @@ namespace i2pcpp {
         {
             Endpoint ep = p->getEndpoint();
 
+            if(isReplay(p, m_establishmentFilter))
+                return;
+
             if(!p->verify(m_inboundKey)) {
-                I2P_LOG(m_log, error) << "dropping new packet with invalid key";
+                I2P_LOG_TAGGED(m_log, error, "Endpoint", p->getEndpoint()) << "dropping new packet with invalid key";
                 return;
             }
 
+            m_establishmentFilter.insert(p->getData().data() + 16);
+
             p->decrypt(m_inboundKey);
             ByteArray &data = p->getData();
 
@@ -127,15 +180,20 @@ namespace i2pcpp {
             unsigned char flag = *(dataItr++);
             Packet::PayloadType ptype = (Packet::PayloadType)(flag >> 4);
 
-            dataItr += 4; // TODO validate timestamp
+            if(!checkTimestamp(p, dataItr))
+                return;
 
             switch(ptype) {
                 case Packet::PayloadType::SESSION_REQUEST:
-                    handleSessionRequest(dataItr, end, m_context.establishmentManager.createState(ep));
+                    {
+                        EstablishmentStatePtr es = m_context.establishmentManager.createState(ep);
+                        es->setRekey(m_context.peers.peerExists(ep));
+                        handleSessionRequest(dataItr, end, es);
+                    }
                     break;
 
                 default:
-                    I2P_LOG(m_log, error) << "dropping new, out-of-state packet";
+                    I2P_LOG_TAGGED(m_log, error, "Endpoint", p->getEndpoint()) << "dropping new, out-of-state packet";
             }
         }
 
@@ -223,5 +281,47 @@ namespace i2pcpp {
             state->setState(EstablishmentState::State::FAILURE);
             m_context.establishmentManager.post(state);
         }
+
+        uint64_t PacketHandler::getReplayedCount() const
+        {
+            return m_replayed;
+        }
+
+        uint64_t PacketHandler::getSkewedCount() const
+        {
+            return m_skewed;
+        }
+
+        bool PacketHandler::isTimely(uint32_t timestamp, uint32_t now)
+        {
+            uint32_t skew = (timestamp > now) ? timestamp - now : now - timestamp;
+
+            return skew <= MAX_CLOCK_SKEW;
+        }
+
+        bool PacketHandler::isReplay(PacketPtr const &packet, ReplayFilter &filter)
+        {
+            if(filter.check(packet->getData().data() + 16)) {
+                ++m_replayed;
+                I2P_LOG_TAGGED(m_log, debug, "Endpoint", packet->getEndpoint()) << "dropping replayed packet";
+                return true;
+            }
+
+            return false;
+        }
+
+        bool PacketHandler::checkTimestamp(PacketPtr const &packet, ByteArrayConstItr &begin)
+        {
+            uint32_t ts = parseUint32(begin);
+            uint32_t now = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+
+            if(!isTimely(ts, now)) {
+                ++m_skewed;
+                I2P_LOG_TAGGED(m_log, debug, "Endpoint", packet->getEndpoint()) << "dropping packet with clock skew of " << ((int64_t)ts - now) << " seconds";
+                return false;
+            }
+
+            return true;
+        }
     }
 }
@@ -6,11 +6,15 @@
 #define SSUPACKETHANDLER_H
 
 #include "InboundMessageFragments.h"
+#include "ReplayFilter.h"
 
 #include <i2pcpp/Log.h>
+#include <i2pcpp/util/Metrics.h>
 
 #include <i2pcpp/datatypes/SessionKey.h>
 
+#include <atomic>
+
 namespace i2pcpp {
     namespace SSU {
         class Context;
@@ -39,6 +43,30 @@ namespace i2pcpp {
                  */
                 void packetReceived(PacketPtr p);
 
+                /**
+                 * @return the number of packets dropped because their IV
+                 *  had already been seen
+                 */
+                uint64_t getReplayedCount() const;
+
+                /**
+                 * @return the number of packets dropped because their
+                 *  timestamp was too far from our clock
+                 */
+                uint64_t getSkewedCount() const;
+
+                /**
+                 * @param timestamp the timestamp of a packet, in seconds
+                 *  since the epoch
+                 * @param now our clock, in seconds since the epoch
+                 * @return true if \a timestamp is within
+                 *  i2pcpp::SSU::PacketHandler::MAX_CLOCK_SKEW of \a now
+                 */
+                static bool isTimely(uint32_t timestamp, uint32_t now);
+
+                /// Maximum allowed clock skew (in seconds) of a packet timestamp
+                static const uint32_t MAX_CLOCK_SKEW = 120;
+
             private:
                 /**
                  * Handles a newly received packet, after the session establishment.
@@ -46,7 +74,7 @@ namespace i2pcpp {
                  *  who sent this packet
                  * @todo better error handling?
                  */
-                void handlePacket(PacketPtr const &packet, PeerState const &state);
+                void handlePacket(PacketPtr const &packet, PeerState &state);
 
                 /**
                  * Handles a newly received packet, during session establishment.
@@ -105,12 +133,36 @@ namespace i2pcpp {
                  */
                 void handleSessionDestroyed(EstablishmentStatePtr const &state);
 
+                /**
+                 * Checks \a packet against \a filter before anything else is
+                 *  done with it.
+                 * @return true if the packet is a replay and must be dropped
+                 */
+                bool isReplay(PacketPtr const &packet, ReplayFilter &filter);
+
+                /**
+                 * Parses the packet timestamp and compares it with our clock.
+                 * @param packet the decrypted packet, for logging
+                 * @param begin iterator to the timestamp, advanced past it
+                 * @return true if the timestamp is within i2pcpp::SSU::PacketHandler::MAX_CLOCK_SKEW
+                 */
+                bool checkTimestamp(PacketPtr const &packet, ByteArrayConstItr &begin);
+
                 Context& m_context;
 
                 SessionKey m_inboundKey;
 
                 InboundMessageFragments m_imf;
 
+                /// Replay filter for packets from peers without a session
+                ReplayFilter m_establishmentFilter;
+
+                std::atomic<uint64_t> m_replayed;
+                std::atomic<uint64_t> m_skewed;
+
+                /// Time taken to decrypt packets of established sessions
+                Metrics::Histogram &m_decryptTime;
+
                 i2p_logger_mt m_log;
         };
     }
@@ -6,9 +6,16 @@
 
 namespace i2pcpp {
     namespace SSU {
-        PeerState::PeerState(Endpoint const &ep, RouterHash const &rh) :
+        // Bound to the const reference taken by std::chrono::seconds
+        const uint32_t PeerState::REKEY_GRACE;
+
+        PeerState::PeerState(Endpoint const &ep, RouterIdentity const &ri, bool initiator) :
             m_endpoint(ep),
-            m_routerHash(rh) {}
+            m_routerHash(ri.getHash()),
+            m_identity(std::make_shared<const RouterIdentity>(ri)),
+            m_initiator(initiator),
+            m_keyTime(std::chrono::steady_clock::now()),
+            m_replayFilter(std::make_shared<ReplayFilter>(ReplayFilter::PEER_BITS, ReplayFilter::PEER_CAPACITY, std::chrono::seconds(ReplayFilter::WINDOW))) {}
 
         SessionKey PeerState::getCurrentSessionKey() const
         {
@@ -30,6 +37,16 @@ namespace i2pcpp {
             return m_nextMacKey;
         }
 
+        SessionKey PeerState::getPreviousSessionKey() const
+        {
+            return m_prevSessionKey;
+        }
+
+        SessionKey PeerState::getPreviousMacKey() const
+        {
+            return m_prevMacKey;
+        }
+
         void PeerState::setCurrentSessionKey(SessionKey const &sk)
         {
             m_sessionKey = sk;
@@ -50,14 +67,81 @@ namespace i2pcpp {
             m_nextMacKey = mk;
         }
 
+        void PeerState::setPendingKeys(SessionKey const &sk, SessionKey const &mk)
+        {
+            m_nextSessionKey = sk;
+            m_nextMacKey = mk;
+            m_pending = true;
+        }
+
+        bool PeerState::hasPendingKeys() const
+        {
+            return m_pending;
+        }
+
+        void PeerState::rotateKeys(std::chrono::steady_clock::time_point now)
+        {
+            // Keys the peer never used are not worth keeping
+            if(m_confirmed) {
+                m_prevSessionKey = m_sessionKey;
+                m_prevMacKey = m_macKey;
+            }
+
+            m_sessionKey = m_nextSessionKey;
+            m_macKey = m_nextMacKey;
+            m_pending = false;
+            m_confirmed = false;
+
+            m_keyTime = now;
+        }
+
+        void PeerState::confirmKeys(std::chrono::steady_clock::time_point now)
+        {
+            if(m_confirmed)
+                return;
+
+            m_confirmed = true;
+            m_graceEnd = now + std::chrono::seconds(REKEY_GRACE);
+        }
+
+        bool PeerState::keysConfirmed() const
+        {
+            return m_confirmed;
+        }
+
+        bool PeerState::inGraceWindow(std::chrono::steady_clock::time_point now) const
+        {
+            return !m_confirmed || now < m_graceEnd;
+        }
+
+        std::chrono::steady_clock::time_point PeerState::getKeyTime() const
+        {
+            return m_keyTime;
+        }
+
         RouterHash PeerState::getHash() const
         {
             return m_routerHash;
         }
 
+        RouterIdentity const &PeerState::getIdentity() const
+        {
+            return *m_identity;
+        }
+
         Endpoint PeerState::getEndpoint() const
         {
             return m_endpoint;
         }
+
+        bool PeerState::isInitiator() const
+        {
+            return m_initiator;
+        }
+
+        ReplayFilter& PeerState::getReplayFilter()
+        {
+            return *m_replayFilter;
+        }
     }
 }
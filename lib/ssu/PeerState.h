@@ -5,10 +5,15 @@
 #ifndef SSUPEERSTATE_H
 #define SSUPEERSTATE_H
 
+#include "ReplayFilter.h"
+
 #include <i2pcpp/datatypes/RouterHash.h>
+#include <i2pcpp/datatypes/RouterIdentity.h>
 #include <i2pcpp/datatypes/Endpoint.h>
 #include <i2pcpp/datatypes/SessionKey.h>
 
+#include <chrono>
+
 namespace i2pcpp {
     namespace SSU {
         /**
@@ -18,9 +23,12 @@ namespace i2pcpp {
             public:
                 /**
                  * Constructs given the endpoint of the peer and its
-                 *  i2pcpp::RouterHash.
+                 *  i2pcpp::RouterIdentity.
+                 * @param initiator true if this router initiated the
+                 *  session, in which case it is also responsible for
+                 *  rekeying it
                  */
-                PeerState(Endpoint const &ep, RouterHash const &rh);
+                PeerState(Endpoint const &ep, RouterIdentity const &ri, bool initiator);
 
                 /**
                  * @return the session key, used for AES-256
@@ -42,6 +50,18 @@ namespace i2pcpp {
                  */
                 SessionKey getNextMacKey() const;
 
+                /**
+                 * @return the AES-256 key that was current before the last
+                 *  rekey.
+                 */
+                SessionKey getPreviousSessionKey() const;
+
+                /**
+                 * @return the HMAC key that was current before the last
+                 *  rekey.
+                 */
+                SessionKey getPreviousMacKey() const;
+
                 /**
                  * Sets the current AES-256 session key to \a sk.
                  */
@@ -62,24 +82,101 @@ namespace i2pcpp {
                  */
                 void setNextMacKey(SessionKey const &mk);
 
+                /**
+                 * Stores the keys of a rekey we initiated. They are accepted
+                 *  for inbound packets, but we keep sending with the current
+                 *  keys until the peer is seen using the new ones, since it
+                 *  only switches once it has received our SessionConfirmed.
+                 *  A later rekey replaces keys which are still pending.
+                 */
+                void setPendingKeys(SessionKey const &sk, SessionKey const &mk);
+
+                /**
+                 * @return true if there are keys waiting for the peer to use
+                 *  them, see i2pcpp::SSU::PeerState::setPendingKeys
+                 */
+                bool hasPendingKeys() const;
+
+                /**
+                 * Makes the next keys current. The keys the peer was last
+                 *  seen using are kept as the previous keys and are accepted
+                 *  for inbound packets until the peer uses the new ones (see
+                 *  i2pcpp::SSU::PeerState::confirmKeys), and for
+                 *  i2pcpp::SSU::PeerState::REKEY_GRACE seconds after that.
+                 */
+                void rotateKeys(std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now());
+
+                /**
+                 * Records that a packet from the peer verified under the
+                 *  current keys, which starts the grace window of the
+                 *  previous keys.
+                 */
+                void confirmKeys(std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now());
+
+                /**
+                 * @return true if the peer has been seen using the current keys
+                 */
+                bool keysConfirmed() const;
+
+                /**
+                 * @return true if the previous keys are still accepted
+                 */
+                bool inGraceWindow(std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now()) const;
+
+                /**
+                 * @return the time at which the current keys were set
+                 */
+                std::chrono::steady_clock::time_point getKeyTime() const;
+
                 /**
                  * @return the i2cpp::RouterHash associated with this peer.
                  */
                 RouterHash getHash() const;
 
+                /**
+                 * @return the i2cpp::RouterIdentity associated with this peer.
+                 */
+                RouterIdentity const &getIdentity() const;
+
                 /**
                  * @return the i2cpp::Endpoint associated with this peer.
                  */
                 Endpoint getEndpoint() const;
 
+                /**
+                 * @return true if this router initiated the session
+                 */
+                bool isInitiator() const;
+
+                /**
+                 * @return the i2pcpp::SSU::ReplayFilter used to detect
+                 *  replayed packets from this peer. Copies of a PeerState
+                 *  share the same filter.
+                 */
+                ReplayFilter& getReplayFilter();
+
+                /// Seconds for which the previous keys remain valid once the peer uses the new ones
+                static const uint32_t REKEY_GRACE = 30;
+
             private:
                 Endpoint m_endpoint;
                 RouterHash m_routerHash;
+                std::shared_ptr<const RouterIdentity> m_identity;
+                bool m_initiator;
 
                 SessionKey m_sessionKey;
                 SessionKey m_macKey;
                 SessionKey m_nextSessionKey;
                 SessionKey m_nextMacKey;
+                SessionKey m_prevSessionKey;
+                SessionKey m_prevMacKey;
+
+                std::chrono::steady_clock::time_point m_keyTime;
+                std::chrono::steady_clock::time_point m_graceEnd;
+                bool m_pending = false;
+                bool m_confirmed = true;
+
+                ReplayFilterPtr m_replayFilter;
         };
 
         typedef std::shared_ptr<PeerState> PeerStatePtr;
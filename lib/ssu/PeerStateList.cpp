@@ -4,27 +4,43 @@
  */
 #include "PeerStateList.h"
 #include "Context.h"
+#include "Packet.h"
 
-#include <i2pcpp/util/make_unique.h>
+#include <boost/bind.hpp>
 
 namespace i2pcpp {
     namespace SSU {
         PeerStateList::PeerStateList(Context &c) :
-            m_context(c) {}
+            m_context(c),
+            m_timer(m_context.ios, boost::posix_time::time_duration(0, 0, 30))
+        {
+            m_timer.async_wait(boost::bind(&PeerStateList::timerCallback, this, boost::asio::placeholders::error));
+        }
 
         void PeerStateList::addPeer(PeerState ps)
         {
-            PeerStateContainer psc(ps);
-
-            auto timer = std::make_unique<boost::asio::deadline_timer>(m_context.ios, boost::posix_time::time_duration(0, 20, 0));
-            timer->async_wait(boost::bind(&PeerStateList::timerCallback, this, boost::asio::placeholders::error, ps.getHash()));
-            psc.timer = std::move(timer);
-
             auto itr = m_container.get<1>().find(ps.getHash());
-            if(itr == m_container.get<1>().end())
-                m_container.insert(std::move(psc));
-            else
-                m_container.get<1>().replace(itr, std::move(psc));
+            if(itr == m_container.get<1>().end()) {
+                if(m_container.size() >= MAX_PEERS)
+                    evict();
+
+                m_container.insert(PeerStateContainer(ps));
+            } else if(itr->getEndpoint() == ps.getEndpoint()) {
+                m_container.get<1>().modify(itr, [&](PeerStateContainer &psc) {
+                    if(ps.isInitiator())
+                        psc.state.setPendingKeys(ps.getCurrentSessionKey(), ps.getCurrentMacKey());
+                    else {
+                        // The SessionConfirmed was sent with the new keys
+                        psc.state.setNextSessionKey(ps.getCurrentSessionKey());
+                        psc.state.setNextMacKey(ps.getCurrentMacKey());
+                        psc.state.rotateKeys();
+                    }
+                });
+                m_container.get<2>().relocate(m_container.get<2>().end(), m_container.project<2>(itr));
+            } else {
+                m_container.get<1>().replace(itr, PeerStateContainer(ps));
+                m_container.get<2>().relocate(m_container.get<2>().end(), m_container.project<2>(itr));
+            }
         }
 
         PeerState PeerStateList::getPeer(Endpoint const &ep)
@@ -65,14 +81,39 @@ namespace i2pcpp {
             return (m_container.get<1>().count(rh) > 0);
         }
 
-        void PeerStateList::resetPeerTimer(RouterHash const &rh)
+        bool PeerStateList::touchPeer(RouterHash const &rh)
         {
             auto itr = m_container.get<1>().find(rh);
             if(itr == m_container.get<1>().end())
                 throw std::runtime_error("record not found");
 
-            itr->timer->expires_at(itr->timer->expires_at() + boost::posix_time::time_duration(0, 20, 0));
-            itr->timer->async_wait(boost::bind(&PeerStateList::timerCallback, this, boost::asio::placeholders::error, rh));
+            const auto now = std::chrono::steady_clock::now();
+            bool rekey = (itr->state.isInitiator() && now >= itr->nextRekey);
+
+            m_container.get<1>().modify(itr, [&](PeerStateContainer &psc) {
+                psc.lastActivity = now;
+                if(rekey)
+                    psc.nextRekey = now + std::chrono::seconds(REKEY_RETRY);
+            });
+            m_container.get<2>().relocate(m_container.get<2>().end(), m_container.project<2>(itr));
+
+            return rekey;
+        }
+
+        void PeerStateList::confirmKeys(RouterHash const &rh)
+        {
+            auto itr = m_container.get<1>().find(rh);
+            if(itr == m_container.get<1>().end())
+                throw std::runtime_error("record not found");
+
+            m_container.get<1>().modify(itr, [](PeerStateContainer &psc) {
+                if(psc.state.hasPendingKeys()) {
+                    psc.state.rotateKeys();
+                    psc.nextRekey = psc.state.getKeyTime() + std::chrono::seconds(REKEY_INTERVAL);
+                }
+
+                psc.state.confirmKeys();
+            });
         }
 
         uint32_t PeerStateList::numPeers() const
@@ -90,15 +131,43 @@ namespace i2pcpp {
             return m_container.get<0>().cend();
         }
 
-        void PeerStateList::timerCallback(const boost::system::error_code& e, RouterHash const rh)
+        void PeerStateList::timerCallback(const boost::system::error_code& e)
         {
-            if(!e)
+            if(e) return;
+
+            std::vector<RouterHash> idle;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+
+                const auto cutoff = std::chrono::steady_clock::now() - std::chrono::seconds(IDLE_TIMEOUT);
+                for(auto itr = m_container.get<2>().cbegin(); itr != m_container.get<2>().cend() && itr->lastActivity < cutoff; ++itr)
+                    idle.push_back(itr->getHash());
+            }
+
+            for(auto& rh: idle)
                 m_context.disconnect(rh);
+
+            m_timer.expires_at(m_timer.expires_at() + boost::posix_time::time_duration(0, 0, 30));
+            m_timer.async_wait(boost::bind(&PeerStateList::timerCallback, this, boost::asio::placeholders::error));
         }
 
         std::mutex& PeerStateList::getMutex() const
         {
             return m_mutex;
         }
+
+        void PeerStateList::evict()
+        {
+            auto itr = m_container.get<2>().begin();
+            const PeerState& ps = itr->state;
+
+            PacketPtr p = PacketBuilder::buildSessionDestroyed(ps.getEndpoint());
+            p->encrypt(ps.getCurrentSessionKey(), ps.getCurrentMacKey());
+            m_context.sendPacket(p);
+
+            m_context.ios.post(boost::bind(boost::ref(m_context.disconnectedSignal), ps.getHash()));
+
+            m_container.get<2>().erase(itr);
+        }
     }
 }
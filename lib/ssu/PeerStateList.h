@@ -10,10 +10,13 @@
 #include <i2pcpp/datatypes/Endpoint.h>
 #include <i2pcpp/datatypes/RouterHash.h>
 
+#include <boost/asio.hpp>
 #include <boost/multi_index_container.hpp>
 #include <boost/multi_index/hashed_index.hpp>
+#include <boost/multi_index/sequenced_index.hpp>
 #include <boost/multi_index/mem_fun.hpp>
 
+#include <chrono>
 #include <mutex>
 
 namespace bmi = boost::multi_index;
@@ -25,17 +28,23 @@ namespace i2pcpp {
 
         /**
          * Stores a list of i2pcpp::SSU::PeerState objects.
+         * Besides the endpoint and router hash indices, peers are kept in
+         *  least recently active order. A single timer walks that order
+         *  from the front to reclaim idle sessions, so there is no timer per
+         *  peer. When the list is full, adding a peer evicts the least
+         *  recently active one.
          */
         class PeerStateList {
             private:
                 struct PeerStateContainer {
                     PeerStateContainer(PeerState const &ps) :
-                        state(ps) {}
-                    PeerStateContainer(PeerStateContainer &&) = default;
-                    PeerStateContainer& operator=(PeerStateContainer &&) = default;
+                        state(ps),
+                        lastActivity(std::chrono::steady_clock::now()),
+                        nextRekey(ps.getKeyTime() + std::chrono::seconds(REKEY_INTERVAL)) {}
 
                     PeerState state;
-                    std::unique_ptr<boost::asio::deadline_timer> timer;
+                    std::chrono::steady_clock::time_point lastActivity;
+                    std::chrono::steady_clock::time_point nextRekey;
 
                     Endpoint getEndpoint() const { return state.getEndpoint(); }
                     RouterHash getHash() const { return state.getHash(); }
@@ -49,7 +58,8 @@ namespace i2pcpp {
                         >,
                         bmi::hashed_unique<
                             bmi::const_mem_fun<PeerStateContainer, RouterHash, &PeerStateContainer::getHash>
-                        >
+                        >,
+                        bmi::sequenced<>
                     >
                 > StateContainer;
 
@@ -64,6 +74,15 @@ namespace i2pcpp {
 
                 /**
                  * Adds an i2pcpp::SSU::PeerState object to the list.
+                 * If a peer with the same i2pcpp::RouterHash and
+                 *  i2pcpp::Endpoint already exists, this is a rekey. If we
+                 *  initiated it, the keys of \a ps are pending until the
+                 *  peer uses them (see i2pcpp::SSU::PeerState::setPendingKeys),
+                 *  otherwise they become current right away and the old ones
+                 *  are kept for the grace window (see
+                 *  i2pcpp::SSU::PeerState::rotateKeys).
+                 * If the list is full, the least recently active peer is
+                 *  disconnected to make room.
                  */
                 void addPeer(PeerState ps);
 
@@ -102,11 +121,25 @@ namespace i2pcpp {
                 bool peerExists(RouterHash const &rh) const;
 
                 /**
-                 * Resets the timer of a peer given by its i2pcpp::RouterHash
-                 *  \a rh.
+                 * Records activity for the peer given by its
+                 *  i2pcpp::RouterHash \a rh and moves it to the back of the
+                 *  idle order.
+                 * @return true if we initiated the session and its keys are
+                 *  due to be replaced. The next rekey attempt is then
+                 *  pushed back by i2pcpp::SSU::PeerStateList::REKEY_RETRY
+                 *  seconds, so at most one attempt is started per interval.
                  * @throw std::runtime_error if there is no such peer
                  */
-                void resetPeerTimer(RouterHash const &rh);
+                bool touchPeer(RouterHash const &rh);
+
+                /**
+                 * Called when a packet from the peer given by its
+                 *  i2pcpp::RouterHash \a rh verified under its current or
+                 *  pending keys. Pending keys become current, and the
+                 *  grace window of the previous keys starts.
+                 * @throw std::runtime_error if there is no such peer
+                 */
+                void confirmKeys(RouterHash const &rh);
 
                 /**
                  * @return the total number of i2pcpp::SSU::PeerState objects
@@ -127,19 +160,41 @@ namespace i2pcpp {
                 const_iterator cend() const;
 
                 /**
-                 * Called when the timer's deadline ends.
+                 * Called periodically. Disconnects peers which have been
+                 *  idle for longer than i2pcpp::SSU::PeerStateList::IDLE_TIMEOUT.
                  */
-                void timerCallback(const boost::system::error_code& e, RouterHash const rh);
+                void timerCallback(const boost::system::error_code& e);
 
                 /**
                  * @return the mutex for this object
                  */
                 std::mutex& getMutex() const;
 
+                /// Seconds without activity after which a session is dropped
+                static const uint32_t IDLE_TIMEOUT = 20 * 60;
+
+                /// Seconds between rekeys of a session
+                static const uint32_t REKEY_INTERVAL = 60 * 60;
+
+                /// Seconds to wait before retrying a rekey that did not complete
+                static const uint32_t REKEY_RETRY = 60;
+
+                /// Maximum number of established sessions
+                static const uint32_t MAX_PEERS = 10000;
+
             private:
+                /**
+                 * Sends a session destroyed message to the least recently
+                 *  active peer and removes it.
+                 */
+                void evict();
+
                 Context& m_context;
                 StateContainer m_container;
 
+                /// Timer for idle session reclamation
+                boost::asio::deadline_timer m_timer;
+
                 mutable std::mutex m_mutex;
         };
     }
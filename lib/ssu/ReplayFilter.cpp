@@ -0,0 +1,127 @@
+/**
+ * @file ReplayFilter.cpp
+ * @brief Implements ReplayFilter.h
+ */
+#include "ReplayFilter.h"
+
+#include <algorithm>
+
+namespace i2pcpp {
+    namespace SSU {
+        namespace {
+            uint64_t parseUint64(const unsigned char *p)
+            {
+                uint64_t v = 0;
+                for(int i = 0; i < 8; i++)
+                    v = (v << 8) | p[i];
+
+                return v;
+            }
+        }
+
+        // Bound to const references by std::chrono::seconds and std::make_shared
+        const uint32_t ReplayFilter::PEER_BITS;
+        const uint32_t ReplayFilter::PEER_CAPACITY;
+        const uint32_t ReplayFilter::WINDOW;
+
+        ReplayFilter::ReplayFilter(uint32_t bits, uint32_t capacity, std::chrono::seconds window) :
+            m_words((bits + 63) / 64),
+            m_capacity(capacity),
+            m_window(window),
+            m_period(window / (NUM_GENERATIONS - 1))
+        {
+            m_bits.resize((size_t)m_words * NUM_GENERATIONS);
+
+            const Clock::time_point now = Clock::now();
+            for(auto& g: m_generations)
+                g.started = now;
+        }
+
+        bool ReplayFilter::contains(const unsigned char *iv, Clock::time_point now) const
+        {
+            /* A generation which has not been rotated for longer than the
+             * window only holds IVs a timestamp check would reject anyway.
+             */
+            for(size_t i = 0; i < NUM_GENERATIONS; i++)
+                if(m_generations[i].count && now - m_generations[i].started < m_window + m_period && contains(i, iv))
+                    return true;
+
+            return false;
+        }
+
+        bool ReplayFilter::check(const unsigned char *iv, Clock::time_point now)
+        {
+            if(!contains(iv, now))
+                return false;
+
+            ++m_duplicates;
+
+            return true;
+        }
+
+        void ReplayFilter::insert(const unsigned char *iv, Clock::time_point now)
+        {
+            Generation &g = m_generations[m_current];
+            if(now - g.started >= m_period)
+                rotate(now);
+            else if(g.count >= m_capacity) {
+                ++m_earlyRotations;
+                rotate(now);
+            }
+
+            uint64_t *bits = m_bits.data() + m_current * m_words;
+            const uint64_t size = (uint64_t)m_words * 64;
+            const uint64_t h1 = parseUint64(iv);
+            const uint64_t h2 = parseUint64(iv + 8) | 1;
+
+            for(uint32_t i = 0; i < NUM_HASHES; i++) {
+                const uint64_t idx = (h1 + i * h2) % size;
+                bits[idx / 64] |= (uint64_t)1 << (idx % 64);
+            }
+
+            ++m_generations[m_current].count;
+        }
+
+        uint64_t ReplayFilter::getDuplicates() const
+        {
+            return m_duplicates;
+        }
+
+        uint64_t ReplayFilter::getEarlyRotations() const
+        {
+            return m_earlyRotations;
+        }
+
+        size_t ReplayFilter::getSize() const
+        {
+            return m_bits.size() * sizeof(uint64_t);
+        }
+
+        bool ReplayFilter::contains(size_t generation, const unsigned char *iv) const
+        {
+            const uint64_t *bits = m_bits.data() + generation * m_words;
+            const uint64_t size = (uint64_t)m_words * 64;
+            const uint64_t h1 = parseUint64(iv);
+            const uint64_t h2 = parseUint64(iv + 8) | 1;
+
+            for(uint32_t i = 0; i < NUM_HASHES; i++) {
+                const uint64_t idx = (h1 + i * h2) % size;
+                if(!(bits[idx / 64] & ((uint64_t)1 << (idx % 64))))
+                    return false;
+            }
+
+            return true;
+        }
+
+        void ReplayFilter::rotate(Clock::time_point now)
+        {
+            m_current = (m_current + 1) % NUM_GENERATIONS;
+
+            auto begin = m_bits.begin() + m_current * m_words;
+            std::fill(begin, begin + m_words, 0);
+
+            m_generations[m_current].count = 0;
+            m_generations[m_current].started = now;
+        }
+    }
+}
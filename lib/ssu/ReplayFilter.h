@@ -0,0 +1,139 @@
+/**
+ * @file ReplayFilter.h
+ * @brief Defines the i2pcpp::SSU::ReplayFilter class.
+ */
+#ifndef SSUREPLAYFILTER_H
+#define SSUREPLAYFILTER_H
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace i2pcpp {
+    namespace SSU {
+        /**
+         * A rotating bloom filter over packet IVs. Every SSU packet carries
+         *  a fresh, random 16 byte IV, so the IV bytes themselves are used
+         *  as the hash input.
+         * The filter is made of NUM_GENERATIONS bloom filters of a fixed
+         *  size. IVs are inserted in to the newest generation, and once it
+         *  is window / (NUM_GENERATIONS - 1) old, or holds its capacity,
+         *  the oldest generation is cleared and becomes the newest. Memory
+         *  and the cost of a lookup are therefore fixed. An IV is
+         *  remembered for at least the window unless generations fill up
+         *  faster than that, in which case the packet rate, rather than
+         *  the window, bounds how long it is remembered.
+         * @note Not thread safe, callers are expected to serialise access.
+         */
+        class ReplayFilter {
+            public:
+                typedef std::chrono::steady_clock Clock;
+
+                /**
+                 * @param bits the size of a generation in bits (rounded up
+                 *  to a multiple of 64)
+                 * @param capacity the number of IVs a generation takes
+                 *  before it is rotated early
+                 * @param window how long an IV is remembered at least,
+                 *  while generations are not rotated early
+                 */
+                ReplayFilter(uint32_t bits, uint32_t capacity, std::chrono::seconds window);
+                ReplayFilter(const ReplayFilter &) = delete;
+                ReplayFilter& operator=(ReplayFilter &) = delete;
+
+                /**
+                 * @param iv pointer to the 16 byte IV
+                 * @return true if the IV has (probably) been seen before
+                 */
+                bool contains(const unsigned char *iv, Clock::time_point now = Clock::now()) const;
+
+                /**
+                 * Like contains(), but counts a hit as a duplicate.
+                 */
+                bool check(const unsigned char *iv, Clock::time_point now = Clock::now());
+
+                /**
+                 * Records the 16 byte IV pointed to by \a iv, rotating the
+                 *  generations first if the newest is due.
+                 */
+                void insert(const unsigned char *iv, Clock::time_point now = Clock::now());
+
+                /**
+                 * @return the number of IVs check() found in the filter
+                 */
+                uint64_t getDuplicates() const;
+
+                /**
+                 * @return the number of times a generation filled up before
+                 *  its time was up
+                 */
+                uint64_t getEarlyRotations() const;
+
+                /**
+                 * @return the memory used by the bit arrays, in bytes
+                 */
+                size_t getSize() const;
+
+                /**
+                 * Number of bits in a generation of a per-peer filter, 6 KB
+                 *  per peer in total.
+                 */
+                static const uint32_t PEER_BITS = 16384;
+
+                /// Number of IVs in a generation of a per-peer filter (32 bits each)
+                static const uint32_t PEER_CAPACITY = 512;
+
+                /**
+                 * Number of bits in a generation of the establishment filter,
+                 *  192 KB in total.
+                 */
+                static const uint32_t ESTABLISHMENT_BITS = 1 << 19;
+
+                /// Number of IVs in a generation of the establishment filter (32 bits each)
+                static const uint32_t ESTABLISHMENT_CAPACITY = 16384;
+
+                /**
+                 * Seconds during which a captured packet can be replayed: its
+                 *  timestamp may be up to PacketHandler::MAX_CLOCK_SKEW from
+                 *  our clock both when it is first received and when it is
+                 *  replayed.
+                 */
+                static const uint32_t WINDOW = 240;
+
+                /// Number of bits set per IV
+                static const uint32_t NUM_HASHES = 8;
+
+                /// Number of bloom filters, the newest one of which takes inserts
+                static const size_t NUM_GENERATIONS = 3;
+
+            private:
+                struct Generation {
+                    uint32_t count = 0;
+                    Clock::time_point started;
+                };
+
+                bool contains(size_t generation, const unsigned char *iv) const;
+
+                void rotate(Clock::time_point now);
+
+                /// The bits of all generations, one after the other
+                std::vector<uint64_t> m_bits;
+                std::array<Generation, NUM_GENERATIONS> m_generations;
+                size_t m_current = 0;
+
+                uint32_t m_words;
+                uint32_t m_capacity;
+                Clock::duration m_window;
+                Clock::duration m_period;
+
+                uint64_t m_duplicates = 0;
+                uint64_t m_earlyRotations = 0;
+        };
+
+        typedef std::shared_ptr<ReplayFilter> ReplayFilterPtr;
+    }
+}
+
+#endif
@@ -127,6 +127,29 @@ namespace i2pcpp {
             return m_impl->peers.peerExists(rh);
         }
 
+        uint32_t SSU::getSendWindow(RouterHash const &rh) const
+        {
+            const uint32_t inFlight = m_impl->omf.getInFlight(rh);
+
+            return (inFlight < OutboundMessageFragments::MAX_IN_FLIGHT ? OutboundMessageFragments::MAX_IN_FLIGHT - inFlight : 0);
+        }
+
+        void SSU::setAckDelay(uint32_t ms)
+        {
+            m_impl->ackManager.setDelay(boost::posix_time::milliseconds(ms));
+        }
+
+        SSU::Stats SSU::getStats() const
+        {
+            Stats s;
+            s.fragmentsSent = m_impl->omf.getFragmentsSent();
+            s.fragmentsRetransmitted = m_impl->omf.getFragmentsRetransmitted();
+            s.packetsReplayed = m_impl->packetHandler.getReplayedCount();
+            s.packetsSkewed = m_impl->packetHandler.getSkewedCount();
+
+            return s;
+        }
+
         void SSU::gracefulShutdown()
         {
             m_impl->acceptingNewPeers = false;
@@ -0,0 +1,104 @@
+#include <i2pcpp/util/ElGamal.h>
+
+#include <botan/dl_group.h>
+#include <botan/numthry.h>
+#include <botan/pow_mod.h>
+#include <botan/workfactor.h>
+
+#include <stdexcept>
+
+namespace i2pcpp {
+    namespace ElGamal {
+        static Botan::DL_Group const &getGroup()
+        {
+            static const Botan::DL_Group group("modp/ietf/2048");
+            return group;
+        }
+
+        Ephemeral generate(Botan::RandomNumberGenerator &rng)
+        {
+            Botan::DL_Group const &group = getGroup();
+            Botan::BigInt const &p = group.get_p();
+
+            /* Fixed base exponentiation with precomputed tables. The
+             * object isn't safe to share, so each thread has its own.
+             */
+            static thread_local Botan::Fixed_Base_Power_Mod powermodG(group.get_g(), p);
+
+            Ephemeral e;
+            e.k = Botan::BigInt(rng, 2 * Botan::dl_work_factor(p.bits()));
+            e.gk = powermodG(e.k);
+
+            return e;
+        }
+
+        std::vector<unsigned char> encrypt(std::vector<unsigned char> const &publicKey, const unsigned char *msg, size_t length, Ephemeral const &ephemeral)
+        {
+            Botan::BigInt const &p = getGroup().get_p();
+            const size_t pBytes = p.bytes();
+
+            Botan::BigInt m(msg, length);
+            if(m >= p)
+                throw std::runtime_error("ElGamal plaintext too large");
+
+            Botan::BigInt y(publicKey.data(), publicKey.size());
+            Botan::BigInt b = (m * Botan::power_mod(y, ephemeral.k, p)) % p;
+
+            std::vector<unsigned char> out(2 * pBytes);
+            ephemeral.gk.binary_encode(out.data() + pBytes - ephemeral.gk.bytes());
+            b.binary_encode(out.data() + 2 * pBytes - b.bytes());
+
+            return out;
+        }
+
+        EphemeralPool::EphemeralPool(size_t capacity) :
+            m_capacity(capacity),
+            m_misses(0)
+        {
+            m_ephemerals.reserve(capacity);
+        }
+
+        Ephemeral EphemeralPool::take(Botan::RandomNumberGenerator &rng)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if(m_ephemerals.size()) {
+                    Ephemeral e = std::move(m_ephemerals.back());
+                    m_ephemerals.pop_back();
+
+                    return e;
+                }
+            }
+
+            ++m_misses;
+            return generate(rng);
+        }
+
+        bool EphemeralPool::refill(Botan::RandomNumberGenerator &rng)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if(m_ephemerals.size() >= m_capacity)
+                    return false;
+            }
+
+            Ephemeral e = generate(rng);
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_ephemerals.push_back(std::move(e));
+
+            return m_ephemerals.size() < m_capacity;
+        }
+
+        size_t EphemeralPool::size() const
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_ephemerals.size();
+        }
+
+        uint64_t EphemeralPool::getMisses() const
+        {
+            return m_misses;
+        }
+    }
+}
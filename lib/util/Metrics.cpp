@@ -0,0 +1,176 @@
+/**
+ * @file Metrics.cpp
+ * @brief Implements Metrics.h
+ */
+#include <i2pcpp/util/Metrics.h>
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace i2pcpp {
+    namespace Metrics {
+        namespace {
+            /**
+             * Metrics are never removed, so references handed out stay
+             *  valid for the lifetime of the process.
+             */
+            struct Registry {
+                std::mutex mutex;
+                std::unordered_map<std::string, std::unique_ptr<Counter>> counters;
+                std::unordered_map<std::string, std::unique_ptr<Gauge>> gauges;
+                std::unordered_map<std::string, std::unique_ptr<Histogram>> histograms;
+            };
+
+            Registry& getRegistry()
+            {
+                static Registry registry;
+                return registry;
+            }
+
+            template<typename T>
+            T& find(std::unordered_map<std::string, std::unique_ptr<T>> &metrics, std::string const &name)
+            {
+                auto& m = metrics[name];
+                if(!m)
+                    m.reset(new T());
+
+                return *m;
+            }
+        }
+
+        size_t getShard()
+        {
+            static std::atomic<size_t> next(0);
+            static thread_local size_t shard = next++ % NUM_SHARDS;
+
+            return shard;
+        }
+
+        uint64_t Counter::value() const
+        {
+            uint64_t sum = 0;
+            for(auto& s: m_shards)
+                sum += s.value.load(std::memory_order_relaxed);
+
+            return sum;
+        }
+
+        uint64_t Counter::reset()
+        {
+            uint64_t sum = 0;
+            for(auto& s: m_shards)
+                sum += s.value.exchange(0, std::memory_order_relaxed);
+
+            return sum;
+        }
+
+        void Histogram::record(uint64_t v)
+        {
+            m_buckets[getBucket(v)].fetch_add(1, std::memory_order_relaxed);
+            m_sum.fetch_add(v, std::memory_order_relaxed);
+
+            uint64_t max = m_max.load(std::memory_order_relaxed);
+            while(v > max && !m_max.compare_exchange_weak(max, v, std::memory_order_relaxed));
+        }
+
+        Histogram::Summary Histogram::summarize(bool reset)
+        {
+            Summary s;
+
+            std::array<uint64_t, BUCKET_COUNT> counts;
+            for(size_t i = 0; i < BUCKET_COUNT; i++) {
+                counts[i] = (reset ? m_buckets[i].exchange(0, std::memory_order_relaxed) : m_buckets[i].load(std::memory_order_relaxed));
+                s.count += counts[i];
+            }
+
+            s.sum = (reset ? m_sum.exchange(0, std::memory_order_relaxed) : m_sum.load(std::memory_order_relaxed));
+            s.max = (reset ? m_max.exchange(0, std::memory_order_relaxed) : m_max.load(std::memory_order_relaxed));
+
+            if(!s.count)
+                return s;
+
+            const std::array<std::pair<double, uint64_t *>, 3> percentiles = {{
+                { 0.50, &s.p50 }, { 0.90, &s.p90 }, { 0.99, &s.p99 }
+            }};
+
+            size_t p = 0;
+            uint64_t seen = 0;
+            for(size_t i = 0; i < BUCKET_COUNT && p < percentiles.size(); i++) {
+                seen += counts[i];
+                while(p < percentiles.size() && seen >= percentiles[p].first * s.count) {
+                    *percentiles[p].second = std::min(getUpperBound(i), s.max);
+                    p++;
+                }
+            }
+
+            return s;
+        }
+
+        size_t Histogram::getBucket(uint64_t v)
+        {
+            if(v < SUB_BUCKETS)
+                return v;
+
+            const size_t msb = 63 - __builtin_clzll(v);
+            const size_t shift = msb - SUB_BUCKET_BITS;
+
+            return (shift + 1) * SUB_BUCKETS + ((v >> shift) & (SUB_BUCKETS - 1));
+        }
+
+        uint64_t Histogram::getUpperBound(size_t bucket)
+        {
+            if(bucket < SUB_BUCKETS)
+                return bucket;
+
+            const size_t shift = bucket / SUB_BUCKETS - 1;
+            const uint64_t lower = (uint64_t)(SUB_BUCKETS + bucket % SUB_BUCKETS) << shift;
+
+            return lower + ((1ULL << shift) - 1);
+        }
+
+        Counter& counter(std::string const &name)
+        {
+            Registry &r = getRegistry();
+            std::lock_guard<std::mutex> lock(r.mutex);
+
+            return find(r.counters, name);
+        }
+
+        Gauge& gauge(std::string const &name)
+        {
+            Registry &r = getRegistry();
+            std::lock_guard<std::mutex> lock(r.mutex);
+
+            return find(r.gauges, name);
+        }
+
+        Histogram& histogram(std::string const &name)
+        {
+            Registry &r = getRegistry();
+            std::lock_guard<std::mutex> lock(r.mutex);
+
+            return find(r.histograms, name);
+        }
+
+        Snapshot snapshot(bool reset)
+        {
+            Registry &r = getRegistry();
+            std::lock_guard<std::mutex> lock(r.mutex);
+
+            Snapshot s;
+
+            for(auto& c: r.counters)
+                s.counters[c.first] = (reset ? c.second->reset() : c.second->value());
+
+            for(auto& g: r.gauges)
+                s.gauges[g.first] = g.second->value();
+
+            for(auto& h: r.histograms)
+                s.histograms[h.first] = h.second->summarize(reset);
+
+            return s;
+        }
+    }
+}
@@ -0,0 +1,128 @@
+/**
+ * @file Random.cpp
+ * @brief Implements Random.h
+ */
+#include <i2pcpp/util/Random.h>
+
+#include <botan/auto_rng.h>
+#include <botan/chacha.h>
+
+#include <algorithm>
+#include <array>
+
+namespace i2pcpp {
+    namespace Random {
+        namespace {
+            typedef std::chrono::steady_clock Clock;
+
+            /**
+             * A ChaCha20 keystream generator. Each refill of the buffer
+             *  rekeys the cipher with the first 32 bytes of its own output,
+             *  and bytes are erased from the buffer as they are handed
+             *  out, so the state never allows earlier output to be
+             *  recovered.
+             */
+            class Generator {
+                public:
+                    Generator() :
+                        m_pos(BUFFER_SIZE),
+                        m_generated(0)
+                    {
+                        reseed();
+                    }
+
+                    Generator(const Generator &) = delete;
+                    Generator& operator=(Generator &) = delete;
+
+                    ~Generator()
+                    {
+                        std::fill(m_buffer.begin(), m_buffer.end(), 0);
+                    }
+
+                    void randomize(unsigned char *buf, size_t len)
+                    {
+                        while(len) {
+                            if(m_pos == BUFFER_SIZE)
+                                refill();
+
+                            const size_t n = std::min(len, BUFFER_SIZE - m_pos);
+                            std::copy(m_buffer.data() + m_pos, m_buffer.data() + m_pos + n, buf);
+                            std::fill(m_buffer.data() + m_pos, m_buffer.data() + m_pos + n, 0);
+
+                            m_pos += n;
+                            buf += n;
+                            len -= n;
+                        }
+                    }
+
+                    void reseed()
+                    {
+                        std::array<unsigned char, KEY_SIZE> seed;
+                        getRNG().randomize(seed.data(), seed.size());
+                        rekey(seed.data());
+                        std::fill(seed.begin(), seed.end(), 0);
+
+                        m_pos = BUFFER_SIZE;
+                        m_generated = 0;
+                        m_reseeded = Clock::now();
+                    }
+
+                private:
+                    void refill()
+                    {
+                        if(m_generated >= RESEED_BYTES || Clock::now() - m_reseeded >= RESEED_INTERVAL)
+                            reseed();
+
+                        std::fill(m_buffer.begin(), m_buffer.end(), 0);
+                        m_cipher.cipher1(m_buffer.data(), m_buffer.size());
+
+                        rekey(m_buffer.data());
+                        std::fill(m_buffer.data(), m_buffer.data() + KEY_SIZE, 0);
+
+                        m_pos = KEY_SIZE;
+                        m_generated += BUFFER_SIZE - KEY_SIZE;
+                    }
+
+                    void rekey(const unsigned char *key)
+                    {
+                        static const std::array<unsigned char, 8> nonce = {{}};
+
+                        m_cipher.set_key(key, KEY_SIZE);
+                        m_cipher.set_iv(nonce.data(), nonce.size());
+                    }
+
+                    static const size_t KEY_SIZE = 32;
+                    static const size_t BUFFER_SIZE = 512;
+
+                    Botan::ChaCha m_cipher;
+                    std::array<unsigned char, BUFFER_SIZE> m_buffer;
+                    size_t m_pos;
+
+                    uint64_t m_generated;
+                    Clock::time_point m_reseeded;
+            };
+
+            Generator& getGenerator()
+            {
+                static thread_local Generator generator;
+                return generator;
+            }
+        }
+
+        void randomize(unsigned char *buf, size_t len)
+        {
+            getGenerator().randomize(buf, len);
+        }
+
+        void reseed()
+        {
+            getGenerator().reseed();
+        }
+
+        Botan::RandomNumberGenerator& getRNG()
+        {
+            static thread_local Botan::AutoSeeded_RNG rng;
+            return rng;
+        }
+    }
+}
@@ -0,0 +1,69 @@
+#include <i2pcpp/util/TokenBucket.h>
+
+#include <algorithm>
+
+namespace i2pcpp {
+    TokenBucket::TokenBucket(uint64_t rate, uint64_t burst)
+    {
+        setRate(rate, burst);
+    }
+
+    bool TokenBucket::consume(uint64_t bytes)
+    {
+        if(!m_rate)
+            return true;
+
+        refill();
+        if(m_tokens < (int64_t)bytes)
+            return false;
+
+        m_tokens -= bytes;
+        return true;
+    }
+
+    bool TokenBucket::available(uint64_t bytes)
+    {
+        if(!m_rate)
+            return true;
+
+        refill();
+        return m_tokens >= (int64_t)bytes;
+    }
+
+    void TokenBucket::charge(uint64_t bytes)
+    {
+        if(!m_rate)
+            return;
+
+        refill();
+        m_tokens = std::max(m_tokens - (int64_t)bytes, -m_burst);
+    }
+
+    void TokenBucket::setRate(uint64_t rate, uint64_t burst)
+    {
+        m_rate = rate;
+        m_burst = (burst ? burst : rate);
+        m_tokens = m_burst;
+        m_last = Clock::now();
+    }
+
+    uint64_t TokenBucket::getRate() const
+    {
+        return m_rate;
+    }
+
+    void TokenBucket::refill()
+    {
+        auto now = Clock::now();
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(now - m_last).count();
+
+        // Leave m_last alone until at least one token is due so that
+        // frequent calls at low rates do not round the refill down to zero.
+        int64_t added = m_rate * elapsed / 1000000;
+        if(!added)
+            return;
+
+        m_last = now;
+        m_tokens = std::min(m_tokens + added, m_burst);
+    }
+}
@@ -36,6 +36,12 @@ CREATE TABLE IF NOT EXISTS "router_options" (
 CREATE TABLE IF NOT EXISTS "profiles" (
   "router_id" BLOB NOT NULL REFERENCES routers_raw(id) ON UPDATE CASCADE ON DELETE CASCADE,
   "last_seen" INTEGER,
+  "build_success" INTEGER NOT NULL DEFAULT 0,
+  "build_failure" INTEGER NOT NULL DEFAULT 0,
+  "connect_failure" INTEGER NOT NULL DEFAULT 0,
+  "rtt" INTEGER NOT NULL DEFAULT 0,
+  "throughput" INTEGER NOT NULL DEFAULT 0,
+  "last_decay" INTEGER NOT NULL DEFAULT 0,
   PRIMARY KEY("router_id")
 );
 ;
@@ -0,0 +1,265 @@
+#include <frontends/console/AsyncBackend.h>
+
+#include <boost/filesystem.hpp>
+#include <boost/log/core.hpp>
+#include <boost/log/sinks/unlocked_frontend.hpp>
+#include <boost/log/sources/record_ostream.hpp>
+#include <boost/log/sources/severity_logger.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+using namespace i2pcpp;
+
+namespace fs = boost::filesystem;
+
+namespace {
+    /**
+     * Runs an AsyncBackend on a file in a directory of its own, attached
+     *  to the logging core for as long as the fixture lives.
+     */
+    struct Backend {
+        fs::path dir;
+        fs::path file;
+        boost::shared_ptr<AsyncBackend> backend;
+        boost::shared_ptr<sinks::unlocked_sink<AsyncBackend>> sink;
+        boost::log::sources::severity_logger<severity_level> lg;
+
+        Backend(AsyncBackend::Options const &options) :
+            dir(fs::temp_directory_path() / fs::unique_path("i2pcpp-%%%%-%%%%")),
+            file(dir / "log")
+        {
+            fs::create_directory(dir);
+
+            backend = boost::make_shared<AsyncBackend>(file.string(), options);
+            sink = boost::make_shared<sinks::unlocked_sink<AsyncBackend>>(backend);
+            boost::log::core::get()->add_sink(sink);
+        }
+
+        ~Backend()
+        {
+            boost::log::core::get()->remove_sink(sink);
+            backend->stop();
+            fs::remove_all(dir);
+        }
+
+        void log(size_t n, severity_level sev = info)
+        {
+            for(size_t i = 0; i < n; i++)
+                BOOST_LOG_SEV(lg, sev) << "record " << i;
+        }
+
+        /// Logs \a n records from each of \a threads threads at once
+        void logFrom(size_t threads, size_t n, severity_level sev = info)
+        {
+            std::vector<std::thread> t;
+            for(size_t i = 0; i < threads; i++)
+                t.emplace_back([this, n, sev]() { log(n, sev); });
+
+            for(auto& x: t)
+                x.join();
+        }
+
+        /// Lines in \a path, or in all of the files in dir if empty
+        std::vector<std::string> lines(fs::path const &path = fs::path()) const
+        {
+            std::vector<std::string> result;
+
+            std::vector<fs::path> files;
+            if(path.empty())
+                files.assign(fs::directory_iterator(dir), fs::directory_iterator());
+            else
+                files.push_back(path);
+
+            for(auto& f: files) {
+                std::ifstream in(f.string());
+                std::string line;
+                while(std::getline(in, line))
+                    result.push_back(line);
+            }
+
+            return result;
+        }
+    };
+
+    size_t countContaining(std::vector<std::string> const &lines, std::string const &s)
+    {
+        return std::count_if(lines.cbegin(), lines.cend(), [&s](std::string const &l) { return l.find(s) != std::string::npos; });
+    }
+
+    /// Adds up the N of the "N log records dropped" warnings
+    uint64_t reportedDropped(std::vector<std::string> const &lines)
+    {
+        uint64_t n = 0;
+        for(auto& l: lines) {
+            auto pos = l.find(" log records dropped");
+            if(pos != std::string::npos)
+                n += std::stoull(l.substr(l.rfind(' ', pos - 1) + 1));
+        }
+
+        return n;
+    }
+}
+
+BOOST_AUTO_TEST_SUITE(AsyncBackendTests)
+
+BOOST_AUTO_TEST_CASE(Ring)
+{
+    AsyncBackend::Options o;
+    o.capacity = 1000;
+    o.overflow = AsyncBackend::Overflow::BLOCK;
+
+    Backend b(o);
+    b.log(3000);
+    b.backend->stop();
+
+    // Records come out in order, across several turns of the ring
+    auto lines = b.lines(b.file);
+    BOOST_REQUIRE_EQUAL(lines.size(), 3000);
+    for(size_t i = 0; i < lines.size(); i++)
+        BOOST_CHECK(lines[i].find("/info: record " + std::to_string(i)) != std::string::npos);
+
+    BOOST_CHECK_EQUAL(b.backend->getDropped(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(AfterStop)
+{
+    Backend b{AsyncBackend::Options()};
+    b.log(10);
+    b.backend->stop();
+    b.log(5);
+
+    BOOST_CHECK_EQUAL(b.lines().size(), 10);
+    BOOST_CHECK_EQUAL(b.backend->getDropped(), 5);
+}
+
+BOOST_AUTO_TEST_CASE(Drop)
+{
+    AsyncBackend::Options o;
+    o.capacity = 2;
+
+    Backend b(o);
+    b.logFrom(4, 2000);
+    b.backend->stop();
+
+    // Every record is either written or counted, and the count is reported
+    auto lines = b.lines();
+    const uint64_t dropped = b.backend->getDropped();
+    BOOST_CHECK_EQUAL(countContaining(lines, ": record "), 8000 - dropped);
+    BOOST_CHECK_EQUAL(reportedDropped(lines), dropped);
+}
+
+BOOST_AUTO_TEST_CASE(Block)
+{
+    AsyncBackend::Options o;
+    o.capacity = 2;
+    o.overflow = AsyncBackend::Overflow::BLOCK;
+
+    Backend b(o);
+    b.logFrom(4, 2000);
+    b.backend->stop();
+
+    auto lines = b.lines();
+    BOOST_CHECK_EQUAL(countContaining(lines, ": record "), 8000);
+    BOOST_CHECK_EQUAL(countContaining(lines, "log records dropped"), 0);
+    BOOST_CHECK_EQUAL(b.backend->getDropped(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(Sample)
+{
+    AsyncBackend::Options o;
+    o.capacity = 16;
+    o.overflow = AsyncBackend::Overflow::SAMPLE;
+    o.sampleRate = 4;
+
+    Backend b(o);
+    b.logFrom(4, 2000);
+    b.backend->stop();
+
+    auto lines = b.lines();
+    const uint64_t dropped = b.backend->getDropped();
+    BOOST_CHECK_EQUAL(countContaining(lines, ": record "), 8000 - dropped);
+    BOOST_CHECK_EQUAL(reportedDropped(lines), dropped);
+}
+
+BOOST_AUTO_TEST_CASE(SampleKeepsWarnings)
+{
+    AsyncBackend::Options o;
+    o.capacity = 16;
+    o.overflow = AsyncBackend::Overflow::SAMPLE;
+    o.sampleRate = 1000;
+
+    Backend b(o);
+
+    // Only a full ring drops warnings, not sampling
+    const size_t n = 8;
+    std::vector<std::thread> t;
+    t.emplace_back([&b]() { b.log(20000); });
+    t.emplace_back([&b]() { b.log(n, warning); });
+    for(auto& x: t)
+        x.join();
+
+    b.backend->stop();
+
+    auto lines = b.lines();
+    const size_t warnings = countContaining(lines, "/warning: record ");
+    const uint64_t dropped = b.backend->getDropped();
+    BOOST_CHECK_EQUAL(countContaining(lines, ": record "), 20000 + n - dropped);
+    BOOST_CHECK(warnings == n || dropped);
+}
+
+BOOST_AUTO_TEST_CASE(RotateSize)
+{
+    AsyncBackend::Options o;
+    o.rotateSize = 1;
+
+    Backend b(o);
+    for(int i = 0; i < 4; i++) {
+        b.log(10);
+        std::this_thread::sleep_for(std::chrono::milliseconds(250));
+    }
+
+    b.backend->stop();
+
+    // Every batch after the first went to a new file
+    std::vector<fs::path> files(fs::directory_iterator(b.dir), (fs::directory_iterator()));
+    BOOST_CHECK_GE(files.size(), 4);
+    BOOST_CHECK_EQUAL(countContaining(b.lines(), ": record "), 40);
+    BOOST_CHECK_EQUAL(b.backend->getRotateFailures(), 0);
+
+    for(auto& f: files)
+        BOOST_CHECK(f == b.file || f.filename().string().compare(0, 4, "log.") == 0);
+}
+
+BOOST_AUTO_TEST_CASE(RotateFailure)
+{
+    AsyncBackend::Options o;
+    o.rotateSize = 1;
+
+    Backend b(o);
+    b.log(10);
+    std::this_thread::sleep_for(std::chrono::milliseconds(250));
+
+    // The writer can neither rename the file nor open a new one
+    const fs::path moved = b.dir.string() + "-moved";
+    fs::rename(b.dir, moved);
+
+    b.log(10);
+    std::this_thread::sleep_for(std::chrono::milliseconds(250));
+    b.backend->stop();
+
+    fs::rename(moved, b.dir);
+
+    // So it carried on with the file it had
+    std::vector<std::string> lines = b.lines();
+    BOOST_CHECK_EQUAL(countContaining(lines, ": record "), 20);
+    BOOST_CHECK_EQUAL(countContaining(lines, "could not open log file"), b.backend->getRotateFailures());
+    BOOST_CHECK_GE(b.backend->getRotateFailures(), 1);
+    BOOST_CHECK_EQUAL(b.backend->getDropped(), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
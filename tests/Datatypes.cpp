@@ -2,6 +2,7 @@
 #define BOOST_TEST_DYN_LINK
 
 #include <i2pcpp/datatypes/RouterInfo.h>
+#include <i2pcpp/datatypes/BuildRecordBlock.h>
 #include <i2pcpp/datatypes/StaticByteArray.h>
 #include <i2pcpp/datatypes/Mapping.h>
 #include <i2pcpp/datatypes/Date.h>
@@ -331,3 +332,85 @@ BOOST_AUTO_TEST_CASE(IncorrectThrows)
 }
 
 BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(BuildRecordBlockTests)
+
+namespace {
+    i2pcpp::ByteArray sampleBlock(unsigned char count)
+    {
+        i2pcpp::ByteArray ba(1 + count * i2pcpp::BuildRecordBlock::RECORD_SIZE);
+        ba[0] = count;
+        for(size_t i = 1; i < ba.size(); i++)
+            ba[i] = (unsigned char)(i * 7);
+
+        return ba;
+    }
+}
+
+BOOST_AUTO_TEST_CASE(RoundTrip)
+{
+    const i2pcpp::ByteArray ba = sampleBlock(3);
+    auto it = ba.cbegin();
+    i2pcpp::BuildRecordBlock block(it, ba.cend());
+
+    BOOST_CHECK_EQUAL(block.size(), 3);
+    BOOST_CHECK(it == ba.cend());
+    BOOST_CHECK(block.serialize() == ba);
+    BOOST_CHECK(block.get(1).serialize() == i2pcpp::ByteArray(ba.cbegin() + 1 + 528, ba.cbegin() + 1 + 2 * 528));
+}
+
+BOOST_AUTO_TEST_CASE(ShortThrows)
+{
+    const i2pcpp::ByteArray ba(1 + 528, 2);
+    auto it = ba.cbegin();
+    BOOST_CHECK_THROW(i2pcpp::BuildRecordBlock block(it, ba.cend()), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(FindAndSet)
+{
+    const i2pcpp::ByteArray ba = sampleBlock(4);
+    auto it = ba.cbegin();
+    i2pcpp::BuildRecordBlock block(it, ba.cend());
+
+    i2pcpp::BuildRecord r = block.get(2);
+    BOOST_CHECK_EQUAL(block.find(r.getHeader()), 2);
+
+    i2pcpp::StaticByteArray<16> header;
+    header.fill(0xAA);
+    r.setHeader(header);
+    block.set(0, r);
+
+    BOOST_CHECK_EQUAL(block.find(header), 0);
+    header.fill(0xBB);
+    BOOST_CHECK_EQUAL(block.find(header), block.size());
+}
+
+BOOST_AUTO_TEST_CASE(MatchesBuildRecord)
+{
+    const i2pcpp::ByteArray ba = sampleBlock(2);
+    auto it = ba.cbegin();
+    i2pcpp::BuildRecordBlock block(it, ba.cend());
+
+    i2pcpp::StaticByteArray<16> iv;
+    iv.fill(0x11);
+    i2pcpp::SessionKey key;
+    key.fill(0x22);
+
+    i2pcpp::BuildRecord r = block.get(1);
+    r.encrypt(iv, key);
+    block.encrypt(iv, key);
+    BOOST_CHECK(block.get(1).serialize() == r.serialize());
+
+    block.decrypt(iv, key, 1);
+    BOOST_CHECK(block.get(1).serialize() == r.serialize());
+
+    it = ba.cbegin();
+    i2pcpp::BuildRecordBlock plain(it, ba.cend());
+    BOOST_CHECK(block.get(0).serialize() == plain.get(0).serialize());
+
+    plain.encrypt(iv, key);
+    plain.decrypt(iv, key);
+    BOOST_CHECK(plain.serialize() == ba);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,253 @@
+#include <lib/i2p/OutboundQueue.h>
+#include <lib/i2p/ProfileManager.h>
+#include <lib/i2p/i2np/Message.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <ctime>
+
+using namespace i2pcpp;
+
+BOOST_AUTO_TEST_SUITE(OutboundQueueTests)
+
+namespace {
+    /**
+     * A message with a given expiration, in seconds since the epoch.
+     */
+    class TestMessage : public I2NP::Message {
+        public:
+            TestMessage(uint32_t msgId, uint32_t expiration) :
+                Message(msgId)
+            {
+                m_expiration = expiration;
+            }
+
+        protected:
+            ByteArray compile() const
+            {
+                return ByteArray();
+            }
+    };
+
+    I2NP::MessagePtr makeMessage(uint32_t msgId, int32_t validFor = 60)
+    {
+        return std::make_shared<TestMessage>(msgId, std::time(nullptr) + validFor);
+    }
+
+    typedef OutboundQueue::Priority Priority;
+}
+
+struct QueueFixture {
+    OutboundQueue q;
+    RouterHash rh;
+
+    bool push(Priority p, uint32_t msgId, size_t size = 10)
+    {
+        return q.push(rh, p, makeMessage(msgId), ByteArray(size));
+    }
+
+    I2NP::MessagePtr pop(Priority &p)
+    {
+        ByteArray data;
+        uint64_t waited;
+
+        return q.pop(rh, p, data, waited);
+    }
+};
+
+BOOST_FIXTURE_TEST_CASE(ControlFirst, QueueFixture)
+{
+    BOOST_CHECK(push(Priority::PARTICIPATING, 1));
+    BOOST_CHECK(push(Priority::TUNNEL, 2));
+    BOOST_CHECK(push(Priority::CONTROL, 3));
+
+    Priority p;
+    BOOST_REQUIRE(pop(p));
+    BOOST_CHECK(p == Priority::CONTROL);
+}
+
+BOOST_FIXTURE_TEST_CASE(WeightedRoundRobin, QueueFixture)
+{
+    for(uint32_t i = 0; i < 20; i++) {
+        BOOST_CHECK(push(Priority::CONTROL, i));
+        BOOST_CHECK(push(Priority::NETDB, 100 + i));
+    }
+
+    // Eight control messages, four netdb and back to control
+    std::vector<Priority> order;
+    Priority p;
+    for(int i = 0; i < 16; i++) {
+        BOOST_REQUIRE(pop(p));
+        order.push_back(p);
+    }
+
+    const std::vector<Priority> expected = {
+        Priority::CONTROL, Priority::CONTROL, Priority::CONTROL, Priority::CONTROL,
+        Priority::CONTROL, Priority::CONTROL, Priority::CONTROL, Priority::CONTROL,
+        Priority::NETDB, Priority::NETDB, Priority::NETDB, Priority::NETDB,
+        Priority::CONTROL, Priority::CONTROL, Priority::CONTROL, Priority::CONTROL
+    };
+    BOOST_CHECK(order == expected);
+}
+
+BOOST_FIXTURE_TEST_CASE(FifoWithinClass, QueueFixture)
+{
+    for(uint32_t i = 0; i < 5; i++)
+        BOOST_CHECK(push(Priority::TUNNEL, i));
+
+    Priority p;
+    for(uint32_t i = 0; i < 5; i++) {
+        I2NP::MessagePtr msg = pop(p);
+        BOOST_REQUIRE(msg);
+        BOOST_CHECK_EQUAL(msg->getMsgId(), i);
+    }
+
+    BOOST_CHECK(!pop(p));
+    BOOST_CHECK(!q.contains(rh));
+}
+
+BOOST_AUTO_TEST_CASE(DropWhenFull)
+{
+    OutboundQueue q(100, 150);
+    RouterHash a, b;
+    b.fill(0x01);
+
+    BOOST_CHECK(q.push(a, Priority::TUNNEL, makeMessage(1), ByteArray(60)));
+
+    // Over the limit of the peer
+    BOOST_CHECK(!q.push(a, Priority::TUNNEL, makeMessage(2), ByteArray(60)));
+
+    // Over the limit of the queue as a whole
+    BOOST_CHECK(q.push(b, Priority::NETDB, makeMessage(3), ByteArray(60)));
+    BOOST_CHECK(!q.push(b, Priority::NETDB, makeMessage(4), ByteArray(40)));
+
+    OutboundQueue::Stats s = q.getStats();
+    BOOST_CHECK_EQUAL(s.dropped[(size_t)Priority::TUNNEL], 1);
+    BOOST_CHECK_EQUAL(s.dropped[(size_t)Priority::NETDB], 1);
+    BOOST_CHECK_EQUAL(s.depth[(size_t)Priority::TUNNEL], 1);
+    BOOST_CHECK_EQUAL(s.depth[(size_t)Priority::NETDB], 1);
+    BOOST_CHECK_EQUAL(s.bytes, 120);
+
+    q.erase(a);
+    s = q.getStats();
+    BOOST_CHECK_EQUAL(s.dropped[(size_t)Priority::TUNNEL], 2);
+    BOOST_CHECK_EQUAL(s.depth[(size_t)Priority::TUNNEL], 0);
+    BOOST_CHECK_EQUAL(s.bytes, 60);
+    BOOST_CHECK(!q.contains(a));
+}
+
+BOOST_FIXTURE_TEST_CASE(DropExpired, QueueFixture)
+{
+    BOOST_CHECK(q.push(rh, Priority::TUNNEL, makeMessage(1, -1), ByteArray(10)));
+    BOOST_CHECK(push(Priority::TUNNEL, 2));
+
+    Priority p;
+    I2NP::MessagePtr msg = pop(p);
+    BOOST_REQUIRE(msg);
+    BOOST_CHECK_EQUAL(msg->getMsgId(), 2);
+
+    OutboundQueue::Stats s = q.getStats();
+    BOOST_CHECK_EQUAL(s.expired[(size_t)Priority::TUNNEL], 1);
+    BOOST_CHECK_EQUAL(s.depth[(size_t)Priority::TUNNEL], 0);
+    BOOST_CHECK_EQUAL(s.bytes, 0);
+}
+
+BOOST_FIXTURE_TEST_CASE(ExpireForgetsPeers, QueueFixture)
+{
+    BOOST_CHECK(q.push(rh, Priority::NETDB, makeMessage(1, -1), ByteArray(10)));
+    BOOST_CHECK(q.contains(rh));
+
+    q.expire();
+    BOOST_CHECK(!q.contains(rh));
+    BOOST_CHECK_EQUAL(q.getStats().expired[(size_t)Priority::NETDB], 1);
+    BOOST_CHECK_EQUAL(q.getStats().bytes, 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(ProfileTests)
+
+namespace {
+    const uint64_t HALF_LIFE = ProfileManager::DECAY_HALF_LIFE;
+}
+
+BOOST_AUTO_TEST_CASE(Decay)
+{
+    ProfileManager::Profile p;
+    p.buildSuccess = 100;
+    p.buildFailure = 40;
+    p.connectFailure = 8;
+    p.consecutiveFailures = 4;
+    p.lastDecay = 1000;
+
+    ProfileManager::decay(p, 1000 + HALF_LIFE - 1);
+    BOOST_CHECK_EQUAL(p.buildSuccess, 100);
+    BOOST_CHECK_EQUAL(p.lastDecay, 1000);
+
+    ProfileManager::decay(p, 1000 + HALF_LIFE);
+    BOOST_CHECK_EQUAL(p.buildSuccess, 50);
+    BOOST_CHECK_EQUAL(p.buildFailure, 20);
+    BOOST_CHECK_EQUAL(p.connectFailure, 4);
+    BOOST_CHECK_EQUAL(p.consecutiveFailures, 2);
+
+    // Time short of a half-life is not lost
+    ProfileManager::decay(p, 1000 + HALF_LIFE * 5 / 2);
+    BOOST_CHECK_EQUAL(p.buildSuccess, 25);
+    BOOST_CHECK_EQUAL(p.lastDecay, 1000 + HALF_LIFE * 2);
+
+    ProfileManager::decay(p, 1000 + HALF_LIFE * 3);
+    BOOST_CHECK_EQUAL(p.buildSuccess, 12);
+}
+
+BOOST_AUTO_TEST_CASE(DecayStart)
+{
+    // Profiles stored before counters decayed start counting on load
+    ProfileManager::Profile p;
+    p.buildFailure = 10;
+    ProfileManager::decay(p, 5000);
+    BOOST_CHECK_EQUAL(p.buildFailure, 10);
+    BOOST_CHECK_EQUAL(p.lastDecay, 5000);
+
+    // Long absences clear everything
+    ProfileManager::decay(p, 5000 + HALF_LIFE * 40);
+    BOOST_CHECK_EQUAL(p.buildFailure, 0);
+    BOOST_CHECK_EQUAL(p.lastDecay, 5000 + HALF_LIFE * 40);
+}
+
+BOOST_AUTO_TEST_CASE(FailingRecovers)
+{
+    ProfileManager::Profile p;
+    p.buildFailure = 100;
+    p.lastDecay = 1000;
+    BOOST_CHECK(ProfileManager::isFailing(p));
+    BOOST_CHECK_LT(ProfileManager::getCapacity(p), 0.1);
+
+    // Too few failures left to judge the peer by
+    ProfileManager::decay(p, 1000 + HALF_LIFE * 5);
+    BOOST_CHECK(!ProfileManager::isFailing(p));
+
+    ProfileManager::Profile q;
+    q.consecutiveFailures = ProfileManager::MAX_CONNECT_FAILURES;
+    q.lastDecay = 1000;
+    BOOST_CHECK(ProfileManager::isFailing(q));
+
+    ProfileManager::decay(q, 1000 + HALF_LIFE);
+    BOOST_CHECK(!ProfileManager::isFailing(q));
+}
+
+BOOST_AUTO_TEST_CASE(Capacity)
+{
+    ProfileManager::Profile p;
+    BOOST_CHECK_CLOSE(ProfileManager::getCapacity(p), 0.5, 0.001);
+
+    // The success rate survives the decay
+    p.buildSuccess = 300;
+    p.buildFailure = 100;
+    p.lastDecay = 1000;
+    const double before = ProfileManager::getCapacity(p);
+
+    ProfileManager::decay(p, 1000 + HALF_LIFE * 2);
+    BOOST_CHECK_CLOSE(ProfileManager::getCapacity(p), before, 1.0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,369 @@
+#include <lib/ssu/CompletedMessages.h>
+#include <lib/ssu/InboundMessageState.h>
+#include <lib/ssu/PacketHandler.h>
+#include <lib/ssu/PeerState.h>
+#include <lib/ssu/ReplayFilter.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <array>
+
+using namespace i2pcpp;
+
+BOOST_AUTO_TEST_SUITE(InboundMessageStateTests)
+
+struct MessageFixture {
+    // Three fragments of 4, 4 and 2 bytes
+    const ByteArray message = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
+    SSU::InboundMessageState ims;
+
+    MessageFixture() :
+        ims(RouterHash(), 1) {}
+
+    bool add(uint8_t fragNum)
+    {
+        auto begin = message.cbegin() + fragNum * 4;
+        auto end = std::min(begin + 4, message.cend());
+        return ims.addFragment(fragNum, begin, end, fragNum == 2);
+    }
+};
+
+BOOST_FIXTURE_TEST_CASE(InOrder, MessageFixture)
+{
+    BOOST_CHECK(add(0));
+    BOOST_CHECK(add(1));
+    BOOST_CHECK(!ims.allFragmentsReceived());
+    BOOST_CHECK(add(2));
+    BOOST_CHECK(ims.allFragmentsReceived());
+
+    ByteArray res = ims.assemble();
+    BOOST_CHECK_EQUAL_COLLECTIONS(res.begin(), res.end(), message.begin(), message.end());
+}
+
+BOOST_FIXTURE_TEST_CASE(OutOfOrder, MessageFixture)
+{
+    BOOST_CHECK(add(1));
+    BOOST_CHECK(add(2));
+    BOOST_CHECK(!ims.allFragmentsReceived());
+    BOOST_CHECK(add(0));
+    BOOST_CHECK(ims.allFragmentsReceived());
+
+    ByteArray res = ims.assemble();
+    BOOST_CHECK_EQUAL_COLLECTIONS(res.begin(), res.end(), message.begin(), message.end());
+}
+
+BOOST_FIXTURE_TEST_CASE(LastFragmentFirst, MessageFixture)
+{
+    BOOST_CHECK(add(2));
+    BOOST_CHECK(add(0));
+    BOOST_CHECK(add(1));
+    BOOST_CHECK(ims.allFragmentsReceived());
+
+    ByteArray res = ims.assemble();
+    BOOST_CHECK_EQUAL_COLLECTIONS(res.begin(), res.end(), message.begin(), message.end());
+}
+
+BOOST_FIXTURE_TEST_CASE(Duplicate, MessageFixture)
+{
+    BOOST_CHECK(add(0));
+    BOOST_CHECK(!add(0));
+    BOOST_CHECK(add(2));
+    BOOST_CHECK(!add(2));
+    BOOST_CHECK(!ims.allFragmentsReceived());
+    BOOST_CHECK_EQUAL(ims.getFragmentsReceived().count(), 2);
+    BOOST_CHECK(add(1));
+    BOOST_CHECK(ims.allFragmentsReceived());
+
+    ByteArray res = ims.assemble();
+    BOOST_CHECK_EQUAL_COLLECTIONS(res.begin(), res.end(), message.begin(), message.end());
+}
+
+BOOST_FIXTURE_TEST_CASE(InconsistentSize, MessageFixture)
+{
+    BOOST_CHECK(add(0));
+    auto begin = message.cbegin() + 4;
+    BOOST_CHECK(!ims.addFragment(1, begin, begin + 3, false));
+    BOOST_CHECK(!ims.getFragmentsReceived()[1]);
+}
+
+BOOST_FIXTURE_TEST_CASE(FragmentAfterLast, MessageFixture)
+{
+    BOOST_CHECK(add(2));
+    auto begin = message.cbegin();
+    BOOST_CHECK(!ims.addFragment(3, begin, begin + 4, false));
+}
+
+BOOST_AUTO_TEST_CASE(SingleFragment)
+{
+    const ByteArray message = { 1, 2, 3 };
+    SSU::InboundMessageState ims(RouterHash(), 1);
+    BOOST_CHECK(ims.addFragment(0, message.cbegin(), message.cend(), true));
+    BOOST_CHECK(ims.allFragmentsReceived());
+
+    ByteArray res = ims.assemble();
+    BOOST_CHECK_EQUAL_COLLECTIONS(res.begin(), res.end(), message.begin(), message.end());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(CompletedMessagesTests)
+
+BOOST_AUTO_TEST_CASE(RemembersDelivered)
+{
+    typedef SSU::CompletedMessages::Clock Clock;
+
+    SSU::CompletedMessages cm(std::chrono::seconds(60), 100);
+    RouterHash a, b;
+    b.fill(0x01);
+
+    const Clock::time_point now = Clock::now();
+    cm.insert(a, 1, now);
+    BOOST_CHECK(cm.contains(a, 1, now));
+    BOOST_CHECK(!cm.contains(a, 2, now));
+
+    // The same message ID from another peer is a different message
+    BOOST_CHECK(!cm.contains(b, 1, now));
+
+    BOOST_CHECK(cm.contains(a, 1, now + std::chrono::seconds(59)));
+    BOOST_CHECK(!cm.contains(a, 1, now + std::chrono::seconds(60)));
+
+    cm.insert(a, 2, now + std::chrono::seconds(60));
+    BOOST_CHECK_EQUAL(cm.size(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(Capacity)
+{
+    SSU::CompletedMessages cm(std::chrono::seconds(60), 10);
+    RouterHash rh;
+
+    for(uint32_t i = 0; i < 100; i++)
+        cm.insert(rh, i);
+
+    BOOST_CHECK_EQUAL(cm.size(), 10);
+    BOOST_CHECK(cm.contains(rh, 99));
+    BOOST_CHECK(!cm.contains(rh, 0));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(ReplayFilterTests)
+
+namespace {
+    typedef SSU::ReplayFilter::Clock Clock;
+
+    std::array<unsigned char, 16> makeIV(uint32_t n)
+    {
+        // Spread the counter over both halves, like a random IV would be
+        std::array<unsigned char, 16> iv;
+        for(size_t i = 0; i < iv.size(); i++)
+            iv[i] = (unsigned char)((n * 2654435761U) >> ((i % 4) * 8)) ^ (unsigned char)(i * 37 + (n >> 8));
+
+        return iv;
+    }
+}
+
+struct FilterFixture {
+    SSU::ReplayFilter filter;
+    Clock::time_point start;
+
+    FilterFixture() :
+        filter(SSU::ReplayFilter::PEER_BITS, SSU::ReplayFilter::PEER_CAPACITY, std::chrono::seconds(SSU::ReplayFilter::WINDOW)),
+        start(Clock::now()) {}
+
+    Clock::time_point at(int seconds) const
+    {
+        return start + std::chrono::seconds(seconds);
+    }
+};
+
+BOOST_FIXTURE_TEST_CASE(InsertContains, FilterFixture)
+{
+    for(uint32_t i = 0; i < 100; i++) {
+        BOOST_CHECK(!filter.contains(makeIV(i).data(), at(0)));
+        filter.insert(makeIV(i).data(), at(0));
+        BOOST_CHECK(filter.contains(makeIV(i).data(), at(0)));
+    }
+
+    for(uint32_t i = 0; i < 100; i++)
+        BOOST_CHECK(filter.contains(makeIV(i).data(), at(1)));
+
+    BOOST_CHECK(!filter.contains(makeIV(1000).data(), at(1)));
+}
+
+BOOST_FIXTURE_TEST_CASE(CountsDuplicates, FilterFixture)
+{
+    filter.insert(makeIV(1).data(), at(0));
+
+    BOOST_CHECK(!filter.check(makeIV(2).data(), at(0)));
+    BOOST_CHECK(filter.check(makeIV(1).data(), at(0)));
+    BOOST_CHECK(filter.check(makeIV(1).data(), at(1)));
+    BOOST_CHECK_EQUAL(filter.getDuplicates(), 2);
+
+    // contains() only looks
+    BOOST_CHECK(filter.contains(makeIV(1).data(), at(1)));
+    BOOST_CHECK_EQUAL(filter.getDuplicates(), 2);
+}
+
+BOOST_FIXTURE_TEST_CASE(Expiry, FilterFixture)
+{
+    const int window = SSU::ReplayFilter::WINDOW;
+
+    filter.insert(makeIV(1).data(), at(0));
+
+    // Generations rotate as packets keep coming, the IV is kept for the window
+    for(int t = 10; t < window; t += 10) {
+        filter.insert(makeIV(1000 + t).data(), at(t));
+        BOOST_CHECK(filter.contains(makeIV(1).data(), at(t)));
+    }
+
+    for(int t = window; t <= 2 * window; t += 10)
+        filter.insert(makeIV(1000 + t).data(), at(t));
+
+    BOOST_CHECK(!filter.contains(makeIV(1).data(), at(2 * window)));
+    BOOST_CHECK_EQUAL(filter.getEarlyRotations(), 0);
+}
+
+BOOST_FIXTURE_TEST_CASE(ExpiryWhenIdle, FilterFixture)
+{
+    const int window = SSU::ReplayFilter::WINDOW;
+
+    // Without inserts nothing rotates, lookups ignore stale generations
+    filter.insert(makeIV(1).data(), at(0));
+    BOOST_CHECK(filter.contains(makeIV(1).data(), at(window)));
+    BOOST_CHECK(!filter.contains(makeIV(1).data(), at(3 * window)));
+}
+
+BOOST_AUTO_TEST_CASE(FixedSize)
+{
+    SSU::ReplayFilter filter(1024, 16, std::chrono::seconds(SSU::ReplayFilter::WINDOW));
+    const size_t size = filter.getSize();
+    BOOST_CHECK(size == SSU::ReplayFilter::NUM_GENERATIONS * 1024 / 8);
+
+    // A flood rotates generations early instead of growing the filter
+    const Clock::time_point now = Clock::now();
+    for(uint32_t i = 0; i < 1000; i++)
+        filter.insert(makeIV(i).data(), now);
+
+    BOOST_CHECK_EQUAL(filter.getSize(), size);
+    BOOST_CHECK_GT(filter.getEarlyRotations(), 0);
+    BOOST_CHECK(filter.contains(makeIV(999).data(), now));
+    BOOST_CHECK(!filter.contains(makeIV(0).data(), now));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(PacketHandlerTests)
+
+BOOST_AUTO_TEST_CASE(ClockSkew)
+{
+    const uint32_t now = 1400000000;
+    const uint32_t skew = SSU::PacketHandler::MAX_CLOCK_SKEW;
+
+    BOOST_CHECK(SSU::PacketHandler::isTimely(now, now));
+    BOOST_CHECK(SSU::PacketHandler::isTimely(now - skew, now));
+    BOOST_CHECK(SSU::PacketHandler::isTimely(now + skew, now));
+    BOOST_CHECK(!SSU::PacketHandler::isTimely(now - skew - 1, now));
+    BOOST_CHECK(!SSU::PacketHandler::isTimely(now + skew + 1, now));
+    BOOST_CHECK(!SSU::PacketHandler::isTimely(0, now));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(PeerStateTests)
+
+namespace {
+    SessionKey makeKey(unsigned char c)
+    {
+        SessionKey sk;
+        sk.fill(c);
+
+        return sk;
+    }
+}
+
+struct PeerFixture {
+    typedef std::chrono::steady_clock Clock;
+
+    SSU::PeerState ps;
+    Clock::time_point start;
+
+    PeerFixture() :
+        ps(Endpoint("127.0.0.1", 12345), RouterIdentity(ByteArray(256), ByteArray(128), Certificate()), true),
+        start(Clock::now())
+    {
+        ps.setCurrentSessionKey(makeKey(1));
+        ps.setCurrentMacKey(makeKey(2));
+    }
+
+    Clock::time_point at(int seconds) const
+    {
+        return start + std::chrono::seconds(seconds);
+    }
+};
+
+BOOST_FIXTURE_TEST_CASE(DualKeyWindow, PeerFixture)
+{
+    BOOST_CHECK(ps.keysConfirmed());
+    BOOST_CHECK(!ps.inGraceWindow(at(0)));
+
+    // The responder switches when it gets the SessionConfirmed
+    ps.setNextSessionKey(makeKey(3));
+    ps.setNextMacKey(makeKey(4));
+    ps.rotateKeys(at(0));
+    BOOST_CHECK(ps.getCurrentMacKey() == makeKey(4));
+    BOOST_CHECK(ps.getPreviousMacKey() == makeKey(2));
+
+    // The old keys are accepted for as long as the peer keeps using them
+    BOOST_CHECK(!ps.keysConfirmed());
+    BOOST_CHECK(ps.inGraceWindow(at(10 * SSU::PeerState::REKEY_GRACE)));
+
+    // and for a grace window once it has switched
+    ps.confirmKeys(at(100));
+    BOOST_CHECK(ps.inGraceWindow(at(100 + SSU::PeerState::REKEY_GRACE - 1)));
+    BOOST_CHECK(!ps.inGraceWindow(at(100 + SSU::PeerState::REKEY_GRACE)));
+
+    // Confirming again does not extend it
+    ps.confirmKeys(at(1000));
+    BOOST_CHECK(!ps.inGraceWindow(at(1000)));
+}
+
+BOOST_FIXTURE_TEST_CASE(LostConfirmed, PeerFixture)
+{
+    // The initiator keeps sending with the old keys until the peer switches
+    ps.setPendingKeys(makeKey(3), makeKey(4));
+    BOOST_CHECK(ps.hasPendingKeys());
+    BOOST_CHECK(ps.getCurrentMacKey() == makeKey(2));
+    BOOST_CHECK(ps.getNextMacKey() == makeKey(4));
+
+    // The SessionConfirmed never arrived, a second rekey replaces the keys
+    ps.setPendingKeys(makeKey(5), makeKey(6));
+    BOOST_CHECK(ps.getCurrentMacKey() == makeKey(2));
+    BOOST_CHECK(ps.getNextMacKey() == makeKey(6));
+
+    // This time the peer uses them
+    ps.rotateKeys(at(0));
+    ps.confirmKeys(at(0));
+    BOOST_CHECK(!ps.hasPendingKeys());
+    BOOST_CHECK(ps.getCurrentSessionKey() == makeKey(5));
+    BOOST_CHECK(ps.getCurrentMacKey() == makeKey(6));
+    BOOST_CHECK(ps.getPreviousMacKey() == makeKey(2));
+    BOOST_CHECK(ps.inGraceWindow(at(1)));
+}
+
+BOOST_FIXTURE_TEST_CASE(UnusedKeysNotKept, PeerFixture)
+{
+    // A responder whose new keys were never used keeps the old ones
+    ps.setNextSessionKey(makeKey(3));
+    ps.setNextMacKey(makeKey(4));
+    ps.rotateKeys(at(0));
+
+    ps.setNextSessionKey(makeKey(5));
+    ps.setNextMacKey(makeKey(6));
+    ps.rotateKeys(at(60));
+
+    BOOST_CHECK(ps.getCurrentMacKey() == makeKey(6));
+    BOOST_CHECK(ps.getPreviousMacKey() == makeKey(2));
+    BOOST_CHECK(ps.inGraceWindow(at(1000)));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
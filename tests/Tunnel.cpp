@@ -0,0 +1,487 @@
+#include <lib/i2p/tunnel/AdmissionController.h>
+#include <lib/i2p/tunnel/FirstFragment.h>
+#include <lib/i2p/tunnel/FollowOnFragment.h>
+#include <lib/i2p/tunnel/FragmentState.h>
+#include <lib/i2p/tunnel/FragmentView.h>
+#include <lib/i2p/tunnel/Gateway.h>
+#include <lib/i2p/tunnel/InboundTunnel.h>
+#include <lib/i2p/tunnel/OutboundTunnel.h>
+#include <lib/i2p/tunnel/Pool.h>
+
+#include <i2pcpp/datatypes/RouterIdentity.h>
+
+#include <boost/test/unit_test.hpp>
+
+using namespace i2pcpp;
+
+BOOST_AUTO_TEST_SUITE(FragmentViewTests)
+
+BOOST_AUTO_TEST_CASE(ParseFirstFragment)
+{
+    // Local delivery, fragmented, message ID 0x01020304, 3 bytes
+    const ByteArray ba = { 0x08, 0x01, 0x02, 0x03, 0x04, 0x00, 0x03, 0xAA, 0xBB, 0xCC };
+    const unsigned char *pos = ba.data();
+    const unsigned char *end = ba.data() + ba.size();
+
+    Tunnel::FragmentView f = Tunnel::FragmentView::parse(pos, end);
+    BOOST_CHECK(f.first);
+    BOOST_CHECK(f.fragmented);
+    BOOST_CHECK_EQUAL(f.fragNum, 0);
+    BOOST_CHECK_EQUAL(f.msgId, 0x01020304);
+    BOOST_CHECK(f.mode == Tunnel::FirstFragment::DeliveryMode::LOCAL);
+    BOOST_CHECK_EQUAL(f.size, 3);
+    BOOST_CHECK(f.payload == ba.data() + 7);
+    BOOST_CHECK(pos == end);
+}
+
+BOOST_AUTO_TEST_CASE(ParseFollowOnFragment)
+{
+    // Fragment 5, the last one, message ID 0x01020304, 2 bytes
+    const ByteArray ba = { 0x80 | (5 << 1) | 0x01, 0x01, 0x02, 0x03, 0x04, 0x00, 0x02, 0xAA, 0xBB, 0xFF };
+    const unsigned char *pos = ba.data();
+    const unsigned char *end = ba.data() + ba.size();
+
+    Tunnel::FragmentView f = Tunnel::FragmentView::parse(pos, end);
+    BOOST_CHECK(!f.first);
+    BOOST_CHECK(f.last);
+    BOOST_CHECK_EQUAL(f.fragNum, 5);
+    BOOST_CHECK_EQUAL(f.msgId, 0x01020304);
+    BOOST_CHECK_EQUAL(f.size, 2);
+    BOOST_CHECK(pos == end - 1);
+}
+
+BOOST_AUTO_TEST_CASE(ParseTruncated)
+{
+    const ByteArray ba = { 0x08, 0x01, 0x02, 0x03, 0x04, 0x00, 0x03, 0xAA };
+    const unsigned char *pos = ba.data();
+
+    BOOST_CHECK_THROW(Tunnel::FragmentView::parse(pos, ba.data() + ba.size()), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(FragmentStateTests)
+
+struct FragmentFixture {
+    // Three fragments of 4, 4 and 2 bytes
+    const ByteArray message = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
+    Tunnel::FragmentState state;
+
+    bool add(uint8_t fragNum)
+    {
+        Tunnel::FragmentView f = {};
+        f.first = (fragNum == 0);
+        f.fragmented = true;
+        f.last = (fragNum == 2);
+        f.fragNum = fragNum;
+        f.msgId = 1;
+        f.payload = message.data() + fragNum * 4;
+        f.size = (fragNum == 2 ? 2 : 4);
+
+        return state.add(f);
+    }
+};
+
+BOOST_FIXTURE_TEST_CASE(InOrder, FragmentFixture)
+{
+    BOOST_CHECK(add(0));
+    BOOST_CHECK(add(1));
+    BOOST_CHECK(!state.isComplete());
+    BOOST_CHECK(add(2));
+    BOOST_CHECK(state.isComplete());
+
+    ByteArray res = state.compile();
+    BOOST_CHECK_EQUAL_COLLECTIONS(res.begin(), res.end(), message.begin(), message.end());
+}
+
+BOOST_FIXTURE_TEST_CASE(OutOfOrder, FragmentFixture)
+{
+    BOOST_CHECK(add(2));
+    BOOST_CHECK(add(0));
+    BOOST_CHECK(!state.isComplete());
+    BOOST_CHECK(add(1));
+    BOOST_CHECK(state.isComplete());
+
+    ByteArray res = state.compile();
+    BOOST_CHECK_EQUAL_COLLECTIONS(res.begin(), res.end(), message.begin(), message.end());
+}
+
+BOOST_FIXTURE_TEST_CASE(FirstFragmentLast, FragmentFixture)
+{
+    BOOST_CHECK(add(1));
+    BOOST_CHECK(add(2));
+    BOOST_CHECK(!state.isComplete());
+    BOOST_CHECK(add(0));
+    BOOST_CHECK(state.isComplete());
+
+    ByteArray res = state.compile();
+    BOOST_CHECK_EQUAL_COLLECTIONS(res.begin(), res.end(), message.begin(), message.end());
+}
+
+BOOST_FIXTURE_TEST_CASE(Duplicate, FragmentFixture)
+{
+    BOOST_CHECK(add(0));
+    BOOST_CHECK(!add(0));
+    BOOST_CHECK(add(2));
+    BOOST_CHECK(!add(2));
+    BOOST_CHECK(!state.isComplete());
+    BOOST_CHECK(add(1));
+    BOOST_CHECK(state.isComplete());
+
+    ByteArray res = state.compile();
+    BOOST_CHECK_EQUAL_COLLECTIONS(res.begin(), res.end(), message.begin(), message.end());
+}
+
+BOOST_FIXTURE_TEST_CASE(DeliveryInstructions, FragmentFixture)
+{
+    RouterHash rh;
+    rh.fill(0x42);
+
+    Tunnel::FragmentView f = {};
+    f.first = true;
+    f.fragmented = true;
+    f.msgId = 1;
+    f.mode = Tunnel::FirstFragment::DeliveryMode::TUNNEL;
+    f.tunnelId = 1234;
+    f.toHash = rh.data();
+    f.payload = message.data();
+    f.size = 4;
+
+    BOOST_CHECK(add(1));
+    BOOST_CHECK(state.add(f));
+    BOOST_CHECK(state.getDeliveryMode() == Tunnel::FirstFragment::DeliveryMode::TUNNEL);
+    BOOST_CHECK_EQUAL(state.getTunnelId(), 1234);
+    BOOST_CHECK(state.getToHash() == rh);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(GatewayTests)
+
+namespace {
+    ByteArray sampleMessage(size_t size)
+    {
+        ByteArray ba(size);
+        for(size_t i = 0; i < size; i++)
+            ba[i] = (unsigned char)(i * 7);
+
+        return ba;
+    }
+
+    uint16_t totalSize(std::list<Tunnel::FragmentPtr> const &fragments)
+    {
+        uint16_t total = 0;
+        for(auto& f: fragments)
+            total += f->size();
+
+        return total;
+    }
+}
+
+BOOST_AUTO_TEST_CASE(ExactFit)
+{
+    // A 3 byte unfragmented first fragment header and 1000 bytes
+    Tunnel::Gateway gw;
+    BOOST_CHECK(gw.add(sampleMessage(1000)));
+
+    auto messages = gw.pack(true);
+    BOOST_REQUIRE_EQUAL(messages.size(), 1);
+    BOOST_REQUIRE_EQUAL(messages[0].size(), 1);
+    BOOST_CHECK(totalSize(messages[0]) == Tunnel::Gateway::MAX_PAYLOAD);
+
+    auto ff = dynamic_cast<Tunnel::FirstFragment *>(messages[0].front().get());
+    BOOST_REQUIRE(ff);
+    BOOST_CHECK(!ff->isFragmented());
+    BOOST_CHECK(gw.empty());
+    BOOST_CHECK_EQUAL(gw.getQueued(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(AcrossBoundary)
+{
+    const ByteArray data = sampleMessage(1001);
+    Tunnel::Gateway gw;
+    BOOST_CHECK(gw.add(data));
+
+    auto messages = gw.pack(true);
+    BOOST_REQUIRE_EQUAL(messages.size(), 2);
+    BOOST_REQUIRE_EQUAL(messages[0].size(), 1);
+    BOOST_REQUIRE_EQUAL(messages[1].size(), 1);
+    BOOST_CHECK(totalSize(messages[0]) == Tunnel::Gateway::MAX_PAYLOAD);
+
+    auto ff = dynamic_cast<Tunnel::FirstFragment *>(messages[0].front().get());
+    auto fof = dynamic_cast<Tunnel::FollowOnFragment *>(messages[1].front().get());
+    BOOST_REQUIRE(ff && fof);
+    BOOST_CHECK(ff->isFragmented());
+    BOOST_CHECK_EQUAL(fof->getFragNum(), 1);
+    BOOST_CHECK(fof->isLast());
+    BOOST_CHECK_EQUAL(ff->getMsgId(), fof->getMsgId());
+
+    ByteArray res = ff->getPayload();
+    res.insert(res.end(), fof->getPayload().cbegin(), fof->getPayload().cend());
+    BOOST_CHECK_EQUAL_COLLECTIONS(res.begin(), res.end(), data.begin(), data.end());
+}
+
+BOOST_AUTO_TEST_CASE(SharedTunnelMessage)
+{
+    const ByteArray first = sampleMessage(600);
+    const ByteArray second = sampleMessage(600);
+    Tunnel::Gateway gw;
+    BOOST_CHECK(gw.add(first));
+    BOOST_CHECK(gw.add(second));
+    BOOST_CHECK_EQUAL(gw.getQueued(), 1200);
+
+    // The second message starts in the space the first one left
+    auto messages = gw.pack(true);
+    BOOST_REQUIRE_EQUAL(messages.size(), 2);
+    BOOST_REQUIRE_EQUAL(messages[0].size(), 2);
+    BOOST_REQUIRE_EQUAL(messages[1].size(), 1);
+    BOOST_CHECK(totalSize(messages[0]) == Tunnel::Gateway::MAX_PAYLOAD);
+
+    const ByteArray &a = messages[0].back()->getPayload();
+    const ByteArray &b = messages[1].front()->getPayload();
+    BOOST_CHECK_EQUAL(a.size() + b.size(), second.size());
+    BOOST_CHECK(gw.empty());
+}
+
+BOOST_AUTO_TEST_CASE(KeepsPartialMessage)
+{
+    Tunnel::Gateway gw;
+    BOOST_CHECK(gw.add(sampleMessage(500)));
+
+    BOOST_CHECK(gw.pack(false).empty());
+    BOOST_CHECK_EQUAL(gw.getQueued(), 500);
+    BOOST_CHECK_EQUAL(gw.pack(true).size(), 1);
+    BOOST_CHECK(gw.empty());
+}
+
+BOOST_AUTO_TEST_CASE(FollowOnLimit)
+{
+    Tunnel::Gateway gw;
+    BOOST_CHECK(!gw.add(sampleMessage(Tunnel::Gateway::MAX_MESSAGE_SIZE + 1)));
+    BOOST_CHECK(gw.empty());
+    BOOST_CHECK_EQUAL(gw.getQueued(), 0);
+
+    // Start the largest message in the space left by a smaller one
+    BOOST_CHECK(gw.add(sampleMessage(700)));
+    BOOST_CHECK(gw.add(sampleMessage(Tunnel::Gateway::MAX_MESSAGE_SIZE)));
+
+    std::vector<std::list<Tunnel::FragmentPtr>> messages;
+    BOOST_REQUIRE_NO_THROW(messages = gw.pack(true));
+    BOOST_CHECK(gw.empty());
+
+    auto fof = dynamic_cast<Tunnel::FollowOnFragment *>(messages.back().back().get());
+    BOOST_REQUIRE(fof);
+    BOOST_CHECK(fof->isLast());
+    BOOST_CHECK(fof->getFragNum() <= Tunnel::Gateway::MAX_FRAGMENT_NUMBER);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(AdmissionControllerTests)
+
+namespace {
+    typedef BuildResponseRecord::Reply Reply;
+}
+
+struct AdmissionFixture {
+    Tunnel::AdmissionController ac;
+
+    AdmissionFixture()
+    {
+        Tunnel::AdmissionController::Limits limits;
+        limits.maxParticipating = 100;
+        ac.setLimits(limits);
+    }
+
+    uint32_t count(uint32_t participating, Reply reply, uint32_t trials)
+    {
+        uint32_t n = 0;
+        for(uint32_t i = 0; i < trials; i++)
+            if(ac.admit(participating) == reply)
+                n++;
+
+        return n;
+    }
+};
+
+BOOST_FIXTURE_TEST_CASE(ParticipatingCap, AdmissionFixture)
+{
+    BOOST_CHECK(ac.admit(0) == Reply::SUCCESS);
+    BOOST_CHECK(ac.admit(100) == Reply::TRANSIENT_OVERLOAD);
+    BOOST_CHECK(ac.admit(1000) == Reply::TRANSIENT_OVERLOAD);
+
+    Tunnel::AdmissionController::Stats s = ac.getStats();
+    BOOST_CHECK_EQUAL(s.accepted, 1);
+    BOOST_CHECK_EQUAL(s.overload, 2);
+}
+
+BOOST_FIXTURE_TEST_CASE(QueueLatency, AdmissionFixture)
+{
+    const uint32_t maxWait = ac.getLimits().maxQueueWait;
+
+    ac.update(0, maxWait);
+    BOOST_CHECK(ac.admit(10) == Reply::SUCCESS);
+
+    ac.update(0, maxWait + 1);
+    BOOST_CHECK(ac.admit(10) == Reply::TRANSIENT_OVERLOAD);
+}
+
+BOOST_FIXTURE_TEST_CASE(Bandwidth, AdmissionFixture)
+{
+    Tunnel::AdmissionController::Limits limits = ac.getLimits();
+    limits.bandwidth = 1000;
+    ac.setLimits(limits);
+
+    // Ten tunnels of 90 B/s each, an eleventh still fits
+    ac.update(900, 0);
+    BOOST_CHECK(ac.admit(10) == Reply::SUCCESS);
+
+    ac.update(950, 0);
+    BOOST_CHECK(ac.admit(10) == Reply::BANDWIDTH);
+    BOOST_CHECK_EQUAL(ac.getStats().bandwidth, 1);
+
+    // No limit
+    limits.bandwidth = 0;
+    ac.setLimits(limits);
+    BOOST_CHECK(ac.admit(10) == Reply::SUCCESS);
+}
+
+BOOST_FIXTURE_TEST_CASE(SoftLimit, AdmissionFixture)
+{
+    const uint32_t soft = 100 * Tunnel::AdmissionController::SOFT_LIMIT / 100;
+
+    // Up to the soft limit everything is accepted
+    BOOST_CHECK_EQUAL(count(soft, Reply::SUCCESS, 1000), 1000);
+
+    // Half way to the cap about half is rejected, just below it nearly all
+    uint32_t half = count(soft + (100 - soft) / 2, Reply::PROBABALISTIC_REJECT, 1000);
+    BOOST_CHECK(half > 350 && half < 650);
+    BOOST_CHECK_GT(count(99, Reply::PROBABALISTIC_REJECT, 1000), 850);
+
+    Tunnel::AdmissionController::Stats s = ac.getStats();
+    BOOST_CHECK_EQUAL(s.accepted + s.probabilistic, 3000);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(PoolTests)
+
+namespace {
+    typedef Tunnel::Tunnel::Direction Direction;
+    typedef Tunnel::Pool::Clock Clock;
+
+    Tunnel::TunnelPtr inbound()
+    {
+        // Zero hop tunnels need no keys
+        return std::make_shared<Tunnel::InboundTunnel>(RouterHash());
+    }
+}
+
+struct PoolFixture {
+    Tunnel::Pool pool;
+
+    PoolFixture() :
+        pool(Tunnel::Pool::Settings()) {}
+};
+
+BOOST_FIXTURE_TEST_CASE(BuildAccounting, PoolFixture)
+{
+    BOOST_CHECK_EQUAL(pool.getBuildsNeeded(Direction::INBOUND), 2);
+    BOOST_CHECK_EQUAL(pool.getBuildsNeeded(Direction::OUTBOUND), 2);
+
+    // Pending builds count as tunnels
+    pool.buildStarted(Direction::INBOUND);
+    pool.buildStarted(Direction::INBOUND);
+    BOOST_CHECK_EQUAL(pool.getBuildsNeeded(Direction::INBOUND), 0);
+    BOOST_CHECK_EQUAL(pool.getBuildsNeeded(Direction::OUTBOUND), 2);
+
+    // A failed build has to be done again
+    pool.buildFinished(Direction::INBOUND, Tunnel::TunnelPtr(), Clock::now());
+    BOOST_CHECK_EQUAL(pool.getBuildsNeeded(Direction::INBOUND), 1);
+
+    pool.buildFinished(Direction::INBOUND, inbound(), Clock::now());
+    BOOST_CHECK_EQUAL(pool.getBuildsNeeded(Direction::INBOUND), 1);
+    BOOST_CHECK_EQUAL(pool.getCount(Direction::INBOUND), 1);
+
+    // More results than builds don't leave a negative pending count
+    pool.buildFinished(Direction::INBOUND, Tunnel::TunnelPtr(), Clock::now());
+    BOOST_CHECK_EQUAL(pool.getBuildsNeeded(Direction::INBOUND), 1);
+}
+
+BOOST_FIXTURE_TEST_CASE(RebuildAhead, PoolFixture)
+{
+    const auto lifetime = std::chrono::seconds(Tunnel::Pool::LIFETIME);
+    const auto ahead = std::chrono::seconds(Tunnel::Pool::REBUILD_AHEAD);
+
+    pool.buildStarted(Direction::INBOUND);
+    pool.buildFinished(Direction::INBOUND, inbound(), Clock::now());
+    pool.buildStarted(Direction::INBOUND);
+    pool.buildFinished(Direction::INBOUND, inbound(), Clock::now() - lifetime + ahead / 2);
+
+    // The tunnel about to expire is replaced while it is still used
+    BOOST_CHECK_EQUAL(pool.getCount(Direction::INBOUND), 2);
+    BOOST_CHECK_EQUAL(pool.getBuildsNeeded(Direction::INBOUND), 1);
+    BOOST_CHECK(pool.expire().empty());
+}
+
+BOOST_FIXTURE_TEST_CASE(Expire, PoolFixture)
+{
+    // The lifetime counts from when the request was sent
+    auto t = inbound();
+    pool.buildStarted(Direction::INBOUND);
+    pool.buildFinished(Direction::INBOUND, t, Clock::now() - std::chrono::seconds(Tunnel::Pool::LIFETIME + 1));
+    pool.buildStarted(Direction::INBOUND);
+    pool.buildFinished(Direction::INBOUND, inbound(), Clock::now());
+
+    auto expired = pool.expire();
+    BOOST_REQUIRE_EQUAL(expired.size(), 1);
+    BOOST_CHECK_EQUAL(expired[0], t->getTunnelId());
+    BOOST_CHECK_EQUAL(pool.getCount(Direction::INBOUND), 1);
+
+    BOOST_CHECK_EQUAL(pool.clear().size(), 1);
+    BOOST_CHECK_EQUAL(pool.getCount(Direction::INBOUND), 0);
+}
+
+BOOST_FIXTURE_TEST_CASE(SelectRoundRobin, PoolFixture)
+{
+    BOOST_CHECK(!pool.select(Direction::INBOUND));
+
+    auto a = inbound(), b = inbound();
+    pool.buildFinished(Direction::INBOUND, a, Clock::now());
+    pool.buildFinished(Direction::INBOUND, b, Clock::now());
+
+    // Every tunnel gets its turn
+    auto first = pool.select(Direction::INBOUND);
+    auto second = pool.select(Direction::INBOUND);
+    BOOST_CHECK(first == a || first == b);
+    BOOST_CHECK(second != first);
+    BOOST_CHECK(pool.select(Direction::INBOUND) == first);
+
+    // The directions are kept apart
+    BOOST_CHECK(!pool.select(Direction::OUTBOUND));
+
+    auto o = std::make_shared<Tunnel::OutboundTunnel>(std::vector<RouterIdentity>(), RouterHash(), 0);
+    pool.buildFinished(Direction::OUTBOUND, o, Clock::now());
+    BOOST_CHECK(pool.select(Direction::OUTBOUND) == o);
+}
+
+BOOST_FIXTURE_TEST_CASE(SelectLasting, PoolFixture)
+{
+    const auto lifetime = std::chrono::seconds(Tunnel::Pool::LIFETIME);
+
+    auto old = inbound(), fresh = inbound();
+    pool.buildFinished(Direction::INBOUND, old, Clock::now() - lifetime + std::chrono::seconds(30));
+    pool.buildFinished(Direction::INBOUND, fresh, Clock::now());
+
+    // Tunnels which expire before they are done with are skipped
+    for(int i = 0; i < 4; i++)
+        BOOST_CHECK(pool.select(Direction::INBOUND, std::chrono::seconds(60)) == fresh);
+
+    BOOST_CHECK(!pool.select(Direction::INBOUND, lifetime));
+
+    // Without a margin both are used
+    auto first = pool.select(Direction::INBOUND);
+    BOOST_CHECK(pool.select(Direction::INBOUND) != first);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
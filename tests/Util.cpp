@@ -0,0 +1,233 @@
+#include <i2pcpp/util/Metrics.h>
+#include <i2pcpp/util/Random.h>
+#include <i2pcpp/util/TokenBucket.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+using namespace i2pcpp;
+
+BOOST_AUTO_TEST_SUITE(RandomTests)
+
+BOOST_AUTO_TEST_CASE(FillsBuffer)
+{
+    std::vector<unsigned char> a(1024), b(1024);
+    Random::randomize(a.data(), a.size());
+    Random::randomize(b.data(), b.size());
+
+    BOOST_CHECK(std::any_of(a.cbegin(), a.cend(), [](unsigned char c) { return c != 0; }));
+    BOOST_CHECK(a != b);
+}
+
+BOOST_AUTO_TEST_CASE(OddSizes)
+{
+    // Requests which straddle the internal buffer
+    std::vector<unsigned char> buf(700);
+    for(size_t len: { 1, 31, 33, 479, 481, 700 }) {
+        std::fill(buf.begin(), buf.end(), 0);
+        Random::randomize(buf.data(), len);
+
+        BOOST_CHECK(std::all_of(buf.cbegin() + len, buf.cend(), [](unsigned char c) { return c == 0; }));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(Reseed)
+{
+    std::vector<unsigned char> a(64), b(64);
+    Random::randomize(a.data(), a.size());
+    Random::reseed();
+    Random::randomize(b.data(), b.size());
+    BOOST_CHECK(a != b);
+
+    // Past the byte limit the generator reseeds by itself
+    std::vector<unsigned char> big(Random::RESEED_BYTES + 1024);
+    Random::randomize(big.data(), big.size());
+    BOOST_CHECK(std::any_of(big.cend() - 1024, big.cend(), [](unsigned char c) { return c != 0; }));
+}
+
+BOOST_AUTO_TEST_CASE(PerThread)
+{
+    // Every thread seeds its own generator
+    std::vector<uint64_t> values(4);
+    std::vector<std::thread> threads;
+    for(size_t i = 0; i < values.size(); i++)
+        threads.emplace_back([&values, i]() { values[i] = Random::get<uint64_t>(); });
+
+    for(auto& t: threads)
+        t.join();
+
+    std::sort(values.begin(), values.end());
+    BOOST_CHECK(std::adjacent_find(values.cbegin(), values.cend()) == values.cend());
+}
+
+BOOST_AUTO_TEST_CASE(BotanRNG)
+{
+    std::vector<unsigned char> buf(32);
+    Random::getRNG().randomize(buf.data(), buf.size());
+    BOOST_CHECK(std::any_of(buf.cbegin(), buf.cend(), [](unsigned char c) { return c != 0; }));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(MetricsTests)
+
+BOOST_AUTO_TEST_CASE(BucketRoundTrip)
+{
+    typedef Metrics::Histogram H;
+
+    // Every bucket starts right after the one before it ends
+    uint64_t lower = 0;
+    for(size_t i = 0; i < H::BUCKET_COUNT; i++) {
+        const uint64_t upper = H::getUpperBound(i);
+        BOOST_REQUIRE_GE(upper, lower);
+        BOOST_CHECK_EQUAL(H::getBucket(lower), i);
+        BOOST_CHECK_EQUAL(H::getBucket(upper), i);
+
+        if(upper == UINT64_MAX) {
+            BOOST_CHECK_EQUAL(i, H::BUCKET_COUNT - 1);
+            break;
+        }
+
+        lower = upper + 1;
+    }
+
+    BOOST_CHECK_EQUAL(H::getBucket(UINT64_MAX), H::BUCKET_COUNT - 1);
+}
+
+BOOST_AUTO_TEST_CASE(BucketPrecision)
+{
+    typedef Metrics::Histogram H;
+
+    for(uint64_t v: { 0ULL, 7ULL, 8ULL, 9ULL, 1000ULL, 123456789ULL, 1ULL << 40, (1ULL << 63) + 12345 }) {
+        const uint64_t upper = H::getUpperBound(H::getBucket(v));
+        BOOST_CHECK_GE(upper, v);
+        BOOST_CHECK_LE(upper - v, v / H::SUB_BUCKETS);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(Summary)
+{
+    Metrics::Histogram h;
+    for(uint64_t v = 1; v <= 100; v++)
+        h.record(v);
+
+    Metrics::Histogram::Summary s = h.summarize();
+    BOOST_CHECK_EQUAL(s.count, 100);
+    BOOST_CHECK_EQUAL(s.sum, 5050);
+    BOOST_CHECK_EQUAL(s.max, 100);
+    BOOST_CHECK(s.p50 >= 50 && s.p50 <= 50 + 50 / Metrics::Histogram::SUB_BUCKETS);
+    BOOST_CHECK(s.p90 >= 90 && s.p90 <= 90 + 90 / Metrics::Histogram::SUB_BUCKETS);
+    BOOST_CHECK(s.p99 >= 99 && s.p99 <= 100);
+
+    h.summarize(true);
+    BOOST_CHECK_EQUAL(h.summarize().count, 0);
+}
+
+BOOST_AUTO_TEST_CASE(CounterAcrossThreads)
+{
+    Metrics::Counter c;
+    std::vector<std::thread> threads;
+    for(int i = 0; i < 4; i++)
+        threads.emplace_back([&c]() {
+            for(int j = 0; j < 1000; j++)
+                c.add();
+        });
+
+    for(auto& t: threads)
+        t.join();
+
+    BOOST_CHECK_EQUAL(c.value(), 4000);
+    BOOST_CHECK_EQUAL(c.reset(), 4000);
+    BOOST_CHECK_EQUAL(c.value(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(Registry)
+{
+    Metrics::Counter &c = Metrics::counter("test.counter");
+    BOOST_CHECK(&c == &Metrics::counter("test.counter"));
+
+    c.add(5);
+    Metrics::histogram("test.histogram").record(42);
+
+    Metrics::Snapshot s = Metrics::snapshot(true);
+    BOOST_CHECK_EQUAL(s.counters["test.counter"], 5);
+    BOOST_CHECK_EQUAL(s.histograms["test.histogram"].count, 1);
+    BOOST_CHECK_EQUAL(c.value(), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(TokenBucketTests)
+
+BOOST_AUTO_TEST_CASE(Unlimited)
+{
+    TokenBucket tb;
+    BOOST_CHECK(tb.consume(UINT32_MAX));
+    BOOST_CHECK(tb.available(UINT32_MAX));
+    tb.charge(UINT32_MAX);
+    BOOST_CHECK(tb.consume(1));
+}
+
+BOOST_AUTO_TEST_CASE(ConsumeAndAvailable)
+{
+    // Slow enough that nothing noticeable refills during the test
+    TokenBucket tb(10, 1000);
+
+    BOOST_CHECK(tb.available(1000));
+    BOOST_CHECK(!tb.available(1001));
+    BOOST_CHECK(tb.consume(600));
+
+    // A failed consume() takes nothing
+    BOOST_CHECK(!tb.consume(500));
+    BOOST_CHECK(tb.available(400));
+    BOOST_CHECK(tb.consume(400));
+    BOOST_CHECK(!tb.available(1));
+}
+
+BOOST_AUTO_TEST_CASE(Charge)
+{
+    TokenBucket tb(1000, 1000);
+    BOOST_CHECK(tb.consume(1000));
+
+    // The debt is paid back before tokens are available again
+    tb.charge(500);
+    std::this_thread::sleep_for(std::chrono::milliseconds(150));
+    BOOST_CHECK(!tb.available(1));
+
+    // Debt is limited to one bucket
+    TokenBucket small(1000, 100);
+    small.charge(5000);
+    std::this_thread::sleep_for(std::chrono::milliseconds(150));
+    BOOST_CHECK(small.consume(40));
+}
+
+BOOST_AUTO_TEST_CASE(Refill)
+{
+    TokenBucket tb(1000, 100);
+    BOOST_CHECK(tb.consume(100));
+    BOOST_CHECK(!tb.consume(50));
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(150));
+    BOOST_CHECK(tb.consume(100));
+    BOOST_CHECK_EQUAL(tb.getRate(), 1000);
+}
+
+BOOST_AUTO_TEST_CASE(BurstCap)
+{
+    TokenBucket tb(1000000, 1000);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+    // Twenty thousand tokens were due, the bucket holds a thousand
+    BOOST_CHECK(!tb.available(1001));
+    BOOST_CHECK(tb.consume(1000));
+
+    // The burst defaults to one second worth of tokens
+    TokenBucket dflt(500);
+    BOOST_CHECK(dflt.available(500));
+    BOOST_CHECK(!dflt.available(501));
+}
+
+BOOST_AUTO_TEST_SUITE_END()